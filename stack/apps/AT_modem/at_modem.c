@@ -70,6 +70,38 @@
 #define MAX_AT_RESPONSE_SIZE    512
 #define MAX_AT_COMMAND_SIZE     512
 
+// The binary mode (entered using AT+BIN) uses the frame header of the serial modem interface:
+// sync byte, version, counter, type, payload length and the CRC16 of the payload (big endian)
+#define BIN_FRAME_SYNC_BYTE     0xC0
+#define BIN_FRAME_VERSION       0x00
+#define BIN_FRAME_HEADER_SIZE   7
+#define BIN_FRAME_COUNTER       2
+#define BIN_FRAME_TYPE          3
+#define BIN_FRAME_SIZE          4
+#define BIN_FRAME_CRC1          5
+#define BIN_FRAME_CRC2          6
+
+typedef enum
+{
+    BIN_FRAME_TYPE_TX = 0x01,       // host -> modem: frame content (without length byte and CRC) to queue for transmission
+    BIN_FRAME_TYPE_EXIT = 0x02,     // host -> modem: return to the AT command mode
+    BIN_FRAME_TYPE_RX = 0x81,       // modem -> host: RSSI (int16), timestamp (uint32), CRC valid (uint8), frame
+    BIN_FRAME_TYPE_TX_DONE = 0x82,  // modem -> host: timestamp (uint32), free TX queue slots (uint8)
+    BIN_FRAME_TYPE_ERROR = 0x83,    // modem -> host: error code (uint8)
+} bin_frame_type_t;
+
+typedef enum
+{
+    BIN_ERROR_CRC = 0x01,
+    BIN_ERROR_TX_QUEUE_FULL = 0x02,
+    BIN_ERROR_FRAME_SIZE = 0x03,
+    BIN_ERROR_UNKNOWN_TYPE = 0x04,
+    BIN_ERROR_RADIO_BUSY = 0x05,
+} bin_error_t;
+
+// number of frames which can be queued in binary mode to be transmitted back-to-back
+#define TX_QUEUE_SIZE           8
+
 // modulation settings
 
 // low rate
@@ -150,6 +182,12 @@ uint16_t default_syncword = 0x192F;
 static frame_t tx_frame;
 static frame_t rx_frame;
 
+static bool binary_mode = false;
+static uint8_t bin_frame_up_counter = 0;
+static frame_t tx_queue[TX_QUEUE_SIZE];
+static uint8_t tx_queue_head = 0;
+static uint8_t tx_queue_count = 0;
+
 static uint16_t counter = 0;
 static uint16_t missed_packets_counter = 0;
 static uint16_t received_packets_counter = 0;
@@ -160,6 +198,8 @@ bool refill_flag = 0;
 
 static char cmd_tx_continuously(char *value);
 static char cmd_tx(char *value);
+static char cmd_start_rx(char *value);
+static void transmit_next_queued_frame();
 
 // TODO code duplication with noise_test, refactor later
 static void channel_id_to_string(channel_id_t* channel, char* str, size_t len) {
@@ -198,6 +238,73 @@ static uint16_t encode_packet(uint8_t *data, uint16_t nbytes)
     return encoded_len;
 }
 
+// adds the length byte and CRC to the frame content stored from data[1] on, and encodes the frame
+static void finalize_tx_frame(frame_t* frame, uint8_t content_length)
+{
+    frame->hw_radio_packet.length = content_length;
+
+#ifndef HAL_RADIO_USE_HW_CRC
+    /* the CRC calculation shall include all the bytes of the frame including the byte for the length*/
+    uint16_t crc = __builtin_bswap16(crc_calculate(frame->hw_radio_packet.data, frame->hw_radio_packet.length + 1 - 2));
+    memcpy(frame->hw_radio_packet.data + 1 + content_length, &crc, 2);
+    frame->hw_radio_packet.length += sizeof(uint16_t); /* CRC is an uint16_t */
+#endif
+
+    frame->hw_radio_packet.data[0] = frame->hw_radio_packet.length;
+    frame->hw_radio_packet.length +=1;
+
+    DPRINT_DATA(frame->hw_radio_packet.data, frame->hw_radio_packet.length);
+
+    // Encode the packet if not supported by xcvr
+    frame->hw_radio_packet.length = encode_packet(frame->hw_radio_packet.data,
+                                                  frame->hw_radio_packet.length);
+
+    DPRINT("Encoded frame len<%i>", frame->hw_radio_packet.length);
+    DPRINT_DATA(frame->hw_radio_packet.data, frame->hw_radio_packet.length);
+}
+
+static void send_bin_frame(bin_frame_type_t type, uint8_t* payload, uint8_t length)
+{
+    uint8_t header[BIN_FRAME_HEADER_SIZE];
+    uint16_t crc = crc_calculate(payload, length);
+
+    header[0] = BIN_FRAME_SYNC_BYTE;
+    header[1] = BIN_FRAME_VERSION;
+    header[BIN_FRAME_COUNTER] = bin_frame_up_counter++;
+    header[BIN_FRAME_TYPE] = type;
+    header[BIN_FRAME_SIZE] = length;
+    header[BIN_FRAME_CRC1] = (crc >> 8) & 0x00FF;
+    header[BIN_FRAME_CRC2] = crc & 0x00FF;
+
+    console_print_bytes(header, BIN_FRAME_HEADER_SIZE);
+    console_print_bytes(payload, length);
+}
+
+static void send_bin_error(bin_error_t error)
+{
+    uint8_t code = error;
+    send_bin_frame(BIN_FRAME_TYPE_ERROR, &code, 1);
+}
+
+static void send_bin_rx_frame(hw_radio_packet_t* hw_radio_packet, bool crc_valid)
+{
+    // the received frame is truncated if it does not fit, the length byte of the frame is kept
+    uint8_t payload[UINT8_MAX];
+    uint8_t frame_length = MIN(hw_radio_packet->length, sizeof(payload) - 7);
+    uint16_t rssi = hw_radio_packet->rx_meta.rssi;
+    uint32_t timestamp = hw_radio_packet->rx_meta.timestamp;
+
+    payload[0] = rssi >> 8;
+    payload[1] = rssi & 0xFF;
+    payload[2] = timestamp >> 24;
+    payload[3] = timestamp >> 16;
+    payload[4] = timestamp >> 8;
+    payload[5] = timestamp & 0xFF;
+    payload[6] = crc_valid;
+    memcpy(payload + 7, hw_radio_packet->data, frame_length);
+    send_bin_frame(BIN_FRAME_TYPE_RX, payload, 7 + frame_length);
+}
+
 static hw_radio_packet_t* alloc_new_packet(uint16_t length) {
     return &rx_frame.hw_radio_packet;
 }
@@ -222,19 +329,24 @@ static void packet_received(hw_radio_packet_t* hw_radio_packet)
     hw_radio_packet->length = hw_radio_packet->data[0] + 1;
     DPRINT_DATA(hw_radio_packet->data, hw_radio_packet->length);
 
+    bool crc_valid = true;
     if (hw_radio_packet->rx_meta.crc_status == HW_CRC_UNAVAILABLE)
     {
         uint16_t crc;
         crc = __builtin_bswap16(crc_calculate(hw_radio_packet->data, hw_radio_packet->length - 2));
-
-        if(memcmp(&crc, hw_radio_packet->data + hw_radio_packet->length - 2, 2) != 0)
-        {
-            DPRINT("CRC invalid");
-            missed_packets_counter++;
-            return;
-        }
+        crc_valid = (memcmp(&crc, hw_radio_packet->data + hw_radio_packet->length - 2, 2) == 0);
     }
     else if (hw_radio_packet->rx_meta.crc_status == HW_CRC_INVALID)
+        crc_valid = false;
+
+    // in binary mode frames are streamed to the host as is, also the ones with an invalid CRC
+    if (binary_mode)
+    {
+        send_bin_rx_frame(hw_radio_packet, crc_valid);
+        return;
+    }
+
+    if (!crc_valid)
     {
         DPRINT("CRC invalid");
         missed_packets_counter++;
@@ -331,6 +443,17 @@ static void packet_transmitted(timer_tick_t timestamp)
 
     state = STATE_IDLE;
 
+    if (binary_mode && tx_queue_count > 0)
+    {
+        tx_queue_head = (tx_queue_head + 1) % TX_QUEUE_SIZE;
+        tx_queue_count--;
+
+        uint8_t tx_done[5] = { timestamp >> 24, timestamp >> 16, timestamp >> 8, timestamp & 0xFF, TX_QUEUE_SIZE - tx_queue_count };
+        send_bin_frame(BIN_FRAME_TYPE_TX_DONE, tx_done, sizeof(tx_done));
+        sched_post_task(&transmit_next_queued_frame);
+        return;
+    }
+
     /* TODO Repeat ?
     timer_tick_t delay;
     if(tx_packet_delay_s == 0)
@@ -387,8 +510,111 @@ answer:
     fifo_clear(&uart_rx_fifo);
 }
 
+static void transmit_next_queued_frame()
+{
+    if (state == STATE_TX)
+        return; // continues when the current frame is transmitted
+
+    if (tx_queue_count == 0)
+    {
+        // return to RX so received frames keep being streamed
+        cmd_start_rx(NULL);
+        return;
+    }
+
+    state = STATE_TX;
+    frame_t* frame = &tx_queue[tx_queue_head];
+    if (hw_radio_send_payload(frame->hw_radio_packet.data, frame->hw_radio_packet.length) == -ENOTSUP) {
+        DPRINT("Cannot send: radio is still transmitting");
+        state = STATE_IDLE;
+        tx_queue_head = (tx_queue_head + 1) % TX_QUEUE_SIZE;
+        tx_queue_count--;
+        send_bin_error(BIN_ERROR_RADIO_BUSY);
+        sched_post_task(&transmit_next_queued_frame);
+    }
+}
+
+static void process_bin_frame(uint8_t type, uint8_t* payload, uint8_t length)
+{
+    switch (type)
+    {
+        case BIN_FRAME_TYPE_TX:
+        {
+            if (tx_queue_count == TX_QUEUE_SIZE)
+            {
+                send_bin_error(BIN_ERROR_TX_QUEUE_FULL);
+                return;
+            }
+
+            uint16_t frame_length = 1 + length + 2; // length byte and CRC
+            if (current_channel_id.channel_header.ch_coding == PHY_CODING_FEC_PN9)
+                frame_length = fec_calculated_decoded_length(frame_length);
+
+            if (frame_length > sizeof(tx_queue[0].__data))
+            {
+                send_bin_error(BIN_ERROR_FRAME_SIZE);
+                return;
+            }
+
+            frame_t* frame = &tx_queue[(tx_queue_head + tx_queue_count) % TX_QUEUE_SIZE];
+            memcpy(frame->hw_radio_packet.data + 1, payload, length);
+            finalize_tx_frame(frame, length);
+            tx_queue_count++;
+            sched_post_task(&transmit_next_queued_frame);
+            break;
+        }
+        case BIN_FRAME_TYPE_EXIT:
+            binary_mode = false;
+            console_print("\r\nOK\r\n");
+            break;
+        default:
+            send_bin_error(BIN_ERROR_UNKNOWN_TYPE);
+    }
+}
+
+static void process_bin_rx_fifo()
+{
+    uint8_t header[BIN_FRAME_HEADER_SIZE];
+    uint8_t payload[UINT8_MAX];
+
+    while (binary_mode && fifo_get_size(&uart_rx_fifo) >= BIN_FRAME_HEADER_SIZE)
+    {
+        fifo_peek(&uart_rx_fifo, header, 0, BIN_FRAME_HEADER_SIZE);
+        if (header[0] != BIN_FRAME_SYNC_BYTE || header[1] != BIN_FRAME_VERSION)
+        {
+            fifo_skip(&uart_rx_fifo, 1); // resync on the next sync byte
+            continue;
+        }
+
+        if (fifo_get_size(&uart_rx_fifo) < BIN_FRAME_HEADER_SIZE + header[BIN_FRAME_SIZE])
+            return; // wait for the rest of the frame
+
+        fifo_skip(&uart_rx_fifo, BIN_FRAME_HEADER_SIZE);
+        fifo_pop(&uart_rx_fifo, payload, header[BIN_FRAME_SIZE]);
+
+        uint16_t crc = crc_calculate(payload, header[BIN_FRAME_SIZE]);
+        if (header[BIN_FRAME_CRC1] != ((crc >> 8) & 0x00FF) || header[BIN_FRAME_CRC2] != (crc & 0x00FF))
+        {
+            send_bin_error(BIN_ERROR_CRC);
+            continue;
+        }
+
+        process_bin_frame(header[BIN_FRAME_TYPE], payload, header[BIN_FRAME_SIZE]);
+    }
+}
+
 static void uart_rx_cb(uint8_t data) {
 
+    if (binary_mode)
+    {
+        // no line editing nor echo in binary mode
+        if (fifo_put(&uart_rx_fifo, &data, 1) == ESIZE)
+            fifo_clear(&uart_rx_fifo);
+
+        sched_post_task(&process_bin_rx_fifo);
+        return;
+    }
+
     if (data == '\b') // back key
     {
         fifo_remove_last_byte(&uart_rx_fifo);
@@ -940,30 +1166,12 @@ static char cmd_tx(char *value)
 
     state = STATE_TX;
 
-    tx_frame.hw_radio_packet.length = sizeof(id) + sizeof(counter) + strlen(value);
     memcpy(tx_frame.hw_radio_packet.data + 1, &id, sizeof(id));
     memcpy(tx_frame.hw_radio_packet.data + 1 + sizeof(id), &counter, sizeof(counter));
     memcpy(tx_frame.hw_radio_packet.data + 1 + sizeof(id) + sizeof(counter), value, strlen(value));
 
-#ifndef HAL_RADIO_USE_HW_CRC
-    /* the CRC calculation shall include all the bytes of the frame including the byte for the length*/
-    uint16_t crc = __builtin_bswap16(crc_calculate(tx_frame.hw_radio_packet.data, tx_frame.hw_radio_packet.length + 1 - 2));
-    memcpy(tx_frame.hw_radio_packet.data + 1 + sizeof(id) + sizeof(counter) + strlen(value), &crc, 2);
-    tx_frame.hw_radio_packet.length += sizeof(uint16_t); /* CRC is an uint16_t */
-#endif
-
-    tx_frame.hw_radio_packet.data[0] = tx_frame.hw_radio_packet.length;
-    tx_frame.hw_radio_packet.length +=1;
-
     DPRINT("Frame <%i>", counter);
-    DPRINT_DATA(tx_frame.hw_radio_packet.data, tx_frame.hw_radio_packet.length);
-
-    // Encode the packet if not supported by xcvr
-    tx_frame.hw_radio_packet.length = encode_packet(tx_frame.hw_radio_packet.data,
-                                                    tx_frame.hw_radio_packet.length);
-
-    DPRINT("Encoded frame len<%i>", tx_frame.hw_radio_packet.length);
-    DPRINT_DATA(tx_frame.hw_radio_packet.data, tx_frame.hw_radio_packet.length);
+    finalize_tx_frame(&tx_frame, sizeof(id) + sizeof(counter) + strlen(value));
 
     if(refill_flag)
         hw_radio_enable_refill(true);
@@ -983,6 +1191,19 @@ static char cmd_tx_continuously(char *value)
     return (cmd_tx(value));
 }
 
+static char cmd_binary_mode(char *value)
+{
+    // the OK response is still sent as text, all following data is framed
+    tx_queue_head = 0;
+    tx_queue_count = 0;
+    fifo_clear(&uart_rx_fifo);
+    binary_mode = true;
+    if (state != STATE_TX)
+        cmd_start_rx(NULL);
+
+    return AT_OK;
+}
+
 static uint32_t get_parameter(netopt_t opt, size_t maxlen)
 {
     uint32_t value = 0x00000000;
@@ -1132,6 +1353,7 @@ static char cmd_print_help(char *value);
     { "+TX", cmd_tx, NULL, "<%d or string>","transmit packet over phy"},
     { "+TXC", cmd_tx_continuously, NULL, "<%d or string>", "transmit continuously same packet over phy"},
     { "+RX", cmd_start_rx, NULL, "","start RX"},
+    { "+BIN", cmd_binary_mode, NULL, "","enter binary framed mode"},
 
     { "+STATUS", cmd_print_status, cmd_print_status, "","print status"},
     { "+HELP", cmd_print_help, cmd_print_help, "","this list of commands"},
@@ -1244,6 +1466,8 @@ void bootstrap() {
     console_set_rx_interrupt_callback(&uart_rx_cb);
 
     sched_register_task(&process_uart_rx_fifo);
+    sched_register_task(&process_bin_rx_fifo);
+    sched_register_task(&transmit_next_queued_frame);
 
     // put in RX mode by default
     cmd_start_rx(NULL);
@@ -52,6 +52,7 @@
 
 #ifdef USE_HTS221
   static i2c_handle_t* hts221_handle;
+  static HTS221_Calibration_st hts221_calibration;
 #endif
 
 uint8_t alp_command[128];
@@ -84,7 +85,7 @@ void execute_sensor_measurement()
 
 #if defined USE_HTS221
   i2c_acquire(hts221_handle);
-  HTS221_Get_Temperature(hts221_handle, &temperature);
+  HTS221_Get_CalibratedTemperature(hts221_handle, &hts221_calibration, &temperature);
   i2c_release(hts221_handle);
 #endif
 
@@ -149,6 +150,7 @@ void bootstrap()
     HTS221_Set_BduMode(hts221_handle, HTS221_ENABLE);
     HTS221_Set_Odr(hts221_handle, HTS221_ODR_7HZ);
     HTS221_Activate(hts221_handle);
+    HTS221_Get_Calibration(hts221_handle, &hts221_calibration);
     i2c_release(hts221_handle);
 #endif
 
@@ -60,6 +60,7 @@ NOTE:   String length must be evenly divisible by 16byte (str_len % 16 == 0)
 #include <string.h> // CBC mode, for memset
 #include "stdbool.h"
 #include "aes.h"
+#include "framework_defs.h"
 
 #ifdef HAL_SUPPORT_HW_AES
 #include "hwaes.h"
@@ -88,11 +89,12 @@ NOTE:   String length must be evenly divisible by 16byte (str_len % 16 == 0)
 /* Private variables:                                                        */
 /*****************************************************************************/
 // state - array holding the intermediate results during decryption.
+// The state and the round keys are passed to the cipher functions so the key schedules of the public functions
+// below are independent.
 typedef uint8_t state_t[4][4];
-static state_t *state;
 
-// The array that stores the round keys.
-static uint8_t RoundKey[176];
+// The round keys of the key set using AES128_init().
+static aes128_key_schedule_t default_key_schedule;
 
 // The array that stores the 128 bits key
 static uint8_t AES128_key[16];
@@ -100,6 +102,16 @@ static uint8_t AES128_key[16];
 // The Key input to the AES Program
 static const uint8_t *Key;
 
+#if defined(CTR) && CTR && FRAMEWORK_AES_KEYSTREAM_CACHE_BLOCKS > 0
+// The keystream of block_count counter blocks starting at ctr_blk, of which the first computed_count are available
+static struct {
+    uint8_t ctr_blk[KEYLEN];
+    uint16_t block_count;
+    uint16_t computed_count;
+    uint8_t blocks[FRAMEWORK_AES_KEYSTREAM_CACHE_BLOCKS][KEYLEN];
+} keystream;
+#endif
+
 #if defined(CBC) && CBC
     // Initial Vector used only for CBC mode
     static uint8_t *Iv;
@@ -182,7 +194,7 @@ static uint8_t getSBoxInvert(uint8_t num)
 }
 
 // This function produces Nb(Nr+1) round keys. The round keys are used in each round to decrypt the states.
-static void KeyExpansion(void)
+static void KeyExpansion(uint8_t* RoundKey, const uint8_t* key)
 {
     uint32_t i, j, k;
     uint8_t tempa[4]; // Used for the column/row operations
@@ -190,10 +202,10 @@ static void KeyExpansion(void)
     // The first round key is the key itself.
     for (i = 0; i < Nk; ++i)
     {
-        RoundKey[(i * 4) + 0] = Key[(i * 4) + 0];
-        RoundKey[(i * 4) + 1] = Key[(i * 4) + 1];
-        RoundKey[(i * 4) + 2] = Key[(i * 4) + 2];
-        RoundKey[(i * 4) + 3] = Key[(i * 4) + 3];
+        RoundKey[(i * 4) + 0] = key[(i * 4) + 0];
+        RoundKey[(i * 4) + 1] = key[(i * 4) + 1];
+        RoundKey[(i * 4) + 2] = key[(i * 4) + 2];
+        RoundKey[(i * 4) + 3] = key[(i * 4) + 3];
     }
 
     // All other round keys are found from the previous round keys.
@@ -249,7 +261,7 @@ static void KeyExpansion(void)
 
 // This function adds the round key to state.
 // The round key is added to the state by an XOR function.
-static void AddRoundKey(uint8_t round)
+static void AddRoundKey(state_t* state, const uint8_t* RoundKey, uint8_t round)
 {
     uint8_t i, j;
 
@@ -264,7 +276,7 @@ static void AddRoundKey(uint8_t round)
 
 // The SubBytes Function Substitutes the values in the
 // state matrix with values in an S-box.
-static void SubBytes(void)
+static void SubBytes(state_t* state)
 {
     uint8_t i, j;
 
@@ -280,7 +292,7 @@ static void SubBytes(void)
 // The ShiftRows() function shifts the rows in the state to the left.
 // Each row is shifted with different offset.
 // Offset = Row number. So the first row is not shifted.
-static void ShiftRows(void)
+static void ShiftRows(state_t* state)
 {
     uint8_t temp;
 
@@ -314,7 +326,7 @@ static uint8_t xtime(uint8_t x)
 }
 
 // MixColumns function mixes the columns of the state matrix
-static void MixColumns(void)
+static void MixColumns(state_t* state)
 {
     uint8_t i;
     uint8_t Tmp, Tm, t;
@@ -353,7 +365,7 @@ static uint8_t Multiply(uint8_t x, uint8_t y)
 // MixColumns function mixes the columns of the state matrix.
 // The method used to multiply may be difficult to understand for the inexperienced.
 // Please use the references to gain more information.
-static void InvMixColumns(void)
+static void InvMixColumns(state_t* state)
 {
     int i;
     uint8_t a, b, c, d;
@@ -375,7 +387,7 @@ static void InvMixColumns(void)
 
 // The SubBytes Function Substitutes the values in the
 // state matrix with values in an S-box.
-static void InvSubBytes(void)
+static void InvSubBytes(state_t* state)
 {
     uint8_t i, j;
 
@@ -388,7 +400,7 @@ static void InvSubBytes(void)
     }
 }
 
-static void InvShiftRows(void)
+static void InvShiftRows(state_t* state)
 {
     uint8_t temp;
 
@@ -418,54 +430,54 @@ static void InvShiftRows(void)
 
 
 // Cipher is the main function that encrypts the PlainText.
-static void Cipher(void)
+static void Cipher(state_t* state, const uint8_t* RoundKey)
 {
     uint8_t round = 0;
 
     // Add the First round key to the state before starting the rounds.
-    AddRoundKey(0);
+    AddRoundKey(state, RoundKey, 0);
 
     // There will be Nr rounds.
     // The first Nr-1 rounds are identical.
     // These Nr-1 rounds are executed in the loop below.
     for (round = 1; round < Nr; ++round)
     {
-      SubBytes();
-      ShiftRows();
-      MixColumns();
-      AddRoundKey(round);
+      SubBytes(state);
+      ShiftRows(state);
+      MixColumns(state);
+      AddRoundKey(state, RoundKey, round);
     }
 
     // The last round is given below.
     // The MixColumns function is not here in the last round.
-    SubBytes();
-    ShiftRows();
-    AddRoundKey(Nr);
+    SubBytes(state);
+    ShiftRows(state);
+    AddRoundKey(state, RoundKey, Nr);
 }
 
-static void InvCipher(void)
+static void InvCipher(state_t* state, const uint8_t* RoundKey)
 {
     uint8_t round = 0;
 
     // Add the First round key to the state before starting the rounds.
-    AddRoundKey(Nr);
+    AddRoundKey(state, RoundKey, Nr);
 
     // There will be Nr rounds.
     // The first Nr-1 rounds are identical.
     // These Nr-1 rounds are executed in the loop below.
     for (round = Nr-1; round > 0; round--)
     {
-      InvShiftRows();
-      InvSubBytes();
-      AddRoundKey(round);
-      InvMixColumns();
+      InvShiftRows(state);
+      InvSubBytes(state);
+      AddRoundKey(state, RoundKey, round);
+      InvMixColumns(state);
     }
 
     // The last round is given below.
     // The MixColumns function is not here in the last round.
-    InvShiftRows();
-    InvSubBytes();
-    AddRoundKey(0);
+    InvShiftRows(state);
+    InvSubBytes(state);
+    AddRoundKey(state, RoundKey, 0);
 }
 
 static void BlockCopy(uint8_t *output, uint8_t *input)
@@ -486,9 +498,17 @@ static void BlockCopy(uint8_t *output, uint8_t *input)
 
 void AES128_init(const uint8_t *key)
 {
+#if defined(CTR) && CTR
+    AES128_CTR_clear_keystream();
+#endif
     memcpy(AES128_key, key, KEYLEN);
     Key = AES128_key;
-    KeyExpansion();
+    KeyExpansion(default_key_schedule.round_key, Key);
+}
+
+void AES128_init_key_schedule(aes128_key_schedule_t* key_schedule, const uint8_t *key)
+{
+    KeyExpansion(key_schedule->round_key, key);
 }
 
 #if defined(ECB) && ECB
@@ -505,10 +525,9 @@ void AES128_ECB_encrypt(uint8_t *input, uint8_t *output)
 #else
     // Copy input to output, and work in-memory on output
     BlockCopy(output, input);
-    state = (state_t *)output;
 
     // The next function call encrypts the PlainText with the Key using AES algorithm.
-    Cipher();
+    Cipher((state_t *)output, default_key_schedule.round_key);
 #endif // HAL_SUPPORT_HW_AES
 }
 
@@ -523,9 +542,8 @@ void AES128_ECB_decrypt(uint8_t *input, uint8_t *output)
 #else
     // Copy input to output, and work in-memory on output
     BlockCopy(output, input);
-    state = (state_t *)output;
 
-    InvCipher();
+    InvCipher((state_t *)output, default_key_schedule.round_key);
 #endif // HAL_SUPPORT_HW_AES
 }
 
@@ -564,8 +582,7 @@ void AES128_CBC_encrypt_buffer(uint8_t *output, uint8_t *input, uint32_t length,
     {
         BlockCopy(output, input);
         XorWithIv(output);
-        state = (state_t *)output;
-        Cipher();
+        Cipher((state_t *)output, default_key_schedule.round_key);
         Iv = output;
         input += KEYLEN;
         output += KEYLEN;
@@ -576,8 +593,7 @@ void AES128_CBC_encrypt_buffer(uint8_t *output, uint8_t *input, uint32_t length,
         BlockCopy(output, input);
         memset(output + remainders, 0, KEYLEN - remainders); /* add 0-padding */
         XorWithIv(output);
-        state = (state_t *)output;
-        Cipher();
+        Cipher((state_t *)output, default_key_schedule.round_key);
     }
 #endif // HAL_SUPPORT_HW_AES
 }
@@ -599,8 +615,7 @@ void AES128_CBC_decrypt_buffer(uint8_t *output, uint8_t *input, uint32_t length,
     for(i = KEYLEN; i <= length; i += KEYLEN)
     {
         BlockCopy(output, input);
-        state = (state_t *)output;
-        InvCipher();
+        InvCipher((state_t *)output, default_key_schedule.round_key);
         XorWithIv(output);
         Iv = input;
         input += KEYLEN;
@@ -631,33 +646,34 @@ void AES128_CBC_decrypt_buffer(uint8_t *output, uint8_t *input, uint32_t length,
  * the most significant bits.
  */
 
-void AES128_CTR_encrypt(uint8_t *output, uint8_t *input, uint32_t length, uint8_t *ctr_blk)
+static void increment_ctr_blk(uint8_t *ctr_blk)
+{
+    for (uint8_t j = 0; j < KEYLEN; j++)
+    {
+        ctr_blk[j]++;
+        if (ctr_blk[j])
+            break;
+    }
+}
+
+static void CTR_encrypt(const uint8_t* RoundKey, uint8_t *output, uint8_t *input, uint32_t length, uint8_t *ctr_blk)
 {
-#ifdef HAL_SUPPORT_HW_AES
-    // Hardware AES support for CTR through the low level peripheral library EMLIB
-    hw_aes_ctr128(output, input, length, Key, ctr_blk);
-#else
     uintptr_t i, j;
     uint8_t remainders = length % KEYLEN; /* Remaining bytes in the last non-full block */
     uint8_t ctr[KEYLEN];
+    state_t* state = (state_t *)ctr;
 
     BlockCopy(ctr, ctr_blk);
-    state = (state_t *)ctr;
 
     for(i = KEYLEN; i <= length; i += KEYLEN)
     {
-        Cipher();
+        Cipher(state, RoundKey);
         BlockCopy(output, input);
         for (j = 0; j < KEYLEN; j++)
             output[j] ^= ctr[j];
 
         /* Increment block counter */
-        for (j = 0; j < KEYLEN; j++)
-        {
-            ctr_blk[j]++;
-            if (ctr_blk[j])
-                break;
-        }
+        increment_ctr_blk(ctr_blk);
 
         input += KEYLEN;
         output += KEYLEN;
@@ -666,11 +682,98 @@ void AES128_CTR_encrypt(uint8_t *output, uint8_t *input, uint32_t length, uint8_
 
     if(remainders)
     {
-        Cipher();
+        Cipher(state, RoundKey);
         for (i=0; i < remainders; ++i)
             output[i] = input[i] ^ ctr[i];
     }
+}
+
+#if FRAMEWORK_AES_KEYSTREAM_CACHE_BLOCKS > 0
+/*
+ * The counter blocks of the cache only differ in the first byte, since the cache never exceeds 256 blocks and
+ * starts without carry. A request is served when all its counter blocks are computed already.
+ */
+static bool CTR_encrypt_from_keystream(uint8_t *output, uint8_t *input, uint32_t length, uint8_t *ctr_blk)
+{
+    if (keystream.computed_count == 0 || ctr_blk[0] < keystream.ctr_blk[0]
+        || memcmp(ctr_blk + 1, keystream.ctr_blk + 1, KEYLEN - 1) != 0)
+        return false;
+
+    uint16_t first_block = ctr_blk[0] - keystream.ctr_blk[0];
+    if (first_block + (length + KEYLEN - 1) / KEYLEN > keystream.computed_count)
+        return false;
+
+    for (uint32_t i = 0; i < length; i++)
+        output[i] = input[i] ^ keystream.blocks[first_block + i / KEYLEN][i % KEYLEN];
+
+    /* the counter is only incremented for the full blocks, as by CTR_encrypt() */
+    for (uint32_t i = 0; i < length / KEYLEN; i++)
+        increment_ctr_blk(ctr_blk);
+
+    return true;
+}
+#endif
+
+void AES128_CTR_start_keystream(const uint8_t *ctr_blk, uint16_t block_count)
+{
+#if FRAMEWORK_AES_KEYSTREAM_CACHE_BLOCKS > 0
+    BlockCopy(keystream.ctr_blk, (uint8_t *)ctr_blk);
+    keystream.computed_count = 0;
+    keystream.block_count = block_count;
+    if (keystream.block_count > FRAMEWORK_AES_KEYSTREAM_CACHE_BLOCKS)
+        keystream.block_count = FRAMEWORK_AES_KEYSTREAM_CACHE_BLOCKS;
+
+    /* avoid a carry out of the first byte, see CTR_encrypt_from_keystream() */
+    if (keystream.ctr_blk[0] + keystream.block_count > 256)
+        keystream.block_count = 256 - keystream.ctr_blk[0];
+#endif
+}
+
+bool AES128_CTR_precompute_keystream_block()
+{
+#if FRAMEWORK_AES_KEYSTREAM_CACHE_BLOCKS > 0
+    if (keystream.computed_count >= keystream.block_count)
+        return false;
+
+    /* always in software, this is done ahead of time */
+    uint8_t* block = keystream.blocks[keystream.computed_count];
+    BlockCopy(block, keystream.ctr_blk);
+    block[0] += keystream.computed_count;
+    Cipher((state_t *)block, default_key_schedule.round_key);
+    keystream.computed_count++;
+    return keystream.computed_count < keystream.block_count;
+#else
+    return false;
+#endif
+}
+
+void AES128_CTR_clear_keystream()
+{
+#if FRAMEWORK_AES_KEYSTREAM_CACHE_BLOCKS > 0
+    keystream.block_count = 0;
+    keystream.computed_count = 0;
 #endif
 }
 
+void AES128_CTR_encrypt(uint8_t *output, uint8_t *input, uint32_t length, uint8_t *ctr_blk)
+{
+#if FRAMEWORK_AES_KEYSTREAM_CACHE_BLOCKS > 0
+    if (CTR_encrypt_from_keystream(output, input, length, ctr_blk))
+        return;
+#endif
+
+#ifdef HAL_SUPPORT_HW_AES
+    // Hardware AES support for CTR through the low level peripheral library EMLIB
+    hw_aes_ctr128(output, input, length, Key, ctr_blk);
+#else
+    CTR_encrypt(default_key_schedule.round_key, output, input, length, ctr_blk);
+#endif
+}
+
+void AES128_CTR_encrypt_with_key_schedule(const aes128_key_schedule_t* key_schedule, uint8_t *output, uint8_t *input,
+                                          uint32_t length, uint8_t *ctr_blk)
+{
+    CTR_encrypt(key_schedule->round_key, output, input, length, ctr_blk);
+}
+
 #endif // #if defined(CTR) && CTR
@@ -0,0 +1,113 @@
+/*! \file bloom_filter.c
+ *
+
+ *  \copyright (C) Copyright 2016 University of Antwerp and others (http://oss-7.cosys.be)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdint.h>
+#include "debug.h"
+#include "bloom_filter.h"
+
+#define FNV_PRIME 16777619UL
+#define FNV_OFFSET_BASIS 2166136261UL
+#define GOLDEN_RATIO 0x9e3779b9UL
+
+static uint32_t fnv1a(const uint8_t* item, uint8_t item_length)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (uint8_t i = 0; i < item_length; i++) {
+        hash ^= item[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+// finalizer of MurmurHash3, spreads every input bit over all output bits
+static uint32_t mix(uint32_t hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bUL;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35UL;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/*
+ * Calls the callback for every bit position of the item, stops and returns false as soon as the callback does.
+ */
+static bool for_each_bit(uint8_t* filter, uint16_t filter_size, uint8_t hash_count, const uint8_t* item,
+    uint8_t item_length, bool (*callback)(uint8_t* filter, uint32_t bit))
+{
+    assert(filter_size > 0);
+    uint32_t bit_count = (uint32_t)filter_size * 8;
+    uint32_t hash = fnv1a(item, item_length);
+    uint32_t h1 = mix(hash) % bit_count;
+    uint32_t h2 = mix(hash ^ GOLDEN_RATIO) % bit_count;
+    if (h2 == 0)
+        h2 = 1; // make sure the positions differ
+
+    uint32_t bit = h1;
+    for (uint8_t i = 0; i < hash_count; i++) {
+        if (!callback(filter, bit))
+            return false;
+
+        bit += h2;
+        if (bit >= bit_count)
+            bit -= bit_count;
+    }
+
+    return true;
+}
+
+static bool set_bit(uint8_t* filter, uint32_t bit)
+{
+    filter[bit / 8] |= 1 << (bit % 8);
+    return true;
+}
+
+static bool is_bit_set(uint8_t* filter, uint32_t bit)
+{
+    return filter[bit / 8] & (1 << (bit % 8));
+}
+
+void bloom_filter_add(uint8_t* filter, uint16_t filter_size, uint8_t hash_count, const uint8_t* item, uint8_t item_length)
+{
+    for_each_bit(filter, filter_size, hash_count, item, item_length, &set_bit);
+}
+
+bool bloom_filter_contains(const uint8_t* filter, uint16_t filter_size, uint8_t hash_count, const uint8_t* item, uint8_t item_length)
+{
+    // is_bit_set does not modify the filter
+    return for_each_bit((uint8_t*)filter, filter_size, hash_count, item, item_length, &is_bit_set);
+}
+
+uint8_t bloom_filter_get_optimal_hash_count(uint16_t filter_size, uint16_t item_count, uint8_t max_hash_count)
+{
+    if (item_count == 0)
+        return 1;
+
+    // ln(2) ~ 693 / 1000, rounded to the nearest integer
+    uint32_t hash_count = ((uint32_t)filter_size * 8 * 693 + item_count * 500) / ((uint32_t)item_count * 1000);
+    if (hash_count < 1)
+        return 1;
+
+    if (hash_count > max_hash_count)
+        return max_hash_count;
+
+    return (uint8_t)hash_count;
+}
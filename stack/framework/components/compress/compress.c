@@ -22,22 +22,25 @@
 #include "debug.h"
 #include "compress.h"
 
-uint8_t compress_data(uint16_t value, bool ceil)
+uint8_t compress_data(uint32_t value, bool ceil)
 {
-    uint8_t mantissa;
-    uint16_t remainder;
-
-    for ( int i = 0; i < 8; i++)
+    // find the smallest exponent for which the value fits in the 5 bit mantissa,
+    // 4^exp is computed as a shift by 2*exp so no floating point is involved
+    for (uint8_t exp = 0; exp < 8; exp++)
     {
-        if (value <= (pow(4, i) * 31))
+        uint8_t shift = 2 * exp;
+        if (value <= ((uint32_t)COMPRESSED_TIME_MANTISSA_MAX << shift))
         {
-            mantissa = value / pow(4, i);
-            remainder = value % (uint16_t)(pow(4, i));
+            uint32_t mantissa = value >> shift;
+            uint32_t remainder = value & ((1UL << shift) - 1);
 
             if (ceil && remainder)
-                mantissa++;
+                mantissa++; // cannot overflow, value <= 31 * 4^exp
 
-            return (uint8_t)( i<<5 | mantissa);
+            return (uint8_t)(exp << 5 | mantissa);
         }
     }
+
+    // saturate to the largest representable value
+    return 0xFF;
 }
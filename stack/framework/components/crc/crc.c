@@ -23,29 +23,26 @@
 #include <stdint.h>
 
 #include "crc.h"
-#include "ng.h"
 
-static uint16_t NGDEF(_crc);
-#define crc NG(_crc)
-
-static void update_crc(uint8_t x)
+// the CRC is kept on the stack so the calculation is reentrant
+static uint16_t update_crc(uint16_t crc, uint8_t x)
 {
      uint16_t crc_new = (uint8_t)(crc >> 8) | (crc << 8);
      crc_new ^= x;
      crc_new ^= (uint8_t)(crc_new & 0xff) >> 4;
      crc_new ^= crc_new << 12;
      crc_new ^= (crc_new & 0xff) << 5;
-     crc = crc_new;
+     return crc_new;
 }
 
 uint16_t crc_calculate(uint8_t* data, uint8_t length)
 {
-    crc = 0xffff;
+    uint16_t crc = 0xffff;
     uint8_t i = 0;
 
     for(; i<length; i++)
     {
-        update_crc(data[i]);
+        crc = update_crc(crc, data[i]);
     }
     return crc;
 }
@@ -31,7 +31,6 @@
 
 #define INITIAL_FECSTATE 0x00
 #define TRELLIS_TERMINATOR 0x0B
-#define FEC_BUFFER_SIZE 256
 
 #define INTERLEAVING
 
@@ -42,21 +41,11 @@ const static uint8_t trellis0_lut[8] = {0, 1, 3, 2, 3, 2, 0, 1};
 const static uint8_t trellis1_lut[8] = {3, 2, 0, 1, 0, 1, 3, 2};
 
 static uint8_t data_buffer[FEC_BUFFER_SIZE];
-static uint8_t* input_buffer;
-static uint8_t* output_buffer;
 
-static uint16_t packetlength;
-static uint16_t fecpacketlength;
-static uint16_t output_packet_length;
+// used by fec_decode_packet(), fec_decode_packet_with_decoder() allows to decode concurrently
+static fec_decoder_t default_decoder;
 
-static uint8_t processedbytes;
-static uint16_t fecprocessedbytes;
-
-static uint16_t pn9;
-static uint16_t fecstate;
-static VITERBISTATE vstate;
-
-static bool fec_decode(uint8_t* input);
+static bool fec_decode(fec_decoder_t* decoder, uint8_t* input);
 
 #if defined(FRAMEWORK_LOG_ENABLED) && defined(FRAMEWORK_PHY_LOG_ENABLED) // TODO more granular (LOG_PHY_ENABLED)
 #define DPRINT(...) log_print_stack_string(LOG_STACK_PHY, __VA_ARGS__)
@@ -97,7 +86,7 @@ const char *int_to_binary(uint16_t x)
     return b;
 }
 
-static void print_vstate()
+static void print_vstate(fec_decoder_t* decoder)
 {
 //	typedef struct {
 //		uint8_t cost;
@@ -112,12 +101,12 @@ static void print_vstate()
 //	} VITERBISTATE;
 
   DPRINT("VSTATE:\n");
-  DPRINT(" - path_size: %d\n", vstate.path_size);
-	//printf(" - old: %03d - %s\n", vstate.old->cost, int_to_binary(vstate.old->path));
-	//printf(" - new: %03d - %s\n", vstate.new->cost, int_to_binary(vstate.new->path));
+  DPRINT(" - path_size: %d\n", decoder->vstate.path_size);
+	//printf(" - old: %03d - %s\n", decoder->vstate.old->cost, int_to_binary(decoder->vstate.old->path));
+	//printf(" - new: %03d - %s\n", decoder->vstate.new->cost, int_to_binary(decoder->vstate.new->path));
 	int i;
 	for (i=0;i<8;i++)
-    DPRINT(" - states - %d: %03d - %s\n", i, vstate.old[i].cost, int_to_binary(vstate.old[i].path));
+    DPRINT(" - states - %d: %03d - %s\n", i, decoder->vstate.old[i].cost, int_to_binary(decoder->vstate.old[i].path));
 
 }
 
@@ -214,7 +203,12 @@ uint16_t fec_encode(uint8_t *data, uint16_t nbytes)
 
 uint16_t fec_decode_packet(uint8_t* data, uint16_t packet_length, uint16_t output_length)
 {
-	uint8_t* output = data_buffer;
+	return fec_decode_packet_with_decoder(&default_decoder, data, packet_length, output_length);
+}
+
+uint16_t fec_decode_packet_with_decoder(fec_decoder_t* decoder, uint8_t* data, uint16_t packet_length, uint16_t output_length)
+{
+	uint8_t* output = decoder->data_buffer;
 	if(output_length < packet_length)
 	{
 		DPRINT("FEC decoding error: buffer to small\n");
@@ -227,22 +221,21 @@ uint16_t fec_decode_packet(uint8_t* data, uint16_t packet_length, uint16_t outpu
 		return 0;
 	}
 
-	output_buffer = output;
-	packetlength = packet_length;
-	output_packet_length = output_length;
+	decoder->output_buffer = output;
+	decoder->packetlength = packet_length;
 
-	processedbytes = 0;
-	fecprocessedbytes = 0;
+	decoder->processedbytes = 0;
+	decoder->fecprocessedbytes = 0;
 
-	vstate.path_size = 0;
+	decoder->vstate.path_size = 0;
 
-	vstate.states1[0].cost = 0;
+	decoder->vstate.states1[0].cost = 0;
 	int16_t i;
 	for (i=1;i<8;i++)
-			vstate.states1[i].cost = 100;
+			decoder->vstate.states1[i].cost = 100;
 
-	vstate.old = vstate.states1;
-	vstate.new = vstate.states2;
+	decoder->vstate.old = decoder->vstate.states1;
+	decoder->vstate.new = decoder->vstate.states2;
 
 	uint16_t decoded_length = 0;
 
@@ -250,18 +243,18 @@ uint16_t fec_decode_packet(uint8_t* data, uint16_t packet_length, uint16_t outpu
 	{
 		//printf("FEC encoding i = %d\n", i);
 
-		bool err = fec_decode(&data[i]);
+		bool err = fec_decode(decoder, &data[i]);
 		decoded_length+=2;
 		if (!err)
 			DPRINT("FEC encoding error\n");
 	}
 
-	memcpy(data, data_buffer, decoded_length);
+	memcpy(data, decoder->data_buffer, decoded_length);
 
 	return decoded_length;
 }
 
-static bool fec_decode(uint8_t* input)
+static bool fec_decode(fec_decoder_t* decoder, uint8_t* input)
 {
 	uint8_t i, k;
 	int8_t j;
@@ -271,7 +264,7 @@ static bool fec_decode(uint8_t* input)
 	uint8_t fecbuffer[4];
 	VITERBIPATH* vstate_tmp;
 
-	if(fecprocessedbytes >= packetlength)
+	if(decoder->fecprocessedbytes >= decoder->packetlength)
 		return false;
 
 	//Deinterleaving (symbols are stored in reverse as this is easier for Viterbi decoding)
@@ -302,7 +295,7 @@ static bool fec_decode(uint8_t* input)
 	fecbuffer[3] = input[3];
 #endif
 	//printf(" input = %04X%04X\n", fecbuffer[0],fecbuffer[1]);
-	fecprocessedbytes +=4;
+	decoder->fecprocessedbytes +=4;
 
 	for (i = 0; i < 3; i=i+2) {
 		//Viterbi decoding
@@ -325,19 +318,19 @@ static bool fec_decode(uint8_t* input)
 				state0 = k >> 1;
 				state1 = state0 + 4;
 
-				cost0  = vstate.old[state0].cost;
-				cost1  = vstate.old[state1].cost;
+				cost0  = decoder->vstate.old[state0].cost;
+				cost1  = decoder->vstate.old[state1].cost;
 
 				//butterfly operation for 0
 				hamming0 = cost0 + (((trellis0_lut[state0] ^ symbol) + 1) >> 1);
 				hamming1 = cost1 + (((trellis0_lut[state1] ^ symbol) + 1) >> 1);
 
 				if(hamming0 <= hamming1) {
-					vstate.new[k].cost = hamming0;
-					vstate.new[k].path = vstate.old[state0].path << 1;
+					decoder->vstate.new[k].cost = hamming0;
+					decoder->vstate.new[k].path = decoder->vstate.old[state0].path << 1;
 				} else {
-					vstate.new[k].cost = hamming1;
-					vstate.new[k].path = vstate.old[state1].path << 1;
+					decoder->vstate.new[k].cost = hamming1;
+					decoder->vstate.new[k].path = decoder->vstate.old[state1].path << 1;
 				}
 
 				//printf("k %d part 1\n");
@@ -350,11 +343,11 @@ static bool fec_decode(uint8_t* input)
 				hamming1 = cost1 + (((trellis1_lut[state1] ^ symbol) + 1) >> 1);
 
 				if(hamming0 <= hamming1) {
-					vstate.new[k].cost = hamming0;
-					vstate.new[k].path = vstate.old[state0].path << 1 | 0x01;
+					decoder->vstate.new[k].cost = hamming0;
+					decoder->vstate.new[k].path = decoder->vstate.old[state0].path << 1 | 0x01;
 				} else {
-					vstate.new[k].cost = hamming1;
-					vstate.new[k].path = vstate.old[state1].path << 1 | 0x01;
+					decoder->vstate.new[k].cost = hamming1;
+					decoder->vstate.new[k].path = decoder->vstate.old[state1].path << 1 | 0x01;
 				}
 
 				//printf("k %d part 2\n");
@@ -362,35 +355,35 @@ static bool fec_decode(uint8_t* input)
 			}
 
 			//Swap Viterbi paths
-			vstate_tmp = vstate.new;
-			vstate.new = vstate.old;
-			vstate.old = vstate_tmp;
+			vstate_tmp = decoder->vstate.new;
+			decoder->vstate.new = decoder->vstate.old;
+			decoder->vstate.old = vstate_tmp;
 
 			//print_vstate();
 		}
 
-		vstate.path_size++;
+		decoder->vstate.path_size++;
 
 		//Flush out byte if path is full
-		if ((vstate.path_size == 2) && (processedbytes < packetlength)) {
+		if ((decoder->vstate.path_size == 2) && (decoder->processedbytes < decoder->packetlength)) {
 			//Calculate path with lowest cost
 			min_state = 0;
 			for (j = 7; j != 0; j--) {
-				if(vstate.old[j].cost < vstate.old[min_state].cost)
+				if(decoder->vstate.old[j].cost < decoder->vstate.old[min_state].cost)
 					min_state = j;
 			}
 
 	        //Normalize costs
-			if (vstate.old[min_state].cost > 0)
-				for (j = 0; j < 8; j++) vstate.old[j].cost -= vstate.old[min_state].cost;
+			if (decoder->vstate.old[min_state].cost > 0)
+				for (j = 0; j < 8; j++) decoder->vstate.old[j].cost -= decoder->vstate.old[min_state].cost;
 
-			*output_buffer++ = vstate.old[min_state].path >> 8;
-			vstate.path_size--;
+			*decoder->output_buffer++ = decoder->vstate.old[min_state].path >> 8;
+			decoder->vstate.path_size--;
 
-			processedbytes++;
+			decoder->processedbytes++;
 
-			if (processedbytes+ 2 == packetlength)
-				*output_buffer = (uint8_t) (vstate.old[min_state].path);
+			if (decoder->processedbytes+ 2 == decoder->packetlength)
+				*decoder->output_buffer = (uint8_t) (decoder->vstate.old[min_state].path);
 		}
 	}
 
@@ -0,0 +1,45 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "scheduler.h"
+#include "timer.h"
+
+// kept out of scheduler.c, so it can be simulated on the host without the scheduler loop
+
+__LINK_C uint8_t sched_select_low_power_mode(const hw_lowpower_mode_t* modes, uint8_t mode_count, uint8_t max_mode,
+	uint32_t time_to_next_event)
+{
+	uint8_t selected = 0;
+	for(uint8_t i = 1; i < mode_count; i++)
+	{
+		if(modes[i].mode > max_mode)
+			break;
+
+		if(time_to_next_event != TIMER_NO_EVENT_PENDING)
+		{
+			// round up, and require a spare tick since the counter may be about to increment
+			uint32_t latency_ticks = (modes[i].wakeup_latency_us * TIMER_TICKS_PER_SEC + 999999) / 1000000;
+			if(latency_ticks >= time_to_next_event)
+				break;
+		}
+
+		selected = i;
+	}
+
+	return selected;
+}
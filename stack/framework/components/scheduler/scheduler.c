@@ -37,6 +37,7 @@
 #include "errors.h"
 #include "timer.h"
 #include "hwwatchdog.h"
+#include "trace.h"
 
 #include "framework_defs.h"
 #define SCHEDULER_MAX_TASKS FRAMEWORK_SCHEDULER_MAX_TASKS
@@ -362,6 +363,33 @@ void sched_set_low_power_mode(uint8_t mode) {
   low_power_mode = mode;
 }
 
+#ifdef FRAMEWORK_SCHEDULER_LP_MODE_AUTO
+static sched_low_power_mode_stats_t low_power_mode_stats[SCHED_MAX_LOW_POWER_MODES];
+
+static void enter_selected_low_power_mode()
+{
+	uint8_t mode_count;
+	const hw_lowpower_mode_t* modes = hw_get_lowpower_modes(&mode_count);
+	assert(mode_count <= SCHED_MAX_LOW_POWER_MODES);
+	uint8_t index = sched_select_low_power_mode(modes, mode_count, low_power_mode, timer_get_time_to_next_event());
+	DPRINT("SCHED entering low power mode %i", modes[index].mode);
+	timer_tick_t start = timer_get_counter_value();
+	hw_enter_lowpower_mode(modes[index].mode);
+	low_power_mode_stats[index].entry_count++;
+	low_power_mode_stats[index].duration += timer_get_counter_value() - start;
+}
+#endif
+
+const sched_low_power_mode_stats_t* sched_get_low_power_mode_stats(uint8_t* count) {
+#ifdef FRAMEWORK_SCHEDULER_LP_MODE_AUTO
+  hw_get_lowpower_modes(count);
+  return low_power_mode_stats;
+#else
+  *count = 0;
+  return NULL;
+#endif
+}
+
 __LINK_C void scheduler_run()
 {
 	
@@ -382,7 +410,9 @@ __LINK_C void scheduler_run()
         timer_tick_t start = timer_get_counter_value();
         log_print_string("SCHED start %p at %i", NG(m_info)[id].task, start);
 #endif
+        trace_record(TRACE_TASK_START, NG(current_priority), (uint32_t)(uintptr_t)NG(m_info)[id].task);
         NG(m_info)[id].task(NG(m_info)[id].arg);
+        trace_record(TRACE_TASK_STOP, NG(current_priority), (uint32_t)(uintptr_t)NG(m_info)[id].task);
 #if defined(FRAMEWORK_LOG_ENABLED) && defined(FRAMEWORK_SCHED_LOG_ENABLED)
         timer_tick_t stop = timer_get_counter_value();
         timer_tick_t duration = stop - start;
@@ -408,7 +438,11 @@ __LINK_C void scheduler_run()
 		}
 		hw_watchdog_feed();
 #endif
+#ifdef FRAMEWORK_SCHEDULER_LP_MODE_AUTO
+		enter_selected_low_power_mode();
+#else
 		hw_enter_lowpower_mode(low_power_mode);
+#endif
 	}
 
 }
@@ -24,6 +24,8 @@
 #include "framework_defs.h"
 #include "log.h"
 #include "errors.h"
+#include "trace.h"
+#include "hwsystem.h"
 
 #if defined(FRAMEWORK_LOG_ENABLED) && defined(FRAMEWORK_TIMER_LOG_ENABLED)
   #define DPRINT(...) log_print_stack_string(LOG_STACK_FWK, __VA_ARGS__)
@@ -46,7 +48,8 @@ extern inline error_t timer_post_task_prio_delay(task_t task, timer_tick_t delay
 extern inline error_t timer_post_task_delay(task_t task, timer_tick_t delay);
 extern inline error_t timer_add_event(timer_event* event);
 
-static timer_event NGDEF(timers)[FRAMEWORK_TIMER_STACK_SIZE];
+// the last entries are the precise lanes, which are executed from the timer interrupt instead of by the scheduler
+static timer_event NGDEF(timers)[FRAMEWORK_TIMER_STACK_SIZE + TIMER_PRECISE_LANE_COUNT];
 static volatile timer_tick_t NGDEF(next_event);
 static volatile bool NGDEF(hw_event_scheduled);
 static volatile timer_tick_t NGDEF(timer_offset);
@@ -55,15 +58,18 @@ static bool timer_busy_programming = false;
 static bool fired_by_interrupt = true;
 enum
 {
-    NO_EVENT = FRAMEWORK_TIMER_STACK_SIZE,
+    PRECISE_EVENT = FRAMEWORK_TIMER_STACK_SIZE,
+    NO_EVENT = FRAMEWORK_TIMER_STACK_SIZE + TIMER_PRECISE_LANE_COUNT,
 };
 
+#define IS_PRECISE_EVENT(event) ((event) >= PRECISE_EVENT && (event) < NO_EVENT)
+
 static void timer_overflow();
 static void timer_fired();
 
 __LINK_C void timer_init()
 {
-    for(uint32_t i = 0; i < FRAMEWORK_TIMER_STACK_SIZE; i++)
+    for(uint32_t i = 0; i < NO_EVENT; i++)
 	NG(timers)[i].f = 0x0;
 
     NG(next_event) = NO_EVENT;
@@ -208,6 +214,75 @@ __LINK_C error_t timer_cancel_task(task_t task)
     return status;
 }
 
+__LINK_C error_t timer_post_precise_task(timer_precise_lane_t lane, task_t task, timer_tick_t fire_time, void *arg)
+{
+    assert(lane < TIMER_PRECISE_LANE_COUNT);
+    uint32_t event = PRECISE_EVENT + lane;
+    bool conf_atomic_ended = false;
+    start_atomic();
+    NG(timers)[event].f = task;
+    NG(timers)[event].next_event = fire_time;
+    NG(timers)[event].priority = MAX_PRIORITY;
+    NG(timers)[event].arg = arg;
+    NG(timers)[event].period = 0;
+
+    bool do_config = NG(next_event) == NO_EVENT || NG(next_event) == event;
+    if (!do_config)
+    {
+        uint32_t counter = timer_get_counter_value();
+        int32_t next_fire_delay = ((int32_t)fire_time) - ((int32_t)counter);
+        int32_t old_fire_delay = ((int32_t)NG(timers)[NG(next_event)].next_event) - ((int32_t)counter);
+        // on a tie the precise lanes go first, see get_next_event()
+        do_config = next_fire_delay <= old_fire_delay;
+    }
+
+    if (do_config)
+        conf_atomic_ended = configure_next_event();
+
+    if(!conf_atomic_ended)
+        end_atomic();
+
+    return SUCCESS;
+}
+
+__LINK_C error_t timer_post_precise_task_delay_us(timer_precise_lane_t lane, task_t task, uint32_t delay_us, void *arg)
+{
+    // the task fires on a counter increment, which happens up to one tick after the current time
+    timer_tick_t delay = (timer_tick_t)(((uint64_t)delay_us * TIMER_TICKS_PER_SEC + 999999) / 1000000) + 1;
+    if(delay <= timer_info->min_delay_ticks + 1)
+    {
+        // below the timer resolution, the task is executed in the context of the caller
+        assert(delay_us <= INT16_MAX);
+        hw_busy_wait((int16_t)delay_us);
+        task(arg);
+        return SUCCESS;
+    }
+
+    return timer_post_precise_task(lane, task, timer_get_counter_value() + delay, arg);
+}
+
+__LINK_C error_t timer_cancel_precise_task(timer_precise_lane_t lane)
+{
+    assert(lane < TIMER_PRECISE_LANE_COUNT);
+    uint32_t event = PRECISE_EVENT + lane;
+    bool conf_atomic_ended = false;
+    start_atomic();
+    if(NG(timers)[event].f == 0x0)
+    {
+        end_atomic();
+        return EALREADY;
+    }
+
+    NG(timers)[event].f = 0x0;
+    if(NG(next_event) == event)
+        conf_atomic_ended = configure_next_event();
+
+    if(!conf_atomic_ended)
+        end_atomic();
+
+    return SUCCESS;
+}
+
 error_t timer_add_event(timer_event* event)
 {
     return timer_post_task_prio(event->f, timer_get_counter_value() + event->next_event, event->priority, event->period, event->arg);
@@ -253,6 +328,19 @@ __LINK_C timer_tick_t timer_get_counter_value()
     return counter;
 }
 
+__LINK_C timer_tick_t timer_get_time_to_next_event()
+{
+    timer_tick_t time_to_next_event = TIMER_NO_EVENT_PENDING;
+    start_atomic();
+    if(NG(next_event) != NO_EVENT)
+    {
+        int32_t delay_ticks = ((int32_t)NG(timers)[NG(next_event)].next_event) - ((int32_t)timer_get_counter_value());
+        time_to_next_event = delay_ticks > 0 ? delay_ticks : 0;
+    }
+    end_atomic();
+    return time_to_next_event;
+}
+
 static uint32_t get_next_event()
 {
     //this function should only be called from an atomic context
@@ -260,7 +348,7 @@ static uint32_t get_next_event()
     uint32_t next_fire_event = NO_EVENT;
     uint32_t counter = timer_get_counter_value();
 
-    for(uint32_t i = 0; i < FRAMEWORK_TIMER_STACK_SIZE; i++)
+    for(uint32_t i = 0; i < NO_EVENT; i++)
     {
     	if(NG(timers)[i].f == 0x0)
     		continue;
@@ -268,7 +356,8 @@ static uint32_t get_next_event()
     	//we know that if the event has already passed delay_ticks will be < 0
     	// --> events are sorted from past -> future regardless of any (pending) overflows
     	int32_t delay_ticks = ((int32_t)NG(timers)[i].next_event) - ((int32_t)counter);
-    	if(next_fire_event == NO_EVENT || delay_ticks < min_delay)
+    	// on a tie the precise lanes go first, they cannot be executed late
+    	if(next_fire_event == NO_EVENT || delay_ticks < min_delay || (delay_ticks == min_delay && IS_PRECISE_EVENT(i)))
 		{
     		min_delay = delay_ticks;
 			next_fire_event = i;
@@ -294,7 +383,15 @@ static bool configure_next_event()
 		if(NG(next_event) != NO_EVENT)
 		{
 			next_fire_time = NG(timers)[NG(next_event)].next_event;
-      if ( (((int32_t)next_fire_time) - ((int32_t)current_time) - timer_info->min_delay_ticks) <= 0 )
+      if ( (((int32_t)next_fire_time) - ((int32_t)current_time) - timer_info->min_delay_ticks) <= 0
+           && IS_PRECISE_EVENT(NG(next_event)))
+      {
+                // the precise lanes only run from the timer interrupt, so they are delayed until the first tick which
+                // can still be scheduled instead of being executed from here
+                next_fire_time = current_time + timer_info->min_delay_ticks + 1;
+                NG(timers)[NG(next_event)].next_event = next_fire_time;
+      }
+      else if ( (((int32_t)next_fire_time) - ((int32_t)current_time) - timer_info->min_delay_ticks) <= 0 )
 			{
                 DPRINT("will be late, sched immediately\n\n");
                 if(NG(timers)[NG(next_event)].f == 0)
@@ -398,6 +495,17 @@ static void timer_fired()
         return;
     assert(NG(next_event) != NO_EVENT);
     assert(NG(timers)[NG(next_event)].f != 0x0);
+    trace_record(TRACE_TIMER_FIRED, NG(timers)[NG(next_event)].priority, (uint32_t)(uintptr_t)NG(timers)[NG(next_event)].f);
+    if(IS_PRECISE_EVENT(NG(next_event))) {
+        // the next event is configured first, so the task can post new timer events
+        task_t precise_task = NG(timers)[NG(next_event)].f;
+        void *arg = NG(timers)[NG(next_event)].arg;
+        NG(timers)[NG(next_event)].f = 0x0;
+        configure_next_event();
+        precise_task(arg);
+        return;
+    }
+
     sched_post_task_prio(NG(timers)[NG(next_event)].f, NG(timers)[NG(next_event)].priority, NG(timers)[NG(next_event)].arg);
     if(NG(timers)[NG(next_event)].period > 0) {
         task_t recursive_task = NG(timers)[NG(next_event)].f;
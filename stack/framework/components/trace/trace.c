@@ -0,0 +1,144 @@
+/*! \file trace.c
+ *
+
+ *  \copyright (C) Copyright 2015 University of Antwerp and others (http://oss-7.cosys.be)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "trace.h"
+
+#ifdef FRAMEWORK_TRACE_ENABLED
+
+#include "platform_defs.h"
+#include "hwatomic.h"
+#include "timer.h"
+
+#ifdef PLATFORM_NATIVE
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TRACE_DEFAULT_FILE "trace.bin"
+
+static FILE* trace_file = NULL;
+static bool close_registered = false;
+
+static void close_trace_file()
+{
+    if (trace_file != NULL)
+        fclose(trace_file);
+
+    trace_file = NULL;
+}
+
+static bool open_trace_file()
+{
+    const char* path = getenv("OSS7_TRACE_FILE");
+    if (path == NULL)
+        path = TRACE_DEFAULT_FILE;
+
+    trace_file = fopen(path, "wb");
+    if (trace_file == NULL)
+        return false;
+
+    trace_header_t header = {
+        .magic = TRACE_MAGIC,
+        .version = TRACE_VERSION,
+        .event_size = sizeof(trace_event_t),
+        .capacity = 0,
+        .ticks_per_sec = 1000000,
+        .write_count = 0 // not known upfront, the converter reads until the end of the file
+    };
+
+    fwrite(&header, sizeof(header), 1, trace_file);
+    if (!close_registered)
+        close_registered = (atexit(&close_trace_file) == 0);
+
+    return true;
+}
+
+static uint32_t get_timestamp()
+{
+    // the native hw timer does not count, use the host clock
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(now.tv_sec * 1000000ULL + now.tv_nsec / 1000);
+}
+
+void trace_record(trace_event_type_t type, uint8_t id, uint32_t value)
+{
+    trace_event_t event = {
+        .timestamp = get_timestamp(),
+        .value = value,
+        .type = type,
+        .id = id
+    };
+
+    start_atomic();
+    if (trace_file != NULL || open_trace_file()) {
+        fwrite(&event, sizeof(event), 1, trace_file);
+        // flush every event, so the trace is complete when the process is killed
+        fflush(trace_file);
+    }
+    end_atomic();
+}
+
+void trace_clear()
+{
+    // the file is truncated when it is opened again by the next event
+    start_atomic();
+    close_trace_file();
+    end_atomic();
+}
+#else
+typedef struct __attribute__((__packed__)) {
+    trace_header_t header;
+    trace_event_t events[FRAMEWORK_TRACE_BUFFER_SIZE];
+} trace_buffer_t;
+
+// not static, so it can be located in a memory dump
+trace_buffer_t trace_buffer = {
+    .header = {
+        .magic = TRACE_MAGIC,
+        .version = TRACE_VERSION,
+        .event_size = sizeof(trace_event_t),
+        .capacity = FRAMEWORK_TRACE_BUFFER_SIZE,
+        .ticks_per_sec = TIMER_TICKS_PER_SEC,
+        .write_count = 0
+    }
+};
+
+void trace_record(trace_event_type_t type, uint8_t id, uint32_t value)
+{
+    start_atomic();
+    trace_event_t* event = &trace_buffer.events[trace_buffer.header.write_count % FRAMEWORK_TRACE_BUFFER_SIZE];
+    event->timestamp = timer_get_counter_value();
+    event->value = value;
+    event->type = type;
+    event->id = id;
+    trace_buffer.header.write_count++;
+    end_atomic();
+}
+
+void trace_clear()
+{
+    start_atomic();
+    trace_buffer.header.write_count = 0;
+    end_atomic();
+}
+#endif
+
+#endif
@@ -60,6 +60,19 @@ void hw_enter_lowpower_mode(uint8_t mode)
     }
 }
 
+// EM3 and EM4 are not listed since they stop the RTC used by the framework timer. Leaving EM2 includes restarting
+// the HF oscillator.
+static const hw_lowpower_mode_t lowpower_modes[] = {
+    { .mode = 0, .wakeup_latency_us = 1, .current_na = 700000 }, // EM1
+    { .mode = 1, .wakeup_latency_us = 100, .current_na = 1100 }, // EM2, with RTC running
+};
+
+const hw_lowpower_mode_t* hw_get_lowpower_modes(uint8_t* count)
+{
+    *count = sizeof(lowpower_modes) / sizeof(lowpower_modes[0]);
+    return lowpower_modes;
+}
+
 uint64_t hw_get_unique_id()
 {
     return SYSTEM_GetUnique();
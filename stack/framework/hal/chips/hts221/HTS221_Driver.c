@@ -270,6 +270,99 @@ HTS221_Error_et HTS221_DeInit(void *handle)
   return HTS221_OK;
 }
 
+static uint16_t HTS221_Convert_Humidity(const HTS221_Calibration_st* calibration, int16_t H_T_out)
+{
+  float   tmp_f;
+
+  tmp_f = (float)(H_T_out - calibration->H0_T0_out) * (float)(calibration->H1_rh - calibration->H0_rh) / (float)(calibration->H1_T0_out - calibration->H0_T0_out)  +  calibration->H0_rh;
+  tmp_f *= 10.0f;
+
+  return ( tmp_f > 1000.0f ) ? 1000
+           : ( tmp_f <    0.0f ) ?    0
+           : ( uint16_t )tmp_f;
+}
+
+static int16_t HTS221_Convert_Temperature(const HTS221_Calibration_st* calibration, int16_t T_out)
+{
+  float   tmp_f;
+
+  tmp_f = (float)(T_out - calibration->T0_out) * (float)(calibration->T1_degC - calibration->T0_degC) / (float)(calibration->T1_out - calibration->T0_out)  +  calibration->T0_degC;
+  tmp_f *= 10.0f;
+
+  return ( int16_t )tmp_f;
+}
+
+/**
+* @brief  Read the HTS221 calibration coefficients in a single transfer.
+* @param  *handle Device handle.
+* @param  calibration pointer to the returned calibration coefficients.
+* @retval Error code [HTS221_OK, HTS221_ERROR].
+*/
+HTS221_Error_et HTS221_Get_Calibration(void *handle, HTS221_Calibration_st* calibration)
+{
+  uint8_t buffer[HTS221_T1_OUT_H - HTS221_H0_RH_X2 + 1];
+  uint16_t T0_degC_x8_u16, T1_degC_x8_u16;
+
+  if(HTS221_ReadReg(handle, HTS221_H0_RH_X2, sizeof(buffer), buffer))
+    return HTS221_ERROR;
+
+#define CALIBRATION_REG(reg) buffer[(reg) - HTS221_H0_RH_X2]
+  calibration->H0_rh = CALIBRATION_REG(HTS221_H0_RH_X2) >> 1;
+  calibration->H1_rh = CALIBRATION_REG(HTS221_H1_RH_X2) >> 1;
+  calibration->H0_T0_out = (((uint16_t)CALIBRATION_REG(HTS221_H0_T0_OUT_H)) << 8) | (uint16_t)CALIBRATION_REG(HTS221_H0_T0_OUT_L);
+  calibration->H1_T0_out = (((uint16_t)CALIBRATION_REG(HTS221_H1_T0_OUT_H)) << 8) | (uint16_t)CALIBRATION_REG(HTS221_H1_T0_OUT_L);
+
+  T0_degC_x8_u16 = (((uint16_t)(CALIBRATION_REG(HTS221_T0_T1_DEGC_H2) & 0x03)) << 8) | ((uint16_t)CALIBRATION_REG(HTS221_T0_DEGC_X8));
+  T1_degC_x8_u16 = (((uint16_t)(CALIBRATION_REG(HTS221_T0_T1_DEGC_H2) & 0x0C)) << 6) | ((uint16_t)CALIBRATION_REG(HTS221_T1_DEGC_X8));
+  calibration->T0_degC = T0_degC_x8_u16 >> 3;
+  calibration->T1_degC = T1_degC_x8_u16 >> 3;
+  calibration->T0_out = (((uint16_t)CALIBRATION_REG(HTS221_T0_OUT_H)) << 8) | (uint16_t)CALIBRATION_REG(HTS221_T0_OUT_L);
+  calibration->T1_out = (((uint16_t)CALIBRATION_REG(HTS221_T1_OUT_H)) << 8) | (uint16_t)CALIBRATION_REG(HTS221_T1_OUT_L);
+#undef CALIBRATION_REG
+
+  return HTS221_OK;
+}
+
+/**
+* @brief  Read HTS221 output registers in a single transfer, and calculate humidity and temperature.
+* @param  *handle Device handle.
+* @param  calibration pointer to the calibration coefficients read using HTS221_Get_Calibration().
+* @param  humidity pointer to the returned humidity value that must be divided by 10 to get the value in [%].
+* @param  temperature pointer to the returned temperature value that must be divided by 10 to get the value in ['C].
+* @retval Error code [HTS221_OK, HTS221_ERROR].
+*/
+HTS221_Error_et HTS221_Get_CalibratedMeasurement(void *handle, const HTS221_Calibration_st* calibration, uint16_t* humidity, int16_t* temperature)
+{
+  int16_t H_T_out, T_out;
+
+  if(HTS221_Get_RawMeasurement(handle, &H_T_out, &T_out))
+    return HTS221_ERROR;
+
+  *humidity = HTS221_Convert_Humidity(calibration, H_T_out);
+  *temperature = HTS221_Convert_Temperature(calibration, T_out);
+
+  return HTS221_OK;
+}
+
+/**
+* @brief  Read HTS221 temperature output registers in a single transfer, and calculate temperature.
+* @param  *handle Device handle.
+* @param  calibration pointer to the calibration coefficients read using HTS221_Get_Calibration().
+* @param  Pointer to the returned temperature value that must be divided by 10 to get the value in ['C].
+* @retval Error code [HTS221_OK, HTS221_ERROR].
+*/
+HTS221_Error_et HTS221_Get_CalibratedTemperature(void *handle, const HTS221_Calibration_st* calibration, int16_t* value)
+{
+  int16_t T_out;
+
+  if(HTS221_Get_TemperatureRaw(handle, &T_out))
+    return HTS221_ERROR;
+
+  *value = HTS221_Convert_Temperature(calibration, T_out);
+
+  return HTS221_OK;
+}
+
 /**
 * @brief  Read HTS221 output registers, and calculate humidity and temperature.
 * @param  *handle Device handle.
@@ -279,10 +372,12 @@ HTS221_Error_et HTS221_DeInit(void *handle)
 */
 HTS221_Error_et HTS221_Get_Measurement(void *handle, uint16_t* humidity, int16_t* temperature)
 {
-  if ( HTS221_Get_Temperature( handle, temperature ) == HTS221_ERROR ) return HTS221_ERROR;
-  if ( HTS221_Get_Humidity( handle, humidity ) == HTS221_ERROR ) return HTS221_ERROR;
+  HTS221_Calibration_st calibration;
 
-  return HTS221_OK;
+  if(HTS221_Get_Calibration(handle, &calibration))
+    return HTS221_ERROR;
+
+  return HTS221_Get_CalibratedMeasurement(handle, &calibration, humidity, temperature);
 }
 
 /**
@@ -313,34 +408,16 @@ HTS221_Error_et HTS221_Get_RawMeasurement(void *handle, int16_t* humidity, int16
 */
 HTS221_Error_et HTS221_Get_Humidity(void *handle, uint16_t* value)
 {
-  int16_t H0_T0_out, H1_T0_out, H_T_out;
-  int16_t H0_rh, H1_rh;
-  uint8_t buffer[2];
-  float   tmp_f;
-
-  if(HTS221_ReadReg(handle, HTS221_H0_RH_X2, 2, buffer))
-    return HTS221_ERROR;
-  H0_rh = buffer[0] >> 1;
-  H1_rh = buffer[1] >> 1;
+  HTS221_Calibration_st calibration;
+  int16_t H_T_out;
 
-  if(HTS221_ReadReg(handle, HTS221_H0_T0_OUT_L, 2, buffer))
+  if(HTS221_Get_Calibration(handle, &calibration))
     return HTS221_ERROR;
-  H0_T0_out = (((uint16_t)buffer[1]) << 8) | (uint16_t)buffer[0];
 
-  if(HTS221_ReadReg(handle, HTS221_H1_T0_OUT_L, 2, buffer))
+  if(HTS221_Get_HumidityRaw(handle, &H_T_out))
     return HTS221_ERROR;
-  H1_T0_out = (((uint16_t)buffer[1]) << 8) | (uint16_t)buffer[0];
 
-  if(HTS221_ReadReg(handle, HTS221_HR_OUT_L_REG, 2, buffer))
-    return HTS221_ERROR;
-  H_T_out = (((uint16_t)buffer[1]) << 8) | (uint16_t)buffer[0];
-
-  tmp_f = (float)(H_T_out - H0_T0_out) * (float)(H1_rh - H0_rh) / (float)(H1_T0_out - H0_T0_out)  +  H0_rh;
-  tmp_f *= 10.0f;
-
-  *value = ( tmp_f > 1000.0f ) ? 1000
-           : ( tmp_f <    0.0f ) ?    0
-           : ( uint16_t )tmp_f;
+  *value = HTS221_Convert_Humidity(&calibration, H_T_out);
 
   return HTS221_OK;
 }
@@ -371,38 +448,12 @@ HTS221_Error_et HTS221_Get_HumidityRaw(void *handle, int16_t* value)
 */
 HTS221_Error_et HTS221_Get_Temperature(void *handle, int16_t *value)
 {
-  int16_t T0_out, T1_out, T_out, T0_degC_x8_u16, T1_degC_x8_u16;
-  int16_t T0_degC, T1_degC;
-  uint8_t buffer[4], tmp;
-  float   tmp_f;
+  HTS221_Calibration_st calibration;
 
-  if(HTS221_ReadReg(handle, HTS221_T0_DEGC_X8, 2, buffer))
-    return HTS221_ERROR;
-  if(HTS221_ReadReg(handle, HTS221_T0_T1_DEGC_H2, 1, &tmp))
+  if(HTS221_Get_Calibration(handle, &calibration))
     return HTS221_ERROR;
 
-  T0_degC_x8_u16 = (((uint16_t)(tmp & 0x03)) << 8) | ((uint16_t)buffer[0]);
-  T1_degC_x8_u16 = (((uint16_t)(tmp & 0x0C)) << 6) | ((uint16_t)buffer[1]);
-  T0_degC = T0_degC_x8_u16 >> 3;
-  T1_degC = T1_degC_x8_u16 >> 3;
-
-  if(HTS221_ReadReg(handle, HTS221_T0_OUT_L, 4, buffer))
-    return HTS221_ERROR;
-
-  T0_out = (((uint16_t)buffer[1]) << 8) | (uint16_t)buffer[0];
-  T1_out = (((uint16_t)buffer[3]) << 8) | (uint16_t)buffer[2];
-
-  if(HTS221_ReadReg(handle, HTS221_TEMP_OUT_L_REG, 2, buffer))
-    return HTS221_ERROR;
-
-  T_out = (((uint16_t)buffer[1]) << 8) | (uint16_t)buffer[0];
-
-  tmp_f = (float)(T_out - T0_out) * (float)(T1_degC - T0_degC) / (float)(T1_out - T0_out)  +  T0_degC;
-  tmp_f *= 10.0f;
-
-  *value = ( int16_t )tmp_f;
-
-  return HTS221_OK;
+  return HTS221_Get_CalibratedTemperature(handle, &calibration, value);
 }
 
 /**
@@ -195,6 +195,22 @@ typedef struct
   HTS221_State_et       irq_enable;       /*!< HTS221_ENABLE/HTS221_DISABLE interrupt on DRDY pin */
 } HTS221_Init_st;
 
+/**
+* @brief  HTS221 calibration coefficients, stored in the device during production.
+*         Reading them once allows to convert every measurement using a single bus transfer.
+*/
+typedef struct
+{
+  int16_t   H0_rh;        /*!< Relative humidity of the first calibration point [%] */
+  int16_t   H1_rh;        /*!< Relative humidity of the second calibration point [%] */
+  int16_t   H0_T0_out;    /*!< Humidity output at the first calibration point */
+  int16_t   H1_T0_out;    /*!< Humidity output at the second calibration point */
+  int16_t   T0_degC;      /*!< Temperature of the first calibration point ['C] */
+  int16_t   T1_degC;      /*!< Temperature of the second calibration point ['C] */
+  int16_t   T0_out;       /*!< Temperature output at the first calibration point */
+  int16_t   T1_out;       /*!< Temperature output at the second calibration point */
+} HTS221_Calibration_st;
+
 /**
 * @}
 */
@@ -468,6 +484,9 @@ HTS221_Error_et HTS221_Get_Humidity(void *handle, uint16_t* value);
 HTS221_Error_et HTS221_Get_HumidityRaw(void *handle, int16_t* value);
 HTS221_Error_et HTS221_Get_TemperatureRaw(void *handle, int16_t* value);
 HTS221_Error_et HTS221_Get_Temperature(void *handle, int16_t* value);
+HTS221_Error_et HTS221_Get_Calibration(void *handle, HTS221_Calibration_st* calibration);
+HTS221_Error_et HTS221_Get_CalibratedMeasurement(void *handle, const HTS221_Calibration_st* calibration, uint16_t* humidity, int16_t* temperature);
+HTS221_Error_et HTS221_Get_CalibratedTemperature(void *handle, const HTS221_Calibration_st* calibration, int16_t* value);
 HTS221_Error_et HTS221_Get_DataStatus(void *handle, HTS221_BitStatus_et* humidity, HTS221_BitStatus_et* temperature);
 HTS221_Error_et HTS221_Activate(void *handle);
 HTS221_Error_et HTS221_DeActivate(void *handle);
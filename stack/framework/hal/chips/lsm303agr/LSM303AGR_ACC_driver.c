@@ -48,6 +48,7 @@
  */
 
 /* Includes ------------------------------------------------------------------*/
+#include "string.h"
 #include "LSM303AGR_ACC_driver.h"
 
 /* Imported function prototypes ----------------------------------------------*/
@@ -225,13 +226,6 @@ status_t LSM303AGR_ACC_Get_Raw_Acceleration(void *handle, u8_t *buff)
   return MEMS_SUCCESS;
 }
 
-/*******************************************************************************
-* Function Name  : status_t LSM303AGR_ACC_Get_Acceleration(void *handle, int *buff)
-* Description    : Read GetAccData output register
-* Input          : pointer to [u8_t]
-* Output         : values are expressed in mg
-* Return         : Status [MEMS_ERROR, MEMS_SUCCESS]
-*******************************************************************************/
 /*
  * Following is the table of sensitivity values for each case.
  * Values are espressed in ug/digit.
@@ -262,41 +256,44 @@ const long long LSM303AGR_ACC_Sensitivity_List[3][4] =
     187580, /* FS @16g */
   },
 };
-status_t LSM303AGR_ACC_Get_Acceleration(void *handle, int *buff)
+
+/* Determine the shift and sensitivity of the raw samples for the current operational mode and full scale */
+static status_t LSM303AGR_ACC_Get_Sensitivity(void *handle, u8_t *shift, long long *sensitivity)
 {
-  Type3Axis16bit_U raw_data_tmp;
-  u8_t op_mode = 0, fs_mode = 0, shift = 0;
+  u8_t op_mode = 0, fs_mode = 0;
   LSM303AGR_ACC_LPEN_t lp;
   LSM303AGR_ACC_HR_t hr;
   LSM303AGR_ACC_FS_t fs;
 
   /* Determine which operational mode the acc is set */
-  LSM303AGR_ACC_R_HiRes(handle, &hr);
-  LSM303AGR_ACC_R_LOWPWR_EN(handle, &lp);
+  if( !LSM303AGR_ACC_R_HiRes(handle, &hr) || !LSM303AGR_ACC_R_LOWPWR_EN(handle, &lp) )
+    return MEMS_ERROR;
 
   if (lp == LSM303AGR_ACC_LPEN_ENABLED && hr == LSM303AGR_ACC_HR_DISABLED)
   {
     /* op mode is LP 8-bit */
     op_mode = 2;
-    shift = 8;
+    *shift = 8;
   }
   else if (lp == LSM303AGR_ACC_LPEN_DISABLED && hr == LSM303AGR_ACC_HR_DISABLED)
   {
     /* op mode is Normal 10-bit */
     op_mode = 1;
-    shift = 6;
+    *shift = 6;
   }
   else if (lp == LSM303AGR_ACC_LPEN_DISABLED && hr == LSM303AGR_ACC_HR_ENABLED)
   {
     /* op mode is HR 12-bit */
     op_mode = 0;
-    shift = 4;
+    *shift = 4;
   }
   else
     return MEMS_ERROR;
 
   /* Determine the Full Scale the acc is set */
-  LSM303AGR_ACC_R_FullScale(handle, &fs);
+  if( !LSM303AGR_ACC_R_FullScale(handle, &fs) )
+    return MEMS_ERROR;
+
   switch (fs)
   {
     case LSM303AGR_ACC_FS_2G:
@@ -316,13 +313,167 @@ status_t LSM303AGR_ACC_Get_Acceleration(void *handle, int *buff)
       break;
   }
 
+  *sensitivity = LSM303AGR_ACC_Sensitivity_List[op_mode][fs_mode];
+  return MEMS_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name  : status_t LSM303AGR_ACC_Get_Acceleration(void *handle, int *buff)
+* Description    : Read GetAccData output register
+* Input          : pointer to [u8_t]
+* Output         : values are expressed in mg
+* Return         : Status [MEMS_ERROR, MEMS_SUCCESS]
+*******************************************************************************/
+status_t LSM303AGR_ACC_Get_Acceleration(void *handle, int *buff)
+{
+  Type3Axis16bit_U raw_data_tmp;
+  u8_t shift = 0;
+  long long sensitivity;
+
+  if( !LSM303AGR_ACC_Get_Sensitivity(handle, &shift, &sensitivity) )
+    return MEMS_ERROR;
+
   /* Read out raw accelerometer samples */
-  LSM303AGR_ACC_Get_Raw_Acceleration(handle, raw_data_tmp.u8bit);
+  if( !LSM303AGR_ACC_Get_Raw_Acceleration(handle, raw_data_tmp.u8bit) )
+    return MEMS_ERROR;
 
   /* Apply proper shift and sensitivity */
-  buff[0] = ((raw_data_tmp.i16bit[0] >> shift) * LSM303AGR_ACC_Sensitivity_List[op_mode][fs_mode] + 500) / 1000;
-  buff[1] = ((raw_data_tmp.i16bit[1] >> shift) * LSM303AGR_ACC_Sensitivity_List[op_mode][fs_mode] + 500) / 1000;
-  buff[2] = ((raw_data_tmp.i16bit[2] >> shift) * LSM303AGR_ACC_Sensitivity_List[op_mode][fs_mode] + 500) / 1000;
+  buff[0] = ((raw_data_tmp.i16bit[0] >> shift) * sensitivity + 500) / 1000;
+  buff[1] = ((raw_data_tmp.i16bit[1] >> shift) * sensitivity + 500) / 1000;
+  buff[2] = ((raw_data_tmp.i16bit[2] >> shift) * sensitivity + 500) / 1000;
+
+  return MEMS_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name  : status_t LSM303AGR_ACC_Enable_FIFO(void *handle, u8_t watermark)
+* Description    : Enable the FIFO in stream mode and signal the watermark on INT1
+* Input          : Number of stored samples which raises the watermark interrupt [0, 31]
+* Output         : None
+* Return         : Status [MEMS_ERROR, MEMS_SUCCESS]
+*******************************************************************************/
+/*
+ * The FIFO is reset by passing through bypass mode first. In stream mode the oldest
+ * samples are discarded when the FIFO is full, the watermark interrupt allows the MCU
+ * to sleep until a batch of samples is ready to be read with one burst transfer.
+ */
+status_t LSM303AGR_ACC_Enable_FIFO(void *handle, u8_t watermark)
+{
+  u8_t value;
+
+  if( watermark > LSM303AGR_ACC_FTH_MASK )
+    return MEMS_ERROR;
+
+  if( !LSM303AGR_ACC_W_FifoMode(handle, LSM303AGR_ACC_FM_BYPASS) )
+    return MEMS_ERROR;
+
+  if( !LSM303AGR_ACC_W_FIFO_EN(handle, LSM303AGR_ACC_FIFO_EN_ENABLED) )
+    return MEMS_ERROR;
+
+  /* mode, trigger and threshold share FIFO_CTRL_REG */
+  value = LSM303AGR_ACC_FM_STREAM | LSM303AGR_ACC_TR_TRIGGER_ON_INT1 | (watermark << LSM303AGR_ACC_FTH_POSITION);
+  if( !LSM303AGR_ACC_WriteReg( handle, LSM303AGR_ACC_FIFO_CTRL_REG, &value, 1) )
+    return MEMS_ERROR;
+
+  if( !LSM303AGR_ACC_W_FIFO_Watermark_on_INT1(handle, LSM303AGR_ACC_I1_WTM_ENABLED) )
+    return MEMS_ERROR;
+
+  return MEMS_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name  : status_t LSM303AGR_ACC_Disable_FIFO(void *handle)
+* Description    : Disable the watermark interrupt and the FIFO
+* Input          : None
+* Output         : None
+* Return         : Status [MEMS_ERROR, MEMS_SUCCESS]
+*******************************************************************************/
+status_t LSM303AGR_ACC_Disable_FIFO(void *handle)
+{
+  if( !LSM303AGR_ACC_W_FIFO_Watermark_on_INT1(handle, LSM303AGR_ACC_I1_WTM_DISABLED) )
+    return MEMS_ERROR;
+
+  if( !LSM303AGR_ACC_W_FifoMode(handle, LSM303AGR_ACC_FM_BYPASS) )
+    return MEMS_ERROR;
+
+  if( !LSM303AGR_ACC_W_FIFO_EN(handle, LSM303AGR_ACC_FIFO_EN_DISABLED) )
+    return MEMS_ERROR;
+
+  return MEMS_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name  : status_t LSM303AGR_ACC_Get_Raw_Acceleration_FIFO(void *handle, u8_t *buff, u8_t max_samples, u8_t *samples)
+* Description    : Read the samples stored in the FIFO
+* Input          : pointer to [u8_t] of 6 * max_samples bytes, maximum number of samples to read
+* Output         : Acceleration buffer u8_t, number of samples read
+* Return         : Status [MEMS_ERROR, MEMS_SUCCESS]
+*******************************************************************************/
+/*
+ * When the FIFO is enabled the register address auto increment wraps from OUT_Z_H
+ * back to OUT_X_L, so all samples are read in a single burst transfer.
+ */
+status_t LSM303AGR_ACC_Get_Raw_Acceleration_FIFO(void *handle, u8_t *buff, u8_t max_samples, u8_t *samples)
+{
+  u8_t fifo_src;
+  u8_t count;
+
+  *samples = 0;
+  if( !LSM303AGR_ACC_ReadReg( handle, LSM303AGR_ACC_FIFO_SRC_REG, &fifo_src, 1) )
+    return MEMS_ERROR;
+
+  if( fifo_src & LSM303AGR_ACC_EMPTY_MASK )
+    return MEMS_SUCCESS;
+
+  /* FSS only counts up to 31 unread samples, the overrun flag indicates all levels are filled */
+  if( fifo_src & LSM303AGR_ACC_OVRN_FIFO_MASK )
+    count = LSM303AGR_ACC_FIFO_SIZE;
+  else
+    count = (fifo_src & LSM303AGR_ACC_FSS_MASK) >> LSM303AGR_ACC_FSS_POSITION;
+
+  if( count > max_samples )
+    count = max_samples;
+
+  if( count == 0 )
+    return MEMS_SUCCESS;
+
+  if( !LSM303AGR_ACC_ReadReg( handle, LSM303AGR_ACC_OUT_X_L, buff, count * 6) )
+    return MEMS_ERROR;
+
+  *samples = count;
+  return MEMS_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name  : status_t LSM303AGR_ACC_Get_Acceleration_FIFO(void *handle, int *buff, u8_t max_samples, u8_t *samples)
+* Description    : Read the samples stored in the FIFO
+* Input          : pointer to [int] of 3 * max_samples values, maximum number of samples to read
+* Output         : values are expressed in mg, number of samples read
+* Return         : Status [MEMS_ERROR, MEMS_SUCCESS]
+*******************************************************************************/
+status_t LSM303AGR_ACC_Get_Acceleration_FIFO(void *handle, int *buff, u8_t max_samples, u8_t *samples)
+{
+  Type3Axis16bit_U raw_data_tmp;
+  u8_t *raw_data = (u8_t *)buff;
+  u8_t shift = 0;
+  long long sensitivity;
+
+  *samples = 0;
+  if( !LSM303AGR_ACC_Get_Sensitivity(handle, &shift, &sensitivity) )
+    return MEMS_ERROR;
+
+  /* The raw samples take less space than the converted ones, so they are read into the output
+   * buffer and converted starting from the last sample, without overwriting unconverted samples */
+  if( !LSM303AGR_ACC_Get_Raw_Acceleration_FIFO(handle, raw_data, max_samples, samples) )
+    return MEMS_ERROR;
+
+  for( int i = *samples - 1; i >= 0; i-- )
+  {
+    memcpy(raw_data_tmp.u8bit, raw_data + (i * 6), 6);
+    buff[(i * 3) + 0] = ((raw_data_tmp.i16bit[0] >> shift) * sensitivity + 500) / 1000;
+    buff[(i * 3) + 1] = ((raw_data_tmp.i16bit[1] >> shift) * sensitivity + 500) / 1000;
+    buff[(i * 3) + 2] = ((raw_data_tmp.i16bit[2] >> shift) * sensitivity + 500) / 1000;
+  }
 
   return MEMS_SUCCESS;
 }
@@ -219,6 +219,17 @@ status_t LSM303AGR_ACC_R_FullScale(void *handle, LSM303AGR_ACC_FS_t *value);
 status_t LSM303AGR_ACC_Get_Raw_Acceleration(void *handle, u8_t *buff);
 status_t LSM303AGR_ACC_Get_Acceleration(void *handle, int *buff);
 
+/*******************************************************************************
+* Register      : FIFO_CTRL_REG, FIFO_SRC_REG, <REGISTER_L> - <REGISTER_H>
+* Output Type   : Acceleration samples stored in the FIFO
+* Permission    : RW
+*******************************************************************************/
+#define   LSM303AGR_ACC_FIFO_SIZE   32
+status_t LSM303AGR_ACC_Enable_FIFO(void *handle, u8_t watermark);
+status_t LSM303AGR_ACC_Disable_FIFO(void *handle);
+status_t LSM303AGR_ACC_Get_Raw_Acceleration_FIFO(void *handle, u8_t *buff, u8_t max_samples, u8_t *samples);
+status_t LSM303AGR_ACC_Get_Acceleration_FIFO(void *handle, int *buff, u8_t max_samples, u8_t *samples);
+
 /*******************************************************************************
 * Register      : CTRL_REG1
 * Address       : 0X20
@@ -207,6 +207,18 @@ void hw_enter_lowpower_mode(uint8_t mode)
   DPRINT("wake up @ %i", hw_timer_getvalue(0) );
 }
 
+// STANDBY mode is not listed since it resets the MCU. Leaving STOP mode includes reinitializing the clock config.
+static const hw_lowpower_mode_t lowpower_modes[] = {
+    { .mode = 0, .wakeup_latency_us = 1, .current_na = 1000000 }, // sleep
+    { .mode = 1, .wakeup_latency_us = 100, .current_na = 1000 }, // STOP, with the LPTIM running
+};
+
+const hw_lowpower_mode_t* hw_get_lowpower_modes(uint8_t* count)
+{
+    *count = sizeof(lowpower_modes) / sizeof(lowpower_modes[0]);
+    return lowpower_modes;
+}
+
 uint64_t hw_get_unique_id()
 {
     // note we are ignoring WAF_NUM and LOT_NUM[55:32] to reduce the 96 bits UID to 64 bits
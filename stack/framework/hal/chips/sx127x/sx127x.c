@@ -36,6 +36,8 @@
 #include "hwspi.h"
 #include "platform.h"
 #include "errors.h"
+#include "timer.h"
+#include "hwatomic.h"
 
 #include "sx1276Regs-Fsk.h"
 #include "sx1276Regs-LoRa.h"
@@ -168,6 +170,9 @@ static rx_packet_callback_t rx_packet_callback;
 static tx_packet_callback_t tx_packet_callback;
 static rx_packet_header_callback_t rx_packet_header_callback;
 static tx_refill_callback_t tx_refill_callback;
+static rssi_valid_callback_t rssi_measurement_callback;
+static int16_t measured_rssi;
+static timer_tick_t tx_done_timestamp;
 static state_t state = STATE_STANDBY;
 static hw_radio_packet_t* current_packet;
 
@@ -183,6 +188,8 @@ static bool lora_mode = false;
 
 void set_opmode(uint8_t opmode);
 static void fifo_threshold_isr();
+static void rssi_measurement_done(void* arg);
+static void signal_rssi_measurement(void* arg);
 
 static void enable_spi_io() {
   if(!io_inited){
@@ -192,22 +199,27 @@ static void enable_spi_io() {
   spi_enable(spi_handle);
 }
 
+// the SPI transactions are atomic, the precise lane of the radio accesses the registers from the timer interrupt
 static uint8_t read_reg(uint8_t addr) {
+  start_atomic();
   enable_spi_io();
   spi_select(sx127x_spi);
   spi_exchange_byte(sx127x_spi, addr & 0x7F); // send address with bit 7 low to signal a read operation
   uint8_t value = spi_exchange_byte(sx127x_spi, 0x00); // get the response
   spi_deselect(sx127x_spi);
+  end_atomic();
   //DPRINT("READ %02x: %02x\n", addr, value);
   return value;
 }
 
 static void write_reg(uint8_t addr, uint8_t value) {
+  start_atomic();
   enable_spi_io();
   spi_select(sx127x_spi);
   spi_exchange_byte(sx127x_spi, addr | 0x80); // send address with bit 8 high to signal a write operation
   spi_exchange_byte(sx127x_spi, value);
   spi_deselect(sx127x_spi);
+  end_atomic();
   //DPRINT("WRITE %02x: %02x", addr, value);
 }
 
@@ -217,21 +229,25 @@ void write_reg_16(uint8_t start_reg, uint16_t value) {
 }
 
 static void write_fifo(uint8_t* buffer, uint8_t size) {
+  start_atomic();
   enable_spi_io();
   spi_select(sx127x_spi);
   spi_exchange_byte(sx127x_spi, 0x80); // send address with bit 8 high to signal a write operation
   spi_exchange_bytes(sx127x_spi, buffer, NULL, size);
   spi_deselect(sx127x_spi);
+  end_atomic();
   // DPRINT("WRITE FIFO %i", size);
   // DPRINT_DATA(buffer, size);
 }
 
 static void read_fifo(uint8_t* buffer, uint8_t size) {
+  start_atomic();
   enable_spi_io();
   spi_select(sx127x_spi);
   spi_exchange_byte(sx127x_spi, REG_FIFO);
   spi_exchange_bytes(sx127x_spi, NULL, buffer, size);
   spi_deselect(sx127x_spi);
+  end_atomic();
   DPRINT("READ FIFO %i", size);
 }
 
@@ -411,14 +427,23 @@ static inline int16_t get_rssi() {
   return (- read_reg(REG_RSSIVALUE) >> 1);
 }
 
+static void signal_packet_transmitted(void* arg) {
+  if(tx_packet_callback)
+    tx_packet_callback(tx_done_timestamp);
+}
+
+// called from the precise lane of the timer
+static void packet_transmitted_done(void* arg) {
+  tx_done_timestamp = timer_get_counter_value();
+  sched_post_task_prio(&signal_packet_transmitted, MAX_PRIORITY, NULL);
+}
+
 static void packet_transmitted_isr() {
 
   DEBUG_TX_END();
   DEBUG_FG_END();
-  hw_busy_wait(110); // TO DO: OPTIMISE
-
-  if(tx_packet_callback)
-    tx_packet_callback(timer_get_counter_value());
+  // TO DO: OPTIMISE, the upper layer is signaled 110 us after the packet sent interrupt
+  timer_post_precise_task_delay_us(TIMER_PRECISE_LANE_RADIO, &packet_transmitted_done, 110, NULL);
 }
 
 static void bg_scan_rx_done() 
@@ -741,6 +766,8 @@ error_t hw_radio_init(hwradio_init_args_t* init_args) {
   sched_register_task(&packet_transmitted_isr);
   sched_register_task(&fifo_threshold_isr);
   sched_register_task(&wait_for_fifo_level_isr);
+  sched_register_task(&signal_packet_transmitted);
+  sched_register_task(&signal_rssi_measurement);
 
   return SUCCESS; // TODO FAIL return code
 }
@@ -764,6 +791,9 @@ error_t hw_radio_set_idle() {
     sched_cancel_task(&wait_for_fifo_level_isr);
     sched_cancel_task(&bg_scan_rx_done);
     sched_cancel_task(&packet_transmitted_isr);
+    timer_cancel_precise_task(TIMER_PRECISE_LANE_RADIO);
+    sched_cancel_task(&signal_packet_transmitted);
+    sched_cancel_task(&signal_rssi_measurement);
     timer_cancel_task(&rx_timeout);
     DPRINT("set to sleep at %i\n", timer_get_counter_value());
     DEBUG_RX_END();
@@ -1178,15 +1208,42 @@ __attribute__((weak)) void hw_radio_io_deinit() {
 /* startup time = TS_RE + TS_RSSI */
 /* with TS_RE = rx_bw_startup_time */
 /* with TS_RSSI = 2^(rssi_smoothing + 1) / (4 * RXBW[kHz]) [ms] */
-int16_t hw_radio_get_rssi() {
+static int16_t start_rssi_measurement() {
     set_opmode(OPMODE_RX); //0.103 ms
     hw_gpio_disable_interrupt(SX127x_DIO0_PIN); //3.7µs
     hw_gpio_disable_interrupt(SX127x_DIO1_PIN);
-    if(!lora_mode) {
-      hw_busy_wait(rx_bw_startup_time[rx_bw_number] + (rssi_smoothing_full * 1000)/(4 * rx_bw_khz));
+    if(!lora_mode)
+      return rx_bw_startup_time[rx_bw_number] + (rssi_smoothing_full * 1000)/(4 * rx_bw_khz);
+    else
+      return rx_bw_startup_time[lora_bw_indexes[lora_closest_bw_index]] + ((rssi_smoothing_full * 1000)/(4 * lora_available_bw[lora_closest_bw_index] / 1000));
+}
+
+static int16_t read_rssi() {
+    if(!lora_mode)
       return (- read_reg(REG_RSSIVALUE) >> 1);
-    } else {
-      hw_busy_wait(rx_bw_startup_time[lora_bw_indexes[lora_closest_bw_index]] + ((rssi_smoothing_full * 1000)/(4 * lora_available_bw[lora_closest_bw_index] / 1000)));
+    else
       return ( - 157 + read_reg(REG_LR_RSSIVALUE));
-    }
+}
+
+int16_t hw_radio_get_rssi() {
+    hw_busy_wait(start_rssi_measurement());
+    return read_rssi();
+}
+
+static void signal_rssi_measurement(void* arg) {
+    rssi_valid_callback_t callback = rssi_measurement_callback;
+    rssi_measurement_callback = NULL;
+    if(callback)
+      callback(measured_rssi);
+}
+
+// called from the precise lane of the timer, the RSSI is read as soon as it is valid
+static void rssi_measurement_done(void* arg) {
+    measured_rssi = read_rssi();
+    sched_post_task_prio(&signal_rssi_measurement, MAX_PRIORITY, NULL);
+}
+
+void hw_radio_start_rssi_measurement(rssi_valid_callback_t rssi_cb) {
+    rssi_measurement_callback = rssi_cb;
+    timer_post_precise_task_delay_us(TIMER_PRECISE_LANE_RADIO, &rssi_measurement_done, start_rssi_measurement(), NULL);
 }
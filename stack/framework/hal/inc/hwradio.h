@@ -414,6 +414,15 @@ bool hw_radio_rssi_valid(void);
  */
 __LINK_C int16_t hw_radio_get_rssi(void);
 
+/** \brief Switch to RX and measure the RSSI once it is valid, without blocking until then.
+ *
+ * The RSSI is read from the radio precise lane of the timer as soon as it is valid (see timer_post_precise_task()),
+ * the callback is invoked with the measured RSSI from a task posted by that lane.
+ * This is a weak symbol which is only implemented by the radio drivers which support it, otherwise
+ * hw_radio_get_rssi() has to be used.
+ */
+__LINK_C __attribute__((weak)) void hw_radio_start_rssi_measurement(rssi_valid_callback_t rssi_cb);
+
 hw_radio_state_t hw_radio_get_opmode(void);
 void hw_radio_set_opmode(hw_radio_state_t opmode);
 
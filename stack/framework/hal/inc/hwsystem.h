@@ -65,6 +65,25 @@ void hw_system_save_reboot_reason(void);
  */
 __LINK_C void hw_enter_lowpower_mode(uint8_t mode);
 
+/*! \brief The cost of a low power mode, used by the scheduler to select the mode automatically
+ */
+typedef struct
+{
+    uint8_t mode;               /**< The mode passed to hw_enter_lowpower_mode() */
+    uint32_t wakeup_latency_us; /**< The time needed to enter and leave the mode, including restoring the clocks */
+    uint32_t current_na;        /**< The typical supply current of the MCU while in this mode */
+} hw_lowpower_mode_t;
+
+/*! \brief Returns the low power modes of the MCU in which the framework timer keeps running, ordered from the
+ * least to the most power saving mode. The first entry is always mode 0.
+ *
+ * Only implemented by the chips of which the low power modes are characterised, FRAMEWORK_SCHEDULER_LP_MODE_AUTO
+ * requires it.
+ *
+ * \param count  Set to the number of entries in the returned table
+ */
+__LINK_C const hw_lowpower_mode_t* hw_get_lowpower_modes(uint8_t* count);
+
 
 /** \brief Deinitializes all pheriperals before going to low power mode.
  * This is a weak symbol which can be implemented in the platform if you want to use this
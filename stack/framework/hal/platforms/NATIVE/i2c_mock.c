@@ -0,0 +1,220 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2019 Aloxy
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "string.h"
+
+#include "hwi2c.h"
+#include "i2c_mock.h"
+#include "debug.h"
+
+struct i2c_handle {
+    uint8_t port_idx;
+    bool acquired;
+};
+
+static i2c_handle_t handle;
+static i2c_mock_device_t* devices = NULL;
+static i2c_mock_stats_t stats;
+
+static i2c_mock_device_t* get_device(uint8_t address)
+{
+    for(i2c_mock_device_t* device = devices; device != NULL; device = device->next)
+    {
+        if(device->address == address)
+            return device;
+    }
+
+    return NULL;
+}
+
+static uint8_t read_register(i2c_mock_device_t* device, uint8_t register_address)
+{
+    if(device->read_callback)
+        return device->read_callback(device, register_address);
+
+    return device->registers[register_address];
+}
+
+static void write_register(i2c_mock_device_t* device, uint8_t register_address, uint8_t value)
+{
+    if(device->write_callback)
+        device->write_callback(device, register_address, value);
+    else
+        device->registers[register_address] = value;
+}
+
+static uint8_t next_register(i2c_mock_device_t* device, uint8_t register_address, uint8_t increment)
+{
+    if(increment && device->next_register_callback)
+        return device->next_register_callback(device, register_address);
+
+    return register_address + increment;
+}
+
+// returns the increment of the register address for every byte transferred, and strips the auto increment bit
+static uint8_t get_register_increment(i2c_mock_device_t* device, uint8_t* register_address)
+{
+    if(device->auto_increment_mask == 0)
+        return 1;
+
+    if(*register_address & device->auto_increment_mask)
+    {
+        *register_address &= ~device->auto_increment_mask;
+        return 1;
+    }
+
+    return 0;
+}
+
+static bool transfer_read(i2c_mock_device_t* device, uint8_t register_address, uint8_t* payload, int length)
+{
+    uint8_t increment = get_register_increment(device, &register_address);
+    for(int i = 0; i < length; i++)
+    {
+        payload[i] = read_register(device, register_address);
+        register_address = next_register(device, register_address, increment);
+    }
+
+    device->register_pointer = register_address;
+    stats.bytes_read += length;
+    return true;
+}
+
+static bool transfer_write(i2c_mock_device_t* device, uint8_t register_address, uint8_t* payload, int length)
+{
+    uint8_t increment = get_register_increment(device, &register_address);
+    for(int i = 0; i < length; i++)
+    {
+        write_register(device, register_address, payload[i]);
+        register_address = next_register(device, register_address, increment);
+    }
+
+    device->register_pointer = register_address;
+    stats.bytes_written += length;
+    return true;
+}
+
+void i2c_mock_attach_device(i2c_mock_device_t* device)
+{
+    assert(get_device(device->address) == NULL);
+    device->register_pointer = 0;
+    device->next = devices;
+    devices = device;
+}
+
+void i2c_mock_detach_all_devices()
+{
+    devices = NULL;
+}
+
+const i2c_mock_stats_t* i2c_mock_get_stats()
+{
+    return &stats;
+}
+
+void i2c_mock_reset_stats()
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+i2c_handle_t* i2c_init(uint8_t i2c_port_idx, uint8_t pins, uint32_t baudrate, bool pullup)
+{
+    handle.port_idx = i2c_port_idx;
+    handle.acquired = false;
+    return &handle;
+}
+
+int8_t i2c_deinit(i2c_handle_t* i2c)
+{
+    return 0;
+}
+
+void i2c_acquire(i2c_handle_t* i2c)
+{
+    assert(!i2c->acquired);
+    i2c->acquired = true;
+    stats.acquires++;
+}
+
+void i2c_release(i2c_handle_t* i2c)
+{
+    assert(i2c->acquired);
+    i2c->acquired = false;
+}
+
+int8_t i2c_write(i2c_handle_t* i2c, uint8_t address, uint8_t* tx_buffer, int length)
+{
+    stats.transactions++;
+    i2c_mock_device_t* device = get_device(address);
+    if(device == NULL)
+        return false;
+
+    // the first byte selects the register, a write of only the register address sets the register pointer
+    if(length == 0)
+        return true;
+
+    if(length == 1)
+    {
+        device->register_pointer = tx_buffer[0];
+        return true;
+    }
+
+    return transfer_write(device, tx_buffer[0], tx_buffer + 1, length - 1);
+}
+
+int8_t i2c_read(i2c_handle_t* i2c, uint8_t address, uint8_t* rx_buffer, int length)
+{
+    stats.transactions++;
+    i2c_mock_device_t* device = get_device(address);
+    if(device == NULL)
+        return false;
+
+    return transfer_read(device, device->register_pointer, rx_buffer, length);
+}
+
+int8_t i2c_write_memory(i2c_handle_t* i2c, uint8_t to, uint16_t register_address, uint8_t register_address_size, uint8_t* payload, int length)
+{
+    assert(register_address_size == 8);
+    stats.transactions++;
+    i2c_mock_device_t* device = get_device(to);
+    if(device == NULL)
+        return false;
+
+    return transfer_write(device, (uint8_t)register_address, payload, length);
+}
+
+int8_t i2c_read_memory(i2c_handle_t* i2c, uint8_t to, uint16_t register_address, uint8_t register_address_size, uint8_t* payload, int length)
+{
+    assert(register_address_size == 8);
+    stats.transactions++;
+    i2c_mock_device_t* device = get_device(to);
+    if(device == NULL)
+        return false;
+
+    return transfer_read(device, (uint8_t)register_address, payload, length);
+}
+
+int8_t i2c_write_read(i2c_handle_t* i2c, uint8_t address, uint8_t* tx_buffer, int lengthtx, uint8_t* rx_buffer, int lengthrx)
+{
+    // a repeated start, so both parts are one transaction
+    if(!i2c_write(i2c, address, tx_buffer, lengthtx))
+        return false;
+
+    i2c_mock_device_t* device = get_device(address);
+    return transfer_read(device, device->register_pointer, rx_buffer, lengthrx);
+}
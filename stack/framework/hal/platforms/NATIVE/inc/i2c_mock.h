@@ -0,0 +1,72 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2019 Aloxy
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file i2c_mock.h
+ * \addtogroup I2C
+ * \ingroup HAL
+ * @{
+ * \brief Mock I2C bus used on the NATIVE platform
+ *
+ * The NATIVE implementation of hwi2c.h routes all transfers to the devices attached using i2c_mock_attach_device().
+ * A device is modelled as a register map; the optional read and write callbacks allow to emulate registers with side
+ * effects, like a hardware FIFO. Register accesses with the auto increment bit set in the register address access the
+ * consecutive registers, otherwise every byte accesses the same register. The next register callback allows to
+ * emulate devices which roll over the register address during auto increment.
+ * Every transfer is counted so the number of bus transactions needed by a driver can be verified.
+ */
+
+#ifndef I2C_MOCK_H_
+#define I2C_MOCK_H_
+
+#include "types.h"
+#include "link_c.h"
+
+#define I2C_MOCK_REGISTER_COUNT 256
+
+typedef struct i2c_mock_device i2c_mock_device_t;
+
+typedef uint8_t (*i2c_mock_read_callback_t)(i2c_mock_device_t* device, uint8_t register_address);
+typedef void (*i2c_mock_write_callback_t)(i2c_mock_device_t* device, uint8_t register_address, uint8_t value);
+typedef uint8_t (*i2c_mock_next_register_callback_t)(i2c_mock_device_t* device, uint8_t register_address);
+
+struct i2c_mock_device {
+    uint8_t address;
+    uint8_t auto_increment_mask; //!< bit in the register address which enables auto increment, 0 if always enabled
+    uint8_t registers[I2C_MOCK_REGISTER_COUNT];
+    i2c_mock_read_callback_t read_callback; //!< when set, called instead of reading the register map
+    i2c_mock_write_callback_t write_callback; //!< when set, called instead of writing the register map
+    i2c_mock_next_register_callback_t next_register_callback; //!< when set, returns the register following register_address during auto increment
+    uint8_t register_pointer; //!< register accessed by a plain read, set by the first byte of a plain write
+    i2c_mock_device_t* next;
+};
+
+typedef struct {
+    uint32_t transactions; //!< number of transfers on the bus, a register access counts as one transfer
+    uint32_t bytes_read;
+    uint32_t bytes_written;
+    uint32_t acquires;
+} i2c_mock_stats_t;
+
+__LINK_C void i2c_mock_attach_device(i2c_mock_device_t* device);
+__LINK_C void i2c_mock_detach_all_devices();
+__LINK_C const i2c_mock_stats_t* i2c_mock_get_stats();
+__LINK_C void i2c_mock_reset_stats();
+
+#endif
+
+/** @}*/
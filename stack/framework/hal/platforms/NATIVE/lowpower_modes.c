@@ -0,0 +1,32 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hwsystem.h"
+
+// native does not sleep, these are the costs of the STM32L0 sleep and STOP modes, so the automatic low power mode
+// selection can be simulated. This is kept out of platf_main.c, so tests can link it without the native main().
+static const hw_lowpower_mode_t lowpower_modes[] = {
+    { .mode = 0, .wakeup_latency_us = 1, .current_na = 1000000 },
+    { .mode = 1, .wakeup_latency_us = 100, .current_na = 1000 },
+};
+
+__LINK_C const hw_lowpower_mode_t* hw_get_lowpower_modes(uint8_t* count)
+{
+    *count = sizeof(lowpower_modes) / sizeof(lowpower_modes[0]);
+    return lowpower_modes;
+}
@@ -100,6 +100,7 @@ __LINK_C error_t hw_timer_init(hwtimer_id_t timer_id, uint8_t frequency, timer_c
 __LINK_C bool hw_timer_is_overflow_pending(hwtimer_id_t id) {}
 __LINK_C error_t hw_timer_cancel(hwtimer_id_t timer_id) {}
 __LINK_C uint64_t hw_get_unique_id(void) { return 0xFFFFFFFFFFFFFF;}
+__LINK_C void hw_busy_wait(int16_t microseconds) {}
 __LINK_C void hw_watchdog_feed(void) {};
 __LINK_C void __watchdog_init(void) {};
 __LINK_C void hw_watchdog_get_timeout(void) {};
@@ -50,8 +50,21 @@
   #define CTR 1
 #endif
 
+/*! \brief The expanded round keys of a 128 bit key */
+typedef struct {
+    uint8_t round_key[176];
+} aes128_key_schedule_t;
+
 void AES128_init(const uint8_t *key);
 
+/*! \brief Expands a key into a separate key schedule, for use with the *_with_key_schedule() functions.
+ *
+ * Contrary to AES128_init(), which sets the key used by all other functions, this keeps no global state. This allows
+ * for instance host tools to decrypt with different keys in parallel. These functions always use the software
+ * implementation.
+ */
+void AES128_init_key_schedule(aes128_key_schedule_t* key_schedule, const uint8_t *key);
+
 #if defined(ECB) && ECB
 
 // The two functions AES128_ECB_xxcrypt() do most of the work, and they expect inputs of 128 bit length.
@@ -70,8 +83,27 @@ void AES128_CBC_decrypt_buffer(uint8_t *output, uint8_t *input, uint32_t length,
 
 #if defined(CTR) && CTR
 void AES128_CTR_encrypt(uint8_t *output, uint8_t *input, uint32_t length, uint8_t* ctr_blk);
+void AES128_CTR_encrypt_with_key_schedule(const aes128_key_schedule_t* key_schedule, uint8_t *output, uint8_t *input,
+                                          uint32_t length, uint8_t* ctr_blk);
 // Decryption is exactly the same operation as encryption
 
+/*! \brief Starts precomputing the keystream of block_count counter blocks, starting at ctr_blk, for the key set
+ * using AES128_init(). The keystream of a previous call is discarded.
+ *
+ * AES128_CTR_encrypt() uses the precomputed keystream when all counter blocks it needs are computed, so encryption
+ * is reduced to an XOR. The cache holds FRAMEWORK_AES_KEYSTREAM_CACHE_BLOCKS blocks, 0 disables it. Since the cache is
+ * tagged by the counter block, a frame counter change is a cache miss. A key change clears the cache.
+ */
+void AES128_CTR_start_keystream(const uint8_t *ctr_blk, uint16_t block_count);
+
+/*! \brief Computes the next block of the keystream started by AES128_CTR_start_keystream(), to be called when idle
+ *
+ * \return true when more blocks are to be computed
+ */
+bool AES128_CTR_precompute_keystream_block();
+
+void AES128_CTR_clear_keystream();
+
 #endif // #if defined(CTR) && CTR
 
 /*! \brief AES CBC-MAC (Cipher Block Chaining MAC).
@@ -45,6 +45,8 @@
 
 #define ALP_PAYLOAD_MAX_SIZE 255 // TODO configurable?
 #define ALP_QUERY_COMPARE_BODY_MAX_SIZE 100
+#define ALP_QUERY_BLOOM_FILTER_ITEM_SIZE 8 // D7A_FILE_UID_SIZE
+#define ALP_QUERY_BLOOM_FILTER_MAX_HASH_COUNT 15
 #define ALP_ITF_CONFIG_SIZE 43
 #define ALP_ITF_STATUS_MAX_SIZE 40
 #define ALP_INDIRECT_ITF_OVERLOAD_MAX_SIZE 10
@@ -246,7 +248,10 @@ typedef enum {
     QUERY_CODE_TYPE_ARITHM_COMP_WITH_VALUE_IN_QUERY = 2,
     QUERY_CODE_TYPE_ARITHM_COMP_WITH_FILES = 3,
     QUERY_CODE_TYPE_RANGE_COMP_WITH_BITMAP = 4,
-    // 5-6 RFU
+    // OSS-7 specific: the compare body is a Bloom filter (param is the hash count) which should contain the
+    // ALP_QUERY_BLOOM_FILTER_ITEM_SIZE bytes at the file offset, normally the UID file
+    QUERY_CODE_TYPE_BLOOM_FILTER = 5,
+    // 6 RFU
     QUERY_CODE_TYPE_STRING_TOKEN_SEARCH = 7,
 } alp_query_code_type_t;
 
@@ -327,8 +332,15 @@ typedef struct {
 #endif
     fifo_t alp_command_fifo;
     uint8_t alp_command[ALP_PAYLOAD_MAX_SIZE];
+    uint16_t expected_response_length; // length of the response to the actions in alp_command_fifo, maintained by the append and parse functions
+    uint16_t expected_response_length_fifo_size; // the fifo size expected_response_length applies to, differs when data was put in the fifo directly
 } alp_command_t;
 
+/*!
+ * \brief Returns the length of the response the actions in the command will result in.
+ * This is kept up to date while actions are appended or parsed, the command is only parsed completely
+ * when data was put in the command fifo directly instead of using the alp_append_* functions.
+ */
 int alp_get_expected_response_length(alp_command_t* command);
 
 alp_status_codes_t alp_register_interface(alp_interface_t* itf);
@@ -336,6 +348,8 @@ bool alp_append_tag_request_action(alp_command_t* command, uint8_t tag_id, bool
 bool alp_append_tag_response_action(alp_command_t* command, uint8_t tag_id, bool eop, bool err);
 bool alp_append_read_file_data_action(alp_command_t* command, uint8_t file_id, uint32_t offset, uint32_t length, bool resp, bool group);
 bool alp_append_write_file_data_action(alp_command_t* command, uint8_t file_id, uint32_t offset, uint32_t length, uint8_t* data, bool resp, bool group);
+bool alp_append_break_query_action(alp_command_t* command, uint8_t file_id, uint32_t offset, uint8_t* compare_value, uint32_t length, alp_query_arithmetic_comparison_type_t comp_type);
+bool alp_append_bloom_filter_query_action(alp_command_t* command, uint8_t file_id, uint32_t offset, uint8_t* filter, uint32_t filter_size, uint8_t hash_count);
 bool alp_append_forward_action(alp_command_t* command, alp_interface_config_t* config, uint8_t config_len);
 bool alp_append_return_file_data_action(alp_command_t* command, uint8_t file_id, uint32_t offset, uint32_t length, uint8_t* data);
 bool alp_append_length_operand(alp_command_t* command, uint32_t length);
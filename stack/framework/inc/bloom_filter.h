@@ -0,0 +1,57 @@
+/*! \file bloom_filter.h
+ *
+
+ *  \copyright (C) Copyright 2016 University of Antwerp and others (http://oss-7.cosys.be)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*!
+ * \file bloom_filter.h
+ * \addtogroup bloom_filter
+ * \ingroup framework
+ * @{
+ * \brief Implements a Bloom filter, a compact set representation without false negatives
+ *
+ * The bit positions of an item are derived from its FNV-1a hash, finalized into two independent hashes h1 and h2
+ * which are combined using double hashing: (h1 + i * h2) mod m for i < hash_count, where m is the filter size in bits. The filter is transmitted over the air, so the encoding is
+ * fixed: bit n is stored in byte n / 8 at bit position n % 8.
+ */
+
+#ifndef BLOOM_FILTER_H_
+#define BLOOM_FILTER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*! \brief Adds an item to the filter, the filter has to be cleared by the caller before adding the first item
+ *
+ * \param filter_size The size of the filter in bytes
+ * \param hash_count  The number of bit positions per item
+ */
+void bloom_filter_add(uint8_t* filter, uint16_t filter_size, uint8_t hash_count, const uint8_t* item, uint8_t item_length);
+
+/*! \brief Returns false when the item was certainly not added to the filter */
+bool bloom_filter_contains(const uint8_t* filter, uint16_t filter_size, uint8_t hash_count, const uint8_t* item, uint8_t item_length);
+
+/*! \brief Returns the number of hashes which minimizes the false positive rate, (m / n) * ln(2), limited to max_hash_count
+ *
+ * \param filter_size The size of the filter in bytes
+ * \param item_count  The number of items which will be added
+ */
+uint8_t bloom_filter_get_optimal_hash_count(uint16_t filter_size, uint16_t item_count, uint8_t max_hash_count);
+
+#endif /* BLOOM_FILTER_H_ */
+
+/** @}*/
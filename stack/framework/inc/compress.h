@@ -36,7 +36,7 @@
 #define COMPRESS_H_
 
 #include <stdbool.h>
-#include "math.h"
+#include <stdint.h>
 
 typedef union{
   uint8_t raw;
@@ -46,9 +46,17 @@ typedef union{
   };
 } compressed_time_t;
 
-#define CT_DECOMPRESS(ct) (pow(4, ct >> 5) * (ct & 0b11111))
+#define COMPRESSED_TIME_MANTISSA_MAX 31
 
-uint8_t compress_data(uint16_t value, bool ceil);
+// T = (4^EXP)·(MANT), computed using a shift instead of pow()
+#define CT_DECOMPRESS(ct) ((uint32_t)((ct) & 0x1F) << (2 * (((ct) >> 5) & 0x07)))
+
+/*! \brief Converts a value to the compressed format, using integer arithmetic only
+ *
+ * \param value The value to compress, values above 507904 saturate to 0xFF
+ * \param ceil  Round up instead of truncating when the value cannot be represented exactly
+ */
+uint8_t compress_data(uint32_t value, bool ceil);
 
 #endif /* COMPRESS_H_ */
 
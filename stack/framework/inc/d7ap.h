@@ -36,6 +36,7 @@
 #include "types.h"
 #include "debug.h"
 #include "hwblockdevice.h"
+#include "modules_defs.h"
 
 #define ID_TYPE_NBID_ID_LENGTH 1
 #define ID_TYPE_NOID_ID_LENGTH 0
@@ -72,7 +73,14 @@ typedef struct {
         struct {
             nls_method_t nls_method : 4;
             d7ap_addressee_id_type_t id_type : 2;
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+            // The number of intermediate nodes which may relay the frame, only for UID or VID addressees.
+            // This deviates from the specification, which defines these bits as RFU: the addressee control is part of
+            // the ALP interface configuration, so other implementations may reject or ignore a non zero hop limit.
+            uint8_t hop_limit : 2;
+#else
             uint8_t _rfu : 2;
+#endif
         };
     };
 } d7ap_addressee_ctrl_t;
@@ -210,6 +218,8 @@ d7ap_addressee_id_type_t d7ap_get_dev_addr(uint8_t* addr);
 /**
  * @brief Get the maximum payload size according the security configuration.
  *
+ * The room of the largest headers is taken into account, larger payloads are refused by d7ap_send().
+ *
  * @param[in] nls_method     The security configuration.
  *
  * @returns the maximum payload size in bytes.
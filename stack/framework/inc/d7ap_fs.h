@@ -94,12 +94,25 @@
 #define USER_FILE_LORAWAN_KEYS_SIZE              24
 #define USER_FILE_LORAWAN_KEYS_ALLOCATED_SIZE    40
 
+// the PER sweep files only exist when MODULE_D7AP_EM_PER_SWEEP_ENABLED is set, 0x42 is left to the applications
+#define USER_FILE_EM_SWEEP_CONFIG_FILE_ID        0x43
+#define USER_FILE_EM_SWEEP_CONFIG_SIZE           17
+
+#define USER_FILE_FILE_DISTRIBUTION_STATUS_FILE_ID 0x44
+
+#define USER_FILE_EM_SWEEP_RESULT_FILE_ID        0x45
+#define USER_FILE_EM_SWEEP_RESULT_RECORD_SIZE    19
+#define USER_FILE_EM_SWEEP_RESULT_MAX_RECORDS    16
+#define USER_FILE_EM_SWEEP_RESULT_SIZE           (1 + USER_FILE_EM_SWEEP_RESULT_MAX_RECORDS * USER_FILE_EM_SWEEP_RESULT_RECORD_SIZE)
+
 typedef enum {
   EM_OFF = 0,
   EM_CONTINUOUS_TX = 1,
   EM_TRANSIENT_TX = 2,
   EM_PER_RX = 3,
-  EM_PER_TX = 4
+  EM_PER_TX = 4,
+  EM_PER_SWEEP_RX = 5,
+  EM_PER_SWEEP_TX = 6
 } engineering_mode_t;
 
 /* \brief The callback function for when a user file is modified
@@ -132,6 +145,45 @@ int d7ap_fs_read_file(uint8_t file_id, uint32_t offset, uint8_t* buffer, uint32_
 int d7ap_fs_write_file(uint8_t file_id, uint32_t offset, const uint8_t* buffer, uint32_t length, authentication_t auth);
 int d7ap_fs_write_file_with_callback(uint8_t file_id, uint32_t offset, const uint8_t* buffer, uint32_t length, authentication_t auth, bool trigger_cb);
 
+/* Circular files
+ *
+ * A circular file stores a series of fixed size records, for example periodic sensor measurements. Appending a record
+ * overwrites the oldest one when the file is full. Every appended record gets the next record index, starting from 0.
+ * The data of the file is:
+ * [record size (2 bytes)][D7AP_FS_CIRCULAR_HEADER_SLOTS x [head (4 bytes)][tail (4 bytes)]][records]
+ * where head is the index of the next record to append and tail the index of the oldest record still stored, big endian.
+ * Record i is stored at position i % capacity. Every append programs the record and one counter slot, the slots are
+ * used in turn so the counters wear D7AP_FS_CIRCULAR_HEADER_SLOTS times slower than they would in place. The slot
+ * with the highest head is the current one.
+ *
+ * Reading a circular file interprets the offset as a record index, or D7AP_FS_LAST_RECORDS(n) for the last n records,
+ * and returns whole records only. Records which were already overwritten are skipped, the index of the first record
+ * returned is passed back through the offset of d7ap_fs_read_file_at(). A reader which continues from the index of
+ * the first record it did not receive yet, will receive only new records. Circular files cannot be written by
+ * d7ap_fs_write_file(), only by d7ap_fs_append_record().
+ */
+#define D7AP_FS_CIRCULAR_HEADER_SLOTS 4
+#define D7AP_FS_CIRCULAR_SLOT_SIZE 8
+#define D7AP_FS_CIRCULAR_HEADER_SIZE (2 + D7AP_FS_CIRCULAR_HEADER_SLOTS * D7AP_FS_CIRCULAR_SLOT_SIZE)
+#define D7AP_FS_CIRCULAR_FILE_SIZE(record_size, record_count) (D7AP_FS_CIRCULAR_HEADER_SIZE + (record_size) * (record_count))
+
+// record indexes are limited to 29 bits, so they fit in an ALP offset together with this flag
+#define D7AP_FS_LAST_RECORDS_FLAG (1UL << 29)
+#define D7AP_FS_LAST_RECORDS(count) (D7AP_FS_LAST_RECORDS_FLAG | (count))
+
+/* \brief Creates a circular file for records of record_size bytes
+ *
+ * The number of records which can be stored follows from the allocated length in the file header. The length is set
+ * to the allocated length, the circular property is set and the file starts empty.
+ */
+int d7ap_fs_init_circular_file(uint8_t file_id, const d7ap_fs_file_header_t* file_header, uint16_t record_size);
+int d7ap_fs_append_record(uint8_t file_id, const uint8_t* record, authentication_t auth);
+/* \brief Returns the index of the oldest record still stored (tail) and of the next record to append (head) */
+int d7ap_fs_read_record_range(uint8_t file_id, uint32_t* tail, uint32_t* head);
+/* \brief Reads a file like d7ap_fs_read_file(), for circular files offset is updated to the index of the first record
+ * which was read */
+int d7ap_fs_read_file_at(uint8_t file_id, uint32_t* offset, uint8_t* buffer, uint32_t* length, authentication_t auth);
+
 int d7ap_fs_read_access_class(uint8_t access_class_index, dae_access_profile_t* access_class);
 int d7ap_fs_write_access_class(uint8_t access_class_index, dae_access_profile_t* access_class);
 
@@ -60,7 +60,8 @@ typedef enum { ROOT_AUTH = 0, USER_AUTH = 1, GUEST_AUTH = 2 } authentication_t;
 typedef struct __attribute__((__packed__))
 {
     fs_storage_class_t storage_class : 2;
-    uint8_t _rfu : 2;
+    bool circular : 1; // the data is a ring of fixed size records, see d7ap_fs_init_circular_file()
+    uint8_t _rfu : 1;
     dae_act_condition_t action_condition : 3;
     bool action_protocol_enabled : 1;
 } d7ap_fs_file_properties_t;
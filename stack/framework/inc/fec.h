@@ -57,10 +57,26 @@ typedef struct {
 	VITERBIPATH states2[8];
 } VITERBISTATE;
 
+#define FEC_BUFFER_SIZE 256
+
+/*! \brief The state of the Viterbi decoder.
+ *
+ * fec_decode_packet() uses a single internal state, threads decoding concurrently each need their own fec_decoder_t.
+ */
+typedef struct {
+	uint8_t data_buffer[FEC_BUFFER_SIZE];
+	uint8_t* output_buffer;
+	uint16_t packetlength;
+	uint8_t processedbytes;
+	uint16_t fecprocessedbytes;
+	VITERBISTATE vstate;
+} fec_decoder_t;
+
 //void print_array(uint8_t* buffer, uint8_t length);
 
 uint16_t fec_encode(uint8_t *data, uint16_t nbytes);
 uint16_t fec_decode_packet(uint8_t* data, uint16_t packet_length, uint16_t output_length);
+uint16_t fec_decode_packet_with_decoder(fec_decoder_t* decoder, uint8_t* data, uint16_t packet_length, uint16_t output_length);
 uint16_t fec_calculated_decoded_length(uint16_t packet_length);
 
 #ifdef __cplusplus
@@ -30,6 +30,7 @@
 
 #include "link_c.h"
 #include "types.h"
+#include "hwsystem.h"
 
 /*! \brief Type definition for tasks
  *
@@ -126,9 +127,39 @@ __LINK_C error_t sched_cancel_task(task_t task);
 __LINK_C bool sched_is_scheduled(task_t task);
 
 
+/*! \brief Get or set the low power mode entered when no tasks are waiting. When FRAMEWORK_SCHEDULER_LP_MODE_AUTO
+ * is enabled this is the deepest mode the scheduler may select, so with the default FRAMEWORK_SCHEDULER_LP_MODE of 0
+ * the automatic selection always uses mode 0 until this is raised.
+ */
 __LINK_C uint8_t sched_get_low_power_mode(void);
 __LINK_C void    sched_set_low_power_mode(uint8_t mode);
 
+#define SCHED_MAX_LOW_POWER_MODES 4
+
+typedef struct
+{
+	uint32_t entry_count;
+	uint32_t duration; /**< The time spent in the mode, in timer ticks */
+} sched_low_power_mode_stats_t;
+
+/*! \brief Select the deepest low power mode, not deeper than max_mode, which wakes up in time for the next timer event
+ *
+ * \param modes			The low power modes as returned by hw_get_lowpower_modes()
+ * \param time_to_next_event	The number of timer ticks until the next timer event, as returned by
+ *				timer_get_time_to_next_event()
+ *
+ * \return uint8_t		The index in modes of the selected mode. This is the first mode when no mode fits.
+ */
+__LINK_C uint8_t sched_select_low_power_mode(const hw_lowpower_mode_t* modes, uint8_t mode_count, uint8_t max_mode,
+	uint32_t time_to_next_event);
+
+/*! \brief Get the time spent in each low power mode, as selected by FRAMEWORK_SCHEDULER_LP_MODE_AUTO
+ *
+ * \param count		Set to the number of entries in the returned table, these are indexed as the table returned by
+ *			hw_get_lowpower_modes(). Set to 0 when FRAMEWORK_SCHEDULER_LP_MODE_AUTO is disabled.
+ */
+__LINK_C const sched_low_power_mode_stats_t* sched_get_low_power_mode_stats(uint8_t* count);
+
 #endif /* SCHEDULER_H_ */
 
 /** @}*/
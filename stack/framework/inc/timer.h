@@ -66,6 +66,15 @@ typedef struct
     timer_tick_t period;
 } timer_event;
 
+/*! \brief The precise lanes, every user of the precise timing has its own lane so they never wait for each other
+ */
+typedef enum
+{
+    TIMER_PRECISE_LANE_RADIO,   /**< The radio driver */
+    TIMER_PRECISE_LANE_DLL,     /**< The D7AP data link layer */
+    TIMER_PRECISE_LANE_COUNT
+} timer_precise_lane_t;
+
 //a bit of dirty macro evaluation to prepend HWTIMER_FREQ_ to the value of 'FRAMEWORK_TIMER_RESOLUTION'
 #define ___CONCAT2(a,b) a ## b
 #define ___CONCAT(a, b) ___CONCAT2(a,b)
@@ -98,6 +107,15 @@ __LINK_C void timer_init();
  */
 __LINK_C timer_tick_t timer_get_counter_value();
 
+#define TIMER_NO_EVENT_PENDING UINT32_MAX
+
+/*! \brief Retrieve the number of clock ticks until the next timer event fires
+ *
+ * \return timer_tick_t	0 when the next event is already due, or TIMER_NO_EVENT_PENDING when no event is scheduled.
+ *
+ */
+__LINK_C timer_tick_t timer_get_time_to_next_event();
+
 /*! \brief Post a task to be scheduled at a given time with a given priority
  *
  * The time parameter denotes the clock tick at which the task is to be scheduled
@@ -196,6 +214,42 @@ inline error_t timer_post_task_prio_delay(task_t task, timer_tick_t delay, uint8
  */
 inline error_t timer_post_task_delay(task_t task, timer_tick_t delay) { return timer_post_task_prio_delay(task, delay, DEFAULT_PRIORITY);}
 
+/*! \brief Call a function at a given time from the timer interrupt, using a precise lane
+ *
+ * The precise lanes are extra timer slots which do not compete with the events posted with timer_post_task_prio(),
+ * meant for short continuations which need precise timing, like the radio operations of the DLL, instead of blocking
+ * the CPU with hw_busy_wait(). The function is called from the timer interrupt, so a running task does not delay
+ * it, but it has to be interrupt safe: it should only do short register accesses and post tasks for the remaining
+ * work. The function does not have to be registered with the scheduler.
+ *
+ * Every lane holds one function, posting on a lane replaces the function which is pending on that lane. When the
+ * time has already passed or is too close to be scheduled, the function is called from the first timer interrupt
+ * which can still be scheduled.
+ *
+ * \param lane		The lane of the caller.
+ * \param task		The function to call.
+ * \param time		The time at which to call the function.
+ * \param arg		The argument passed to the function
+ *
+ * \returns error_t	SUCCESS if the function was posted successfully
+ */
+__LINK_C error_t timer_post_precise_task(timer_precise_lane_t lane, task_t task, timer_tick_t time, void *arg);
+
+/*! \brief Call a function at least \<delay_us\> microseconds from now, using a precise lane
+ *
+ * Delays which are too short to be scheduled on the timer are busy waited, after which the function is called
+ * directly in the context of the caller.
+ *
+ * \returns error_t	SUCCESS if the function was posted or called
+ */
+__LINK_C error_t timer_post_precise_task_delay_us(timer_precise_lane_t lane, task_t task, uint32_t delay_us, void *arg);
+
+/*! \brief Cancel the function pending on a precise lane
+ *
+ * \return error_t	SUCCESS if the function was canceled, EALREADY if nothing was pending on the lane
+ */
+__LINK_C error_t timer_cancel_precise_task(timer_precise_lane_t lane);
+
 /*! \brief Set a timer to execute a callback at some time in the future.
  *
  * @param[in] event        Structure containing the event parameters
@@ -0,0 +1,94 @@
+/*! \file trace.h
+ *
+
+ *  \copyright (C) Copyright 2015 University of Antwerp and others (http://oss-7.cosys.be)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*!
+ * \file trace.h
+ * \addtogroup trace
+ * \ingroup framework
+ * @{
+ * \brief Records a timeline of scheduler, timer, radio and ALP events as compact binary events
+ *
+ * Enabled using FRAMEWORK_TRACE_ENABLED, otherwise trace_record() compiles to nothing. On target the events are
+ * stored in the trace_buffer RAM ring buffer, where the oldest events are overwritten. The buffer starts with a
+ * trace_header_t, so a memory dump of trace_buffer (for example using 'dump binary value trace.bin trace_buffer' in
+ * gdb) can be converted as is. On the NATIVE platform the events are appended to the file set by the OSS7_TRACE_FILE
+ * environment variable (trace.bin by default) instead, with microsecond timestamps.
+ *
+ * The tools/trace_converter host tool converts both formats to the Chrome trace event JSON format, which can be
+ * opened in chrome://tracing or https://ui.perfetto.dev
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+
+#include "framework_defs.h"
+
+#define TRACE_MAGIC 0x4352544F // "OTRC"
+#define TRACE_VERSION 1
+
+// X(name, meaning of id, meaning of value)
+#define TRACE_EVENT_TYPES(X)                                  \
+    X(TRACE_TASK_START, priority, task address)               \
+    X(TRACE_TASK_STOP, priority, task address)                \
+    X(TRACE_TIMER_FIRED, priority, task address)              \
+    X(TRACE_PHY_STATE, new state, 0)                          \
+    X(TRACE_PACKET_RX, channel index, packet length)          \
+    X(TRACE_PACKET_TX, channel index, packet length)          \
+    X(TRACE_ALP_COMMAND_BEGIN, command slot, tag ID)          \
+    X(TRACE_ALP_COMMAND_END, command slot, tag ID)
+
+#define TRACE_EVENT_TYPE_ENUM(name, id, value) name,
+
+typedef enum {
+    TRACE_EVENT_TYPES(TRACE_EVENT_TYPE_ENUM)
+    TRACE_EVENT_TYPE_COUNT
+} trace_event_type_t;
+
+typedef struct __attribute__((__packed__)) {
+    uint32_t timestamp;
+    uint32_t value;
+    uint8_t type;
+    uint8_t id;
+} trace_event_t;
+
+typedef struct __attribute__((__packed__)) {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t event_size;
+    uint16_t capacity; // number of events in the ring buffer, 0 when the events are streamed to a file
+    uint32_t ticks_per_sec;
+    uint32_t write_count; // number of events recorded, the oldest event is at write_count % capacity after wrapping
+} trace_header_t;
+
+#ifdef FRAMEWORK_TRACE_ENABLED
+/*! \brief Records an event, can be called from interrupt context */
+void trace_record(trace_event_type_t type, uint8_t id, uint32_t value);
+
+/*! \brief Discards all events recorded so far */
+void trace_clear();
+#else
+#define trace_record(type, id, value) ((void)0)
+#define trace_clear() ((void)0)
+#endif
+
+#endif /* TRACE_H_ */
+
+/** @}*/
@@ -27,6 +27,7 @@
 #include "modules_defs.h"
 
 #include "alp.h"
+#include "alp_operations.h"
 #include "dae.h"
 #include "fifo.h"
 #include "d7ap.h"
@@ -42,8 +43,43 @@
   #define DPRINT_DATA(...)
 #endif
 
+#define EXPECTED_RESPONSE_LENGTH_INVALID 0xFFFF
+
 alp_interface_t* interfaces[MODULE_ALP_INTERFACE_CNT];
 
+static inline uint16_t read_file_data_response_length(uint32_t offset, uint32_t length)
+{
+    // return file data operation: opcode, file ID, offset, length and the data itself
+    return 1 + 1 + alp_length_operand_coded_length(offset) + alp_length_operand_coded_length(length) + length;
+}
+
+static inline uint16_t read_file_properties_response_length()
+{
+    // return file properties operation: opcode, file ID and header
+    return 1 + 1 + sizeof(d7ap_fs_file_header_t);
+}
+
+static inline bool is_expected_response_length_tracked(alp_command_t* command)
+{
+    return command->expected_response_length_fifo_size == fifo_get_size(&command->alp_command_fifo);
+}
+
+/*
+ * Called after appending (positive delta) or parsing (negative delta) an action. When data was put in the fifo directly
+ * before the action (was_tracked false) the expected response length is no longer known and has to be recalculated.
+ */
+static void update_expected_response_length(alp_command_t* command, bool was_tracked, int32_t delta)
+{
+    if (!was_tracked) {
+        command->expected_response_length_fifo_size = EXPECTED_RESPONSE_LENGTH_INVALID;
+        return;
+    }
+
+    int32_t expected_response_length = (int32_t)command->expected_response_length + delta;
+    command->expected_response_length = expected_response_length < 0 ? 0 : (uint16_t)expected_response_length;
+    command->expected_response_length_fifo_size = fifo_get_size(&command->alp_command_fifo);
+}
+
 alp_status_codes_t alp_register_interface(alp_interface_t* itf)
 {
   for(uint8_t i=0; i < MODULE_ALP_INTERFACE_CNT; i++) {
@@ -123,6 +159,7 @@ bool alp_append_indirect_forward_action(
     alp_command_t* command, uint8_t file_id, bool overload, uint8_t* overload_config, uint8_t overload_config_len)
 {
     fifo_t* cmd_fifo = &command->alp_command_fifo;
+    bool tracked = is_expected_response_length_tracked(command);
     error_t rc = SUCCESS;
     rc = fifo_put_byte(cmd_fifo, ALP_OP_INDIRECT_FORWARD | (overload << 7));
     rc += fifo_put_byte(cmd_fifo, file_id);
@@ -131,6 +168,7 @@ bool alp_append_indirect_forward_action(
         rc += fifo_put(cmd_fifo, overload_config, overload_config_len);
     }
 
+    update_expected_response_length(command, tracked, 0);
     DPRINT("INDIRECT FORWARD");
     return (rc == SUCCESS);
 }
@@ -141,6 +179,7 @@ bool alp_append_forward_action(alp_command_t* command, alp_interface_config_t* i
     if(!itf_config)
         return false;
     
+    bool tracked = is_expected_response_length_tracked(command);
     error_t rc = SUCCESS;
     rc = fifo_put_byte(cmd_fifo, ALP_OP_FORWARD);
     rc += fifo_put_byte(cmd_fifo, itf_config->itf_id);
@@ -166,18 +205,21 @@ bool alp_append_forward_action(alp_command_t* command, alp_interface_config_t* i
         rc += fifo_put(cmd_fifo, itf_config->itf_config, config_len);
     }
 
+    update_expected_response_length(command, tracked, 0);
     DPRINT("FORWARD");
     return (rc == SUCCESS);
 }
 
 bool alp_append_return_file_data_action(alp_command_t* command, uint8_t file_id, uint32_t offset, uint32_t length, uint8_t* data) {
     fifo_t* cmd_fifo = &command->alp_command_fifo;
+    bool tracked = is_expected_response_length_tracked(command);
     int rc;
     rc = fifo_put_byte(cmd_fifo, ALP_OP_RETURN_FILE_DATA);
     rc += fifo_put_byte(cmd_fifo, file_id);
     rc += !alp_append_length_operand(command, offset);
     rc += !alp_append_length_operand(command, length);
     rc += fifo_put(cmd_fifo, data, length);
+    update_expected_response_length(command, tracked, 0);
     return rc == SUCCESS;
 }
 
@@ -196,6 +238,7 @@ static bool parse_operand_file_data(alp_command_t* command, alp_action_t* action
     return true;
 }
 
+#if defined(MODULE_ALP_OP_READ_FILE_DATA_ENABLED)
 static bool parse_operand_file_data_request(alp_command_t* command, alp_action_t* action)
 {
     if(!alp_parse_file_offset_operand(&command->alp_command_fifo, &action->file_data_request_operand.file_offset))
@@ -205,10 +248,13 @@ static bool parse_operand_file_data_request(alp_command_t* command, alp_action_t
     DPRINT("parsed read file data file %i, len %i", action->file_data_operand.file_offset.file_id, action->file_data_operand.provided_data_length);
     return true;
 }
+#endif
 
-static bool parse_operand_status(alp_command_t* command, alp_action_t* action, bool b6, bool b7)
+static bool parse_operand_status(alp_command_t* command, alp_action_t* action)
 {
     fifo_t* cmd_fifo = &command->alp_command_fifo;
+    bool b6 = action->ctrl.b6;
+    bool b7 = action->ctrl.b7;
     if (!b7 && !b6) {
         //action status operation
         DPRINT("act status");
@@ -262,6 +308,7 @@ static bool parse_op_forward(alp_command_t* command, alp_action_t* action)
     return false;
 }
 
+#if defined(MODULE_ALP_OP_FILE_PROPERTIES_ENABLED)
 static bool parse_operand_file_id(alp_command_t* command, alp_action_t* action)
 {
     if(fifo_pop(&command->alp_command_fifo, &action->file_id_operand.file_id, 1) != SUCCESS)
@@ -269,7 +316,9 @@ static bool parse_operand_file_id(alp_command_t* command, alp_action_t* action)
     DPRINT("READ FILE PROPERTIES %i", action->file_id_operand.file_id);
     return true;
 }
+#endif
 
+#if defined(MODULE_ALP_OP_FILE_PROPERTIES_ENABLED) || defined(MODULE_ALP_OP_CREATE_FILE_ENABLED)
 static bool parse_operand_file_header(alp_command_t* command, alp_action_t* action)
 {
     fifo_t* cmd_fifo = &command->alp_command_fifo;
@@ -286,7 +335,9 @@ static bool parse_operand_file_header(alp_command_t* command, alp_action_t* acti
     DPRINT("WRITE FILE PROPERTIES %i", action->file_header_operand.file_id);
     return true;
 }
+#endif
 
+#if defined(MODULE_ALP_OP_QUERY_ENABLED)
 static bool parse_operand_query(alp_command_t* command, alp_action_t* action)
 {
     fifo_t* cmd_fifo = &command->alp_command_fifo;
@@ -295,7 +346,8 @@ static bool parse_operand_query(alp_command_t* command, alp_action_t* action)
     if(fifo_pop(cmd_fifo, &action->query_operand.code.raw, 1) != SUCCESS)
         return false;
 
-    if(action->query_operand.code.type != QUERY_CODE_TYPE_ARITHM_COMP_WITH_VALUE_IN_QUERY)
+    if(action->query_operand.code.type != QUERY_CODE_TYPE_ARITHM_COMP_WITH_VALUE_IN_QUERY
+        && action->query_operand.code.type != QUERY_CODE_TYPE_BLOOM_FILTER)
         return false;
     
     // TODO assuming no compare mask for now + assume compare value present + only 1 file offset operand
@@ -314,24 +366,31 @@ static bool parse_operand_query(alp_command_t* command, alp_action_t* action)
     if(fifo_pop(cmd_fifo, action->query_operand.compare_body, (uint16_t)action->query_operand.compare_operand_length) != SUCCESS)
         return false;
     
-    // parse the file offset operand(s), using a temp fifo
-    fifo_t temp_fifo;
-    fifo_init_filled(&temp_fifo, action->query_operand.compare_body + action->query_operand.compare_operand_length,
-        2 * sizeof(alp_operand_file_offset_t), 2 * sizeof(alp_operand_file_offset_t));
-    alp_operand_file_offset_t temp_offset;
-    if(!alp_parse_file_offset_operand(&temp_fifo, &temp_offset)) // TODO assuming only 1 file offset operant. Why does this get discarded?
+    // store the file offset operand behind the compare value, it is parsed when the query is executed.
+    // The file ID and the first byte of the length operand determine the length of the operand.
+    // TODO assuming only 1 file offset operand
+    uint8_t* file_offset = action->query_operand.compare_body + action->query_operand.compare_operand_length;
+    uint8_t file_offset_header[2];
+    if(fifo_peek(cmd_fifo, file_offset_header, 0, sizeof(file_offset_header)) != SUCCESS)
         return false;
-    if(fifo_pop(cmd_fifo, action->query_operand.compare_body + action->query_operand.compare_operand_length, temp_fifo.head_idx) != SUCCESS)
+
+    uint8_t file_offset_length = 1 + 1 + (file_offset_header[1] >> 6);
+    if(action->query_operand.compare_operand_length + file_offset_length > ALP_QUERY_COMPARE_BODY_MAX_SIZE)
+        return false;
+
+    if(fifo_pop(cmd_fifo, file_offset, file_offset_length) != SUCCESS)
         return false;
 
     return true;
 }
+#endif
 
 static bool parse_operand_tag_id(alp_command_t* command, alp_action_t* action)
 {
     return (fifo_pop(&command->alp_command_fifo, &action->tag_id_operand.tag_id, 1) == SUCCESS);
 }
 
+#if defined(MODULE_ALP_OP_FORWARD_ENABLED)
 static bool parse_operand_interface_config(alp_command_t* command, alp_action_t* action)
 {
     error_t err;
@@ -365,7 +424,9 @@ static bool parse_operand_interface_config(alp_command_t* command, alp_action_t*
     DPRINT("FORWARD interface %02X not found", action->interface_config.itf_id);
     return false;
 }
+#endif
 
+#if defined(MODULE_ALP_OP_INDIRECT_FORWARD_ENABLED)
 static bool parse_operand_indirect_interface(alp_command_t* command, alp_action_t* action)
 {
     DPRINT("indirect fwd");
@@ -400,7 +461,9 @@ static bool parse_operand_indirect_interface(alp_command_t* command, alp_action_
     }
     return true;
 }
+#endif
 
+#if defined(MODULE_ALP_OP_ITF_CTRL_ENABLED)
 static bool parse_operand_start(alp_command_t* command, alp_action_t* action)
 {
     DPRINT("start interface");
@@ -414,62 +477,47 @@ static bool parse_operand_stop(alp_command_t* command, alp_action_t* action)
     //add which interface should be stopped?
     return true;
 }
+#endif
+
+typedef bool (*alp_operand_parser_t)(alp_command_t* command, alp_action_t* action);
+
+#define OPERAND_PARSER_ENTRY(operation, parser, executor) [operation] = parser,
+
+// indexed by operation code, NULL for operations which are not supported
+static const alp_operand_parser_t operand_parsers[ALP_OPERATION_CODE_COUNT] = { ALP_OPERATIONS(OPERAND_PARSER_ENTRY) };
 
 bool alp_parse_action(alp_command_t* command, alp_action_t* action)
 {
     fifo_t* cmd_fifo = &command->alp_command_fifo;
+    bool tracked = is_expected_response_length_tracked(command);
     if(fifo_pop(cmd_fifo, &action->ctrl.raw, 1) != SUCCESS)
         return false;
     DPRINT("ALP op %i", action->ctrl.operation);
-    bool succeeded;
-    
-    switch (action->ctrl.operation) {
-    case ALP_OP_WRITE_FILE_DATA:
-    case ALP_OP_RETURN_FILE_DATA:
-        succeeded = parse_operand_file_data(command, action);
-        break;
-    case ALP_OP_READ_FILE_DATA:
-        succeeded = parse_operand_file_data_request(command, action);
-        break;
-    case ALP_OP_READ_FILE_PROPERTIES:
-        succeeded = parse_operand_file_id(command, action);
-        break;
-    case ALP_OP_WRITE_FILE_PROPERTIES:
-    case ALP_OP_CREATE_FILE:
-        succeeded = parse_operand_file_header(command, action);
-        break;
-    case ALP_OP_STATUS:
-        succeeded = parse_operand_status(command, action, action->ctrl.b6, action->ctrl.b7);
-        break;
-    case ALP_OP_BREAK_QUERY:
-    case ALP_OP_ACTION_QUERY:
-        succeeded = parse_operand_query(command, action);
-        break;
-    case ALP_OP_RESPONSE_TAG:
-    case ALP_OP_REQUEST_TAG:
-        succeeded = parse_operand_tag_id(command, action);
-        break;
-    case ALP_OP_FORWARD:
-        succeeded = parse_operand_interface_config(command, action);
-        break;
-    case ALP_OP_INDIRECT_FORWARD:
-        succeeded = parse_operand_indirect_interface(command, action);
-        break;
-    case ALP_OP_START_ITF:
-        succeeded = parse_operand_start(command, action);
-        break;
-    case ALP_OP_STOP_ITF:
-        succeeded = parse_operand_stop(command, action);
-        break;
-    default:
-        succeeded = false;
-    }
+    alp_operand_parser_t parser = operand_parsers[action->ctrl.operation];
+    bool succeeded = (parser != NULL) && parser(command, action);
+
+    if(succeeded) {
+        // this action is no longer part of the command, neither is its response
+        int32_t response_length = 0;
+        if(action->ctrl.operation == ALP_OP_READ_FILE_DATA)
+            response_length = read_file_data_response_length(action->file_data_request_operand.file_offset.offset,
+                action->file_data_request_operand.requested_data_length);
+        else if(action->ctrl.operation == ALP_OP_READ_FILE_PROPERTIES)
+            response_length = read_file_properties_response_length();
+
+        update_expected_response_length(command, tracked, -response_length);
+    } else
+        command->expected_response_length_fifo_size = EXPECTED_RESPONSE_LENGTH_INVALID;
+
     return succeeded;
 }
 
 int alp_get_expected_response_length(alp_command_t* command)
 {
-    uint8_t expected_response_length = 0;
+    if(is_expected_response_length_tracked(command))
+        return command->expected_response_length;
+
+    uint32_t expected_response_length = 0;
     static alp_command_t command_copy;
     memcpy(&command_copy, command, sizeof(alp_command_t)); // use a copy, so we don't pop from the original command
     fifo_t* command_copy_fifo = &command_copy.alp_command_fifo;
@@ -487,12 +535,11 @@ int alp_get_expected_response_length(alp_command_t* command)
             uint32_t offset;
             e += !alp_parse_length_operand(command_copy_fifo, &offset);
             e += !alp_parse_length_operand(command_copy_fifo, &length);
-            expected_response_length += alp_length_operand_coded_length(length); // the length of the provided data operand
-            expected_response_length += alp_length_operand_coded_length(offset) + 1; // the length of the offset operand
-            expected_response_length += 1; // the opcode
+            expected_response_length += read_file_data_response_length(offset, length);
             break;
         case ALP_OP_READ_FILE_PROPERTIES:
             e += fifo_skip(command_copy_fifo, 1); //skip file ID
+            expected_response_length += read_file_properties_response_length();
             break;
         case ALP_OP_REQUEST_TAG:
         case ALP_OP_RESPONSE_TAG:
@@ -554,6 +601,11 @@ int alp_get_expected_response_length(alp_command_t* command)
     if(e != SUCCESS)
         return -EFAULT;
 
+    if(expected_response_length > 0xFFFF)
+        expected_response_length = 0xFFFF;
+
+    command->expected_response_length = expected_response_length;
+    command->expected_response_length_fifo_size = fifo_get_size(&command->alp_command_fifo);
     DPRINT("Expected ALP response length=%i", expected_response_length);
     return (int)expected_response_length;
 }
@@ -561,33 +613,43 @@ int alp_get_expected_response_length(alp_command_t* command)
 bool alp_append_tag_request_action(alp_command_t* command, uint8_t tag_id, bool eop)
 {
     fifo_t* cmd_fifo = &command->alp_command_fifo;
+    bool tracked = is_expected_response_length_tracked(command);
     DPRINT("append tag req %i", tag_id);
     uint8_t op = ALP_OP_REQUEST_TAG | (eop << 7);
     int rc = fifo_put_byte(cmd_fifo, op);
     rc += fifo_put_byte(cmd_fifo, tag_id);
+    update_expected_response_length(command, tracked, 0);
     return (rc == SUCCESS);
 }
 
 bool alp_append_start_itf_action(alp_command_t* command)
 {
+    bool tracked = is_expected_response_length_tracked(command);
     uint8_t op = ALP_OP_START_ITF;
-    return (fifo_put_byte(&command->alp_command_fifo, op) == SUCCESS);
+    error_t rc = fifo_put_byte(&command->alp_command_fifo, op);
+    update_expected_response_length(command, tracked, 0);
+    return (rc == SUCCESS);
 }
 
 
 bool alp_append_stop_itf_action(alp_command_t* command)
 {
+    bool tracked = is_expected_response_length_tracked(command);
     uint8_t op = ALP_OP_STOP_ITF;
-    return (fifo_put_byte(&command->alp_command_fifo, op) == SUCCESS);
+    error_t rc = fifo_put_byte(&command->alp_command_fifo, op);
+    update_expected_response_length(command, tracked, 0);
+    return (rc == SUCCESS);
 }
 
 bool alp_append_tag_response_action(alp_command_t* command, uint8_t tag_id, bool eop, bool err)
 {
     fifo_t* cmd_fifo = &command->alp_command_fifo;
+    bool tracked = is_expected_response_length_tracked(command);
     DPRINT("append tag resp %i err %i", tag_id, err);
     uint8_t op = ALP_OP_RESPONSE_TAG | (eop << 7) | (err << 6);
     int rc = fifo_put_byte(cmd_fifo, op);
     rc += fifo_put_byte(cmd_fifo, tag_id);
+    update_expected_response_length(command, tracked, 0);
     return (rc == SUCCESS);
 }
 
@@ -595,10 +657,12 @@ bool alp_append_read_file_data_action(
     alp_command_t* command, uint8_t file_id, uint32_t offset, uint32_t length, bool resp, bool group)
 {
     fifo_t* cmd_fifo = &command->alp_command_fifo;
+    bool tracked = is_expected_response_length_tracked(command);
     uint8_t op = ALP_OP_READ_FILE_DATA | (resp << 6) | (group << 7);
     int rc = fifo_put_byte(cmd_fifo, op);
     rc += !alp_append_file_offset_operand(command, file_id, offset);
     rc += !alp_append_length_operand(command, length);
+    update_expected_response_length(command, tracked, read_file_data_response_length(offset, length));
     return (rc == SUCCESS);
 }
 
@@ -606,19 +670,55 @@ bool alp_append_write_file_data_action(
     alp_command_t* command, uint8_t file_id, uint32_t offset, uint32_t length, uint8_t* data, bool resp, bool group)
 {
     fifo_t* cmd_fifo = &command->alp_command_fifo;
+    bool tracked = is_expected_response_length_tracked(command);
     uint8_t op = ALP_OP_WRITE_FILE_DATA | (resp << 6) | (group << 7);
     int rc = fifo_put_byte(cmd_fifo, op);
     rc += !alp_append_file_offset_operand(command, file_id, offset);
     rc += !alp_append_length_operand(command, length);
     rc += fifo_put(cmd_fifo, data, length);
+    update_expected_response_length(command, tracked, 0);
+    return (rc == SUCCESS);
+}
+
+bool alp_append_bloom_filter_query_action(
+    alp_command_t* command, uint8_t file_id, uint32_t offset, uint8_t* filter, uint32_t filter_size, uint8_t hash_count)
+{
+    assert(hash_count > 0 && hash_count <= ALP_QUERY_BLOOM_FILTER_MAX_HASH_COUNT);
+    fifo_t* cmd_fifo = &command->alp_command_fifo;
+    bool tracked = is_expected_response_length_tracked(command);
+    uint8_t code = (QUERY_CODE_TYPE_BLOOM_FILTER << 5) | hash_count;
+    int rc = fifo_put_byte(cmd_fifo, ALP_OP_BREAK_QUERY);
+    rc += fifo_put_byte(cmd_fifo, code);
+    rc += !alp_append_length_operand(command, filter_size);
+    rc += fifo_put(cmd_fifo, filter, filter_size);
+    rc += !alp_append_file_offset_operand(command, file_id, offset);
+    update_expected_response_length(command, tracked, 0);
+    return (rc == SUCCESS);
+}
+
+bool alp_append_break_query_action(alp_command_t* command, uint8_t file_id, uint32_t offset, uint8_t* compare_value,
+    uint32_t length, alp_query_arithmetic_comparison_type_t comp_type)
+{
+    fifo_t* cmd_fifo = &command->alp_command_fifo;
+    bool tracked = is_expected_response_length_tracked(command);
+    // unsigned arithmetic comparison with the value in the query, without compare mask
+    uint8_t code = (QUERY_CODE_TYPE_ARITHM_COMP_WITH_VALUE_IN_QUERY << 5) | (comp_type & 0x07);
+    int rc = fifo_put_byte(cmd_fifo, ALP_OP_BREAK_QUERY);
+    rc += fifo_put_byte(cmd_fifo, code);
+    rc += !alp_append_length_operand(command, length);
+    rc += fifo_put(cmd_fifo, compare_value, length);
+    rc += !alp_append_file_offset_operand(command, file_id, offset);
+    update_expected_response_length(command, tracked, 0);
     return (rc == SUCCESS);
 }
 
 bool alp_append_interface_status(alp_command_t* command, alp_interface_status_t* status)
 {
     fifo_t* cmd_fifo = &command->alp_command_fifo;
+    bool tracked = is_expected_response_length_tracked(command);
     int rc = fifo_put_byte(cmd_fifo, ALP_OP_STATUS + (1 << 6));
     rc += fifo_put(cmd_fifo, (uint8_t*)status, status->len + 2);
+    update_expected_response_length(command, tracked, 0);
     return (rc == SUCCESS);
 }
 
@@ -626,6 +726,7 @@ bool alp_append_create_new_file_data_action(
     alp_command_t* command, uint8_t file_id, uint32_t length, fs_storage_class_t storage_class, bool resp, bool group)
 {
     fifo_t* cmd_fifo = &command->alp_command_fifo;
+    bool tracked = is_expected_response_length_tracked(command);
     uint8_t op = ALP_OP_CREATE_FILE | (resp << 6) | (group << 7);
     int rc = fifo_put_byte(cmd_fifo, op);
     alp_operand_file_header_t header = { .file_id = file_id,
@@ -635,6 +736,7 @@ bool alp_append_create_new_file_data_action(
             .length = __builtin_bswap32(length),
             .allocated_length = __builtin_bswap32(length) } };
     rc += fifo_put(cmd_fifo, (uint8_t*)&header, sizeof(alp_operand_file_header_t));
+    update_expected_response_length(command, tracked, 0);
     return (rc == SUCCESS);
 }
 
@@ -34,6 +34,9 @@
 #include "timer.h"
 #include "modules_defs.h"
 #include "MODULE_ALP_defs.h"
+#include "alp_operations.h"
+#include "bloom_filter.h"
+#include "trace.h"
 
 
 #ifdef MODULE_D7AP
@@ -64,6 +67,17 @@
 #define DPRINT_DATA(p, n)
 #endif
 
+// the state an action is executed in, shared by all executors so they can be called through the action_executors table
+typedef struct {
+    alp_command_t* command;
+    alp_command_t* resp_command;
+    alp_interface_config_t* forward_interface_config;
+    authentication_t origin_auth;
+    bool is_tag_mismatch; // set when a response tag does not match the tag of the command, the command is dropped
+} action_context_t;
+
+typedef alp_status_codes_t (*alp_action_executor_t)(alp_action_t* action, action_context_t* context);
+
 static interface_deinit current_itf_deinit = NULL;
 
 bool use_serial_itf;
@@ -82,7 +96,15 @@ static uint8_t alp_data2[ALP_QUERY_COMPARE_BODY_MAX_SIZE]; // temp buffer static
 
 extern alp_interface_t* interfaces[MODULE_ALP_INTERFACE_CNT];
 
-static itf_ctrl_t current_itf_ctrl;
+static itf_ctrl_t current_itf_ctrl; // the interface active at runtime
+static itf_ctrl_t persisted_itf_ctrl; // the interface stored in the ALP ctrl file, which is started on boot
+
+static uint16_t itf_switch_count = 0;
+static uint16_t itf_ctrl_write_count = 0;
+
+#if MODULE_ALP_ITF_CTRL_PERSIST_DELAY_S > 0
+static timer_event persist_itf_ctrl_timer;
+#endif
 
 static void process_async(void* arg);
 
@@ -93,6 +115,9 @@ static alp_command_t* command_fifo_buffer[MODULE_ALP_MAX_ACTIVE_COMMAND_COUNT];
 
 static void free_command(alp_command_t* command) {
   DPRINT("!!! Free cmd %02x %p", command->trans_id, command);
+  if (command->is_active)
+    trace_record(TRACE_ALP_COMMAND_END, command - commands, command->tag_id);
+
   memset(command, 0, sizeof (alp_command_t));
   command->is_active = false;
   fifo_init(&command->alp_command_fifo, command->alp_command, ALP_PAYLOAD_MAX_SIZE);
@@ -241,6 +266,12 @@ static void itf_ctrl_file_callback(uint8_t file_id)
             .interface = 0
         };
     }
+
+    // the file was written explicitly, no need to persist the runtime state anymore
+    persisted_itf_ctrl = current_itf_ctrl;
+#if MODULE_ALP_ITF_CTRL_PERSIST_DELAY_S > 0
+    timer_cancel_event(&persist_itf_ctrl_timer);
+#endif
     if (current_itf_ctrl.action == ITF_STOP) {
         if (!current_itf_deinit)
             return;
@@ -276,6 +307,45 @@ static void itf_ctrl_file_callback(uint8_t file_id)
     }
 }
 
+#if MODULE_ALP_ITF_CTRL_PERSIST_DELAY_S > 0
+static void persist_itf_ctrl(void* arg)
+{
+    (void)arg;
+    if (current_itf_ctrl.raw_itf_ctrl == persisted_itf_ctrl.raw_itf_ctrl)
+        return;
+
+    int rc = d7ap_fs_write_file_with_callback(USER_FILE_ALP_CTRL_FILE_ID, 0, (uint8_t*)&current_itf_ctrl.raw_itf_ctrl,
+        USER_FILE_ALP_CTRL_SIZE, ROOT_AUTH, false);
+    if (rc != SUCCESS) {
+        log_print_error_string("alp_layer: persisting interface %i failed with error %i", current_itf_ctrl.interface, rc);
+        return;
+    }
+
+    persisted_itf_ctrl = current_itf_ctrl;
+    itf_ctrl_write_count++;
+    DPRINT("persisted itf %i, %i writes for %i interface switches", current_itf_ctrl.interface, itf_ctrl_write_count, itf_switch_count);
+}
+#endif
+
+/*
+ * Called when a forward switches the active unique interface. Only the runtime state is updated here, the interface is
+ * stored as boot preference when it stays active for MODULE_ALP_ITF_CTRL_PERSIST_DELAY_S, so alternating between
+ * interfaces results in at most one write.
+ */
+static void schedule_persist_itf_ctrl()
+{
+#if MODULE_ALP_ITF_CTRL_PERSIST_DELAY_S > 0
+    timer_cancel_event(&persist_itf_ctrl_timer);
+    if (current_itf_ctrl.raw_itf_ctrl == persisted_itf_ctrl.raw_itf_ctrl)
+        return;
+
+    persist_itf_ctrl_timer.next_event = MODULE_ALP_ITF_CTRL_PERSIST_DELAY_S * TIMER_TICKS_PER_SEC;
+    error_t rc = timer_add_event(&persist_itf_ctrl_timer);
+    if (rc != SUCCESS)
+        log_print_error_string("alp_layer: scheduling persist of interface failed with error %i", rc);
+#endif
+}
+
 static void init_auth_key_files()
 {
 #ifdef MODULE_ALP_LOCK_KEY_FILES
@@ -330,19 +400,25 @@ void alp_layer_init(alp_init_args_t* alp_init_args, bool use_serial_interface)
 #endif
 
   sched_register_task(&process_async);
+#if MODULE_ALP_ITF_CTRL_PERSIST_DELAY_S > 0
+  timer_init_event(&persist_itf_ctrl_timer, &persist_itf_ctrl);
+#endif
 
   if(fs_file_stat(USER_FILE_ALP_CTRL_FILE_ID)) {
     d7ap_fs_register_file_modified_callback(USER_FILE_ALP_CTRL_FILE_ID, &itf_ctrl_file_callback);
     itf_ctrl_file_callback(USER_FILE_ALP_CTRL_FILE_ID);
-  } else
+  } else {
     current_itf_ctrl.raw_itf_ctrl = 0;
+    persisted_itf_ctrl.raw_itf_ctrl = 0;
+  }
 }
 
 void alp_layer_register_interface(alp_interface_t* interface) {
   alp_register_interface(interface);
 }
 
-static alp_status_codes_t process_op_read_file_data(alp_action_t* action, alp_command_t* resp_command, alp_command_t* command, authentication_t origin_auth)
+#ifdef MODULE_ALP_OP_READ_FILE_DATA_ENABLED
+static alp_status_codes_t process_op_read_file_data(alp_action_t* action, action_context_t* context)
 {
     alp_operand_file_data_request_t operand = action->file_data_request_operand;
     DPRINT("READ FILE %i LEN %i OFFSET %i", operand.file_offset.file_id, operand.requested_data_length, operand.file_offset.offset);
@@ -350,14 +426,15 @@ static alp_status_codes_t process_op_read_file_data(alp_action_t* action, alp_co
     if (operand.requested_data_length <= 0 || operand.requested_data_length > ALP_PAYLOAD_MAX_SIZE)
         return ALP_STATUS_EXCEEDS_MAX_ALP_SIZE;
 
-    int rc = d7ap_fs_read_file(operand.file_offset.file_id, operand.file_offset.offset, alp_data, &operand.requested_data_length, origin_auth);
+    // the offset of a circular file is resolved to the index of the first record read, which is returned to the requester
+    int rc = d7ap_fs_read_file_at(operand.file_offset.file_id, &operand.file_offset.offset, alp_data, &operand.requested_data_length, context->origin_auth);
     
     if (rc == -ENOENT && init_args != NULL && init_args->alp_unhandled_read_action_cb != NULL) // give the application layer the chance to fullfill this request ...
-        rc = init_args->alp_unhandled_read_action_cb(&command->origin_itf_status, operand, alp_data);
+        rc = init_args->alp_unhandled_read_action_cb(&context->command->origin_itf_status, operand, alp_data);
 
     if (rc == SUCCESS) {
         // fill response
-        if(!alp_append_return_file_data_action(resp_command, operand.file_offset.file_id, operand.file_offset.offset, operand.requested_data_length, alp_data))
+        if(!alp_append_return_file_data_action(context->resp_command, operand.file_offset.file_id, operand.file_offset.offset, operand.requested_data_length, alp_data))
             return ALP_STATUS_FIFO_OUT_OF_BOUNDS;
 
     } else
@@ -366,9 +443,12 @@ static alp_status_codes_t process_op_read_file_data(alp_action_t* action, alp_co
 
     return ALP_STATUS_OK;
 }
+#endif
 
-static alp_status_codes_t process_op_read_file_properties(alp_action_t* action, alp_command_t* resp_command)
+#ifdef MODULE_ALP_OP_FILE_PROPERTIES_ENABLED
+static alp_status_codes_t process_op_read_file_properties(alp_action_t* action, action_context_t* context)
 {
+    alp_command_t* resp_command = context->resp_command;
     error_t err;
     
     DPRINT("READ FILE PROPERTIES %i", action->file_id_operand.file_id);
@@ -390,24 +470,28 @@ static alp_status_codes_t process_op_read_file_properties(alp_action_t* action,
     return err == SUCCESS ? ALP_STATUS_OK : ALP_STATUS_FIFO_OUT_OF_BOUNDS;
 }
 
-static alp_status_codes_t process_op_write_file_properties(alp_action_t* action, authentication_t origin_auth)
+static alp_status_codes_t process_op_write_file_properties(alp_action_t* action, action_context_t* context)
 {
     DPRINT("WRITE FILE PROPERTIES %i", action->file_header_operand.file_id);
         
-    int rc = d7ap_fs_write_file_header(action->file_header_operand.file_id, &action->file_header_operand.file_header, origin_auth);
+    int rc = d7ap_fs_write_file_header(action->file_header_operand.file_id, &action->file_header_operand.file_header, context->origin_auth);
     return rc == SUCCESS ? ALP_STATUS_OK : alp_translate_error(rc);
 }
+#endif
 
-static alp_status_codes_t process_op_write_file_data(alp_action_t* action, authentication_t origin_auth) {
+#ifdef MODULE_ALP_OP_WRITE_FILE_DATA_ENABLED
+static alp_status_codes_t process_op_write_file_data(alp_action_t* action, action_context_t* context) {
     DPRINT("WRITE FILE %i LEN %i OFFSET %i", action->file_data_operand.file_offset.file_id, action->file_data_operand.provided_data_length, action->file_data_operand.file_offset.offset);
     if (action->file_data_operand.provided_data_length > ALP_PAYLOAD_MAX_SIZE)
         return ALP_STATUS_EXCEEDS_MAX_ALP_SIZE;
     
     int rc = d7ap_fs_write_file(action->file_data_operand.file_offset.file_id, action->file_data_operand.file_offset.offset,
-        action->file_data_operand.data, action->file_data_operand.provided_data_length, origin_auth);
+        action->file_data_operand.data, action->file_data_operand.provided_data_length, context->origin_auth);
     return rc == SUCCESS ? ALP_STATUS_OK : alp_translate_error(rc);
 }
+#endif
 
+#ifdef MODULE_ALP_OP_QUERY_ENABLED
 bool process_arithm_predicate(uint8_t* value1, uint8_t* value2, uint32_t len, alp_query_arithmetic_comparison_type_t comp_type) {
   // TODO assuming unsigned for now
   DPRINT("ARITH PREDICATE COMP TYPE %i LEN %i", comp_type, len);
@@ -439,10 +523,45 @@ bool process_arithm_predicate(uint8_t* value1, uint8_t* value2, uint32_t len, al
   return false; //not implemented type should always fail
 }
 
-static alp_status_codes_t process_op_break_query(alp_action_t* action, authentication_t origin_auth)
+/*
+ * Checks whether the item at the file offset behind the filter, normally the UID of this node, is part of the
+ * Bloom filter in the compare body. This way a single broadcast can target an arbitrary subset of nodes, at the cost
+ * of some false positives which respond as well.
+ */
+static alp_status_codes_t process_bloom_filter_query(alp_action_t* action, action_context_t* context)
+{
+    uint32_t filter_size = action->query_operand.compare_operand_length;
+    uint8_t hash_count = action->query_operand.code.param;
+    if(filter_size == 0 || hash_count == 0)
+        return ALP_STATUS_WRONG_OPERAND_FORMAT;
+
+    fifo_t temp_fifo;
+    fifo_init_filled(&temp_fifo, action->query_operand.compare_body + filter_size,
+        ALP_QUERY_COMPARE_BODY_MAX_SIZE - filter_size, ALP_QUERY_COMPARE_BODY_MAX_SIZE - filter_size);
+    alp_operand_file_offset_t offset;
+    if(!alp_parse_file_offset_operand(&temp_fifo, &offset))
+        return ALP_STATUS_FIFO_OUT_OF_BOUNDS;
+
+    uint32_t length = ALP_QUERY_BLOOM_FILTER_ITEM_SIZE;
+    int rc = d7ap_fs_read_file(offset.file_id, offset.offset, alp_data2, &length, context->origin_auth);
+    if(rc != SUCCESS)
+        return alp_translate_error(rc);
+
+    if(!bloom_filter_contains(action->query_operand.compare_body, filter_size, hash_count, alp_data2, length)) {
+        DPRINT("not part of the Bloom filter");
+        return ALP_STATUS_BREAK_QUERY_FAILED;
+    }
+
+    return ALP_STATUS_OK;
+}
+
+static alp_status_codes_t process_op_break_query(alp_action_t* action, action_context_t* context)
 {
     
     DPRINT("BREAK QUERY");
+    if(action->query_operand.code.type == QUERY_CODE_TYPE_BLOOM_FILTER)
+        return process_bloom_filter_query(action, context);
+
     if(action->query_operand.code.type != QUERY_CODE_TYPE_ARITHM_COMP_WITH_VALUE_IN_QUERY)
         return ALP_STATUS_NOT_YET_IMPLEMENTED;
     
@@ -470,7 +589,7 @@ static alp_status_codes_t process_op_break_query(alp_action_t* action, authentic
     // make sure the uint32_t is word-aligned before passing it as a pointer
     uint32_t length = action->query_operand.compare_operand_length;
 
-    int rc = d7ap_fs_read_file(offset_a.file_id, offset_a.offset, alp_data2, &length, origin_auth);
+    int rc = d7ap_fs_read_file(offset_a.file_id, offset_a.offset, alp_data2, &length, context->origin_auth);
     if(rc != SUCCESS)
         return alp_translate_error(rc);
     
@@ -481,16 +600,19 @@ static alp_status_codes_t process_op_break_query(alp_action_t* action, authentic
     
     return ALP_STATUS_OK;
 }
+#endif
 
+#ifdef MODULE_ALP_OP_INDIRECT_FORWARD_ENABLED
 static void interface_file_changed_callback(uint8_t file_id)
 {
     (void)file_id; // suppress unused warning
     interface_file_changed = true;
 }
 
-static alp_status_codes_t process_op_indirect_forward(
-    alp_action_t* action, uint8_t* itf_id, alp_interface_config_t* session_config)
+static alp_status_codes_t process_op_indirect_forward(alp_action_t* action, action_context_t* context)
 {
+    uint8_t* itf_id = &context->command->forward_itf_id;
+    alp_interface_config_t* session_config = context->forward_interface_config;
     DPRINT("indirect fwd");
     bool re_read = false;
     alp_control_t ctrl;
@@ -544,27 +666,42 @@ static alp_status_codes_t process_op_indirect_forward(
     DPRINT("interface %02X is not registered", *itf_id);
     return ALP_STATUS_WRONG_OPERAND_FORMAT;
 }
+#endif
 
-static alp_status_codes_t process_op_forward(alp_action_t* action, uint8_t* itf_id, alp_interface_config_t* session_config)
+#ifdef MODULE_ALP_OP_FORWARD_ENABLED
+static alp_status_codes_t process_op_forward(alp_action_t* action, action_context_t* context)
 {
+    alp_interface_config_t* session_config = context->forward_interface_config;
     // TODO move session config to alp_command_t struct
     memcpy(session_config, &action->interface_config, sizeof(alp_interface_config_t));
-    *itf_id = action->interface_config.itf_id;
+    context->command->forward_itf_id = action->interface_config.itf_id;
     DPRINT("FORWARD %02X", session_config->itf_id);
     return ALP_STATUS_PARTIALLY_COMPLETED;
 }
+#endif
 
-static alp_status_codes_t process_op_response_tag(alp_action_t* action, alp_command_t* command, uint8_t* tag_id, bool* is_response_completed, bool* is_response_error)
+static alp_status_codes_t process_op_response_tag(alp_action_t* action, action_context_t* context)
 {
-    *tag_id = action->tag_id_operand.tag_id;
-    *is_response_completed = action->ctrl.b7;
-    *is_response_error = action->ctrl.b6;
-    DPRINT("tag response %i EOP %i, ERR %i\n", *tag_id, *is_response_completed, *is_response_error);
+    alp_command_t* command = context->command;
+    uint8_t tag_id = action->tag_id_operand.tag_id;
+    command->is_response_completed = action->ctrl.b7;
+    command->is_response_error = action->ctrl.b6;
+    command->is_response = true;
+    DPRINT("tag response %i EOP %i, ERR %i\n", tag_id, command->is_response_completed, command->is_response_error);
+    if((command->tag_id != tag_id) && (command->tag_id != 0)) {
+        log_print_error_string("process_async: tag_id's don't sync up! (%i != %i != 0)", tag_id, command->tag_id);
+        context->is_tag_mismatch = true;
+        return ALP_STATUS_UNKNOWN_ERROR;
+    }
+
+    command->tag_id = tag_id;
+    context->resp_command->is_unsollicited = false;
     return ALP_STATUS_OK;
 }
 
-static alp_status_codes_t process_op_status(alp_action_t* action, alp_command_t* command)
+static alp_status_codes_t process_op_status(alp_action_t* action, action_context_t* context)
 {
+    alp_command_t* command = context->command;
     if (!action->ctrl.b7 && !action->ctrl.b6) {
         //action status operation
         DPRINT("act status");
@@ -580,17 +717,18 @@ static alp_status_codes_t process_op_status(alp_action_t* action, alp_command_t*
     return ALP_STATUS_OK;
 }
 
-static alp_status_codes_t process_op_request_tag(alp_action_t* action, uint8_t* tag_id, bool* respond_when_completed)
+static alp_status_codes_t process_op_request_tag(alp_action_t* action, action_context_t* context)
 {
-    *tag_id = action->tag_id_operand.tag_id;
-    *respond_when_completed = action->ctrl.b7;
-    DPRINT("tag req %i, EOP %i", *tag_id, *respond_when_completed);
+    context->command->tag_id = action->tag_id_operand.tag_id;
+    context->command->respond_when_completed = action->ctrl.b7;
+    context->command->is_tag_requested = true;
+    DPRINT("tag req %i, EOP %i", context->command->tag_id, context->command->respond_when_completed);
     return ALP_STATUS_OK;
 }
 
-static alp_status_codes_t process_op_return_file_data(
-    alp_action_t* action, alp_command_t* unsollicited_response_command)
+static alp_status_codes_t process_op_return_file_data(alp_action_t* action, action_context_t* context)
 {
+    alp_command_t* unsollicited_response_command = context->resp_command;
 
     DPRINT("Return file data (%i):", action->file_data_operand.file_offset.file_id);
     DPRINT("offset size: %d", action->file_data_operand.file_offset.offset);
@@ -605,29 +743,38 @@ static alp_status_codes_t process_op_return_file_data(
     return ALP_STATUS_OK;
 }
 
-static alp_status_codes_t process_op_create_file(alp_action_t* action) {
+#ifdef MODULE_ALP_OP_CREATE_FILE_ENABLED
+static alp_status_codes_t process_op_create_file(alp_action_t* action, action_context_t* context) {
     DPRINT("CREATE FILE %i", action->file_header_operand.file_id);
     int rc = d7ap_fs_init_file(action->file_header_operand.file_id, &action->file_header_operand.file_header, NULL);
     return rc == SUCCESS ? ALP_STATUS_OK : alp_translate_error(rc);
 }
+#endif
 
+#ifdef MODULE_ALP_OP_ITF_CTRL_ENABLED
 static alp_status_codes_t write_itf_command(itf_ctrl_action_t action, authentication_t origin_auth)
 {
     int rc = d7ap_fs_write_file(USER_FILE_ALP_CTRL_FILE_ID, 0, &action, 1, origin_auth); // gets handled in write file callback
     return rc == SUCCESS ? ALP_STATUS_OK : alp_translate_error(rc);
 }
 
-static alp_status_codes_t process_op_start_itf(alp_action_t* action, authentication_t origin_auth)
+static alp_status_codes_t process_op_start_itf(alp_action_t* action, action_context_t* context)
 {
     DPRINT("START INTERFACE");
-    return write_itf_command(ITF_START, origin_auth);
+    return write_itf_command(ITF_START, context->origin_auth);
 }
 
-static alp_status_codes_t process_op_stop_itf(alp_action_t* action, authentication_t origin_auth)
+static alp_status_codes_t process_op_stop_itf(alp_action_t* action, action_context_t* context)
 {
     DPRINT("STOP INTERFACE");
-    return write_itf_command(ITF_STOP, origin_auth);
+    return write_itf_command(ITF_STOP, context->origin_auth);
 }
+#endif
+
+#define ACTION_EXECUTOR_ENTRY(operation, parser, executor) [operation] = executor,
+
+// indexed by operation code, NULL for operations which are not supported
+static const alp_action_executor_t action_executors[ALP_OPERATION_CODE_COUNT] = { ALP_OPERATIONS(ACTION_EXECUTOR_ENTRY) };
 
 static bool forward_command(alp_command_t* command, alp_interface_config_t* itf_config)
 {
@@ -644,6 +791,7 @@ static bool forward_command(alp_command_t* command, alp_interface_config_t* itf_
                     log_print_error_string("tried to forward something over a unique itf while stack stop is active");
                     return true;
                 } else if(interfaces[i]->deinit != current_itf_deinit) {
+                    timer_tick_t switch_start = timer_get_counter_value();
                     if(current_itf_deinit) {
                         current_itf_deinit();
                         itf_clear_commands(current_itf_ctrl.interface);
@@ -652,20 +800,26 @@ static bool forward_command(alp_command_t* command, alp_interface_config_t* itf_
                     current_itf_deinit = interfaces[i]->deinit;
 
                     current_itf_ctrl.interface = interfaces[i]->itf_id;
-                    d7ap_fs_write_file_with_callback(USER_FILE_ALP_CTRL_FILE_ID, 0, (uint8_t*)&current_itf_ctrl.raw_itf_ctrl, USER_FILE_ALP_CTRL_SIZE, ROOT_AUTH, false);
+                    itf_switch_count++;
+                    DPRINT("switched to itf %i in %i ticks (%i switches, %i writes)", current_itf_ctrl.interface,
+                        timer_get_counter_value() - switch_start, itf_switch_count, itf_ctrl_write_count);
+                    schedule_persist_itf_ctrl();
                 }
             }
             uint8_t forwarded_alp_size = fifo_get_size(&command->alp_command_fifo);
             if(forwarded_alp_size > ALP_PAYLOAD_MAX_SIZE)
                 return false;
-            fifo_pop(&command->alp_command_fifo, command->alp_command, forwarded_alp_size);
-            DPRINT("Forwarding command:");
-            DPRINT_DATA(command->alp_command, forwarded_alp_size);
+            // determine the expected response before the forwarded actions are popped from the command fifo
             int expected_response_length = alp_get_expected_response_length(command);
             if(expected_response_length < 0) {
                 free_command(command);
                 return false;
             }
+            if(expected_response_length > ALP_PAYLOAD_MAX_SIZE)
+                expected_response_length = ALP_PAYLOAD_MAX_SIZE;
+            fifo_pop(&command->alp_command_fifo, command->alp_command, forwarded_alp_size);
+            DPRINT("Forwarding command:");
+            DPRINT_DATA(command->alp_command, forwarded_alp_size);
             command->forward_itf_id = itf_config->itf_id;
             error_t error = interfaces[i]->send_command(command->alp_command, forwarded_alp_size, expected_response_length, &command->trans_id, itf_config);
             if (command->trans_id == 0)
@@ -720,7 +874,11 @@ static error_t transmit_response(
     }
 
     uint8_t alp_response_length = (uint8_t)fifo_get_size(&resp->alp_command_fifo);
-    uint8_t expected_response_length = 0; // TODO alp_get_expected_response_length(&resp->alp_command_fifo);
+    int expected_response_length = alp_get_expected_response_length(resp);
+    if(expected_response_length < 0)
+        expected_response_length = 0; // the response is sent anyway, only the response period depends on this
+    else if(expected_response_length > ALP_PAYLOAD_MAX_SIZE)
+        expected_response_length = ALP_PAYLOAD_MAX_SIZE;
     DPRINT("interface found, sending len %i, expect %i answer", alp_response_length, expected_response_length);
     return interface->send_command(
         resp->alp_command, alp_response_length, expected_response_length, &resp->trans_id, NULL);
@@ -750,21 +908,25 @@ static void process_async(void* arg)
     static alp_action_t action;
     bool error = false;
 
-    authentication_t origin_auth;
+    action_context_t context = {
+        .command = command,
+        .resp_command = resp_command,
+        .forward_interface_config = &forward_interface_config,
+    };
     switch(command->origin_itf_id) {
     case ALP_ITF_ID_HOST:
-        origin_auth = ROOT_AUTH;
+        context.origin_auth = ROOT_AUTH;
         break;
     case ALP_ITF_ID_SERIAL:
     case ALP_ITF_ID_NFC:
-        origin_auth = USER_AUTH;
+        context.origin_auth = USER_AUTH;
         break;
     case ALP_ITF_ID_D7ASP:
     case ALP_ITF_ID_LORAWAN_OTAA:
-        origin_auth = GUEST_AUTH;
+        context.origin_auth = GUEST_AUTH;
         break;
     default: //this shouldn't happen but we don't want to give higher permission in any case
-        origin_auth = GUEST_AUTH;
+        context.origin_auth = GUEST_AUTH;
         break;
     }
 
@@ -778,64 +940,14 @@ static void process_async(void* arg)
             sched_post_task(&process_async);
             return;
         }
-        alp_status_codes_t alp_status;
-        switch (action.ctrl.operation) {
-        case ALP_OP_READ_FILE_DATA:
-            alp_status = process_op_read_file_data(&action, resp_command, command, origin_auth);
-            break;
-        case ALP_OP_READ_FILE_PROPERTIES:
-            alp_status = process_op_read_file_properties(&action, resp_command);
-            break;
-        case ALP_OP_WRITE_FILE_DATA:
-            alp_status = process_op_write_file_data(&action, origin_auth);
-            break;
-        case ALP_OP_WRITE_FILE_PROPERTIES:
-            alp_status = process_op_write_file_properties(&action, origin_auth);
-            break;
-        case ALP_OP_BREAK_QUERY:
-            alp_status = process_op_break_query(&action, origin_auth);
-            break;
-        case ALP_OP_STATUS:
-            alp_status = process_op_status(&action, command);
-            break;
-        case ALP_OP_RESPONSE_TAG:;
-            uint8_t resp_tag_id;
-            alp_status = process_op_response_tag(&action, command, &resp_tag_id, &command->is_response_completed, &command->is_response_error);
-            command->is_response = true;
-            if((command->tag_id != resp_tag_id) && (command->tag_id != 0)) {
-                log_print_error_string("process_async: tag_id's don't sync up! (%i != %i != 0)", resp_tag_id, command->tag_id);
-                free_command(command);
-                free_command(resp_command);
-                return;
-            }
-            command->tag_id = resp_tag_id;
-            resp_command->is_unsollicited = false;
-            break;
-        case ALP_OP_FORWARD:
-            alp_status = process_op_forward(&action, &command->forward_itf_id, &forward_interface_config);
-            break;
-        case ALP_OP_INDIRECT_FORWARD:
-            alp_status = process_op_indirect_forward(&action, &command->forward_itf_id, &forward_interface_config);
-            break;
-        case ALP_OP_REQUEST_TAG:;
-            alp_status = process_op_request_tag(&action, &command->tag_id, &command->respond_when_completed);
-            command->is_tag_requested = true;
-            break;
-        case ALP_OP_RETURN_FILE_DATA:
-            alp_status = process_op_return_file_data(&action, resp_command);
-            break;
-        case ALP_OP_CREATE_FILE:
-            alp_status = process_op_create_file(&action);
-            break;
-        case ALP_OP_START_ITF:
-            alp_status = process_op_start_itf(&action, origin_auth);
-            break;
-        case ALP_OP_STOP_ITF:
-            alp_status = process_op_stop_itf(&action, origin_auth);
-            break;
-        default:
-            alp_status = ALP_STATUS_UNKNOWN_OPERATION;
+        alp_action_executor_t executor = action_executors[action.ctrl.operation];
+        alp_status_codes_t alp_status = executor ? executor(&action, &context) : ALP_STATUS_UNKNOWN_OPERATION;
+        if(context.is_tag_mismatch) {
+            free_command(command);
+            free_command(resp_command);
+            return;
         }
+
         if(alp_status != ALP_STATUS_OK && alp_status != ALP_STATUS_PARTIALLY_COMPLETED) {
             //should BREAK QUERY FAILED also return error?
             //TODO put error code in action status and send to requester
@@ -950,6 +1062,7 @@ static void process_async(void* arg)
 
 bool alp_layer_process(alp_command_t* command)
 {
+    trace_record(TRACE_ALP_COMMAND_BEGIN, command - commands, command->tag_id);
     DPRINT_DATA(command->alp_command, fifo_get_size(&command->alp_command_fifo));
     int expected_response_length = alp_get_expected_response_length(command);
     if(expected_response_length < 0) {
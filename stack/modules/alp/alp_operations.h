@@ -0,0 +1,112 @@
+/*! \file alp_operations.h
+ *
+
+ *  \copyright (C) Copyright 2015 University of Antwerp and others (http://oss-7.cosys.be)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*! \file alp_operations.h
+ * \addtogroup ALP
+ * \ingroup D7AP
+ * @{
+ * \brief The ALP operations supported by this build.
+ *
+ * Each operation is listed as X(operation, parser, executor). alp.c expands this list into the table of parsers and
+ * alp_layer.c into the table of executors, both indexed by the operation code. Operations which are disabled using the
+ * MODULE_ALP_OP_*_ENABLED options are not part of the tables, so their parser and executor are not linked in.
+ * An operation without executor is parsed but reported as unknown when executed.
+ */
+
+#ifndef ALP_OPERATIONS_H
+#define ALP_OPERATIONS_H
+
+#include "MODULE_ALP_defs.h"
+
+#define ALP_OPERATION_CODE_COUNT 64 // the operation code is 6 bits
+
+#ifdef MODULE_ALP_OP_READ_FILE_DATA_ENABLED
+#define ALP_OPERATIONS_READ_FILE_DATA(X)                                                                               \
+    X(ALP_OP_READ_FILE_DATA, parse_operand_file_data_request, process_op_read_file_data)
+#else
+#define ALP_OPERATIONS_READ_FILE_DATA(X)
+#endif
+
+#ifdef MODULE_ALP_OP_WRITE_FILE_DATA_ENABLED
+#define ALP_OPERATIONS_WRITE_FILE_DATA(X)                                                                              \
+    X(ALP_OP_WRITE_FILE_DATA, parse_operand_file_data, process_op_write_file_data)
+#else
+#define ALP_OPERATIONS_WRITE_FILE_DATA(X)
+#endif
+
+#ifdef MODULE_ALP_OP_FILE_PROPERTIES_ENABLED
+#define ALP_OPERATIONS_FILE_PROPERTIES(X)                                                                              \
+    X(ALP_OP_READ_FILE_PROPERTIES, parse_operand_file_id, process_op_read_file_properties)                            \
+    X(ALP_OP_WRITE_FILE_PROPERTIES, parse_operand_file_header, process_op_write_file_properties)
+#else
+#define ALP_OPERATIONS_FILE_PROPERTIES(X)
+#endif
+
+#ifdef MODULE_ALP_OP_CREATE_FILE_ENABLED
+#define ALP_OPERATIONS_CREATE_FILE(X) X(ALP_OP_CREATE_FILE, parse_operand_file_header, process_op_create_file)
+#else
+#define ALP_OPERATIONS_CREATE_FILE(X)
+#endif
+
+#ifdef MODULE_ALP_OP_QUERY_ENABLED
+#define ALP_OPERATIONS_QUERY(X)                                                                                        \
+    X(ALP_OP_BREAK_QUERY, parse_operand_query, process_op_break_query)                                                \
+    X(ALP_OP_ACTION_QUERY, parse_operand_query, NULL)
+#else
+#define ALP_OPERATIONS_QUERY(X)
+#endif
+
+#ifdef MODULE_ALP_OP_FORWARD_ENABLED
+#define ALP_OPERATIONS_FORWARD(X) X(ALP_OP_FORWARD, parse_operand_interface_config, process_op_forward)
+#else
+#define ALP_OPERATIONS_FORWARD(X)
+#endif
+
+#ifdef MODULE_ALP_OP_INDIRECT_FORWARD_ENABLED
+#define ALP_OPERATIONS_INDIRECT_FORWARD(X)                                                                             \
+    X(ALP_OP_INDIRECT_FORWARD, parse_operand_indirect_interface, process_op_indirect_forward)
+#else
+#define ALP_OPERATIONS_INDIRECT_FORWARD(X)
+#endif
+
+#ifdef MODULE_ALP_OP_ITF_CTRL_ENABLED
+#define ALP_OPERATIONS_ITF_CTRL(X)                                                                                     \
+    X(ALP_OP_START_ITF, parse_operand_start, process_op_start_itf)                                                    \
+    X(ALP_OP_STOP_ITF, parse_operand_stop, process_op_stop_itf)
+#else
+#define ALP_OPERATIONS_ITF_CTRL(X)
+#endif
+
+#define ALP_OPERATIONS(X)                                                                                              \
+    X(ALP_OP_RETURN_FILE_DATA, parse_operand_file_data, process_op_return_file_data)                                  \
+    X(ALP_OP_STATUS, parse_operand_status, process_op_status)                                                         \
+    X(ALP_OP_RESPONSE_TAG, parse_operand_tag_id, process_op_response_tag)                                             \
+    X(ALP_OP_REQUEST_TAG, parse_operand_tag_id, process_op_request_tag)                                               \
+    ALP_OPERATIONS_READ_FILE_DATA(X)                                                                                   \
+    ALP_OPERATIONS_WRITE_FILE_DATA(X)                                                                                  \
+    ALP_OPERATIONS_FILE_PROPERTIES(X)                                                                                  \
+    ALP_OPERATIONS_CREATE_FILE(X)                                                                                      \
+    ALP_OPERATIONS_QUERY(X)                                                                                            \
+    ALP_OPERATIONS_FORWARD(X)                                                                                          \
+    ALP_OPERATIONS_INDIRECT_FORWARD(X)                                                                                 \
+    ALP_OPERATIONS_ITF_CTRL(X)
+
+#endif // ALP_OPERATIONS_H
+
+/** @}*/
@@ -0,0 +1,158 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "string.h"
+#include "debug.h"
+#include "bitmap.h"
+
+#include "file_distribution.h"
+
+#if MODULE_ALP_FILE_DISTRIBUTION_MAX_CHUNK_COUNT > 255
+#error "The chunk index is transmitted as a single byte"
+#endif
+
+static void set_all_chunks(uint8_t* bitmap, uint8_t chunk_count)
+{
+    memset(bitmap, 0, FILE_DISTRIBUTION_BITMAP_SIZE);
+    for (uint8_t i = 0; i < chunk_count; i++)
+        bitmap_set(bitmap, i);
+}
+
+static bool is_bitmap_empty(const uint8_t* bitmap)
+{
+    for (uint8_t i = 0; i < FILE_DISTRIBUTION_BITMAP_SIZE; i++) {
+        if (bitmap[i])
+            return false;
+    }
+
+    return true;
+}
+
+error_t file_distribution_master_init(file_distribution_master_t* master, uint8_t session_id, uint8_t file_id,
+    uint32_t file_size, uint8_t chunk_size)
+{
+    // session 0 is never used, this is the state of a status file which did not receive anything yet
+    if (chunk_size == 0 || session_id == 0)
+        return -EINVAL;
+
+    uint32_t chunk_count = (file_size + chunk_size - 1) / chunk_size;
+    if (chunk_count == 0 || chunk_count > MODULE_ALP_FILE_DISTRIBUTION_MAX_CHUNK_COUNT)
+        return -EINVAL;
+
+    memset(master, 0, sizeof(file_distribution_master_t));
+    master->session_id = session_id;
+    master->file_id = file_id;
+    master->chunk_size = chunk_size;
+    master->chunk_count = (uint8_t)chunk_count;
+    master->file_size = file_size;
+    set_all_chunks(master->pending, master->chunk_count);
+    return SUCCESS;
+}
+
+bool file_distribution_master_next_chunk(file_distribution_master_t* master, uint8_t* chunk_index)
+{
+    while (master->next_chunk_index < master->chunk_count) {
+        uint8_t index = master->next_chunk_index++;
+        if (bitmap_get(master->pending, index)) {
+            bitmap_clear(master->pending, index);
+            *chunk_index = index;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint8_t file_distribution_master_get_chunk_length(file_distribution_master_t* master, uint8_t chunk_index)
+{
+    assert(chunk_index < master->chunk_count);
+    uint32_t offset = (uint32_t)chunk_index * master->chunk_size;
+    if (master->file_size - offset < master->chunk_size)
+        return (uint8_t)(master->file_size - offset);
+
+    return master->chunk_size;
+}
+
+void file_distribution_master_get_chunk_header(
+    file_distribution_master_t* master, uint8_t chunk_index, file_distribution_status_t* status)
+{
+    status->session_id = master->session_id;
+    status->file_id = master->file_id;
+    status->chunk_size = master->chunk_size;
+    status->chunk_count = master->chunk_count;
+    status->chunk_index = chunk_index;
+}
+
+void file_distribution_master_start_poll(file_distribution_master_t* master)
+{
+    memset(master->missing, 0, FILE_DISTRIBUTION_BITMAP_SIZE);
+}
+
+void file_distribution_master_process_report(file_distribution_master_t* master, const file_distribution_status_t* status)
+{
+    // only receivers which did not complete this session respond to the poll, when they did not receive any chunk of
+    // this session yet their bitmap still applies to an older session
+    if (status->active_session_id != master->session_id) {
+        set_all_chunks(master->missing, master->chunk_count);
+        return;
+    }
+
+    for (uint8_t i = 0; i < FILE_DISTRIBUTION_BITMAP_SIZE; i++)
+        master->missing[i] |= status->missing[i];
+}
+
+file_distribution_poll_result_t file_distribution_master_end_poll(file_distribution_master_t* master)
+{
+    if (is_bitmap_empty(master->missing)) {
+        master->quiet_poll_count++;
+        if (master->quiet_poll_count >= MODULE_ALP_FILE_DISTRIBUTION_QUIET_POLL_COUNT)
+            return FILE_DISTRIBUTION_POLL_DONE;
+
+        return FILE_DISTRIBUTION_POLL_AGAIN;
+    }
+
+    master->quiet_poll_count = 0;
+    if (master->repair_round >= MODULE_ALP_FILE_DISTRIBUTION_MAX_REPAIR_ROUNDS)
+        return FILE_DISTRIBUTION_POLL_FAILED;
+
+    master->repair_round++;
+    memcpy(master->pending, master->missing, FILE_DISTRIBUTION_BITMAP_SIZE);
+    master->next_chunk_index = 0;
+    return FILE_DISTRIBUTION_POLL_REPAIR;
+}
+
+bool file_distribution_receiver_process_status(file_distribution_status_t* status)
+{
+    if (status->session_id == 0 || status->chunk_count == 0
+        || status->chunk_count > MODULE_ALP_FILE_DISTRIBUTION_MAX_CHUNK_COUNT)
+        return false;
+
+    if (status->active_session_id != status->session_id) {
+        // first chunk of a new session
+        set_all_chunks(status->missing, status->chunk_count);
+        status->active_session_id = status->session_id;
+    }
+
+    if (status->chunk_index < status->chunk_count)
+        bitmap_clear(status->missing, status->chunk_index);
+
+    if (is_bitmap_empty(status->missing))
+        status->completed_session_id = status->session_id;
+
+    return true;
+}
@@ -0,0 +1,162 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file file_distribution.h
+ * \addtogroup file_distribution
+ * \ingroup ALP
+ * @{
+ * \brief Multicast distribution of a file to a group of nodes, with NACK based repair
+ *
+ * The master broadcasts the file in numbered chunks to a group addressee (NBID or VID), without requesting responses.
+ * Every chunk is a single ALP command which writes the chunk data straight into the target file on the receivers,
+ * followed by a write of the chunk header in the USER_FILE_FILE_DISTRIBUTION_STATUS_FILE_ID file. A receiver keeps a
+ * bitmap of the chunks it is still missing in this status file.
+ *
+ * After the broadcast the master polls the group with a break query on the completed session ID, so only receivers
+ * which did not receive the complete file respond with their missing chunk bitmap. The union of the reported
+ * bitmaps is rebroadcast, until MODULE_ALP_FILE_DISTRIBUTION_QUIET_POLL_COUNT consecutive polls stay unanswered.
+ *
+ * The target file has to exist on the receivers, with an allocated length of at least the distributed file size.
+ * Receivers need the write file data and break query operations.
+ */
+
+#ifndef FILE_DISTRIBUTION_H
+#define FILE_DISTRIBUTION_H
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "errors.h"
+#include "MODULE_ALP_defs.h"
+
+#define FILE_DISTRIBUTION_BITMAP_SIZE ((MODULE_ALP_FILE_DISTRIBUTION_MAX_CHUNK_COUNT + 7) / 8)
+
+/*! \brief The status file of a receiver. The chunk header is written by the master together with every chunk,
+ * the remaining fields are maintained by the receiver.
+ */
+typedef struct __attribute__((__packed__)) {
+    // chunk header
+    uint8_t session_id;
+    uint8_t file_id;
+    uint8_t chunk_size;
+    uint8_t chunk_count;
+    uint8_t chunk_index;
+    // receiver state
+    uint8_t active_session_id; // the session the missing bitmap applies to
+    uint8_t completed_session_id; // the last session of which all chunks were received
+    uint8_t missing[FILE_DISTRIBUTION_BITMAP_SIZE]; // bit set for every chunk not received yet
+} file_distribution_status_t;
+
+#define FILE_DISTRIBUTION_CHUNK_HEADER_SIZE 5
+
+// ALP overhead of a chunk command on the air: the write action of the chunk data (with a 3 byte offset and 2 byte
+// length operand) and the write action of the chunk header
+#define FILE_DISTRIBUTION_CHUNK_OVERHEAD (1 + 1 + 3 + 2 + 1 + 1 + 1 + 1 + FILE_DISTRIBUTION_CHUNK_HEADER_SIZE)
+#define FILE_DISTRIBUTION_STATUS_SIZE sizeof(file_distribution_status_t)
+
+typedef enum {
+    FILE_DISTRIBUTION_POLL_REPAIR, // rebroadcast the missing chunks
+    FILE_DISTRIBUTION_POLL_AGAIN, // no missing chunks reported, poll again to confirm
+    FILE_DISTRIBUTION_POLL_DONE,
+    FILE_DISTRIBUTION_POLL_FAILED, // still missing chunks after MODULE_ALP_FILE_DISTRIBUTION_MAX_REPAIR_ROUNDS
+} file_distribution_poll_result_t;
+
+/*! \brief State of the master of a distribution session */
+typedef struct {
+    uint8_t session_id;
+    uint8_t file_id;
+    uint8_t chunk_size;
+    uint8_t chunk_count;
+    uint32_t file_size;
+    uint8_t pending[FILE_DISTRIBUTION_BITMAP_SIZE]; // chunks still to be broadcast in the current round
+    uint8_t missing[FILE_DISTRIBUTION_BITMAP_SIZE]; // union of the chunks reported missing during the current poll
+    uint8_t next_chunk_index;
+    uint8_t repair_round;
+    uint8_t quiet_poll_count;
+} file_distribution_master_t;
+
+/*!
+ * \brief Initializes a distribution session, all chunks are pending for the first round.
+ * \return -EINVAL when the chunk size is 0, the session ID is 0 or the file needs more than
+ * MODULE_ALP_FILE_DISTRIBUTION_MAX_CHUNK_COUNT chunks
+ */
+error_t file_distribution_master_init(file_distribution_master_t* master, uint8_t session_id, uint8_t file_id,
+    uint32_t file_size, uint8_t chunk_size);
+
+/*!
+ * \brief Returns the next chunk to broadcast in the current round
+ * \return false when all pending chunks of this round are broadcast, the group should be polled
+ */
+bool file_distribution_master_next_chunk(file_distribution_master_t* master, uint8_t* chunk_index);
+
+uint8_t file_distribution_master_get_chunk_length(file_distribution_master_t* master, uint8_t chunk_index);
+
+/*! \brief Fills the chunk header part of a status file, to be written after the chunk data */
+void file_distribution_master_get_chunk_header(
+    file_distribution_master_t* master, uint8_t chunk_index, file_distribution_status_t* status);
+
+void file_distribution_master_start_poll(file_distribution_master_t* master);
+
+/*!
+ * \brief Merges the status file reported by a receiver during a poll. Reports of other sessions are ignored, a
+ * receiver which did not receive any chunk of this session yet is missing all chunks.
+ */
+void file_distribution_master_process_report(file_distribution_master_t* master, const file_distribution_status_t* status);
+
+file_distribution_poll_result_t file_distribution_master_end_poll(file_distribution_master_t* master);
+
+/*!
+ * \brief Updates the receiver state of a status file after the master wrote a chunk header
+ * \return true when the status changed and has to be written back
+ */
+bool file_distribution_receiver_process_status(file_distribution_status_t* status);
+
+#ifdef MODULE_D7AP
+#include "alp.h"
+#include "d7ap.h"
+
+typedef void (*file_distribution_completed_callback)(uint8_t file_id, bool success);
+
+/*!
+ * \brief Creates the status file when it does not exist yet and starts tracking received chunks
+ */
+error_t file_distribution_init();
+
+/*!
+ * \brief Distributes the local file with the given ID to the same file on the nodes addressed by session_config.
+ * The response mode of session_config is overruled.
+ * \return -EBUSY when a distribution is still in progress
+ */
+error_t file_distribution_start(uint8_t file_id, uint8_t chunk_size, d7ap_session_config_t* session_config,
+    file_distribution_completed_callback completed_cb);
+
+/*!
+ * \brief To be called from the alp_command_result_cb of the application, to collect the reports of a poll
+ */
+void file_distribution_process_command_result(alp_command_t* command, alp_interface_status_t* origin_itf_status);
+
+/*!
+ * \brief To be called from the alp_command_completed_cb of the application
+ * \return true when the command belonged to the distribution
+ */
+bool file_distribution_process_command_completed(uint8_t tag_id, bool success);
+#endif
+
+#endif // FILE_DISTRIBUTION_H
+
+/** @}*/
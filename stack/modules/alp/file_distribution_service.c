@@ -0,0 +1,257 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "debug.h"
+#include "log.h"
+#include "errors.h"
+#include "random.h"
+#include "scheduler.h"
+#include "fs.h"
+#include "d7ap_fs.h"
+#include "alp_layer.h"
+
+#include "file_distribution.h"
+
+#if defined(FRAMEWORK_LOG_ENABLED) && defined(MODULE_ALP_LOG_ENABLED)
+#define DPRINT(...) log_print_stack_string(LOG_STACK_ALP, __VA_ARGS__)
+#else
+#define DPRINT(...)
+#endif
+
+typedef enum {
+    STATE_IDLE,
+    STATE_BROADCAST,
+    STATE_POLL,
+} state_t;
+
+static state_t state = STATE_IDLE;
+static file_distribution_master_t master;
+static alp_interface_config_d7ap_t itf_config;
+static file_distribution_completed_callback completed_cb;
+static uint8_t session_id = 0;
+static uint8_t tag_id = 0;
+static uint8_t chunk_data[255];
+
+static void status_file_modified_callback(uint8_t file_id)
+{
+    file_distribution_status_t status;
+    uint32_t length = FILE_DISTRIBUTION_STATUS_SIZE;
+    if (d7ap_fs_read_file(file_id, 0, (uint8_t*)&status, &length, ROOT_AUTH) != SUCCESS)
+        return;
+
+    if (!file_distribution_receiver_process_status(&status)) {
+        DPRINT("Ignoring invalid chunk header");
+        return;
+    }
+
+    DPRINT("Received chunk %i/%i of file %i in session %i", status.chunk_index, status.chunk_count, status.file_id,
+        status.session_id);
+
+    // only write back the receiver state, without triggering this callback again
+    d7ap_fs_write_file_with_callback(file_id, FILE_DISTRIBUTION_CHUNK_HEADER_SIZE,
+        (uint8_t*)&status + FILE_DISTRIBUTION_CHUNK_HEADER_SIZE,
+        FILE_DISTRIBUTION_STATUS_SIZE - FILE_DISTRIBUTION_CHUNK_HEADER_SIZE, ROOT_AUTH, false);
+}
+
+static error_t send_chunk(uint8_t chunk_index)
+{
+    uint32_t offset = (uint32_t)chunk_index * master.chunk_size;
+    uint32_t length = file_distribution_master_get_chunk_length(&master, chunk_index);
+    int rc = d7ap_fs_read_file(master.file_id, offset, chunk_data, &length, ROOT_AUTH);
+    if (rc != SUCCESS)
+        return rc;
+
+    file_distribution_status_t chunk_header;
+    file_distribution_master_get_chunk_header(&master, chunk_index, &chunk_header);
+
+    alp_command_t* command = alp_layer_command_alloc(true, true);
+    if (command == NULL)
+        return -ENOMEM;
+
+    // the chunk data is written first, so the chunk is only marked as received when the data is stored
+    itf_config.d7ap_session_config.qos.qos_resp_mode = SESSION_RESP_MODE_NO;
+    if (!alp_append_forward_action(command, (alp_interface_config_t*)&itf_config, sizeof(itf_config))
+        || !alp_append_write_file_data_action(command, master.file_id, offset, length, chunk_data, false, false)
+        || !alp_append_write_file_data_action(command, USER_FILE_FILE_DISTRIBUTION_STATUS_FILE_ID, 0,
+            FILE_DISTRIBUTION_CHUNK_HEADER_SIZE, (uint8_t*)&chunk_header, false, false)) {
+        alp_layer_command_free(command);
+        return -ESIZE;
+    }
+
+    DPRINT("Broadcasting chunk %i of file %i", chunk_index, master.file_id);
+    tag_id = command->tag_id;
+    alp_layer_process(command);
+    return SUCCESS;
+}
+
+static error_t send_poll()
+{
+    alp_command_t* command = alp_layer_command_alloc(true, true);
+    if (command == NULL)
+        return -ENOMEM;
+
+    // only receivers which did not complete this session return their status
+    file_distribution_master_start_poll(&master);
+    itf_config.d7ap_session_config.qos.qos_resp_mode = SESSION_RESP_MODE_ALL;
+    if (!alp_append_forward_action(command, (alp_interface_config_t*)&itf_config, sizeof(itf_config))
+        || !alp_append_break_query_action(command, USER_FILE_FILE_DISTRIBUTION_STATUS_FILE_ID,
+            offsetof(file_distribution_status_t, completed_session_id), &master.session_id, 1,
+            ARITH_COMP_TYPE_INEQUALITY)
+        || !alp_append_read_file_data_action(
+            command, USER_FILE_FILE_DISTRIBUTION_STATUS_FILE_ID, 0, FILE_DISTRIBUTION_STATUS_SIZE, true, false)) {
+        alp_layer_command_free(command);
+        return -ESIZE;
+    }
+
+    DPRINT("Polling for missing chunks of file %i", master.file_id);
+    tag_id = command->tag_id;
+    alp_layer_process(command);
+    return SUCCESS;
+}
+
+static void finish(bool success)
+{
+    DPRINT("Distribution of file %i completed, success %i", master.file_id, success);
+    state = STATE_IDLE;
+    if (completed_cb)
+        completed_cb(master.file_id, success);
+}
+
+static void distribute_next(void* arg)
+{
+    uint8_t chunk_index;
+    error_t rc;
+    if (file_distribution_master_next_chunk(&master, &chunk_index)) {
+        state = STATE_BROADCAST;
+        rc = send_chunk(chunk_index);
+    } else {
+        state = STATE_POLL;
+        rc = send_poll();
+    }
+
+    if (rc != SUCCESS) {
+        log_print_error_string("file distribution: sending failed with error %i", rc);
+        finish(false);
+    }
+}
+
+error_t file_distribution_init()
+{
+    d7ap_fs_file_header_t status_file_header = {
+        .file_permissions = (file_permission_t){ .guest_read = true, .guest_write = true, .user_read = true, .user_write = true },
+        .file_properties.storage_class = FS_STORAGE_PERMANENT,
+        .length = FILE_DISTRIBUTION_STATUS_SIZE,
+        .allocated_length = FILE_DISTRIBUTION_STATUS_SIZE
+    };
+
+    if (!fs_file_stat(USER_FILE_FILE_DISTRIBUTION_STATUS_FILE_ID)) {
+        int rc = d7ap_fs_init_file(USER_FILE_FILE_DISTRIBUTION_STATUS_FILE_ID, &status_file_header, NULL);
+        if (rc != SUCCESS)
+            return rc;
+    }
+
+    d7ap_fs_register_file_modified_callback(USER_FILE_FILE_DISTRIBUTION_STATUS_FILE_ID, &status_file_modified_callback);
+    sched_register_task(&distribute_next);
+    // avoid reusing the session ID of a distribution which was interrupted by a reset
+    session_id = get_rnd() % 0xFF;
+    return SUCCESS;
+}
+
+error_t file_distribution_start(uint8_t file_id, uint8_t chunk_size, d7ap_session_config_t* session_config,
+    file_distribution_completed_callback cb)
+{
+    if (state != STATE_IDLE)
+        return -EBUSY;
+
+    if (chunk_size > d7ap_get_payload_max_size(session_config->addressee.ctrl.nls_method) - FILE_DISTRIBUTION_CHUNK_OVERHEAD)
+        return -ESIZE;
+
+    session_id++;
+    if (session_id == 0)
+        session_id++;
+
+    error_t rc = file_distribution_master_init(&master, session_id, file_id, d7ap_fs_get_file_length(file_id), chunk_size);
+    if (rc != SUCCESS)
+        return rc;
+
+    itf_config = (alp_interface_config_d7ap_t){
+        .itf_id = ALP_ITF_ID_D7ASP,
+        .d7ap_session_config = *session_config,
+    };
+    completed_cb = cb;
+    DPRINT("Distributing file %i in %i chunks, session %i", file_id, master.chunk_count, session_id);
+    state = STATE_BROADCAST;
+    sched_post_task(&distribute_next);
+    return SUCCESS;
+}
+
+void file_distribution_process_command_result(alp_command_t* command, alp_interface_status_t* origin_itf_status)
+{
+    if (state != STATE_POLL)
+        return;
+
+    // use a copy, so the application can still parse the original command
+    static alp_command_t command_copy;
+    memcpy(&command_copy, command, sizeof(alp_command_t));
+    alp_action_t action;
+    while (fifo_get_size(&command_copy.alp_command_fifo) > 0) {
+        if (!alp_parse_action(&command_copy, &action))
+            return;
+
+        if (action.ctrl.operation != ALP_OP_RETURN_FILE_DATA
+            || action.file_data_operand.file_offset.file_id != USER_FILE_FILE_DISTRIBUTION_STATUS_FILE_ID
+            || action.file_data_operand.file_offset.offset != 0
+            || action.file_data_operand.provided_data_length != FILE_DISTRIBUTION_STATUS_SIZE)
+            continue;
+
+        DPRINT("Received missing chunks report");
+        file_distribution_master_process_report(&master, (file_distribution_status_t*)action.file_data_operand.data);
+    }
+}
+
+bool file_distribution_process_command_completed(uint8_t completed_tag_id, bool success)
+{
+    if (state == STATE_IDLE || completed_tag_id != tag_id)
+        return false;
+
+    // a chunk which failed to be broadcast is reported missing by the receivers, a failed poll just did not receive
+    // any report
+    if (!success)
+        DPRINT("Command with tag %i failed", completed_tag_id);
+
+    if (state == STATE_POLL) {
+        switch (file_distribution_master_end_poll(&master)) {
+        case FILE_DISTRIBUTION_POLL_REPAIR:
+            DPRINT("Repair round %i", master.repair_round);
+            break;
+        case FILE_DISTRIBUTION_POLL_AGAIN:
+            break;
+        case FILE_DISTRIBUTION_POLL_DONE:
+            finish(true);
+            return true;
+        case FILE_DISTRIBUTION_POLL_FAILED:
+            finish(false);
+            return true;
+        }
+    }
+
+    sched_post_task(&distribute_next);
+    return true;
+}
@@ -0,0 +1,105 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "string.h"
+
+#include "bg_scan_control.h"
+
+// more than 3/4 false triggers raises the threshold, less than 1/4 lowers it
+#define RAISE_FALSE_TRIGGER_COUNT (BG_SCAN_CONTROL_WINDOW * 3 / 4)
+#define LOWER_FALSE_TRIGGER_COUNT (BG_SCAN_CONTROL_WINDOW / 4)
+
+static void start_window(bg_scan_control_t* control)
+{
+    control->trigger_count = 0;
+    control->false_trigger_count = 0;
+    control->window_weakest_detection_rssi = INT16_MAX;
+    control->window_longest_detection_delay = 0;
+}
+
+static void end_window(bg_scan_control_t* control)
+{
+    if (control->false_trigger_count > RAISE_FALSE_TRIGGER_COUNT
+        && control->rssi_offset + BG_SCAN_CONTROL_STEP_DB <= BG_SCAN_CONTROL_MAX_OFFSET_DB)
+        control->rssi_offset += BG_SCAN_CONTROL_STEP_DB;
+    else if (control->false_trigger_count < LOWER_FALSE_TRIGGER_COUNT && control->rssi_offset >= BG_SCAN_CONTROL_STEP_DB)
+        control->rssi_offset -= BG_SCAN_CONTROL_STEP_DB;
+
+    // without detections in this window, there is nothing new to learn about the received background frames
+    if (control->window_weakest_detection_rssi != INT16_MAX)
+    {
+        // frames below the threshold are never detected, so the weakest detection is kept and can only get weaker
+        if (control->window_weakest_detection_rssi < control->weakest_detection_rssi)
+            control->weakest_detection_rssi = control->window_weakest_detection_rssi;
+
+        uint16_t listen_timeout = control->window_longest_detection_delay + control->min_listen_timeout;
+        if (listen_timeout > control->max_listen_timeout)
+            listen_timeout = control->max_listen_timeout;
+
+        control->listen_timeout = listen_timeout;
+    }
+
+    start_window(control);
+}
+
+void bg_scan_control_init(bg_scan_control_t* control, uint8_t min_listen_timeout, uint8_t max_listen_timeout)
+{
+    memset(control, 0, sizeof(bg_scan_control_t));
+    control->min_listen_timeout = min_listen_timeout;
+    control->max_listen_timeout = max_listen_timeout;
+    control->listen_timeout = max_listen_timeout;
+    control->weakest_detection_rssi = INT16_MAX;
+    start_window(control);
+}
+
+int16_t bg_scan_control_get_rssi_thr(const bg_scan_control_t* control, int16_t rssi_thr)
+{
+    int16_t adapted_rssi_thr = rssi_thr + control->rssi_offset;
+    if (control->weakest_detection_rssi != INT16_MAX
+        && adapted_rssi_thr > control->weakest_detection_rssi - BG_SCAN_CONTROL_DETECTION_MARGIN_DB)
+        adapted_rssi_thr = control->weakest_detection_rssi - BG_SCAN_CONTROL_DETECTION_MARGIN_DB;
+
+    // never more sensitive than the DLL requires, this threshold is also used for the noise floor measurement
+    if (adapted_rssi_thr < rssi_thr)
+        adapted_rssi_thr = rssi_thr;
+
+    return adapted_rssi_thr;
+}
+
+uint8_t bg_scan_control_get_listen_timeout(const bg_scan_control_t* control)
+{
+    return control->listen_timeout;
+}
+
+void bg_scan_control_report_trigger(bg_scan_control_t* control, int16_t rssi, bool detected, uint8_t detection_delay)
+{
+    control->trigger_count++;
+    if (!detected)
+        control->false_trigger_count++;
+    else
+    {
+        if (rssi < control->window_weakest_detection_rssi)
+            control->window_weakest_detection_rssi = rssi;
+
+        if (detection_delay > control->window_longest_detection_delay)
+            control->window_longest_detection_delay = detection_delay;
+    }
+
+    if (control->trigger_count == BG_SCAN_CONTROL_WINDOW)
+        end_window(control);
+}
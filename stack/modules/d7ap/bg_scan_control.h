@@ -0,0 +1,78 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file bg_scan_control.h
+ * \addtogroup Bg_scan_control
+ * \ingroup D7AP
+ * @{
+ * \brief Adapts the RSSI threshold and the listen timeout of the background scan of one channel.
+ *
+ * A background scan which measures an RSSI above the threshold listens for a background frame until the listen
+ * timeout. When no frame is detected this is a false trigger, caused by noise or by foreign traffic on the channel.
+ * The outcome of every trigger is reported, and after every window of BG_SCAN_CONTROL_WINDOW triggers:
+ * - the threshold is raised by BG_SCAN_CONTROL_STEP_DB when most triggers are false, and lowered again when most
+ *   triggers result in a detection. The threshold stays between the threshold set by the DLL (based on the noise
+ *   floor) and BG_SCAN_CONTROL_MAX_OFFSET_DB above it, and at least BG_SCAN_CONTROL_DETECTION_MARGIN_DB below the
+ *   weakest background frame detected so far, so the nodes which were heard before are not lost.
+ * - the listen timeout is set to the longest time needed to detect a frame in the window plus To, between To and
+ *   the maximum listen timeout.
+ */
+
+#ifndef OSS_7_BG_SCAN_CONTROL_H
+#define OSS_7_BG_SCAN_CONTROL_H
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#define BG_SCAN_CONTROL_WINDOW 16
+#define BG_SCAN_CONTROL_STEP_DB 2
+#define BG_SCAN_CONTROL_MAX_OFFSET_DB 16
+#define BG_SCAN_CONTROL_DETECTION_MARGIN_DB 6
+
+typedef struct
+{
+    uint8_t rssi_offset;            /**< Added to the RSSI threshold set by the DLL */
+    uint8_t listen_timeout;         /**< In ticks, after the RSSI triggered the scan */
+    uint8_t min_listen_timeout;     /**< To, the duration of a background frame including the longest preamble */
+    uint8_t max_listen_timeout;
+    int16_t weakest_detection_rssi; /**< INT16_MAX as long as no frame was detected */
+    uint8_t trigger_count;          /**< In the current window */
+    uint8_t false_trigger_count;
+    int16_t window_weakest_detection_rssi;
+    uint8_t window_longest_detection_delay;
+} bg_scan_control_t;
+
+/*! Starts with the RSSI threshold set by the DLL and the maximum listen timeout */
+void bg_scan_control_init(bg_scan_control_t* control, uint8_t min_listen_timeout, uint8_t max_listen_timeout);
+
+/*! Returns the RSSI threshold to use, based on the threshold set by the DLL */
+int16_t bg_scan_control_get_rssi_thr(const bg_scan_control_t* control, int16_t rssi_thr);
+
+uint8_t bg_scan_control_get_listen_timeout(const bg_scan_control_t* control);
+
+/*!
+ * Reports the outcome of a scan which was triggered by an RSSI above the threshold.
+ * \param rssi              The RSSI which triggered the scan
+ * \param detected          True when a background frame was received before the listen timeout
+ * \param detection_delay   The time between the trigger and the detection of the sync word of the frame, in ticks
+ */
+void bg_scan_control_report_trigger(bg_scan_control_t* control, int16_t rssi, bool detected, uint8_t detection_delay);
+
+#endif //OSS_7_BG_SCAN_CONTROL_H
+
+/** @}*/
@@ -0,0 +1,173 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "string.h"
+
+#include "channel_queue.h"
+#include "random.h"
+
+// the number of channel indexes taken by a 200 kHz channel
+#define WIDE_CHANNEL_INDEX_COUNT 8
+
+static void add_channel(channel_queue_t* queue, uint16_t candidate_count, const channel_queue_entry_t* entry)
+{
+    // when there are more channels than fit in the queue, each of them has the same chance to be in it
+    if (candidate_count < CHANNEL_QUEUE_SIZE)
+    {
+        queue->entries[queue->length++] = *entry;
+        return;
+    }
+
+    uint32_t position = get_rnd() % (candidate_count + 1);
+    if (position < CHANNEL_QUEUE_SIZE)
+        queue->entries[position] = *entry;
+}
+
+static void build(channel_queue_t* queue, const dae_access_profile_t* access_profile, uint8_t access_mask)
+{
+    channel_queue_init(queue);
+    queue->access_profile = *access_profile;
+    queue->access_mask = access_mask;
+
+    uint8_t subband_bitmap = 0;
+    for (uint8_t i = 0; i < SUBPROFILES_NB; i++)
+    {
+        if (access_mask & (0x01 << i))
+            subband_bitmap |= access_profile->subprofiles[i].subband_bitmap;
+    }
+
+    uint8_t index_step = 1;
+    if (access_profile->channel_header.ch_class != PHY_CLASS_LO_RATE)
+        index_step = WIDE_CHANNEL_INDEX_COUNT;
+
+    uint16_t candidate_count = 0;
+    for (uint8_t i = 0; i < SUBBANDS_NB; i++)
+    {
+        if (!(subband_bitmap & (0x01 << i)))
+            continue;
+
+        const subband_t* subband = &access_profile->subbands[i];
+        channel_queue_entry_t entry = {
+            .channel_id.channel_header_raw = access_profile->channel_header_raw,
+            .eirp = subband->eirp,
+            .cca = subband->cca,
+            .noise_floor = subband->cca
+        };
+
+        // a subband which ends before its start only holds the start channel
+        uint32_t index = subband->channel_index_start;
+        do
+        {
+            entry.channel_id.center_freq_index = index;
+            add_channel(queue, candidate_count++, &entry);
+            index += index_step;
+        } while (index <= subband->channel_index_end && candidate_count < UINT16_MAX);
+    }
+}
+
+static uint8_t get_noise_floor_step(const channel_queue_entry_t* entry)
+{
+    return entry->noise_floor / CHANNEL_QUEUE_NOISE_FLOOR_STEP_DB;
+}
+
+static void order(channel_queue_t* queue)
+{
+    for (uint8_t i = queue->length; i > 1; i--)
+    {
+        uint8_t j = get_rnd() % i;
+        channel_queue_entry_t entry = queue->entries[i - 1];
+        queue->entries[i - 1] = queue->entries[j];
+        queue->entries[j] = entry;
+    }
+
+    // the noise floor is in -dBm, the quietest channel has the highest value. The sort is stable, so the channels
+    // with a similar noise floor keep their random order.
+    for (uint8_t i = 1; i < queue->length; i++)
+    {
+        channel_queue_entry_t entry = queue->entries[i];
+        uint8_t j = i;
+        while (j > 0 && get_noise_floor_step(&queue->entries[j - 1]) < get_noise_floor_step(&entry))
+        {
+            queue->entries[j] = queue->entries[j - 1];
+            j--;
+        }
+
+        queue->entries[j] = entry;
+    }
+
+    queue->front = 0;
+}
+
+void channel_queue_init(channel_queue_t* queue)
+{
+    memset(queue, 0, sizeof(channel_queue_t));
+}
+
+const channel_queue_entry_t* channel_queue_start(channel_queue_t* queue, const dae_access_profile_t* access_profile,
+                                                 uint8_t access_mask)
+{
+    if (queue->length == 0 || queue->access_mask != access_mask
+        || memcmp(&queue->access_profile, access_profile, sizeof(dae_access_profile_t)) != 0)
+        build(queue, access_profile, access_mask);
+
+    order(queue);
+    return channel_queue_get_front(queue);
+}
+
+const channel_queue_entry_t* channel_queue_get_front(const channel_queue_t* queue)
+{
+    if (queue->length == 0)
+        return NULL;
+
+    return &queue->entries[queue->front];
+}
+
+bool channel_queue_shift(channel_queue_t* queue)
+{
+    if (queue->length == 0)
+        return false;
+
+    int8_t eirp = queue->entries[queue->front].eirp;
+    for (uint8_t i = 1; i < queue->length; i++)
+    {
+        uint8_t next = (queue->front + i) % queue->length;
+        if (queue->entries[next].eirp == eirp)
+        {
+            queue->front = next;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void channel_queue_report_rssi(channel_queue_t* queue, int16_t rssi)
+{
+    if (queue->length == 0)
+        return;
+
+    uint8_t noise_floor = 0;
+    if (rssi < -UINT8_MAX)
+        noise_floor = UINT8_MAX;
+    else if (rssi < 0)
+        noise_floor = -rssi;
+
+    // a moving average, a channel which is found busy during several CCAs moves to the back of the queue
+    channel_queue_entry_t* entry = &queue->entries[queue->front];
+    entry->noise_floor = (3 * entry->noise_floor + noise_floor + 2) / 4;
+}
@@ -0,0 +1,89 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file channel_queue.h
+ * \addtogroup Channel_queue
+ * \ingroup D7AP
+ * @{
+ * \brief The queue of channels a requester can transmit a request on with CSMA-CA.
+ *
+ * The queue holds the channels of the subbands of the selectable subprofiles of an access profile (having their
+ * access mask bit set and a non-void subband bitmap). Normal and high rate channels take 8 channel indexes (200 kHz),
+ * low rate channels one index (25 kHz).
+ *
+ * Every request starts at the front of the queue. The channels are ordered randomly, to spread the requesters over
+ * the channels, and then by their recent noise floor, quietest first, in steps of CHANNEL_QUEUE_NOISE_FLOOR_STEP_DB.
+ * The noise floor of a channel is estimated from the RSSI of the CCAs on that channel, as long as the access profile
+ * and the access mask do not change. When the CCA fails, CSMA-CA shifts the queue to the next channel which can be
+ * used with the same EIRP, because the EIRP is part of the DLL header which was already assembled.
+ */
+
+#ifndef OSS_7_CHANNEL_QUEUE_H
+#define OSS_7_CHANNEL_QUEUE_H
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "dae.h"
+#include "phy.h"
+
+#define CHANNEL_QUEUE_SIZE 16
+#define CHANNEL_QUEUE_NOISE_FLOOR_STEP_DB 3
+
+typedef struct
+{
+    channel_id_t channel_id;
+    int8_t eirp;
+    uint8_t cca;                    /**< The default CCA threshold of the subband (-dBm) */
+    uint8_t noise_floor;            /**< The recent noise floor (-dBm), the default CCA threshold until measured */
+} channel_queue_entry_t;
+
+typedef struct
+{
+    channel_queue_entry_t entries[CHANNEL_QUEUE_SIZE];
+    uint8_t length;
+    uint8_t front;
+    dae_access_profile_t access_profile; /**< The access profile the channels were taken from */
+    uint8_t access_mask;
+} channel_queue_t;
+
+void channel_queue_init(channel_queue_t* queue);
+
+/*!
+ * Prepares the queue for a new request. The channels are taken again from the access profile when it or the access
+ * mask changed, otherwise the channels and their noise floor are kept. The queue is ordered again in both cases.
+ * Returns the channel at the front of the queue or NULL when the access profile has no selectable channels.
+ */
+const channel_queue_entry_t* channel_queue_start(channel_queue_t* queue, const dae_access_profile_t* access_profile,
+                                                 uint8_t access_mask);
+
+/*! Returns the channel at the front of the queue or NULL when the queue is empty */
+const channel_queue_entry_t* channel_queue_get_front(const channel_queue_t* queue);
+
+/*!
+ * Moves the front of the queue to the next channel with the same EIRP, wrapping around at the end of the queue.
+ * Returns false when there is no such channel, the front is not changed in this case.
+ */
+bool channel_queue_shift(channel_queue_t* queue);
+
+/*! Updates the noise floor of the channel at the front of the queue with the RSSI measured by a CCA */
+void channel_queue_report_rssi(channel_queue_t* queue, int16_t rssi);
+
+#endif //OSS_7_CHANNEL_QUEUE_H
+
+/** @}*/
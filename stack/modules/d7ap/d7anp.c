@@ -21,6 +21,7 @@
 
 #include "debug.h"
 #include "packet.h"
+#include "packet_codec.h"
 #include "d7anp.h"
 #include "d7ap_fs.h"
 #include "ng.h"
@@ -32,6 +33,11 @@
 #include "errors.h"
 #include "timer.h"
 
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+#include "crc.h"
+#include "duplicate_filter.h"
+#endif
+
 #if defined(FRAMEWORK_LOG_ENABLED) && defined(MODULE_D7AP_NP_LOG_ENABLED)
 #define DPRINT(...) log_print_stack_string(LOG_STACK_NWL, __VA_ARGS__)
 #define DPRINT_DATA(...) log_print_data(__VA_ARGS__)
@@ -67,36 +73,28 @@ static dae_nwl_ssr_t NGDEF(_node_security_state);
 
 static dae_nwl_trusted_node_t* NGDEF(_latest_node);
 #define latest_node NG(_latest_node)
+
+static void precompute_keystream(void *arg);
 #endif
 
 static timer_event d7anp_fg_scan_expired_timer;
 static timer_event d7anp_start_fg_scan_after_d7aadvp_timer;
 
-d7ap_addressee_id_type_t address_id_type;
-uint8_t address_id[8];
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+static duplicate_filter_t NGDEF(_relay_duplicate_filter);
+#define relay_duplicate_filter NG(_relay_duplicate_filter)
 
-#if defined(MODULE_D7AP_NLS_ENABLED)
-static inline uint8_t get_auth_len(uint8_t nls_method)
-{
-    switch(nls_method)
-    {
-    case AES_CTR:
-        return 0;
-    case AES_CBC_MAC_128:
-    case AES_CCM_128:
-        return 16;
-    case AES_CBC_MAC_64:
-    case AES_CCM_64:
-        return 8;
-    case AES_CBC_MAC_32:
-    case AES_CCM_32:
-        return 4;
-    default:
-        assert(false);
-    }
-}
+// the frame which is being relayed, an own frame to transmit meanwhile is transmitted after it
+static packet_t* NGDEF(_relayed_packet);
+#define relayed_packet NG(_relayed_packet)
+
+static packet_t* NGDEF(_pending_tx_packet);
+#define pending_tx_packet NG(_pending_tx_packet)
 #endif
 
+d7ap_addressee_id_type_t address_id_type;
+uint8_t address_id[8];
+
 static void switch_state(state_t next_state)
 {
     switch(next_state)
@@ -224,6 +222,11 @@ void d7anp_init()
 
     d7anp_state = D7ANP_STATE_IDLE;
     fg_scan_timeout_ticks = 0;
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+    relayed_packet = NULL;
+    pending_tx_packet = NULL;
+    duplicate_filter_init(&relay_duplicate_filter);
+#endif
 
     // Initialize timers
     timer_init_event(&d7anp_fg_scan_expired_timer, &foreground_scan_expired);
@@ -251,6 +254,7 @@ void d7anp_init()
 
     d7ap_fs_register_file_modified_callback(D7A_FILE_NWL_SECURITY_KEY, &set_key);
     set_key(D7A_FILE_NWL_SECURITY_KEY);
+    sched_register_task(&precompute_keystream);
 
     /* Read the NWL security parameters */
     d7ap_fs_read_nwl_security(&security_state);
@@ -262,6 +266,30 @@ void d7anp_init()
 #endif
 }
 
+d7ap_addressee_id_type_t d7anp_get_origin_id_type()
+{
+    return address_id_type;
+}
+
+uint8_t d7anp_get_security_overhead(uint8_t nls_method)
+{
+#if defined(MODULE_D7AP_NLS_ENABLED)
+    if (nls_method == AES_NONE)
+        return 0;
+
+    uint8_t overhead = packet_codec_nls_auth_length(nls_method);
+
+    // key counter and frame counter, see d7anp_assemble_packet_header()
+    if (nls_method == AES_CTR || nls_method == AES_CCM_32 || nls_method == AES_CCM_64 || nls_method == AES_CCM_128)
+        overhead += 1 + sizeof(uint32_t);
+
+    return overhead;
+#else
+    (void)nls_method;
+    return 0;
+#endif
+}
+
 void d7anp_stop()
 {
     d7anp_state = D7ANP_STATE_STOPPED;
@@ -271,18 +299,36 @@ void d7anp_stop()
 
 error_t d7anp_tx_foreground_frame(packet_t* packet, bool should_include_origin_template)
 {
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+    assert(d7anp_state == D7ANP_STATE_IDLE || d7anp_state == D7ANP_STATE_FOREGROUND_SCAN
+           || (d7anp_state == D7ANP_STATE_TRANSMIT && relayed_packet != NULL && pending_tx_packet == NULL));
+
+    // only a single destination can be reached by hopping, the destination ID is part of the D7ANP header
+    d7ap_addressee_t* addressee = packet->d7anp_addressee;
+    packet->d7anp_ctrl.hop_enabled = addressee->ctrl.hop_limit && !ID_TYPE_IS_BROADCAST(addressee->ctrl.id_type);
+    if (packet->d7anp_ctrl.hop_enabled)
+    {
+        packet->d7anp_hop_ctrl.hop_count = 0;
+        packet->d7anp_hop_ctrl.hop_limit = addressee->ctrl.hop_limit;
+        packet->d7anp_hop_ctrl.destination_id_type = addressee->ctrl.id_type;
+        memcpy(packet->destination_access_id, addressee->id, d7ap_addressee_id_length(addressee->ctrl.id_type));
+    }
+#else
     assert(d7anp_state == D7ANP_STATE_IDLE || d7anp_state == D7ANP_STATE_FOREGROUND_SCAN);
 
     packet->d7anp_ctrl.hop_enabled = false;
+#endif
 
     // we need to switch back to the current state after the transmission procedure
-    d7anp_prev_state = d7anp_state;
+    if (d7anp_state != D7ANP_STATE_TRANSMIT)
+        d7anp_prev_state = d7anp_state;
 
     // No need to initialize the packet field in case of retry, except the security frame counter
     if (packet->type == RETRY_REQUEST)
         goto security;
 
-    if (!should_include_origin_template)
+    // the intermediate nodes and the destination need the origin of a hopping frame to route the response back
+    if (!should_include_origin_template && !packet->d7anp_ctrl.hop_enabled)
     {
         packet->d7anp_ctrl.origin_id_type = ID_TYPE_NOID;
         packet->d7anp_ctrl.origin_void = true;
@@ -319,6 +365,15 @@ security:
     assert(packet->d7anp_ctrl.nls_method == AES_NONE); // when encryption is requested the MODULE_D7AP_NLS_ENABLED cmake option should be set
 #endif
 
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+    if (relayed_packet)
+    {
+        DPRINT("Transmitting after the relayed frame");
+        pending_tx_packet = packet;
+        return SUCCESS;
+    }
+#endif
+
     switch_state(D7ANP_STATE_TRANSMIT);
     dll_tx_frame(packet);
     return SUCCESS;
@@ -333,19 +388,6 @@ static void schedule_foreground_scan_after_D7AAdvP(timer_tick_t eta)
 }
 
 #if defined(MODULE_D7AP_NLS_ENABLED)
-static inline void write_be32(uint8_t *buf, uint32_t val)
-{
-    buf[0] = (val >> 24) & 0xff;
-    buf[1] = (val >> 16) & 0xff;
-    buf[2] = (val >> 8) & 0xff;
-    buf[3] = val & 0xff;
-}
-
-static inline uint32_t read_be32(const uint8_t *buf)
-{
-    return ((uint32_t) buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
-}
-
 static void build_header(packet_t *packet, uint8_t payload_len, uint8_t *header)
 {
     /*
@@ -365,28 +407,35 @@ static void build_header(packet_t *packet, uint8_t payload_len, uint8_t *header)
     DPRINT_DATA(header, AES_BLOCK_SIZE);
 }
 
-static void build_iv(packet_t *packet, uint8_t payload_len, uint8_t *iv)
+static void precompute_keystream(void *arg)
 {
-    /*
-     * According DASH7 specification, the initialization vector is defined  as (LSB first):
-     * IV: Block counter | NLS Method | Key counter | Frame counter | Origin ID | Control extension | Payload length
-     */
+    if (AES128_CTR_precompute_keystream_block())
+        sched_post_task_prio(&precompute_keystream, MIN_PRIORITY, NULL);
+}
 
-    memset(iv, 0, AES_BLOCK_SIZE);
+/*
+ * The next secured frame is most likely the next request or response of the same dialog partner, with the same
+ * length, only differing in the frame counter. Its keystream is computed ahead, one block per task so other tasks
+ * are not delayed. When the guess turns out wrong AES128_CTR_encrypt() just computes the keystream itself.
+ */
+static void start_keystream_precomputation(const uint8_t *iv, uint8_t nls_method, uint8_t payload_len)
+{
+    if (security_state.frame_counter == (uint32_t)~0)
+        return;
 
-    /* AES-CTR/AES-CCM Initialization Vector (IV)*/
-    iv[0] = SET_NLS_METHOD(packet->d7anp_ctrl.nls_method);
-    iv[1] = packet->d7anp_security.key_counter;
-    write_be32(&iv[2], packet->d7anp_security.frame_counter);
-    /* When Origin ID is not provided in the NWL frame, it is provided by upper layer.*/
-    memcpy( iv + 6, packet->origin_access_id, packet->d7anp_ctrl.origin_id_type == ID_TYPE_VID? 2 : 8);
-    iv[14] = packet->d7anp_ctrl.raw;
-    iv[15] = payload_len;
+    uint8_t ctr_blk[AES_BLOCK_SIZE];
+    uint16_t block_count = (payload_len + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+    memcpy(ctr_blk, iv, AES_BLOCK_SIZE);
+    packet_codec_set_nls_iv_frame_counter(ctr_blk, security_state.frame_counter);
+    if (nls_method != AES_CTR)
+    {
+        // CCM encrypts the authentication tag with block counter 0 and the payload starting from block counter 1
+        ctr_blk[0] &= 0xF0;
+        block_count++;
+    }
 
-#if defined(FRAMEWORK_AES_LOG_ENABLED)
-    DPRINT("iv for CTR/CCM");
-    DPRINT_DATA(iv, AES_BLOCK_SIZE);
-#endif
+    AES128_CTR_start_keystream(ctr_blk, block_count);
+    sched_post_task_prio(&precompute_keystream, MIN_PRIORITY, NULL);
 }
 
 uint8_t d7anp_secure_payload(packet_t *packet, uint8_t *payload, uint8_t payload_len)
@@ -404,7 +453,7 @@ uint8_t d7anp_secure_payload(packet_t *packet, uint8_t *payload, uint8_t payload
 
 
     nls_method = packet->d7anp_ctrl.nls_method;
-    auth_len = get_auth_len(nls_method);
+    auth_len = packet_codec_nls_auth_length(nls_method);
 
     /* When unicast access, add the auxiliary authentication data composed of the destination address */
     if(auth_len && !ID_TYPE_IS_BROADCAST(packet->d7anp_addressee->ctrl.id_type))
@@ -417,7 +466,9 @@ uint8_t d7anp_secure_payload(packet_t *packet, uint8_t *payload, uint8_t payload
     {
     case AES_CTR:
         // Build the initial counter block
-        build_iv(packet, payload_len, ctr_blk);
+        packet_codec_build_nls_iv(packet, payload_len, ctr_blk);
+
+        memcpy(header, ctr_blk, AES_BLOCK_SIZE);
 
         // the encrypted payload replaces the plaintext
         AES128_CTR_encrypt(payload, payload, payload_len, ctr_blk);
@@ -444,7 +495,7 @@ uint8_t d7anp_secure_payload(packet_t *packet, uint8_t *payload, uint8_t payload
          * For CCM, the same IV is used for the header block and the counter block
          * Bits 0-3 are set with the flags in AES-CCM header whereas they are set
          * to the Block counter for the CTR block*/
-        build_iv(packet, payload_len, header);
+        packet_codec_build_nls_iv(packet, payload_len, header);
         memcpy(ctr_blk, header, AES_BLOCK_SIZE);
 
         /* Set Header flags */
@@ -455,6 +506,10 @@ uint8_t d7anp_secure_payload(packet_t *packet, uint8_t *payload, uint8_t payload
         break;
     }
 
+    // only after encrypting this frame, which may use the keystream computed for it
+    if (nls_method == AES_CTR || nls_method == AES_CCM_32 || nls_method == AES_CCM_64 || nls_method == AES_CCM_128)
+        start_keystream_precomputation(header, nls_method, payload_len);
+
     time_elapsed = timer_get_counter_value() - time_elapsed;
     DPRINT("Payload secured in %i Ti", time_elapsed);
     return auth_len;
@@ -476,7 +531,7 @@ bool d7anp_unsecure_payload(packet_t *packet, uint8_t index)
 
     //this said payload_len = packet->hw_radio_packet.length + 1 - index - CRC_SIZE; but I don't know why we would add 1 and it seems to only work without it.
     payload_len = packet->hw_radio_packet.length - index - CRC_SIZE; // exclude the headers CRC bytes // TODO exclude footers
-    auth_len = get_auth_len(nls_method); // the authentication length is given in bytes
+    auth_len = packet_codec_nls_auth_length(nls_method); // the authentication length is given in bytes
 
     /* remove the authentication tag from the payload length if relevant */
     payload_len -= auth_len;
@@ -504,7 +559,7 @@ bool d7anp_unsecure_payload(packet_t *packet, uint8_t index)
     {
     case AES_CTR:
         /* Build the initial counter block */
-        build_iv(packet, payload_len, ctr_blk);
+        packet_codec_build_nls_iv(packet, payload_len, ctr_blk);
 
         // the decrypted payload replaces the encrypted data
         AES128_CTR_encrypt(packet->hw_radio_packet.data + index,
@@ -537,7 +592,7 @@ bool d7anp_unsecure_payload(packet_t *packet, uint8_t index)
     case AES_CCM_64:
     case AES_CCM_32:
         /* For CCM, the same IV is used for the header block and the counter block */
-        build_iv(packet, payload_len, header);
+        packet_codec_build_nls_iv(packet, payload_len, header);
         memcpy(ctr_blk, header, AES_BLOCK_SIZE);
 
         /* Set Header flags */
@@ -556,51 +611,21 @@ bool d7anp_unsecure_payload(packet_t *packet, uint8_t index)
 }
 #endif
 
-uint8_t d7anp_assemble_packet_header(packet_t *packet, uint8_t *data_ptr)
+uint8_t d7anp_assemble_packet_header(packet_t *packet, uint8_t *data_ptr, uint8_t size)
 {
-    assert(!packet->d7anp_ctrl.hop_enabled); // TODO hopping not yet supported
-
-    uint8_t* d7anp_header_start = data_ptr;
-    (*data_ptr) = packet->d7anp_ctrl.raw; data_ptr++;
-
-    if (!packet->d7anp_ctrl.origin_void)
+    // a relayed frame keeps the origin of the received frame
+    if (!packet->d7anp_ctrl.origin_void && packet->type != RELAYED_FRAME)
     {
-        (*data_ptr) = packet->origin_access_class; data_ptr++;
-
         if (packet->d7anp_ctrl.origin_id_type == ID_TYPE_UID)
-        {
             memcpy(packet->origin_access_id, address_id, 8);
-            memcpy(data_ptr, address_id, 8);
-            data_ptr += 8;
-        }
         else if (packet->d7anp_ctrl.origin_id_type == ID_TYPE_VID)
-        {
             memcpy(packet->origin_access_id, address_id, 2);
-            memcpy(data_ptr, address_id, 2);
-            data_ptr += 2;
-        }
-        else if (packet->d7anp_ctrl.origin_id_type == ID_TYPE_NBID)
-        {
-            (*data_ptr) = packet->origin_access_id[0]; data_ptr++;
-            // who set the NBID?
-        }
-    }
-
-    // TODO hopping ctrl
-
-#if defined(MODULE_D7AP_NLS_ENABLED)
-    if (packet->d7anp_ctrl.nls_method == AES_CTR ||
-        packet->d7anp_ctrl.nls_method == AES_CCM_32 ||
-        packet->d7anp_ctrl.nls_method == AES_CCM_64 ||
-        packet->d7anp_ctrl.nls_method == AES_CCM_128)
-    {
-        (*data_ptr) = packet->d7anp_security.key_counter; data_ptr++;
-        write_be32(data_ptr, packet->d7anp_security.frame_counter);
-        data_ptr += sizeof(uint32_t);
+        // who set the NBID?
     }
-#endif
 
-    return data_ptr - d7anp_header_start;
+    uint8_t header_len = packet_codec_encode_d7anp_header(packet, data_ptr, size);
+    assert(header_len);
+    return header_len;
 }
 
 #if defined(MODULE_D7AP_NLS_ENABLED)
@@ -642,27 +667,102 @@ dae_nwl_trusted_node_t *add_trusted_node(uint8_t *address, uint32_t frame_counte
 }
 #endif
 
-bool d7anp_disassemble_packet_header(packet_t* packet, uint8_t *data_idx)
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+static bool is_own_address(d7ap_addressee_id_type_t id_type, const uint8_t* id)
+{
+    uint8_t own_id[8];
+    if (id_type == ID_TYPE_UID)
+        d7ap_fs_read_uid(own_id);
+    else if (id_type == ID_TYPE_VID)
+        d7ap_fs_read_vid(own_id);
+    else
+        return false;
+
+    return memcmp(own_id, id, d7ap_addressee_id_length(id_type)) == 0;
+}
+
+// the longest time an intermediate node holds a frame, which is the congestion period of the DLL for a relayed frame
+static timer_tick_t get_relay_period(uint16_t tx_duration)
 {
-    packet->d7anp_ctrl.raw = packet->hw_radio_packet.data[(*data_idx)]; (*data_idx)++;
+    return (SFc + 1) * tx_duration + t_g;
+}
 
-    if (!packet->d7anp_ctrl.origin_void)
+static bool process_hopping_frame(packet_t* packet, uint8_t header_idx)
+{
+    if (packet->d7anp_ctrl.origin_void || is_own_address(packet->d7anp_ctrl.origin_id_type, packet->origin_access_id))
     {
-        packet->origin_access_class = packet->hw_radio_packet.data[(*data_idx)]; (*data_idx)++;
+        DPRINT("Hopping frame without origin or transmitted by this node, skipping packet");
+        return false;
+    }
 
-        if (!ID_TYPE_IS_BROADCAST(packet->d7anp_ctrl.origin_id_type))
-        {
-            uint8_t origin_access_id_size = packet->d7anp_ctrl.origin_id_type == ID_TYPE_VID? 2 : 8;
-            memcpy(packet->origin_access_id, packet->hw_radio_packet.data + (*data_idx), origin_access_id_size); (*data_idx) += origin_access_id_size;
-        }
-        else if (packet->d7anp_ctrl.origin_id_type == ID_TYPE_NBID)
-        {
-            packet->origin_access_id[0] = packet->hw_radio_packet.data[(*data_idx)];
-            (*data_idx)++;
-        }
+    // the origin and everything following it are not modified by the intermediate nodes, so all copies of a frame
+    // have the same key. The copies can arrive as long as the frame can still be relayed.
+    uint8_t* hop_invariant_data = packet->hw_radio_packet.data + header_idx + 2;
+    uint8_t hop_invariant_len = packet->hw_radio_packet.length - 2 - (header_idx + 2);
+    uint16_t tx_duration = phy_calculate_tx_duration(packet->phy_config.rx.channel_id.channel_header.ch_class,
+                                                     packet->phy_config.rx.channel_id.channel_header.ch_coding,
+                                                     packet->hw_radio_packet.length + 1, false);
+    if (duplicate_filter_check(&relay_duplicate_filter, crc_calculate(hop_invariant_data, hop_invariant_len),
+                               timer_get_counter_value(), packet->d7anp_hop_ctrl.hop_limit * get_relay_period(tx_duration)))
+    {
+        DPRINT("Copy of a hopping frame received before, skipping packet");
+        return false;
     }
 
-    // TODO hopping
+    if (is_own_address(packet->d7anp_hop_ctrl.destination_id_type, packet->destination_access_id))
+    {
+        // the upper layers handle the frame as if it was addressed to this node in the DLL header
+        packet->dll_header.control_target_id_type = packet->d7anp_hop_ctrl.destination_id_type;
+        return true;
+    }
+
+    if (packet->d7anp_hop_ctrl.hop_count >= packet->d7anp_hop_ctrl.hop_limit)
+    {
+        DPRINT("Hop limit reached, skipping packet");
+        return false;
+    }
+
+    // frames are only relayed when this node is not engaged in a dialog itself
+    if (d7anp_state != D7ANP_STATE_IDLE)
+    {
+        DPRINT("Not relaying while in state %i, skipping packet", d7anp_state);
+        return false;
+    }
+
+    packet->type = RELAYED_FRAME;
+    return true;
+}
+#endif
+
+bool d7anp_disassemble_packet_header(packet_t* packet, uint8_t *data_idx)
+{
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+    uint8_t header_idx = *data_idx;
+#endif
+    uint8_t header_len = packet_codec_decode_d7anp_header(packet, packet->hw_radio_packet.data + (*data_idx),
+        packet->hw_radio_packet.length - 2 - (*data_idx));
+    if (!header_len)
+    {
+        DPRINT("D7ANP header exceeds frame length, skipping packet");
+        return false;
+    }
+
+    (*data_idx) += header_len;
+
+    if (packet->d7anp_ctrl.hop_enabled)
+    {
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+        if (!process_hopping_frame(packet, header_idx))
+            return false;
+
+        // the secured part of a relayed frame is forwarded as is
+        if (packet->type == RELAYED_FRAME)
+            return true;
+#else
+        DPRINT("Hopping not enabled, skipping packet");
+        return false;
+#endif
+    }
 
 #if defined(MODULE_D7AP_NLS_ENABLED)
     if (packet->d7anp_ctrl.nls_method)
@@ -677,11 +777,7 @@ bool d7anp_disassemble_packet_header(packet_t* packet, uint8_t *data_idx)
         if (nls_method == AES_CTR || nls_method == AES_CCM_32 ||
             nls_method == AES_CCM_64 || nls_method == AES_CCM_128)
         {
-            // extract the key counter and the frame counter
-            packet->d7anp_security.key_counter = packet->hw_radio_packet.data[(*data_idx)]; (*data_idx)++;
-            packet->d7anp_security.frame_counter = read_be32(packet->hw_radio_packet.data + (*data_idx));
-            (*data_idx) += sizeof(uint32_t);
-
+            // the key counter and the frame counter are extracted by the header decoder
             DPRINT("Received key counter <%d>, frame counter <%ld>", packet->d7anp_security.key_counter, packet->d7anp_security.frame_counter);
 
             if (node_security_state.filter_mode & ENABLE_SSR_FILTER)
@@ -734,17 +830,42 @@ bool d7anp_disassemble_packet_header(packet_t* packet, uint8_t *data_idx)
     }
 #endif
 
-    assert(!packet->d7anp_ctrl.hop_enabled); // TODO hopping not yet supported
-
     return true;
 }
 
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+static void relay_completed()
+{
+    packet_queue_free_packet(relayed_packet);
+    relayed_packet = NULL;
+
+    if (pending_tx_packet)
+    {
+        packet_t* packet = pending_tx_packet;
+        pending_tx_packet = NULL;
+        dll_tx_frame(packet);
+        return;
+    }
+
+    switch_state(d7anp_prev_state);
+    dll_notify_dialog_terminated(); // resume the scan automation
+}
+#endif
+
 void d7anp_signal_transmission_failure()
 {
     assert(d7anp_state == D7ANP_STATE_TRANSMIT);
 
     DPRINT("CSMA-CA insertion failed");
 
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+    if (relayed_packet)
+    {
+        relay_completed();
+        return;
+    }
+#endif
+
     // switch back to the previous state before the transmission
     switch_state(d7anp_prev_state);
 
@@ -755,16 +876,50 @@ void d7anp_signal_packet_transmitted(packet_t* packet)
 {
     assert(d7anp_state == D7ANP_STATE_TRANSMIT);
 
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+    if (packet == relayed_packet)
+    {
+        DPRINT("Relayed frame transmitted");
+        relay_completed();
+        return;
+    }
+#endif
+
     /* switch back to the same state as before the transmission */
     switch_state(d7anp_prev_state);
     d7atp_signal_packet_transmitted(packet);
 
 }
 
-void d7anp_process_received_packet(packet_t* packet)
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+void d7anp_relay_packet(packet_t* packet)
 {
-    // TODO handle case where we are intermediate node while hopping (ie start FG scan, after auth if needed, and return)
+    assert(d7anp_state == D7ANP_STATE_IDLE && packet->type == RELAYED_FRAME);
 
+    DPRINT("Relaying frame, hop %i of %i", packet->d7anp_hop_ctrl.hop_count + 1, packet->d7anp_hop_ctrl.hop_limit);
+    packet->d7anp_hop_ctrl.hop_count++;
+    // the congestion period of the DLL starts at the reception
+    packet->request_received_timestamp = packet->hw_radio_packet.rx_meta.timestamp;
+
+    relayed_packet = packet;
+    d7anp_prev_state = d7anp_state;
+    switch_state(D7ANP_STATE_TRANSMIT);
+    dll_tx_frame(packet);
+}
+
+timer_tick_t d7anp_get_relay_delay(packet_t* packet, timer_tick_t response_period)
+{
+    if (!packet->d7anp_ctrl.hop_enabled)
+        return 0;
+
+    // every intermediate node relays the request within its congestion period and the response within the response
+    // period of the request
+    return packet->d7anp_hop_ctrl.hop_limit * (get_relay_period(packet->tx_duration) + response_period);
+}
+#endif
+
+void d7anp_process_received_packet(packet_t* packet)
+{
     if (d7anp_state == D7ANP_STATE_FOREGROUND_SCAN)
     {
         DPRINT("Received packet while in D7ANP_STATE_FOREGROUND_SCAN");
@@ -71,20 +71,42 @@ typedef struct {
     };
 } d7anp_ctrl_t;
 
+/*! \brief The D7ANP hopping control, present when hop_enabled is set in the D7ANP CTRL header
+ *
+ * Frames which are hopping are addressed to the destination in the D7ANP header instead of to a target in the DLL
+ * header. Intermediate nodes relay the frame until it was relayed hop_limit times.
+ */
+typedef struct {
+    union {
+        uint8_t raw;
+        struct {
+            uint8_t hop_count : 3;
+            uint8_t hop_limit : 3;
+            d7ap_addressee_id_type_t destination_id_type : 2;
+        };
+    };
+} d7anp_hop_ctrl_t;
+
 
 
 void d7anp_init();
 void d7anp_stop();
 error_t d7anp_tx_foreground_frame(packet_t* packet, bool should_include_origin_template);
-uint8_t d7anp_assemble_packet_header(packet_t* packet, uint8_t* data_ptr);
+uint8_t d7anp_assemble_packet_header(packet_t* packet, uint8_t* data_ptr, uint8_t size);
 bool d7anp_disassemble_packet_header(packet_t* packet, uint8_t* packet_idx);
 void d7anp_signal_transmission_failure();
 void d7anp_signal_packet_transmitted(packet_t* packet);
 void d7anp_process_received_packet(packet_t* packet);
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+void d7anp_relay_packet(packet_t* packet);
+timer_tick_t d7anp_get_relay_delay(packet_t* packet, timer_tick_t response_period);
+#endif
 void d7anp_set_foreground_scan_timeout(timer_tick_t timeout);
 void d7anp_start_foreground_scan();
 void d7anp_stop_foreground_scan();
 uint8_t d7anp_secure_payload(packet_t* packet, uint8_t* payload, uint8_t payload_len);
+d7ap_addressee_id_type_t d7anp_get_origin_id_type();
+uint8_t d7anp_get_security_overhead(uint8_t nls_method);
 
 #endif /* D7ANP_H_ */
 
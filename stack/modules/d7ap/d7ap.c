@@ -22,6 +22,7 @@
 #include "d7ap_stack.h"
 
 #include "d7ap_fs.h"
+#include "packet.h"
 #include "phy.h"
 #include "hwradio.h"
 #include "errors.h"
@@ -44,8 +45,6 @@
 #define DPRINT_DATA(ptr, len)
 #endif
 
-#define D7A_SECURITY_HEADER_SIZE 5
-
 d7ap_resource_desc_t registered_client[MODULE_D7AP_MAX_CLIENT_COUNT];
 uint8_t registered_client_nb = 0;
 bool inited = false;
@@ -122,31 +121,25 @@ d7ap_addressee_id_type_t d7ap_get_dev_addr(uint8_t* addr)
  */
 uint8_t d7ap_get_payload_max_size(nls_method_t nls_method)
 {
-    uint8_t max_payload_size = D7A_PAYLOAD_MAX_SIZE;
+    // the security header is part of the header room reserved in front of the payload, only the authentication tag
+    // which follows the payload is left to subtract
+    uint8_t max_payload_size = PACKET_MAX_TX_PAYLOAD_SIZE;
 
     switch (nls_method)
     {
-        case(AES_CTR):
-            max_payload_size -= D7A_SECURITY_HEADER_SIZE;
-            break;
         case(AES_CBC_MAC_128):
+        case(AES_CCM_128):
             max_payload_size -= 16;
             break;
         case(AES_CBC_MAC_64):
+        case(AES_CCM_64):
             max_payload_size -= 8;
             break;
         case(AES_CBC_MAC_32):
-            max_payload_size -= 4;
-            break;
-        case(AES_CCM_128):
-            max_payload_size -= 16 + D7A_SECURITY_HEADER_SIZE;
-            break;
-        case(AES_CCM_64):
-            max_payload_size -= 8 + D7A_SECURITY_HEADER_SIZE;
-            break;
         case(AES_CCM_32):
-            max_payload_size -= 4 + D7A_SECURITY_HEADER_SIZE;
+            max_payload_size -= 4;
             break;
+        case(AES_CTR):
         case AES_NONE:
         default:
             break;
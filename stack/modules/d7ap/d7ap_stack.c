@@ -95,8 +95,7 @@ static void switch_state(state_t new_state)
                     DPRINT("[D7AP] Switching to state D7AP_STATE_TRANSMITTING");
                     break;
                 case D7AP_STACK_STATE_TRANSMITTING:
-                    // new requests in fifo, reschedule for later flushing
-                    // TODO sched_post_task(&flush_fifos);
+                    // new requests are appended to the FIFO of the active session, which flushes them in the same dialog
                     break;
                 default:
                     assert(false);
@@ -244,6 +243,10 @@ error_t d7ap_stack_send(uint8_t client_id, d7ap_session_config_t* config, uint8_
         return (d7asp_send_response(payload, len));
     }
 
+    // A request is sent in a single frame, together with the headers
+    if (len > d7ap_get_payload_max_size(config->addressee.ctrl.nls_method))
+        return -ESIZE;
+
     // Create or return the master session if the current one is compatible with the given session configuration.
     uint8_t session_token = d7asp_master_session_create(config);
 
@@ -270,6 +273,16 @@ error_t d7ap_stack_send(uint8_t client_id, d7ap_session_config_t* config, uint8_
     uint8_t request_id = d7asp_queue_request(session->token,
                                              payload, len,
                                              expected_response_length);
+    if (request_id == NO_ACTIVE_REQUEST_ID)
+    {
+        if (session->request_nb == 0)
+            free_session(session);
+
+        return -ESIZE;
+    }
+
+    if (session->active)
+        DPRINT("[D7AP] request appended to the active session %d", session->token);
 
     session->trans_id[session->request_nb] = ((uint16_t)session->token << 8) | (request_id & 0x00FF);
 
@@ -78,6 +78,10 @@ static d7asp_master_session_t NGDEF(_current_master_session); // TODO we only us
 static uint8_t NGDEF(_current_request_id); // TODO move ?
 #define current_request_id NG(_current_request_id)
 
+// the last request sent in the current transaction, this differs from current_request_id when requests are packed
+static uint8_t NGDEF(_current_request_last_id);
+#define current_request_last_id NG(_current_request_last_id)
+
 static uint8_t NGDEF(_current_request_retry_count);
 #define current_request_retry_count NG(_current_request_retry_count)
 
@@ -90,6 +94,14 @@ static uint8_t NGDEF(_single_request_retry_limit);
 static packet_t* NGDEF(_current_response_packet);
 #define current_response_packet NG(_current_response_packet)
 
+// the number of attempts of a group request, the request is done earlier when an attempt is not answered by new responders
+#define GROUP_REQUEST_RETRY_LIMIT 4
+
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+static uint8_t NGDEF(_current_attempt_responses_count);
+#define current_attempt_responses_count NG(_current_attempt_responses_count)
+#endif
+
 static timer_event current_session_timer;
 static timer_event dormant_session_timer;
 
@@ -119,13 +131,159 @@ static void switch_state(state_t new_state);
 
 static void mark_current_request_done()
 {
-    bitmap_set(current_master_session.progress_bitmap, current_request_id);
+    for (uint8_t request_id = current_request_id; request_id <= current_request_last_id; request_id++)
+        bitmap_set(current_master_session.progress_bitmap, request_id);
     // current_request_packet will be free-ed in the packet_queue when the transaction is completed
 }
 
 static void mark_current_request_successful()
 {
-    bitmap_set(current_master_session.success_bitmap, current_request_id);
+    for (uint8_t request_id = current_request_id; request_id <= current_request_last_id; request_id++)
+        bitmap_set(current_master_session.success_bitmap, request_id);
+}
+
+/*
+ * A broadcast request in response mode ALL is retried to give the responders which collided or missed the request
+ * another chance. The retried request acknowledges the responders which were heard, so only the others respond.
+ */
+static bool is_group_request()
+{
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+    return current_master_session.config.qos.qos_resp_mode == SESSION_RESP_MODE_ALL
+        && ID_TYPE_IS_BROADCAST(current_master_session.config.addressee.ctrl.id_type);
+#else
+    return false;
+#endif
+}
+
+static bool is_current_request_last_in_fifo()
+{
+    return current_request_last_id == current_master_session.next_request_id - 1;
+}
+
+static uint8_t get_current_expected_response_length()
+{
+    uint8_t expected_response_length = 0;
+    for (uint8_t request_id = current_request_id; request_id <= current_request_last_id; request_id++)
+        expected_response_length += current_master_session.response_lengths[request_id];
+
+    return expected_response_length;
+}
+
+// returns the request the response data belongs to, when requests are packed at most one of them expects response data
+static uint8_t get_current_responding_request_id()
+{
+    for (uint8_t request_id = current_request_id; request_id <= current_request_last_id; request_id++)
+    {
+        if (current_master_session.response_lengths[request_id] > 0)
+            return request_id;
+    }
+
+    return current_request_id;
+}
+
+#ifdef MODULE_D7AP_SP_PACKING_ENABLED
+/*
+ * Returns the last request which can be packed in one frame with the given first request, as long as they fit in one
+ * frame. The response of a transaction can only be split per request when at most one of the packed requests expects
+ * response data, the other requests are only acknowledged.
+ */
+static uint8_t get_last_packed_request_id(uint8_t request_id, uint8_t* payload_length)
+{
+    uint8_t max_payload_size = d7ap_get_payload_max_size(current_master_session.config.addressee.ctrl.nls_method);
+    uint8_t expected_response_length = current_master_session.response_lengths[request_id];
+    *payload_length = current_master_session.requests_lengths[request_id];
+
+    while (request_id + 1 < current_master_session.next_request_id)
+    {
+        uint8_t next_request_id = request_id + 1;
+        uint8_t request_length = current_master_session.requests_lengths[next_request_id];
+        if (bitmap_get(current_master_session.progress_bitmap, next_request_id)
+            || *payload_length + request_length > max_payload_size
+            || (expected_response_length && current_master_session.response_lengths[next_request_id]))
+            break;
+
+        *payload_length += request_length;
+        expected_response_length += current_master_session.response_lengths[next_request_id];
+        request_id = next_request_id;
+    }
+
+    return request_id;
+}
+
+// appends the requests following the current request to its payload, as long as they fit in one frame
+static void pack_requests(packet_t* packet)
+{
+    uint8_t payload_length;
+    uint8_t last_request_id = get_last_packed_request_id(current_request_id, &payload_length);
+    for (uint8_t request_id = current_request_id + 1; request_id <= last_request_id; request_id++)
+    {
+        uint8_t request_length = current_master_session.requests_lengths[request_id];
+        memcpy(packet_get_payload(packet) + packet->payload_length,
+               current_master_session.request_buffer + current_master_session.requests_indices[request_id], request_length);
+        packet->payload_length += request_length;
+    }
+
+    current_request_last_id = last_request_id;
+    if (current_request_last_id != current_request_id)
+        DPRINT("Packed requests %i to %i in one frame (%i bytes)", current_request_id, current_request_last_id, packet->payload_length);
+}
+
+// compares the airtime of the assembled frame with the airtime of sending each packed request in its own frame
+static void log_packing_gain(packet_t* packet)
+{
+    uint8_t request_count = current_request_last_id - current_request_id + 1;
+    if (request_count == 1)
+        return;
+
+    phy_channel_header_t channel_header = packet->phy_config.tx.channel_id.channel_header;
+    uint8_t overhead = packet->hw_radio_packet.length - packet->payload_length;
+    uint32_t unpacked_duration = 0;
+    for (uint8_t request_id = current_request_id; request_id <= current_request_last_id; request_id++)
+        unpacked_duration += phy_calculate_tx_duration(channel_header.ch_class, channel_header.ch_coding,
+                                                       overhead + current_master_session.requests_lengths[request_id], false);
+
+    uint16_t packed_duration = phy_calculate_tx_duration(channel_header.ch_class, channel_header.ch_coding,
+                                                         packet->hw_radio_packet.length, false);
+    DPRINT("Packing %i requests saves %i ticks of request airtime per request, and %i response periods",
+           request_count, (unpacked_duration - packed_duration) / request_count, request_count - 1);
+}
+#endif
+
+/*
+ * Returns the payload length of the request which follows the current transaction in this dialog, or 0 when there is
+ * none. The responders listen for it after their response (Tl). A group request is followed by its next attempt as
+ * long as the retry limit is not reached, so the responders which collided receive it directly. The retry of a single
+ * request is not taken into account, it is only sent when the responder was not heard and thus uses ad-hoc
+ * synchronization like the initial request.
+ */
+static uint8_t get_next_request_length()
+{
+    if (is_group_request() && current_request_retry_count + 1 < GROUP_REQUEST_RETRY_LIMIT)
+        return current_request_packet->payload_length;
+
+    if (is_current_request_last_in_fifo())
+        return 0;
+
+#ifdef MODULE_D7AP_SP_PACKING_ENABLED
+    uint8_t payload_length;
+    get_last_packed_request_id(current_request_last_id + 1, &payload_length);
+    return payload_length;
+#else
+    return current_master_session.requests_lengths[current_request_last_id + 1];
+#endif
+}
+
+// the payload of a previous attempt is secured in place, so the request is copied from the FIFO for every attempt
+static void load_current_request(packet_t* packet)
+{
+    packet_reset_payload(packet);
+    memcpy(packet_get_payload(packet), current_master_session.request_buffer + current_master_session.requests_indices[current_request_id], current_master_session.requests_lengths[current_request_id]);
+    packet->payload_length = current_master_session.requests_lengths[current_request_id];
+    current_request_last_id = current_request_id;
+#ifdef MODULE_D7AP_SP_PACKING_ENABLED
+    pack_requests(packet);
+#endif
 }
 
 static void init_master_session(d7asp_master_session_t* session) {
@@ -233,8 +391,7 @@ static void flush_fifos()
             current_request_packet->d7anp_addressee = &current_master_session.preferred_addressee;
         }
 
-        memcpy(current_request_packet->payload, current_master_session.request_buffer + current_master_session.requests_indices[current_request_id], current_master_session.requests_lengths[current_request_id]);
-        current_request_packet->payload_length = current_master_session.requests_lengths[current_request_id];
+        load_current_request(current_request_packet);
 
         if(is_triggered_dormant_session)
         {
@@ -248,18 +405,17 @@ static void flush_fifos()
                 current_request_packet->type =  SUBSEQUENT_REQUEST;
         }
 
-        // TODO calculate Tl
-        // Tl should correspond to the maximum time needed to send the remaining requests in the FIFO including the RETRY parameter
     }
     else
     {
         // retrying request ...
         DPRINT("Current request retry count: %i", current_request_retry_count);
-        if (current_request_retry_count == single_request_retry_limit)
+        uint8_t retry_limit = is_group_request() ? GROUP_REQUEST_RETRY_LIMIT : single_request_retry_limit;
+        if (current_request_retry_count == retry_limit)
         {
             // mark request as failed and pop
             mark_current_request_done();
-            DPRINT("Request reached single request retry limit (%i), skipping request", single_request_retry_limit);
+            DPRINT("Request reached single request retry limit (%i), skipping request", retry_limit);
             packet_queue_free_packet(current_request_packet);
             current_request_id = NO_ACTIVE_REQUEST_ID;
             schedule_current_session(); //reschedule the d7ap stack to continue flushing the session until all request handled ...
@@ -267,19 +423,27 @@ static void flush_fifos()
         }
 
         packet_queue_mark_processing(current_request_packet);
+        load_current_request(current_request_packet);
         current_request_packet->type = RETRY_REQUEST;
         // TODO stop on error
     }
 
-    uint8_t listen_timeout = 0; // TODO calculate timeout (and update during transaction lifetime) (based on Tc, channel, cs, payload size, # msgs, # retries)
-    ret = d7atp_send_request(current_master_session.token, current_request_id, (current_request_id == current_master_session.next_request_id - 1),
-                       current_request_packet, &current_master_session.config.qos, listen_timeout, current_master_session.response_lengths[current_request_id]);
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+    current_attempt_responses_count = 0;
+#endif
+    ret = d7atp_send_request(current_master_session.token, current_request_id, is_current_request_last_in_fifo(),
+                       current_request_packet, &current_master_session.config.qos, get_next_request_length(),
+                       get_current_expected_response_length());
     if (ret == EPERM)
     {
         // this is probably because no further encryption is possible (frame counter reaches the maximum value)
         // TODO return an error code to the application?
         DPRINT("Request sending is not allowed likely because frame counter reaches its maximum value");
     }
+#ifdef MODULE_D7AP_SP_PACKING_ENABLED
+    else if (current_request_packet->type != RETRY_REQUEST)
+        log_packing_gain(current_request_packet);
+#endif
 }
 
 // TODO document state diagram
@@ -394,18 +558,33 @@ void d7asp_stop()
     timer_cancel_event(&dormant_session_timer);
 }
 
+// a request can be appended to a session with the same addressee and QoS, also while the session is being flushed
+static bool is_session_compatible(d7asp_master_session_t* session, d7ap_session_config_t* config)
+{
+    if (session->config.addressee.access_class != config->addressee.access_class
+        || session->config.addressee.ctrl.nls_method != config->addressee.ctrl.nls_method
+        || session->config.qos.raw != config->qos.raw)
+        return false;
+
+    // the addressee of a session in preferred mode is selected by the session itself
+    if (config->qos.qos_resp_mode == SESSION_RESP_MODE_PREFERRED)
+        return true;
+
+    return session->config.addressee.ctrl.id_type == config->addressee.ctrl.id_type
+        && memcmp(session->config.addressee.id, config->addressee.id, d7ap_addressee_id_length(config->addressee.ctrl.id_type)) == 0;
+}
+
 uint8_t d7asp_master_session_create(d7ap_session_config_t* d7asp_master_session_config) {
     // TODO for now we assume only one concurrent session, in the future we should dynamically allocate (or return from pool) a session
 
     if (current_master_session.state != D7ASP_MASTER_SESSION_IDLE)
     {
         // Requests can be pushed in the FIFO by upper layer anytime
-        if ((current_master_session.config.addressee.access_class == d7asp_master_session_config->addressee.access_class) &&
-                (current_master_session.config.addressee.ctrl.nls_method == d7asp_master_session_config->addressee.ctrl.nls_method) &&
-                ((d7asp_master_session_config->qos.qos_resp_mode == SESSION_RESP_MODE_PREFERRED && current_master_session.config.qos.qos_resp_mode == SESSION_RESP_MODE_PREFERRED) ||
-                (current_master_session.config.addressee.ctrl.id_type == d7asp_master_session_config->addressee.ctrl.id_type && 
-                memcmp(current_master_session.config.addressee.id, d7asp_master_session_config->addressee.id, d7ap_addressee_id_length(d7asp_master_session_config->addressee.ctrl.id_type)) == 0)))
+        if (is_session_compatible(&current_master_session, d7asp_master_session_config))
+        {
+            DPRINT("Appending to master session %d in state %d", current_master_session.token, current_master_session.state);
             return current_master_session.token;
+        }
         else
             return 0;
         // TODO create a pending session or a dormant session if TO (DORM_TIMER) !=0
@@ -463,8 +642,16 @@ error_t d7asp_send_response(uint8_t* payload, uint8_t length)
         return EINVAL;
     }
 
+    if (length > d7ap_get_payload_max_size(current_response_packet->d7anp_ctrl.nls_method))
+    {
+        DPRINT("Response too large for one frame, discard it");
+        return -ESIZE;
+    }
+
+    // the packet of the request is reused, the response is written in the reserved room in front of the request payload
+    packet_reset_payload(current_response_packet);
     current_response_packet->payload_length = length;
-    memcpy(current_response_packet->payload, payload, length);
+    memcpy(packet_get_payload(current_response_packet), payload, length);
 
     // check if there is a pending session
     if (current_master_session.state == D7ASP_MASTER_SESSION_ACTIVE)
@@ -496,14 +683,23 @@ uint8_t d7asp_queue_request(uint8_t session_token, uint8_t* alp_payload_buffer,
 
     // TODO can be called in all session states?
     assert(session != NULL);
-    assert(session->request_buffer_tail_idx + alp_payload_length < MODULE_D7AP_FIFO_COMMAND_BUFFER_SIZE);
-    assert(session->next_request_id < MODULE_D7AP_FIFO_MAX_REQUESTS_COUNT); // TODO do not assert but let upper layer handle this
+    if (session->request_buffer_tail_idx + alp_payload_length >= MODULE_D7AP_FIFO_COMMAND_BUFFER_SIZE
+        || session->next_request_id >= MODULE_D7AP_FIFO_MAX_REQUESTS_COUNT)
+    {
+        DPRINT("Session FIFO full, request not queued");
+        return NO_ACTIVE_REQUEST_ID;
+    }
+
     assert(!(expected_alp_response_length > 0 &&
              (session->config.qos.qos_resp_mode == SESSION_RESP_MODE_NO || session->config.qos.qos_resp_mode == SESSION_RESP_MODE_NO_RPT))); // TODO return error
     single_request_retry_limit = 1; // TODO read from SEL config file
 
     // add request to buffer
     // TODO request can contain 1 or more ALP commands, find a way to group commands in requests instead of dumping all requests in one buffer
+    // When the session is being flushed, the request is appended to the dialog: flush_fifos() only completes the session
+    // when no request is left after the current one, so the new request is sent as a subsequent request. It skips
+    // CSMA-CA only when it is sent within the guard period Tg after the last frame, which is the case right after the
+    // response to a unicast request. After the response period of a broadcast request the guard has expired.
     uint8_t request_id = session->next_request_id;
     session->requests_indices[request_id] = session->request_buffer_tail_idx;
     session->requests_lengths[request_id] = alp_payload_length;
@@ -578,9 +774,13 @@ void d7asp_process_received_response(packet_t* packet, bool extension)
         }
 
         result.fifo_token = current_master_session.token;
-        result.seqnr = current_request_id;
         mark_current_request_successful();
-        mark_current_request_done();
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+        current_attempt_responses_count++;
+#endif
+        // a group request is done when an attempt is not answered by any new responder, see on_request_completed()
+        if (!is_group_request())
+            mark_current_request_done();
         if(current_master_session.config.qos.qos_resp_mode == SESSION_RESP_MODE_PREFERRED
            && ID_TYPE_IS_BROADCAST(current_master_session.config.addressee.ctrl.id_type))
         {
@@ -595,7 +795,13 @@ void d7asp_process_received_response(packet_t* packet, bool extension)
         assert(packet != current_request_packet);
     }
 
-    d7ap_stack_process_received_response(packet->payload, packet->payload_length, result);
+    // every packed request is acknowledged, only the one expecting response data receives it
+    uint8_t responding_request_id = get_current_responding_request_id();
+    for (uint8_t request_id = current_request_id; request_id <= current_request_last_id; request_id++)
+    {
+        result.seqnr = request_id;
+        d7ap_stack_process_received_response(packet_get_payload(packet), request_id == responding_request_id ? packet->payload_length : 0, result);
+    }
 
     packet_queue_free_packet(packet); // ACK can be cleaned
 
@@ -608,7 +814,7 @@ void d7asp_process_received_response(packet_t* packet, bool extension)
         // terminate the dialog if all request handled
         // we need to switch to the state idle otherwise we may receive a new packet before the task flush_fifos is handled
         // in this case, we may assert since the state remains MASTER
-        if (current_request_id == current_master_session.next_request_id - 1)
+        if (is_current_request_last_in_fifo())
         {
             flush_completed();
             return;
@@ -619,7 +825,7 @@ void d7asp_process_received_response(packet_t* packet, bool extension)
         // d7atp_stop_transaction(); //TO BE CHECKED THAT COMMENTING THIS OUT HAS NO NEGATIVE EFFECT
     }
     // switch to the state slave when the D7ATP Dialog Extension Procedure is initiated and all request are handled
-    else if ((extension) && (current_request_id == current_master_session.next_request_id - 1))
+    else if ((extension) && (is_current_request_last_in_fifo()))
     {
         DPRINT("Dialog Extension Procedure is initiated, mark the FIFO flush "
                "completed before switching to a responder state");
@@ -668,7 +874,7 @@ bool d7asp_process_received_packet(packet_t* packet)
             .seqnr = packet->d7atp_transaction_id
         };
 
-        expect_upper_layer_resp_payload = d7ap_stack_process_unsolicited_request(packet->payload, packet->payload_length, result);
+        expect_upper_layer_resp_payload = d7ap_stack_process_unsolicited_request(packet_get_payload(packet), packet->payload_length, result);
     }
 
     if (current_master_session.state == D7ASP_MASTER_SESSION_DORMANT &&
@@ -708,7 +914,10 @@ bool d7asp_process_received_packet(packet_t* packet)
         packet->d7atp_tl = compress_data(estimated_tl, true);
     }
     else
+    {
         packet->d7atp_ctrl.ctrl_is_start = 0;
+        packet->d7atp_ctrl.ctrl_tl = false; // the listen timeout of the request is not echoed in the response
+    }
 
     // execute slave transaction
     if (packet->d7atp_ctrl.ctrl_is_ack_requested)
@@ -745,6 +954,16 @@ static void on_request_completed()
       DPRINT_DATA(current_master_session.preferred_addressee.id, 8);
     }
 
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+    // the responders which were heard are not answering again, so no response means all responders were heard
+    if (is_group_request() && bitmap_get(current_master_session.success_bitmap, current_request_id)
+        && current_attempt_responses_count == 0)
+    {
+        DPRINT("No new responders, group request completed");
+        mark_current_request_done();
+    }
+#endif
+
     if (!bitmap_get(current_master_session.progress_bitmap, current_request_id))
     {
         if(current_master_session.config.qos.qos_resp_mode == SESSION_RESP_MODE_PREFERRED
@@ -765,7 +984,7 @@ static void on_request_completed()
         // terminate the dialog if all request handled
         // we need to switch to the state idle otherwise we may receive a new packet before the task flush_fifos is handled
         // in this case, we may assert since the state remains MASTER
-        if (current_request_id == current_master_session.next_request_id - 1)
+        if (is_current_request_last_in_fifo())
         {
             flush_completed();
             return;
@@ -58,6 +58,15 @@ void d7asp_init();
 void d7asp_stop();
 uint8_t d7asp_master_session_create(d7ap_session_config_t* d7asp_master_session_config);
 
+/**
+ * @brief Queues a request in the FIFO of the session, which may be active already. In this case the request is sent in
+ * the same dialog, after the requests queued before.
+ *
+ * Request IDs are not reused within a session, so at most MODULE_D7AP_FIFO_MAX_REQUESTS_COUNT requests are queued in
+ * total, the completed ones included.
+ *
+ * @returns The request ID, or NO_ACTIVE_REQUEST_ID when the FIFO is full
+ */
 uint8_t d7asp_queue_request(uint8_t session_token, uint8_t* alp_payload_buffer, uint8_t alp_payload_length, uint8_t expected_alp_response_length);
 
 error_t d7asp_send_response(uint8_t* payload, uint8_t length);
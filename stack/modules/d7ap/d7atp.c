@@ -28,6 +28,7 @@
 #include "d7atp.h"
 #include "packet_queue.h"
 #include "packet.h"
+#include "packet_codec.h"
 #include "d7asp.h"
 #include "dll.h"
 #include "ng.h"
@@ -75,6 +76,40 @@ static timer_event d7atp_execution_delay_expired_timer;
 
 static bool ctrl_xoff;
 
+static timer_tick_t NGDEF(_dialog_start_time);
+#define dialog_start_time NG(_dialog_start_time)
+
+// statistics on the duration of the dialogs we initiate as a requester
+static uint32_t NGDEF(_dialog_count);
+#define dialog_count NG(_dialog_count)
+
+static uint32_t NGDEF(_dialog_duration_total);
+#define dialog_duration_total NG(_dialog_duration_total)
+
+#ifdef MODULE_D7AP_ADAPTIVE_NB_ENABLED
+#define RESPONDERS_ESTIMATE_UNKNOWN 0xFFFF
+
+// Moving average of the number of responders seen per broadcast request, per access specifier.
+// The average is kept in 1/4 units to not lose precision when only a few responders are present.
+static uint16_t NGDEF(_responders_estimate)[16];
+#define responders_estimate NG(_responders_estimate)
+
+static uint8_t NGDEF(_responders_count);
+#define responders_count NG(_responders_count)
+
+static bool NGDEF(_is_broadcast_transaction);
+#define is_broadcast_transaction NG(_is_broadcast_transaction)
+#endif
+
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+// the UIDs of the responders heard in the attempts of the current request, listed when the request is retried
+static uint8_t NGDEF(_recorded_responders)[D7ATP_ACK_RECORD_SIZE][ID_TYPE_UID_ID_LENGTH];
+#define recorded_responders NG(_recorded_responders)
+
+static uint8_t NGDEF(_recorded_responders_count);
+#define recorded_responders_count NG(_recorded_responders_count)
+#endif
+
 typedef enum {
     D7ATP_STATE_STOPPED,
     D7ATP_STATE_IDLE,
@@ -140,6 +175,154 @@ static void execution_delay_timeout_handler()
     d7anp_start_foreground_scan();
 }
 
+#ifdef MODULE_D7AP_ADAPTIVE_NB_ENABLED
+static void update_responders_estimate()
+{
+    if (!is_broadcast_transaction)
+        return;
+
+    is_broadcast_transaction = false;
+    uint8_t access_specifier = ACCESS_SPECIFIER(current_access_class);
+    uint16_t count = (uint16_t)responders_count << 2;
+    if (responders_estimate[access_specifier] == RESPONDERS_ESTIMATE_UNKNOWN)
+        responders_estimate[access_specifier] = count;
+    else
+        responders_estimate[access_specifier] = (3 * responders_estimate[access_specifier] + count) >> 2;
+
+    DPRINT("%i responders seen, estimate for AS %i is now %i/4", responders_count, access_specifier, responders_estimate[access_specifier]);
+}
+
+/*
+ * Returns the number of concurrent responders to take into account for the response period.
+ * The observed average is doubled to leave room for responders which collided or were added since,
+ * the number of responders supplied by the requester (NBID) or the default for NOID is used as upper bound.
+ */
+static uint8_t get_estimated_responders(uint8_t access_specifier, uint8_t nb)
+{
+    if (responders_estimate[access_specifier] == RESPONDERS_ESTIMATE_UNKNOWN)
+        return nb;
+
+    uint16_t estimated_nb = ((responders_estimate[access_specifier] + 3) >> 2) * 2;
+    if (estimated_nb == 0)
+        estimated_nb = 1;
+
+    return estimated_nb < nb ? estimated_nb : nb;
+}
+#endif
+
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+/*
+ * Adds the responder to the ACK record, returns false when it was recorded already. Responders with a VID origin and
+ * the responders which do not fit in the record are not recorded, these respond again when the request is retried.
+ */
+static bool add_to_ack_record(packet_t* packet)
+{
+    if (packet->d7anp_ctrl.origin_void || packet->d7anp_ctrl.origin_id_type != ID_TYPE_UID)
+        return true;
+
+    for (uint8_t i = 0; i < recorded_responders_count; i++)
+    {
+        if (memcmp(recorded_responders[i], packet->origin_access_id, ID_TYPE_UID_ID_LENGTH) == 0)
+            return false;
+    }
+
+    if (recorded_responders_count < D7ATP_ACK_RECORD_SIZE)
+        memcpy(recorded_responders[recorded_responders_count++], packet->origin_access_id, ID_TYPE_UID_ID_LENGTH);
+
+    return true;
+}
+
+// returns true when our UID is listed in the ACK record of the request, our response to this transaction arrived already
+static bool is_listed_in_ack_record(packet_t* packet)
+{
+    if (!packet->d7atp_ctrl.ctrl_is_ack_requested || !packet->d7atp_ctrl.ctrl_ack_not_void || !packet->d7atp_ctrl.ctrl_ack_record)
+        return false;
+
+    if (packet->d7atp_transaction_id < packet->d7atp_ack_template.ack_transaction_id_start
+        || packet->d7atp_transaction_id > packet->d7atp_ack_template.ack_transaction_id_stop)
+        return false;
+
+    uint8_t uid[ID_TYPE_UID_ID_LENGTH];
+    d7ap_fs_read_uid(uid);
+    for (uint8_t i = 0; i < packet->d7atp_ack_template.ack_record_count; i++)
+    {
+        if (memcmp(packet->d7atp_ack_template.ack_record[i], uid, ID_TYPE_UID_ID_LENGTH) == 0)
+            return true;
+    }
+
+    return false;
+}
+#endif
+
+/*
+ * The length of a response frame as it will be transmitted by the responder, excluding the preamble and syncword.
+ * The responder addresses the response to our origin address and will include its own origin template (assuming an UID),
+ * secured with the same method as the request.
+ */
+static uint16_t calculate_response_frame_length(d7ap_addressee_t* addressee, bool ack_not_void, uint8_t payload_length)
+{
+    uint16_t length = 1; // length field
+    length += 2 + d7ap_addressee_id_length(d7anp_get_origin_id_type()); // DLL subnet, control and target address
+    length += 1 + 1 + ID_TYPE_UID_ID_LENGTH; // D7ANP control and origin access class and address
+    length += d7anp_get_security_overhead(addressee->ctrl.nls_method);
+    length += 3; // D7ATP control, dialog ID and transaction ID
+    if (ack_not_void)
+        length += 2; // responder ACK template
+    length += payload_length;
+    length += 2; // CRC
+
+    return length;
+}
+
+/*
+ * The length of a request frame as it will be transmitted by the requester, excluding the preamble and syncword.
+ * A retried group request may carry the ACK record of the responders which were heard.
+ */
+static uint16_t calculate_request_frame_length(d7ap_addressee_t* addressee, d7ap_session_qos_t* qos_settings,
+                                               uint8_t payload_length)
+{
+    uint16_t length = 1; // length field
+    length += 2 + d7ap_addressee_id_length(addressee->ctrl.id_type); // DLL subnet, control and target address
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+    if (addressee->ctrl.hop_limit)
+        length += 1 + d7ap_addressee_id_length(addressee->ctrl.id_type); // D7ANP hopping control and destination address
+#endif
+    length += 1 + 1 + d7ap_addressee_id_length(d7anp_get_origin_id_type()); // D7ANP control and origin access class and address
+    length += d7anp_get_security_overhead(addressee->ctrl.nls_method);
+    length += 3 + 1 + 1; // D7ATP control, dialog ID, transaction ID, Tl and Tc
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+    if (qos_settings->qos_resp_mode == SESSION_RESP_MODE_ALL && ID_TYPE_IS_BROADCAST(addressee->ctrl.id_type))
+        length += 2 + D7ATP_ACK_RECORD_MAX_LENGTH; // requester ACK template and ACK record
+#endif
+    length += payload_length;
+    length += 2; // CRC
+
+    return length;
+}
+
+/*
+ * Sets the listen timeout of a request, see D7ATP_LISTEN_TIMEOUT(). Tl is omitted when no request follows.
+ */
+static void set_listen_timeout(packet_t* packet, d7ap_session_qos_t* qos_settings, uint8_t next_request_length)
+{
+    packet->d7atp_ctrl.ctrl_tl = false;
+    packet->d7atp_tl = 0;
+    if (!next_request_length)
+        return;
+
+    uint16_t request_length = calculate_request_frame_length(packet->d7anp_addressee, qos_settings, next_request_length);
+    uint16_t tx_duration_request = phy_calculate_tx_duration(active_addressee_access_profile.channel_header.ch_class,
+                                                             active_addressee_access_profile.channel_header.ch_coding,
+                                                             request_length, false);
+    timer_tick_t tc = packet->d7atp_ctrl.ctrl_is_ack_requested ? CT_DECOMPRESS(packet->d7atp_tc) : 0;
+    timer_tick_t te = packet->d7atp_ctrl.ctrl_te ? CT_DECOMPRESS(packet->d7atp_te) : 0;
+    timer_tick_t tl = D7ATP_LISTEN_TIMEOUT(tc, te, tx_duration_request);
+
+    packet->d7atp_ctrl.ctrl_tl = true;
+    packet->d7atp_tl = compress_data(tl, true);
+    DPRINT("Tl <%i (Ti)> Tl <0x%02x (CT)> for a next request of %i bytes", tl, packet->d7atp_tl, next_request_length);
+}
+
 static void terminate_dialog()
 {
     DPRINT("Dialog terminated");
@@ -220,6 +403,11 @@ void d7atp_signal_foreground_scan_expired()
     // Reset the transaction Id
     current_transaction_id = NO_ACTIVE_REQUEST_ID;
 
+#ifdef MODULE_D7AP_ADAPTIVE_NB_ENABLED
+    if (d7atp_state == D7ATP_STATE_MASTER_TRANSACTION_RESPONSE_PERIOD)
+        update_responders_estimate();
+#endif
+
     // In case of slave, we can consider that the dialog is terminated
     if (d7atp_state == D7ATP_STATE_SLAVE_TRANSACTION_RESPONSE_PERIOD
         || d7atp_state == D7ATP_STATE_SLAVE_TRANSACTION_RECEIVED_REQUEST
@@ -243,6 +431,15 @@ void d7atp_signal_dialog_termination()
 {
     DPRINT("Dialog is terminated by upper layer");
 
+    if (IS_IN_MASTER_TRANSACTION())
+    {
+        timer_tick_t dialog_duration = timer_get_counter_value() - dialog_start_time;
+        dialog_count++;
+        dialog_duration_total += dialog_duration;
+        DPRINT("Dialog took %i ticks, mean dialog duration %i ticks over %i dialogs",
+               dialog_duration, dialog_duration_total / dialog_count, dialog_count);
+    }
+
     // It means that we are not participating in a dialog and we can accept
     // segments marked with START flag set to 1.
     switch_state(D7ATP_STATE_IDLE);
@@ -271,6 +468,10 @@ void d7atp_stop_transaction()
     assert(d7atp_state == D7ATP_STATE_MASTER_TRANSACTION_RESPONSE_PERIOD);
     current_transaction_id = NO_ACTIVE_REQUEST_ID;
 
+#ifdef MODULE_D7AP_ADAPTIVE_NB_ENABLED
+    update_responders_estimate();
+#endif
+
     // stop the DLL foreground scan
     d7anp_stop_foreground_scan();
 }
@@ -284,6 +485,12 @@ void d7atp_init()
     current_dialog_id = 0;
     current_Tl_received = 0;
     stop_dialog_after_tx = false;
+    dialog_count = 0;
+    dialog_duration_total = 0;
+#ifdef MODULE_D7AP_ADAPTIVE_NB_ENABLED
+    memset(responders_estimate, 0xFF, sizeof(responders_estimate));
+    is_broadcast_transaction = false;
+#endif
     timer_init_event(&d7atp_response_period_expired_timer, &response_period_timeout_handler);
     timer_init_event(&d7atp_execution_delay_expired_timer, &execution_delay_timeout_handler);
 
@@ -305,17 +512,18 @@ void d7atp_stop()
 }
 
 error_t d7atp_send_request(uint8_t dialog_id, uint8_t transaction_id, bool is_last_transaction,
-                        packet_t* packet, d7ap_session_qos_t* qos_settings, uint8_t listen_timeout, uint8_t expected_response_length)
+                        packet_t* packet, d7ap_session_qos_t* qos_settings, uint8_t next_request_length, uint8_t expected_response_length)
 {
     // unused parameters
     (void)is_last_transaction;
-    (void)listen_timeout;
 
     /* check that we are not initiating a different dialog if a dialog is still ongoing */
     if (current_dialog_id)
     {
         assert( dialog_id == current_dialog_id);
     }
+    else if (packet->type != RETRY_REQUEST)
+        dialog_start_time = timer_get_counter_value();
 
     if (d7atp_state != D7ATP_STATE_MASTER_TRANSACTION_REQUEST_PERIOD)
         switch_state(D7ATP_STATE_MASTER_TRANSACTION_REQUEST_PERIOD);
@@ -324,11 +532,25 @@ error_t d7atp_send_request(uint8_t dialog_id, uint8_t transaction_id, bool is_la
     {
         DPRINT("Retry the transmission with the same packet content");
         current_transaction_id = transaction_id;
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+        // acknowledge the responders heard in the previous attempts, these do not respond again
+        if (recorded_responders_count)
+        {
+            DPRINT("Acknowledging %i responders", recorded_responders_count);
+            packet->d7atp_ctrl.ctrl_ack_not_void = true;
+            packet->d7atp_ctrl.ctrl_ack_record = true;
+            packet->d7atp_ack_template.ack_record_count = recorded_responders_count;
+            memcpy(packet->d7atp_ack_template.ack_record, recorded_responders, recorded_responders_count * ID_TYPE_UID_ID_LENGTH);
+        }
+#endif
         goto send_packet;
     }
 
     current_dialog_id = dialog_id;
     current_transaction_id = transaction_id;
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+    recorded_responders_count = 0;
+#endif
     packet->d7atp_dialog_id = current_dialog_id;
     packet->d7atp_transaction_id = current_transaction_id;
 
@@ -346,9 +568,6 @@ error_t d7atp_send_request(uint8_t dialog_id, uint8_t transaction_id, bool is_la
         && expected_response_length == 0)
       ack_requested = false;
 
-    // TODO based on what do we calculate Tc? payload length alone is not enough, depends on for example use of FEC, encryption ..
-    // keep the same as transmission timeout for now
-
     // FG scan timeout is set (and scan started) in d7atp_signal_packet_transmitted() for now, to be verified
 
     packet->d7atp_ctrl = (d7atp_ctrl_t){
@@ -362,28 +581,38 @@ error_t d7atp_send_request(uint8_t dialog_id, uint8_t transaction_id, bool is_la
 
     if (ack_requested)
     {
-        // TODO payload length does not include headers ... + hardcoded subband
-        // TODO this length does not include lower layers overhead for now, use a minimum len of 50 for now ...
-        if (expected_response_length < 50)
-            expected_response_length = 50;
-
+        // the response is transmitted on the channel of the request, thus using the channel class and coding of the addressee access profile
+        uint16_t response_length = calculate_response_frame_length(packet->d7anp_addressee, packet->d7atp_ctrl.ctrl_ack_not_void,
+                                                                   expected_response_length);
         uint16_t tx_duration_response = phy_calculate_tx_duration(active_addressee_access_profile.channel_header.ch_class,
                                                                   active_addressee_access_profile.channel_header.ch_coding,
-                                                                  expected_response_length, false);
+                                                                  response_length, false);
         uint8_t nb = 1;
         if (packet->d7anp_addressee->ctrl.id_type == ID_TYPE_NOID)
             nb = 32;
         else if (packet->d7anp_addressee->ctrl.id_type == ID_TYPE_NBID)
-            nb = CT_DECOMPRESS(packet->d7anp_addressee->id[0]);
+        {
+            uint32_t nbid = CT_DECOMPRESS(packet->d7anp_addressee->id[0]);
+            nb = nbid > 0xFF ? 0xFF : (nbid ? nbid : 1);
+        }
+
+#ifdef MODULE_D7AP_ADAPTIVE_NB_ENABLED
+        is_broadcast_transaction = ID_TYPE_IS_BROADCAST(packet->d7anp_addressee->ctrl.id_type);
+        responders_count = 0;
+        if (is_broadcast_transaction)
+            nb = get_estimated_responders(packet->d7anp_addressee->access_specifier, nb);
+#endif
 
         // Tc(NB, LEN, CH) = ceil((SFC  * NB  + 1) * TTX(CH, LEN) + TG) with NB the number of concurrent devices and SF the collision Avoidance Spreading Factor
-        uint16_t resp_tc = (SFc * nb + 1) * tx_duration_response + t_g;
+        uint32_t resp_tc = (SFc * nb + 1) * (uint32_t)tx_duration_response + t_g;
         packet->d7atp_tc = compress_data(resp_tc, true);
 
-        DPRINT("Tc <%i (Ti)> Tc <0x%02x (CT)> Tx duration <%i>", resp_tc, packet->d7atp_tc, tx_duration_response);
+        DPRINT("Tc <%i (Ti)> Tc <0x%02x (CT)> Tx duration <%i> for %i bytes, NB %i", resp_tc, packet->d7atp_tc, tx_duration_response, response_length, nb);
     }
 
 send_packet:
+    // Tl is set again for every attempt, since the request which follows depends on the progress of the FIFO
+    set_listen_timeout(packet, qos_settings, next_request_length);
     return(d7anp_tx_foreground_frame(packet, true));
 }
 
@@ -431,87 +660,53 @@ error_t d7atp_send_response(packet_t* packet)
     return (d7anp_tx_foreground_frame(packet, should_include_origin_template));
 }
 
-uint8_t d7atp_assemble_packet_header(packet_t* packet, uint8_t* data_ptr)
+uint8_t d7atp_assemble_packet_header(packet_t* packet, uint8_t* data_ptr, uint8_t size)
 {
-    uint8_t* d7atp_header_start = data_ptr;
-    (*data_ptr) = packet->d7atp_ctrl.ctrl_raw; data_ptr++;
-    (*data_ptr) = packet->d7atp_dialog_id; data_ptr++;
-    (*data_ptr) = packet->d7atp_transaction_id; data_ptr++;
-    if (packet->d7atp_ctrl.ctrl_agc) {
-        (*data_ptr) = packet->d7atp_target_rx_level_i;
-        data_ptr++;
-    }
-
-    if (packet->d7atp_ctrl.ctrl_tl) {
-        (*data_ptr) = packet->d7atp_tl;
-        data_ptr++;
-    }
-
-    if (packet->d7atp_ctrl.ctrl_te) {
-        (*data_ptr) = packet->d7atp_te;
-        data_ptr++;
-    }
-
-    if (packet->d7atp_ctrl.ctrl_is_ack_requested && d7atp_state == D7ATP_STATE_MASTER_TRANSACTION_REQUEST_PERIOD) {
-        (*data_ptr) = packet->d7atp_tc;
-        data_ptr++;
-    }
-
-    //TODO check if at least one Responder has set the ACK_REQ flag
-    //TODO aggregate the Device IDs of the Responders that set their ACK_REQ flags.
-    // Provide the Responder or Requester ACK template when requested
-    if (packet->d7atp_ctrl.ctrl_is_ack_requested && packet->d7atp_ctrl.ctrl_ack_not_void)
-    {
-        // add Responder ACK template
-        (*data_ptr) = packet->d7atp_transaction_id; data_ptr++; // transaction ID start
-        (*data_ptr) = packet->d7atp_transaction_id; data_ptr++; // transaction ID stop
-        // TODO ACK bitmap, support for multiple segments to ack not implemented yet
-    }
-
-    return data_ptr - d7atp_header_start;
+    // Provide the Responder or Requester ACK template when requested, the ACK record of a retried request is filled in
+    // d7atp_send_request()
+    packet->d7atp_ack_template.ack_transaction_id_start = packet->d7atp_transaction_id;
+    packet->d7atp_ack_template.ack_transaction_id_stop = packet->d7atp_transaction_id;
+
+    uint8_t header_len = packet_codec_encode_d7atp_header(packet,
+        d7atp_state == D7ATP_STATE_MASTER_TRANSACTION_REQUEST_PERIOD, data_ptr, size);
+    assert(header_len);
+    return header_len;
 }
 
 bool d7atp_disassemble_packet_header(packet_t *packet, uint8_t *data_idx)
 {
-    packet->d7atp_ctrl.ctrl_raw = packet->hw_radio_packet.data[(*data_idx)]; (*data_idx)++;
-    packet->d7atp_dialog_id = packet->hw_radio_packet.data[(*data_idx)]; (*data_idx)++;
-    packet->d7atp_transaction_id = packet->hw_radio_packet.data[(*data_idx)]; (*data_idx)++;
-    if (packet->d7atp_ctrl.ctrl_agc) {
-        packet->d7atp_target_rx_level_i = packet->hw_radio_packet.data[(*data_idx)];
-        (*data_idx)++;
-    }
-
-    if (packet->d7atp_ctrl.ctrl_tl) {
-        packet->d7atp_tl = packet->hw_radio_packet.data[(*data_idx)];
-        (*data_idx)++;
-    }
-    else
-        packet->d7atp_tl = 0;
-
-    if (packet->d7atp_ctrl.ctrl_te) {
-        packet->d7atp_te = packet->hw_radio_packet.data[(*data_idx)];
-        (*data_idx)++;
-    }
-    else
-        packet->d7atp_te = 0;
-
-    if ((d7atp_state != D7ATP_STATE_MASTER_TRANSACTION_RESPONSE_PERIOD) && (packet->d7atp_ctrl.ctrl_is_ack_requested)) {
-      packet->d7atp_tc = packet->hw_radio_packet.data[(*data_idx)];
-      (*data_idx)++;
-    }
-
-    if (packet->d7atp_ctrl.ctrl_is_ack_requested && packet->d7atp_ctrl.ctrl_ack_not_void)
+    // Tl and Te are 0 when not present in the header
+    packet->d7atp_tl = 0;
+    packet->d7atp_te = 0;
+    uint8_t header_len = packet_codec_decode_d7atp_header(packet,
+        d7atp_state != D7ATP_STATE_MASTER_TRANSACTION_RESPONSE_PERIOD, packet->hw_radio_packet.data + (*data_idx),
+        packet->hw_radio_packet.length - 2 - (*data_idx));
+    if (!header_len)
     {
-        packet->d7atp_ack_template.ack_transaction_id_start = packet->hw_radio_packet.data[(*data_idx)]; (*data_idx)++;
-        packet->d7atp_ack_template.ack_transaction_id_stop = packet->hw_radio_packet.data[(*data_idx)]; (*data_idx)++;
-        // TODO ACK bitmap, support for multiple segments to ack not implemented yet
+        DPRINT("D7ATP header exceeds frame length, skipping packet");
+        return false;
     }
 
+    (*data_idx) += header_len;
     return true;
 }
 
 void d7atp_signal_packet_transmitted(packet_t* packet)
 {
+    // After a unicast response, the requester can send the next request as soon as it received the response, so the
+    // listen period starts now instead of at the end of the response period. The remaining response period is added to
+    // it, the listen timeout still ends at the same time. This is computed before the response packet is freed.
+    timer_tick_t listen_timeout = 0;
+    if (d7atp_state == D7ATP_STATE_SLAVE_TRANSACTION_SENDING_RESPONSE && packet->type == RESPONSE_TO_UNICAST
+        && packet->d7atp_ctrl.ctrl_is_ack_requested && current_Tl_received && !stop_dialog_after_tx)
+    {
+        timer_tick_t Tc = CT_DECOMPRESS(packet->d7atp_tc);
+        if (packet->d7atp_ctrl.ctrl_te)
+            Tc += CT_DECOMPRESS(packet->d7atp_te);
+
+        listen_timeout = adjust_timeout_value(Tc, packet->request_received_timestamp) + current_Tl_received;
+    }
+
     d7asp_signal_packet_transmitted(packet);
 
     if (d7atp_state == D7ATP_STATE_MASTER_TRANSACTION_REQUEST_PERIOD)
@@ -521,6 +716,9 @@ void d7atp_signal_packet_transmitted(packet_t* packet)
         if (packet->d7atp_ctrl.ctrl_is_ack_requested)
         {
             timer_tick_t Tc = CT_DECOMPRESS(packet->d7atp_tc);
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+            Tc += d7anp_get_relay_delay(packet, Tc);
+#endif
 
             // Check if an Execution Delay period needs to be observed
             if (packet->d7atp_ctrl.ctrl_te)
@@ -528,7 +726,7 @@ void d7atp_signal_packet_transmitted(packet_t* packet)
                 timer_tick_t Te = adjust_timeout_value(CT_DECOMPRESS(packet->d7atp_te), packet->hw_radio_packet.tx_meta.timestamp);
                 if (Te)
                 {
-                    d7anp_set_foreground_scan_timeout(Tc + 2); // we include Tt here for now
+                    d7anp_set_foreground_scan_timeout(Tc + t_t);
 
                     d7atp_execution_delay_expired_timer.next_event = Te;
                     timer_add_event(&d7atp_execution_delay_expired_timer);
@@ -541,7 +739,7 @@ void d7atp_signal_packet_transmitted(packet_t* packet)
             }
 
             Tc = adjust_timeout_value( Tc, packet->hw_radio_packet.tx_meta.timestamp);
-            d7anp_set_foreground_scan_timeout(Tc + 2); // we include Tt here for now
+            d7anp_set_foreground_scan_timeout(Tc + t_t);
             d7anp_start_foreground_scan();
         }
         else
@@ -560,6 +758,12 @@ void d7atp_signal_packet_transmitted(packet_t* packet)
             d7anp_stop_foreground_scan();
             terminate_dialog();
         }
+        else if (listen_timeout)
+        {
+            timer_cancel_event(&d7atp_response_period_expired_timer);
+            current_Tl_received = listen_timeout;
+            response_period_timeout_handler();
+        }
     }
     else if (d7atp_state == D7ATP_STATE_IDLE)
         assert(!packet->d7atp_ctrl.ctrl_is_ack_requested); // can only occur in this case
@@ -592,8 +796,11 @@ void d7atp_process_received_packet(packet_t* packet)
            || d7atp_state == D7ATP_STATE_SLAVE_TRANSACTION_RESPONSE_PERIOD
            || d7atp_state == D7ATP_STATE_IDLE); // IDLE: when doing channel scanning outside of transaction
 
-    // copy addressee from NP origin
+    // copy addressee from NP origin, the response to a hopping request hops back to the origin
     current_addressee.ctrl.id_type = packet->d7anp_ctrl.origin_id_type;
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+    current_addressee.ctrl.hop_limit = packet->d7anp_ctrl.hop_enabled ? packet->d7anp_hop_ctrl.hop_limit : 0;
+#endif
     current_addressee.access_class = packet->origin_access_class;
     DPRINT("ORI AC=0x%02x", packet->origin_access_class);
     memcpy(current_addressee.id, packet->origin_access_id, 8);
@@ -615,6 +822,20 @@ void d7atp_process_received_packet(packet_t* packet)
             return;
         }
 
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+        if (!add_to_ack_record(packet))
+        {
+            DPRINT("Responder was acknowledged already, skipping segment");
+            packet_queue_free_packet(packet);
+            return;
+        }
+#endif
+
+#ifdef MODULE_D7AP_ADAPTIVE_NB_ENABLED
+        if (is_broadcast_transaction && responders_count < 0xFF)
+            responders_count++;
+#endif
+
         // Check if a new dialog initiated by the responder is allowed
         if (packet->d7atp_ctrl.ctrl_is_start)
         {
@@ -663,6 +884,16 @@ void d7atp_process_received_packet(packet_t* packet)
             return;
         }
 
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+        // the request is retried for the responders which were not heard, we responded already
+        if (is_listed_in_ack_record(packet))
+        {
+            DPRINT("Filtered retried request which acknowledges our response");
+            packet_queue_free_packet(packet);
+            return;
+        }
+#endif
+
          // The FG scan is only started when the response period expires.
         if (packet->d7atp_ctrl.ctrl_is_ack_requested)
         {
@@ -742,7 +973,7 @@ void d7atp_process_received_packet(packet_t* packet)
                     schedule_response_period_timeout_handler(Tc);
 
                 // if ACK requested and no response payload expected, send the ack now
-                packet->payload_length = 0;
+                packet_reset_payload(packet);
                 d7atp_send_response(packet);
             }
         }
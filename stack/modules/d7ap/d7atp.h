@@ -36,6 +36,7 @@
 #include "stdbool.h"
 
 #include "d7ap.h"
+#include "MODULE_D7AP_defs.h"
 
 typedef struct packet packet_t;
 
@@ -75,18 +76,37 @@ typedef struct {
     };
 } d7a_segment_filter_options_t;
 
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+#define D7ATP_ACK_RECORD_SIZE MODULE_D7AP_ACK_RECORD_SIZE
+// the responders count followed by their UIDs
+#define D7ATP_ACK_RECORD_MAX_LENGTH (1 + D7ATP_ACK_RECORD_SIZE * ID_TYPE_UID_ID_LENGTH)
+#else
+#define D7ATP_ACK_RECORD_MAX_LENGTH 0
+#endif
+
+/*! The listen timeout of a request in Ti, the time the responders keep listening after receiving it. It covers the
+ * response period (Tc and Te), the turnaround time of the requester (Tt) and the time needed to transmit the next
+ * request of the dialog with CSMA-CA: Tc(1, next request) = (SFc + 1) * Ttx + Tg. */
+#define D7ATP_LISTEN_TIMEOUT(tc, te, next_request_tx_duration) \
+    ((tc) + (te) + t_t + (SFc + 1) * (timer_tick_t)(next_request_tx_duration) + t_g)
+
 typedef struct {
     uint8_t ack_transaction_id_start;
     uint8_t ack_transaction_id_stop;
     // TODO ACK bitmap
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+    // the responders to the acknowledged transactions which were heard, present in requests when ctrl_ack_record is set
+    uint8_t ack_record_count;
+    uint8_t ack_record[D7ATP_ACK_RECORD_SIZE][ID_TYPE_UID_ID_LENGTH];
+#endif
 } d7atp_ack_template_t;
 
 void d7atp_init();
 void d7atp_stop();
 error_t  d7atp_send_request(uint8_t dialog_id, uint8_t transaction_id, bool is_last_transaction,
-                        packet_t* packet, d7ap_session_qos_t* qos_settings, uint8_t listen_timeout, uint8_t expected_response_length);
+                        packet_t* packet, d7ap_session_qos_t* qos_settings, uint8_t next_request_length, uint8_t expected_response_length);
 error_t d7atp_send_response(packet_t* packet);
-uint8_t d7atp_assemble_packet_header(packet_t* packet, uint8_t* data_ptr);
+uint8_t d7atp_assemble_packet_header(packet_t* packet, uint8_t* data_ptr, uint8_t size);
 bool d7atp_disassemble_packet_header(packet_t* packet, uint8_t* data_idx);
 void d7atp_signal_packet_transmitted(packet_t* packet);
 void d7atp_signal_transmission_failure();
@@ -33,6 +33,8 @@
 #include "packet_queue.h"
 #include "packet.h"
 #include "dll.h"
+#include "packet_codec.h"
+#include "channel_queue.h"
 
 #include "hwdebug.h"
 #include "hwatomic.h"
@@ -109,6 +111,15 @@ static channel_id_t NGDEF(_current_channel_id);
 static csma_ca_mode_t NGDEF(_csma_ca_mode);
 #define csma_ca_mode NG(_csma_ca_mode)
 
+#ifdef MODULE_D7AP_CHANNEL_QUEUE_ENABLED
+static channel_queue_t NGDEF(_tx_channel_queue);
+#define tx_channel_queue NG(_tx_channel_queue)
+
+// true when the channel of the current packet is taken from the channel queue
+static bool NGDEF(_tx_channel_queue_used);
+#define tx_channel_queue_used NG(_tx_channel_queue_used)
+#endif
+
 static uint8_t NGDEF(_tx_nf_method);
 #define tx_nf_method NG(_tx_nf_method)
 
@@ -131,10 +142,12 @@ static bool reset_noisefl_last_measurements = false;
 static bool phy_status_file_inited = false;
 
 static void execute_cca(void *arg);
+static void start_cca2(void *arg);
 static void execute_csma_ca(void *arg);
 static void start_foreground_scan();
 static void save_noise_floor(uint8_t position);
 static uint8_t get_position_channel();
+static void set_tx_cca_threshold(uint8_t cca);
 
 /*!
  * D7A timer used to perform a CCA
@@ -436,6 +449,7 @@ static void discard_tx()
     if ((dll_state == DLL_STATE_CCA1) || (dll_state == DLL_STATE_CCA2))
     {
         timer_cancel_event(&dll_cca_timer);
+        timer_cancel_precise_task(TIMER_PRECISE_LANE_DLL);
     }
     else if ((dll_state == DLL_STATE_CCA_FAIL) || (dll_state == DLL_STATE_CSMA_CA_RETRY))
     {
@@ -458,6 +472,11 @@ static void cca_rssi_valid(int16_t cur_rssi)
     if (dll_state != DLL_STATE_CCA1 && dll_state != DLL_STATE_CCA2)
         return;
 
+#ifdef MODULE_D7AP_CHANNEL_QUEUE_ENABLED
+    if (tx_channel_queue_used)
+        channel_queue_report_rssi(&tx_channel_queue, cur_rssi);
+#endif
+
     if (cur_rssi <= E_CCA)
     {
         if((tx_nf_method == D7ADLL_MEDIAN_OF_THREE || rx_nf_method == D7ADLL_MEDIAN_OF_THREE))
@@ -473,10 +492,9 @@ static void cca_rssi_valid(int16_t cur_rssi)
             DPRINT("CCA1 RSSI: %d", cur_rssi);
             switch_state(DLL_STATE_CCA2);
 
-            // execute CCA2 directly after busy wait instead of scheduling this, to prevent another long running
-            // scheduled task to interfer with this timer (for instance d7asp_received_unsollicited_data_cb() )
-            hw_busy_wait(5000);
-            execute_cca(NULL);
+            // CCA2 is started from the timer interrupt by the precise lane of the DLL, so a long running scheduled task
+            // (for instance d7asp_received_unsollicited_data_cb() ) cannot delay it
+            timer_post_precise_task_delay_us(TIMER_PRECISE_LANE_DLL, &start_cca2, 5000, NULL);
             return;
         }
         else if (dll_state == DLL_STATE_CCA2)
@@ -494,7 +512,7 @@ static void cca_rssi_valid(int16_t cur_rssi)
             {
                 DPRINT("Start background advertising @ %i", timer_get_counter_value());
                 uint8_t dll_header_bg_frame[2];
-                dll_assemble_packet_header_bg(current_packet, dll_header_bg_frame);
+                dll_assemble_packet_header_bg(current_packet, dll_header_bg_frame, sizeof(dll_header_bg_frame));
 
                 err = phy_send_packet_with_advertising(&current_packet->hw_radio_packet,
                                                        &current_packet->phy_config.tx,
@@ -528,10 +546,20 @@ static void execute_cca(void *arg)
     phy_start_energy_scan(&current_channel_id, cca_rssi_valid, 160);
 }
 
+// called from the precise lane of the timer, the result of the energy scan is signalled from a task
+static void start_cca2(void *arg)
+{
+    (void)arg;
+    if (dll_state != DLL_STATE_CCA2)
+        return;
+
+    phy_start_energy_scan(&current_channel_id, cca_rssi_valid, 160);
+}
+
 static void execute_csma_ca(void *arg)
 {
     (void)arg;
-    // TODO select Channel at front of the channel queue
+    // the channel at the front of the channel queue is selected by dll_tx_frame()
 
     /*
      * During the period when the channel is guarded by the Requester, the transmission
@@ -559,7 +587,7 @@ static void execute_csma_ca(void *arg)
             if (current_packet->type == RESPONSE_TO_UNICAST || current_packet->type == RESPONSE_TO_BROADCAST)
                 dll_tc = CT_DECOMPRESS(current_packet->d7atp_tc);
             else
-                dll_tc = ceil((SFc + 1) * current_packet->tx_duration + t_g);
+                dll_tc = (SFc + 1) * current_packet->tx_duration + t_g;
 
             /*
              * Tca = Tc - Ttx - Tg
@@ -589,7 +617,8 @@ static void execute_csma_ca(void *arg)
 
             uint16_t t_offset = 0;
 
-            if (current_packet->type == RESPONSE_TO_BROADCAST)
+            // all intermediate nodes which received a hopping frame try to relay it at the same time
+            if (current_packet->type == RESPONSE_TO_BROADCAST || current_packet->type == RELAYED_FRAME)
                 csma_ca_mode = CSMA_CA_MODE_RAIND;
             else
                 csma_ca_mode = CSMA_CA_MODE_AIND;
@@ -663,7 +692,17 @@ static void execute_csma_ca(void *arg)
 
             DPRINT("RETRY with dll_to = %i", dll_to);
 
-            // TODO shift channel queue
+#ifdef MODULE_D7AP_CHANNEL_QUEUE_ENABLED
+            // the frame does not depend on the channel, so it is retried on the next channel as is
+            if (tx_channel_queue_used && channel_queue_shift(&tx_channel_queue))
+            {
+                const channel_queue_entry_t* channel = channel_queue_get_front(&tx_channel_queue);
+                current_channel_id = channel->channel_id;
+                current_packet->phy_config.tx.channel_id = channel->channel_id;
+                set_tx_cca_threshold(channel->cca);
+                DPRINT("Shifted channel queue to channel %i", current_channel_id.center_freq_index);
+            }
+#endif
 
             dll_tca = dll_to;
             dll_cca_started = timer_get_counter_value();
@@ -968,6 +1007,11 @@ void dll_init()
     process_received_packets_after_tx = false;
     resume_fg_scan = false;
 
+#ifdef MODULE_D7AP_CHANNEL_QUEUE_ENABLED
+    channel_queue_init(&tx_channel_queue);
+    tx_channel_queue_used = false;
+#endif
+
     d7ap_fs_register_file_modified_callback(D7A_FILE_DLL_CONF_FILE_ID, &conf_file_changed_callback);
 
 #ifdef MODULE_D7AP_EM_ENABLED
@@ -1004,10 +1048,35 @@ void dll_stop()
     phy_stop();
 }
 
+// compute Ecca = NF + Eccao for the channel of the current packet
+static void set_tx_cca_threshold(uint8_t cca)
+{
+    if (tx_nf_method == D7ADLL_FIXED_NOISE_FLOOR)
+    {
+        //Use the default channel CCA threshold
+        E_CCA = - cca; // Eccao is set to 0 dB
+        DPRINT("fixed floor: E_CCA %i", E_CCA);
+    }
+    else if(tx_nf_method == D7ADLL_MEDIAN_OF_THREE)
+    {
+        uint8_t position = get_position_channel();
+        median_measured_noisefloor(position);
+    }
+    else
+    {
+      // TODO support the Slow RSSI Variation computation method" and possibly add other methods
+      assert(false);
+    }
+}
+
 void dll_tx_frame(packet_t* packet)
 {
     timer_cancel_event(&dll_scan_automation_timer); //enable this code if this costly operation proves to be necessary
 
+#ifdef MODULE_D7AP_CHANNEL_QUEUE_ENABLED
+    tx_channel_queue_used = false;
+#endif
+
     if (dll_state == DLL_STATE_SCAN_AUTOMATION)
     {
         timer_cancel_event(&dll_background_scan_timer);
@@ -1022,13 +1091,19 @@ void dll_tx_frame(packet_t* packet)
         resume_fg_scan = true;
 
     dll_header_t* dll_header = &(packet->dll_header);
-    dll_header->subnet = packet->d7anp_addressee->access_class;
-    DPRINT("TX with subnet=0x%02x", dll_header->subnet);
 
-    packet->origin_access_class = active_access_class;  // strictly speaking this is a D7ANP field,
-                                                        // but we set it here to prevent rereading/caching in D7ANP
+    // a relayed frame keeps the subnet and the origin of the received frame
+    if (packet->type != RELAYED_FRAME)
+    {
+        dll_header->subnet = packet->d7anp_addressee->access_class;
+        packet->origin_access_class = active_access_class;  // strictly speaking this is a D7ANP field,
+                                                            // but we set it here to prevent rereading/caching in D7ANP
+    }
+
+    DPRINT("TX with subnet=0x%02x", dll_header->subnet);
 
-    if (packet->d7atp_ctrl.ctrl_is_start && packet->d7anp_addressee != NULL) // when responding in a transaction we MAY skip targetID
+    // the destination of a hopping frame is in the D7ANP header, so all nodes in range receive it
+    if (packet->d7atp_ctrl.ctrl_is_start && packet->d7anp_addressee != NULL && !packet->d7anp_ctrl.hop_enabled) // when responding in a transaction we MAY skip targetID
         dll_header->control_target_id_type = packet->d7anp_addressee->ctrl.id_type;
     else
         dll_header->control_target_id_type = ID_TYPE_NOID;
@@ -1057,28 +1132,54 @@ void dll_tx_frame(packet_t* packet)
                 .eirp = current_eirp
             };
     }
+    else if (packet->type == RELAYED_FRAME)
+    {
+        // relayed on the channel it was received on, with the EIRP of the scan access profile of this node
+        dll_header->control_eirp_index = current_access_profile.subbands[0].eirp + 32;
+
+        packet->phy_config.tx = (phy_tx_config_t){
+                .channel_id = packet->phy_config.rx.channel_id,
+                .syncword_class = packet->phy_config.rx.syncword_class,
+                .eirp = current_access_profile.subbands[0].eirp
+            };
+
+        current_channel_id = packet->phy_config.tx.channel_id;
+    }
     else
     {
         d7ap_fs_read_access_class(packet->d7anp_addressee->access_specifier, &remote_access_profile);
         /*
-         * For now the access mask and the subband bitmap are not used
-         * By default, subprofile[0] is selected and subband[0] is used
+         * Without the channel queue the access mask and the subband bitmap are not used
+         * and by default, subprofile[0] is selected and subband[0] is used
          */
+        channel_queue_entry_t channel = {
+            .channel_id.channel_header_raw = remote_access_profile.channel_header_raw,
+            .channel_id.center_freq_index = remote_access_profile.subbands[0].channel_index_start,
+            .eirp = remote_access_profile.subbands[0].eirp,
+            .cca = remote_access_profile.subbands[0].cca
+        };
 
-        // TODO generate random channel queue
         // TODO assert if no selectable subprofile can be found
+#ifdef MODULE_D7AP_CHANNEL_QUEUE_ENABLED
+        const channel_queue_entry_t* front = channel_queue_start(&tx_channel_queue, &remote_access_profile,
+                                                                 packet->d7anp_addressee->access_mask);
+        if (front)
+        {
+            channel = *front;
+            tx_channel_queue_used = true;
+        }
+#endif
 
         /* EIRP (dBm) = (EIRP_I – 32) dBm */
 
         DPRINT("AC specifier=%i channel=%i",
                          packet->d7anp_addressee->access_specifier,
-                         remote_access_profile.subbands[0].channel_index_start);
-        dll_header->control_eirp_index = remote_access_profile.subbands[0].eirp + 32;
+                         channel.channel_id.center_freq_index);
+        dll_header->control_eirp_index = channel.eirp + 32;
 
         packet->phy_config.tx = (phy_tx_config_t){
-            .channel_id.channel_header_raw = remote_access_profile.channel_header_raw,
-            .channel_id.center_freq_index = remote_access_profile.subbands[0].channel_index_start,
-            .eirp = remote_access_profile.subbands[0].eirp
+            .channel_id = channel.channel_id,
+            .eirp = channel.eirp
         };
 
         // The Access TSCHED is obtained as the maximum of all selected subprofiles' TSCHED.
@@ -1108,23 +1209,7 @@ void dll_tx_frame(packet_t* packet)
         current_eirp = packet->phy_config.tx.eirp;
         current_channel_id = packet->phy_config.tx.channel_id;
 
-        // compute Ecca = NF + Eccao
-        if (tx_nf_method == D7ADLL_FIXED_NOISE_FLOOR)
-        {
-            //Use the default channel CCA threshold
-            E_CCA = - remote_access_profile.subbands[0].cca; // Eccao is set to 0 dB
-            DPRINT("fixed floor: E_CCA %i", E_CCA);
-        }
-        else if(tx_nf_method == D7ADLL_MEDIAN_OF_THREE)
-        {
-            uint8_t position = get_position_channel();
-            median_measured_noisefloor(position);
-        }
-        else
-        {
-          // TODO support the Slow RSSI Variation computation method" and possibly add other methods
-          assert(false);
-        }
+        set_tx_cca_threshold(channel.cca);
     }
 
     packet_assemble(packet);
@@ -1213,10 +1298,8 @@ void dll_stop_foreground_scan()
     switch_state(DLL_STATE_IDLE);
 }
 
-uint8_t dll_assemble_packet_header_bg(packet_t* packet, uint8_t* data_ptr)
+uint8_t dll_assemble_packet_header_bg(packet_t* packet, uint8_t* data_ptr, uint8_t size)
 {
-    *data_ptr = packet->dll_header.subnet; data_ptr += sizeof(packet->dll_header.subnet);
-
     uint16_t crc;
     uint8_t addr_len = packet->dll_header.control_target_id_type == ID_TYPE_VID? 2 : 8;
     crc = crc_calculate(packet->d7anp_addressee->id, addr_len);
@@ -1225,39 +1308,32 @@ uint8_t dll_assemble_packet_header_bg(packet_t* packet, uint8_t* data_ptr)
     packet->dll_header.control_identifier_tag = (uint8_t)crc & 0x3F;
     DPRINT("dll_header.control_identifier_tag %x ", packet->dll_header.control_identifier_tag);
 
-    *data_ptr = (packet->dll_header.control_target_id_type << 6) | (packet->dll_header.control_identifier_tag & 0x3F);
-    DPRINT("dll_header.control %x ", *data_ptr);
-    data_ptr ++;
-
-    return 0;
+    uint8_t header_len = packet_codec_encode_dll_header(packet, true, data_ptr, size);
+    assert(header_len);
+    DPRINT("dll_header.control %x ", data_ptr[1]);
+    return header_len;
 }
 
-uint8_t dll_assemble_packet_header(packet_t* packet, uint8_t* data_ptr)
+uint8_t dll_assemble_packet_header(packet_t* packet, uint8_t* data_ptr, uint8_t size)
 {
-    uint8_t* dll_header_start = data_ptr;
-    *data_ptr = packet->dll_header.subnet; data_ptr += sizeof(packet->dll_header.subnet);
+    if (packet->dll_header.control_target_id_type == ID_TYPE_NBID)
+        packet->dll_header.control_target_id_type = ID_TYPE_NOID;
 
-    if (!ID_TYPE_IS_BROADCAST(packet->dll_header.control_target_id_type))
-    {
-        uint8_t addr_len = packet->dll_header.control_target_id_type == ID_TYPE_VID? 2 : 8;
-        *data_ptr = (packet->dll_header.control_target_id_type << 6) | (packet->dll_header.control_eirp_index & 0x3F);
-        data_ptr ++;
-        memcpy(data_ptr, packet->d7anp_addressee->id, addr_len); data_ptr += addr_len;
-    }
-    else
-    {
-        if (packet->dll_header.control_target_id_type == ID_TYPE_NBID)
-            packet->dll_header.control_target_id_type = ID_TYPE_NOID;
-        *data_ptr = (packet->dll_header.control_target_id_type << 6) | (packet->dll_header.control_eirp_index & 0x3F);
-        data_ptr ++;
-    }
-
-    return data_ptr - dll_header_start;
+    uint8_t header_len = packet_codec_encode_dll_header(packet, false, data_ptr, size);
+    assert(header_len);
+    return header_len;
 }
 
 bool dll_disassemble_packet_header(packet_t* packet, uint8_t* data_idx)
 {
-    packet->dll_header.subnet = packet->hw_radio_packet.data[(*data_idx)]; (*data_idx)++;
+    uint8_t header_len = packet_codec_decode_dll_header(packet, packet->type == BACKGROUND_ADV,
+        packet->hw_radio_packet.data + (*data_idx), packet->hw_radio_packet.length - 2 - (*data_idx));
+    if (!header_len)
+    {
+        DPRINT("DLL header exceeds frame length, skipping packet");
+        return false;
+    }
+
     uint8_t FSS = ACCESS_SPECIFIER(packet->dll_header.subnet);
     uint8_t FSM = ACCESS_MASK(packet->dll_header.subnet);
     uint8_t address_len;
@@ -1275,20 +1351,10 @@ bool dll_disassemble_packet_header(packet_t* packet, uint8_t* data_idx)
         return false;
     }
 
-    packet->dll_header.control_target_id_type  = packet->hw_radio_packet.data[(*data_idx)] >> 6 ;
-
     if (packet->type == BACKGROUND_ADV)
-    {
-        packet->dll_header.control_identifier_tag = packet->hw_radio_packet.data[(*data_idx)] & 0x3F;
         DPRINT("control_target_id_type 0x%02x Identifier Tag 0x%02x", packet->dll_header.control_target_id_type, packet->dll_header.control_identifier_tag);
-    }
     else
-    {
-        packet->dll_header.control_eirp_index = packet->hw_radio_packet.data[(*data_idx)] & 0x3F;
         DPRINT("control_target_id_type 0x%02x EIRP index %d", packet->dll_header.control_target_id_type, packet->dll_header.control_eirp_index);
-    }
-
-    (*data_idx)++;
 
     if (!ID_TYPE_IS_BROADCAST(packet->dll_header.control_target_id_type))
     {
@@ -1317,18 +1383,19 @@ bool dll_disassemble_packet_header(packet_t* packet, uint8_t* data_idx)
         }
         else
         {
-            if (memcmp(packet->hw_radio_packet.data + (*data_idx), id, address_len) != 0)
+            if (memcmp(packet->dll_header.target_address, id, address_len) != 0)
             {
                 DPRINT("Device ID filtering failed, skipping packet");
                 DPRINT("OUR DEVICE ID");
                 DPRINT_DATA(id, address_len);
                 DPRINT("TARGET DEVICE ID");
-                DPRINT_DATA(packet->hw_radio_packet.data + (*data_idx), address_len);
+                DPRINT_DATA(packet->dll_header.target_address, address_len);
                 return false;
             }
-            (*data_idx) += address_len;
         }
     }
+
+    (*data_idx) += header_len;
     // TODO filter LQ
     // TODO pass to upper layer
     // TODO Tscan -= Trx
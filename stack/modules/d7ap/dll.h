@@ -52,6 +52,8 @@ typedef enum {
 
 #define t_g    5 // Guarding period
 
+#define t_t    2 // Turnaround time (Tt) of the requester between the end of the response period and its next request
+
 #define PHY_STATUS_CHANNEL_BYTES 3
 #define PHY_STATUS_MAX_CHANNELS 10
 
@@ -69,7 +71,7 @@ typedef struct
     };
 
     d7ap_addressee_id_type_t control_target_id_type;
-    //uint8_t target_address[8]; // TODO assuming 8B UID for now
+    uint8_t target_address[8]; // only filled when decoding a received foreground frame
 } dll_header_t;
 
 typedef enum
@@ -88,8 +90,8 @@ void dll_stop_foreground_scan();
 void dll_stop_background_scan();
 void dll_execute_scan_automation();
 
-uint8_t dll_assemble_packet_header(packet_t* packet, uint8_t* data_ptr);
-uint8_t dll_assemble_packet_header_bg(packet_t* packet, uint8_t* data_ptr);
+uint8_t dll_assemble_packet_header(packet_t* packet, uint8_t* data_ptr, uint8_t size);
+uint8_t dll_assemble_packet_header_bg(packet_t* packet, uint8_t* data_ptr, uint8_t size);
 bool dll_disassemble_packet_header(packet_t* packet, uint8_t* data_idx);
 void dll_signal_packet_transmitted(packet_t* packet);
 void dll_signal_packet_received(packet_t* packet);
@@ -0,0 +1,43 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "string.h"
+
+#include "duplicate_filter.h"
+
+void duplicate_filter_init(duplicate_filter_t* filter)
+{
+    memset(filter, 0, sizeof(duplicate_filter_t));
+}
+
+bool duplicate_filter_check(duplicate_filter_t* filter, uint16_t key, timer_tick_t now, timer_tick_t lifetime)
+{
+    for (uint8_t i = 0; i < DUPLICATE_FILTER_SIZE; i++)
+    {
+        // the expiration time is compared in a circular fashion, like the framework timer does
+        duplicate_filter_entry_t* entry = &filter->entries[i];
+        if (entry->key == key && (int32_t)(entry->expiration_time - now) > 0)
+            return true;
+    }
+
+    // the entries are added in order, so the next entry is the oldest one
+    filter->entries[filter->next_entry].key = key;
+    filter->entries[filter->next_entry].expiration_time = now + lifetime;
+    filter->next_entry = (filter->next_entry + 1) % DUPLICATE_FILTER_SIZE;
+    return false;
+}
@@ -0,0 +1,63 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file duplicate_filter.h
+ * \addtogroup Duplicate_filter
+ * \ingroup D7AP
+ * @{
+ * \brief Remembers the frames received recently, to drop the copies of a frame which is relayed by multiple nodes.
+ *
+ * A frame is identified by a 16 bit key, which is derived from the part of the frame which is not modified when the
+ * frame is relayed. Every key is remembered until its expiration time, which covers the time the frame can still be
+ * relayed. When the filter is full, the oldest key is replaced.
+ */
+
+#ifndef OSS_7_DUPLICATE_FILTER_H
+#define OSS_7_DUPLICATE_FILTER_H
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "timer.h"
+
+#define DUPLICATE_FILTER_SIZE 8
+
+typedef struct
+{
+    uint16_t key;
+    timer_tick_t expiration_time;
+} duplicate_filter_entry_t;
+
+typedef struct
+{
+    duplicate_filter_entry_t entries[DUPLICATE_FILTER_SIZE];
+    uint8_t next_entry;
+} duplicate_filter_t;
+
+void duplicate_filter_init(duplicate_filter_t* filter);
+
+/*!
+ * Returns true when the key was added before and did not expire yet, otherwise the key is added.
+ * \param now       The current time
+ * \param lifetime  The time the key is remembered, in ticks from now
+ */
+bool duplicate_filter_check(duplicate_filter_t* filter, uint16_t key, timer_tick_t now, timer_tick_t lifetime);
+
+#endif //OSS_7_DUPLICATE_FILTER_H
+
+/** @}*/
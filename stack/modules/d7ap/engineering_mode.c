@@ -26,6 +26,8 @@
 #include "packet.h"
 #include "crc.h"
 #include "packet_queue.h"
+#include "fs.h"
+#include "errors.h"
 
 #include "modem_interface.h"
 
@@ -47,6 +49,13 @@
 #define FILL_DATA_SIZE PACKET_SIZE - PACKET_METADATA_SIZE
 #define PER_PACKET_DELAY 20
 
+#ifdef MODULE_D7AP_EM_PER_SWEEP_ENABLED
+// a sweep frame contains the length byte, the step index, the packet counter and the CRC
+#define SWEEP_PACKET_METADATA_SIZE (1 + 1 + sizeof(uint16_t) + sizeof(uint16_t))
+#define SWEEP_START_DELAY 500 // ms, gives time to answer through uart
+#define MS_TO_TICKS(ms) ((timer_tick_t)(ms) * TIMER_TICKS_PER_SEC / 1000)
+#endif
+
 typedef struct packet packet_t;
 
 static uint8_t timeout_em = 0;
@@ -69,6 +78,32 @@ typedef struct {
 } per_packet_t;
 static per_packet_t per_packet;
 
+#ifdef MODULE_D7AP_EM_PER_SWEEP_ENABLED
+typedef struct {
+  phy_channel_class_t channel_class;
+  phy_coding_t coding;
+  uint8_t packet_size;
+  int8_t eirp;
+} sweep_step_t;
+
+static d7ap_fs_em_sweep_config_t sweep_cfg;
+static bool sweep_is_tx = false;
+static uint8_t sweep_step_count = 0;
+static uint8_t sweep_step_index = 0;
+static sweep_step_t sweep_step;
+static timer_tick_t sweep_step_start;
+static timer_tick_t sweep_step_end;
+static uint16_t sweep_packet_counter = 0;
+static uint16_t sweep_packets_sent = 0;
+static uint16_t sweep_packets_received = 0;
+static uint16_t sweep_crc_errors = 0;
+static int16_t sweep_rssi_min;
+static int16_t sweep_rssi_max;
+static int32_t sweep_rssi_sum;
+
+static void sweep_end_step();
+#endif
+
 static void start_per_rx();
 static void transmit_per_packet();
 
@@ -173,6 +208,271 @@ static void transmit_per_packet() {
     error_t e = phy_send_packet(&per_packet.hw_radio_packet, &tx_cfg, &packet_transmitted_callback);
 }
 
+#ifdef MODULE_D7AP_EM_PER_SWEEP_ENABLED
+static uint8_t sweep_range_count(int16_t start, int16_t stop, uint8_t step) {
+  if(step == 0 || stop <= start)
+    return 1;
+
+  return (stop - start) / step + 1;
+}
+
+// returns the index of the n-th bit set in mask
+static uint8_t sweep_mask_bit(uint8_t mask, uint8_t n) {
+  for(uint8_t bit = 0; bit < 8; bit++) {
+    if(mask & (1 << bit)) {
+      if(n == 0)
+        return bit;
+
+      n--;
+    }
+  }
+
+  assert(false);
+  return 0;
+}
+
+static void sweep_get_step(uint8_t index, sweep_step_t* step) {
+  uint8_t eirp_count = sweep_range_count(sweep_cfg.eirp_start, sweep_cfg.eirp_stop, sweep_cfg.eirp_step);
+  uint8_t packet_size_count = sweep_range_count(sweep_cfg.packet_size_start, sweep_cfg.packet_size_stop, sweep_cfg.packet_size_step);
+  uint8_t coding_count = __builtin_popcount(sweep_cfg.coding_mask);
+
+  step->eirp = sweep_cfg.eirp_start + (index % eirp_count) * sweep_cfg.eirp_step;
+  index /= eirp_count;
+  step->packet_size = sweep_cfg.packet_size_start + (index % packet_size_count) * sweep_cfg.packet_size_step;
+  index /= packet_size_count;
+  step->coding = sweep_mask_bit(sweep_cfg.coding_mask, index % coding_count);
+  index /= coding_count;
+  step->channel_class = sweep_mask_bit(sweep_cfg.channel_class_mask, index);
+}
+
+static bool sweep_read_config() {
+  uint32_t length = USER_FILE_EM_SWEEP_CONFIG_SIZE;
+  if(d7ap_fs_read_file(USER_FILE_EM_SWEEP_CONFIG_FILE_ID, 0, (uint8_t*)&sweep_cfg, &length, ROOT_AUTH) != SUCCESS)
+    return false;
+
+  sweep_cfg.center_freq_index = __builtin_bswap16(sweep_cfg.center_freq_index);
+  sweep_cfg.packets_per_step = __builtin_bswap16(sweep_cfg.packets_per_step);
+  sweep_cfg.packet_interval = __builtin_bswap16(sweep_cfg.packet_interval);
+  sweep_cfg.guard_time = __builtin_bswap16(sweep_cfg.guard_time);
+
+  if(sweep_cfg.channel_class_mask == 0 || sweep_cfg.coding_mask == 0 || sweep_cfg.packets_per_step == 0
+      || sweep_cfg.packet_interval == 0 || sweep_cfg.packet_size_start < SWEEP_PACKET_METADATA_SIZE)
+    return false;
+
+  uint32_t step_count = __builtin_popcount(sweep_cfg.channel_class_mask) * __builtin_popcount(sweep_cfg.coding_mask)
+      * sweep_range_count(sweep_cfg.packet_size_start, sweep_cfg.packet_size_stop, sweep_cfg.packet_size_step)
+      * sweep_range_count(sweep_cfg.eirp_start, sweep_cfg.eirp_stop, sweep_cfg.eirp_step);
+
+  if(step_count > USER_FILE_EM_SWEEP_RESULT_MAX_RECORDS) {
+    DPRINT("PER sweep of %i steps truncated to %i", step_count, USER_FILE_EM_SWEEP_RESULT_MAX_RECORDS);
+    step_count = USER_FILE_EM_SWEEP_RESULT_MAX_RECORDS;
+  }
+
+  sweep_step_count = step_count;
+  return true;
+}
+
+static int8_t sweep_rssi_to_int8(int32_t rssi) {
+  if(rssi < INT8_MIN)
+    return INT8_MIN;
+
+  return rssi > INT8_MAX ? INT8_MAX : rssi;
+}
+
+static void sweep_store_result() {
+  d7ap_fs_em_sweep_result_t result = {
+    .channel_class = sweep_step.channel_class,
+    .coding = sweep_step.coding,
+    .packet_size = sweep_step.packet_size,
+    .eirp = sweep_step.eirp,
+  };
+
+  if(sweep_is_tx) {
+    result.packets_expected = __builtin_bswap16(sweep_packets_sent);
+  } else {
+    uint32_t duration_ms = (uint32_t)sweep_cfg.packets_per_step * sweep_cfg.packet_interval;
+    result.packets_expected = __builtin_bswap16(sweep_cfg.packets_per_step);
+    result.packets_received = __builtin_bswap16(sweep_packets_received);
+    result.crc_errors = __builtin_bswap16(sweep_crc_errors);
+    if(sweep_packets_received < sweep_cfg.packets_per_step)
+      result.per = __builtin_bswap16((uint32_t)(sweep_cfg.packets_per_step - sweep_packets_received) * 1000 / sweep_cfg.packets_per_step);
+    result.throughput = __builtin_bswap32((uint64_t)sweep_packets_received * sweep_step.packet_size * 8 * 1000 / duration_ms);
+    if(sweep_packets_received > 0) {
+      result.rssi_min = sweep_rssi_to_int8(sweep_rssi_min);
+      result.rssi_avg = sweep_rssi_to_int8(sweep_rssi_sum / sweep_packets_received);
+      result.rssi_max = sweep_rssi_to_int8(sweep_rssi_max);
+    }
+  }
+
+  uint8_t completed_steps = sweep_step_index + 1;
+  d7ap_fs_write_file(USER_FILE_EM_SWEEP_RESULT_FILE_ID, 1 + sweep_step_index * USER_FILE_EM_SWEEP_RESULT_RECORD_SIZE,
+                     (uint8_t*)&result, USER_FILE_EM_SWEEP_RESULT_RECORD_SIZE, ROOT_AUTH);
+  d7ap_fs_write_file(USER_FILE_EM_SWEEP_RESULT_FILE_ID, 0, &completed_steps, 1, ROOT_AUTH);
+}
+
+static void sweep_packet_transmitted(packet_t* packet) {
+  sweep_packets_sent++;
+}
+
+static void sweep_transmit_packet() {
+  uint8_t* data = per_packet.hw_radio_packet.data;
+  data[0] = sweep_step.packet_size - 1;
+  data[1] = sweep_step_index;
+  memcpy(data + 2, &sweep_packet_counter, sizeof(sweep_packet_counter));
+  for(uint8_t i = 4; i < sweep_step.packet_size - 2; i++)
+    data[i] = i;
+
+  uint16_t crc = __builtin_bswap16(crc_calculate(data, sweep_step.packet_size - 2));
+  memcpy(data + sweep_step.packet_size - 2, &crc, 2);
+  per_packet.hw_radio_packet.length = sweep_step.packet_size;
+
+  DPRINT("sweep step %i: transmitting packet %i", sweep_step_index, sweep_packet_counter);
+  if(phy_send_packet(&per_packet.hw_radio_packet, &tx_cfg, &sweep_packet_transmitted) != SUCCESS)
+    DPRINT("sweep packet %i not sent, the packet interval is too short", sweep_packet_counter);
+
+  sweep_packet_counter++;
+  if(sweep_packet_counter < sweep_cfg.packets_per_step)
+    timer_post_task(&sweep_transmit_packet, sweep_step_start + MS_TO_TICKS(sweep_cfg.guard_time / 2)
+                                            + sweep_packet_counter * MS_TO_TICKS(sweep_cfg.packet_interval));
+}
+
+static void sweep_packet_received(packet_t* packet) {
+  uint8_t* data = packet->hw_radio_packet.data;
+  uint16_t length = packet->hw_radio_packet.length;
+  uint16_t crc = 0;
+  if(length >= SWEEP_PACKET_METADATA_SIZE)
+    crc = __builtin_bswap16(crc_calculate(data, length - 2));
+
+  if(length < SWEEP_PACKET_METADATA_SIZE || memcmp(&crc, data + length - 2, 2) != 0) {
+    sweep_crc_errors++;
+    packet_queue_free_packet(packet);
+    return;
+  }
+
+  uint16_t msg_counter;
+  memcpy(&msg_counter, data + 2, sizeof(msg_counter));
+  if(data[1] != sweep_step_index || msg_counter >= sweep_cfg.packets_per_step) {
+    DPRINT("packet of sweep step %i received during step %i", data[1], sweep_step_index);
+    packet_queue_free_packet(packet);
+    return;
+  }
+
+  int16_t rssi = packet->hw_radio_packet.rx_meta.rssi;
+  if(sweep_packets_received == 0 || rssi < sweep_rssi_min)
+    sweep_rssi_min = rssi;
+
+  if(sweep_packets_received == 0 || rssi > sweep_rssi_max)
+    sweep_rssi_max = rssi;
+
+  sweep_rssi_sum += rssi;
+  sweep_packets_received++;
+
+  // follow the schedule of the transmitter: the step ends half a guard time after the last packet
+  sweep_step_end = packet->hw_radio_packet.rx_meta.timestamp
+                   + (sweep_cfg.packets_per_step - msg_counter) * MS_TO_TICKS(sweep_cfg.packet_interval)
+                   + MS_TO_TICKS(sweep_cfg.guard_time / 2);
+  timer_cancel_task(&sweep_end_step);
+  timer_post_task(&sweep_end_step, sweep_step_end);
+
+  packet_queue_free_packet(packet);
+}
+
+static void sweep_start_step() {
+  sweep_get_step(sweep_step_index, &sweep_step);
+  sweep_packet_counter = 0;
+  sweep_packets_sent = 0;
+  sweep_packets_received = 0;
+  sweep_crc_errors = 0;
+  sweep_rssi_sum = 0;
+
+  channel_id_t channel_id = {
+    .channel_header.ch_coding = sweep_step.coding,
+    .channel_header.ch_class = sweep_step.channel_class,
+    .channel_header.ch_freq_band = sweep_cfg.freq_band,
+    .center_freq_index = sweep_cfg.center_freq_index
+  };
+
+  DPRINT("sweep step %i: class %i, coding %i, size %i, eirp %i", sweep_step_index, sweep_step.channel_class,
+         sweep_step.coding, sweep_step.packet_size, sweep_step.eirp);
+
+  sweep_step_end = sweep_step_start + MS_TO_TICKS(sweep_cfg.guard_time)
+                   + sweep_cfg.packets_per_step * MS_TO_TICKS(sweep_cfg.packet_interval);
+  if(sweep_is_tx) {
+    tx_cfg.channel_id = channel_id;
+    tx_cfg.eirp = sweep_step.eirp;
+    timer_post_task(&sweep_transmit_packet, sweep_step_start + MS_TO_TICKS(sweep_cfg.guard_time / 2));
+  } else {
+    rx_cfg.channel_id = channel_id;
+    phy_start_rx(&(rx_cfg.channel_id), rx_cfg.syncword_class, &sweep_packet_received);
+  }
+
+  timer_post_task(&sweep_end_step, sweep_step_end);
+}
+
+static void sweep_end_step() {
+  if(sweep_is_tx)
+    timer_cancel_task(&sweep_transmit_packet);
+  else
+    phy_stop_rx();
+
+  sweep_store_result();
+  DPRINT("sweep step %i done: sent %i, received %i, crc errors %i", sweep_step_index, sweep_packets_sent,
+         sweep_packets_received, sweep_crc_errors);
+
+  sweep_step_index++;
+  if(sweep_step_index == sweep_step_count) {
+    DPRINT("PER sweep done");
+    return;
+  }
+
+  // the next step starts right away, at the end of the previous one
+  sweep_step_start = sweep_step_end;
+  sweep_start_step();
+}
+
+static void sweep_start(bool is_tx) {
+  timer_cancel_task(&sweep_start_step);
+  timer_cancel_task(&sweep_end_step);
+  timer_cancel_task(&sweep_transmit_packet);
+
+  if(!sweep_read_config()) {
+    DPRINT("invalid PER sweep configuration");
+    return;
+  }
+
+  uint8_t completed_steps = 0;
+  d7ap_fs_write_file(USER_FILE_EM_SWEEP_RESULT_FILE_ID, 0, &completed_steps, 1, ROOT_AUTH);
+
+  sweep_is_tx = is_tx;
+  sweep_step_index = 0;
+  sweep_step_start = timer_get_counter_value() + MS_TO_TICKS(SWEEP_START_DELAY);
+  hw_radio_set_idle();
+  timer_post_task(&sweep_start_step, sweep_step_start);
+}
+
+/*
+ * The sweep files are only created when the sweep is enabled, so they do not take permanent storage on the other
+ * nodes. The configuration file has to exist before a sweep is started, so it can be written over ALP.
+ */
+static void sweep_init_files() {
+  d7ap_fs_file_header_t sweep_file_header = {
+    .file_permissions = (file_permission_t){ .guest_read = true, .user_read = true, .user_write = true },
+    .file_properties.storage_class = FS_STORAGE_PERMANENT,
+    .length = USER_FILE_EM_SWEEP_CONFIG_SIZE,
+    .allocated_length = USER_FILE_EM_SWEEP_CONFIG_SIZE
+  };
+
+  if(!fs_file_stat(USER_FILE_EM_SWEEP_CONFIG_FILE_ID))
+    d7ap_fs_init_file(USER_FILE_EM_SWEEP_CONFIG_FILE_ID, &sweep_file_header, NULL);
+
+  sweep_file_header.file_permissions.user_write = false;
+  sweep_file_header.length = USER_FILE_EM_SWEEP_RESULT_SIZE;
+  sweep_file_header.allocated_length = USER_FILE_EM_SWEEP_RESULT_SIZE;
+  if(!fs_file_stat(USER_FILE_EM_SWEEP_RESULT_FILE_ID))
+    d7ap_fs_init_file(USER_FILE_EM_SWEEP_RESULT_FILE_ID, &sweep_file_header, NULL);
+}
+#endif
+
 static void start_tx() {
     phy_continuous_tx(&tx_cfg, timeout_em, &cont_tx_done_callback);
 }
@@ -252,6 +552,16 @@ static void em_file_change_callback(uint8_t file_id) {
         hw_radio_set_idle();
         timer_post_task_delay(&transmit_per_packet, 500);
         break;
+#ifdef MODULE_D7AP_EM_PER_SWEEP_ENABLED
+      case EM_PER_SWEEP_RX:
+        DPRINT("EM_MODE_PER_SWEEP_RX\n");
+        sweep_start(false);
+        break;
+      case EM_PER_SWEEP_TX:
+        DPRINT("EM_MODE_PER_SWEEP_TX\n");
+        sweep_start(true);
+        break;
+#endif
     }
 }
 
@@ -267,6 +577,12 @@ error_t engineering_mode_init()
   sched_register_task(&transmit_per_packet);
   sched_register_task(&start_per_rx);
   sched_register_task(&em_reset);
+#ifdef MODULE_D7AP_EM_PER_SWEEP_ENABLED
+  sweep_init_files();
+  sched_register_task(&sweep_start_step);
+  sched_register_task(&sweep_end_step);
+  sched_register_task(&sweep_transmit_packet);
+#endif
   
   return SUCCESS;
 }
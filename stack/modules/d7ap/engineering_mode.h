@@ -40,6 +40,52 @@ typedef struct __attribute__((__packed__))
   int8_t eirp;
 } d7ap_fs_engineering_mode_t;
 
+/*! \brief Configuration of a PER sweep, stored in the USER_FILE_EM_SWEEP_CONFIG_FILE_ID file (multi byte fields big endian)
+ *
+ * A sweep iterates over all combinations of the selected channel classes and codings, packet sizes and EIRPs (the EIRP
+ * in the innermost loop). Every combination is a step which lasts guard_time + packets_per_step * packet_interval ms
+ * on both the transmitter and the receiver, this way both follow the same schedule once the sweep is started on both
+ * sides by writing EM_PER_SWEEP_TX or EM_PER_SWEEP_RX to the engineering mode file. The sweep and its files are only
+ * available when MODULE_D7AP_EM_PER_SWEEP_ENABLED is set.
+ */
+typedef struct __attribute__((__packed__))
+{
+  uint8_t freq_band;
+  uint16_t center_freq_index;
+  uint8_t channel_class_mask; //!< bit n selects the channel class n
+  uint8_t coding_mask; //!< bit n selects the coding n
+  uint8_t packet_size_start; //!< size of the frame, including the length byte and the CRC
+  uint8_t packet_size_stop;
+  uint8_t packet_size_step;
+  int8_t eirp_start;
+  int8_t eirp_stop;
+  uint8_t eirp_step;
+  uint16_t packets_per_step;
+  uint16_t packet_interval; //!< in ms
+  uint16_t guard_time; //!< in ms, covers the start offset between transmitter and receiver
+} d7ap_fs_em_sweep_config_t;
+
+/*! \brief Result of one step of a PER sweep, stored in the USER_FILE_EM_SWEEP_RESULT_FILE_ID file
+ *
+ * The result file starts with the number of completed steps followed by a record per step (multi byte fields big
+ * endian). The transmitter only fills in the packets sent, in packets_expected.
+ */
+typedef struct __attribute__((__packed__))
+{
+  uint8_t channel_class;
+  uint8_t coding;
+  uint8_t packet_size;
+  int8_t eirp;
+  uint16_t packets_expected;
+  uint16_t packets_received;
+  uint16_t crc_errors;
+  uint16_t per; //!< in per mille
+  int8_t rssi_min;
+  int8_t rssi_avg;
+  int8_t rssi_max;
+  uint32_t throughput; //!< received frame bits per second
+} d7ap_fs_em_sweep_result_t;
+
 error_t engineering_mode_init(); 
 error_t engineering_mode_stop();
 
@@ -0,0 +1,156 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "string.h"
+
+#include "frame_decoder.h"
+#include "packet_codec.h"
+#include "crc.h"
+#include "pn9.h"
+#include "MODULE_D7AP_defs.h"
+
+#define CRC_SIZE 2
+
+void frame_decoder_init(frame_decoder_t* decoder, const uint8_t* nls_key)
+{
+    memset(decoder, 0, sizeof(frame_decoder_t));
+    if (nls_key)
+    {
+        AES128_init_key_schedule(&decoder->nls_key_schedule, nls_key);
+        decoder->has_nls_key = true;
+    }
+}
+
+#if defined(MODULE_D7AP_NLS_ENABLED)
+// decrypts the payload in place and strips the authentication tag, like d7anp_unsecure_payload()
+static bool unsecure_payload(frame_decoder_t* decoder, packet_t* packet, uint8_t index)
+{
+    uint8_t ctr_blk[AES_BLOCK_SIZE];
+    uint8_t nls_method = packet->d7anp_ctrl.nls_method;
+    uint8_t auth_len = packet_codec_nls_auth_length(nls_method);
+
+    if (!decoder->has_nls_key || packet->hw_radio_packet.length < index + CRC_SIZE + auth_len)
+        return false;
+
+    uint8_t payload_len = packet->hw_radio_packet.length - index - CRC_SIZE - auth_len;
+    switch (nls_method)
+    {
+    case AES_CTR:
+        packet_codec_build_nls_iv(packet, payload_len, ctr_blk);
+        break;
+    case AES_CCM_128:
+    case AES_CCM_64:
+    case AES_CCM_32:
+        // the payload is encrypted starting from block counter 1, block 0 encrypts the authentication tag
+        packet_codec_build_nls_iv(packet, payload_len, ctr_blk);
+        ctr_blk[0] = (ctr_blk[0] & 0xF0) + 1;
+        break;
+    default:
+        // CBC-MAC only authenticates, the payload is not encrypted
+        packet->hw_radio_packet.length -= auth_len;
+        return true;
+    }
+
+    AES128_CTR_encrypt_with_key_schedule(&decoder->nls_key_schedule, packet->hw_radio_packet.data + index,
+                                         packet->hw_radio_packet.data + index, payload_len, ctr_blk);
+    packet->hw_radio_packet.length -= auth_len;
+    return true;
+}
+#endif
+
+frame_decoder_status_t frame_decoder_decode(frame_decoder_t* decoder, const uint8_t* raw, uint16_t raw_length,
+                                            phy_coding_t coding, bool background, bool is_request, packet_t* packet)
+{
+    uint8_t* data = decoder->buffer;
+    uint16_t decoded_length = raw_length;
+
+    if (raw_length == 0 || raw_length > sizeof(decoder->buffer))
+        return FRAME_DECODER_ERROR_LENGTH;
+
+    memcpy(data, raw, raw_length);
+    pn9_encode(data, raw_length);
+    if (coding == PHY_CODING_FEC_PN9)
+    {
+        if (raw_length % 4 != 0)
+            return FRAME_DECODER_ERROR_LENGTH;
+
+        decoded_length = fec_decode_packet_with_decoder(&decoder->fec, data, raw_length, raw_length);
+    }
+
+    uint16_t frame_length = background ? BACKGROUND_FRAME_LENGTH : data[0] + 1;
+    if (frame_length > decoded_length || frame_length > sizeof(packet->__data))
+        return FRAME_DECODER_ERROR_LENGTH;
+
+    packet->type = background ? BACKGROUND_ADV : (is_request ? INITIAL_REQUEST : RESPONSE_TO_UNICAST);
+    packet->d7anp_addressee = NULL;
+    packet->hw_radio_packet.length = frame_length;
+    memcpy(packet->hw_radio_packet.data, data, frame_length);
+    data = packet->hw_radio_packet.data;
+
+    uint8_t data_idx = background ? 0 : 1;
+    if (frame_length < data_idx + CRC_SIZE)
+        return FRAME_DECODER_ERROR_LENGTH;
+
+    uint16_t crc = __builtin_bswap16(crc_calculate(data, frame_length - CRC_SIZE));
+    if (memcmp(&crc, data + frame_length - CRC_SIZE, CRC_SIZE) != 0)
+        return FRAME_DECODER_ERROR_CRC;
+
+    uint8_t header_len = packet_codec_decode_dll_header(packet, background, data + data_idx,
+                                                        frame_length - CRC_SIZE - data_idx);
+    if (!header_len)
+        return FRAME_DECODER_ERROR_HEADER;
+
+    data_idx += header_len;
+    if (background)
+    {
+        if (frame_length - CRC_SIZE - data_idx != sizeof(uint16_t))
+            return FRAME_DECODER_ERROR_LENGTH;
+
+        packet->ETA = (data[data_idx] << 8) | data[data_idx + 1];
+        packet->payload_length = 0;
+        return FRAME_DECODER_OK;
+    }
+
+    header_len = packet_codec_decode_d7anp_header(packet, data + data_idx, frame_length - CRC_SIZE - data_idx);
+    if (!header_len)
+        return FRAME_DECODER_ERROR_HEADER;
+
+    data_idx += header_len;
+    if (packet->d7anp_ctrl.nls_method)
+    {
+#if defined(MODULE_D7AP_NLS_ENABLED)
+        if (!unsecure_payload(decoder, packet, data_idx))
+            return FRAME_DECODER_ERROR_NLS;
+#else
+        return FRAME_DECODER_ERROR_NLS;
+#endif
+    }
+
+    // Tl and Te are 0 when not present in the header
+    packet->d7atp_tl = 0;
+    packet->d7atp_te = 0;
+    header_len = packet_codec_decode_d7atp_header(packet, is_request, data + data_idx,
+                                                  packet->hw_radio_packet.length - CRC_SIZE - data_idx);
+    if (!header_len)
+        return FRAME_DECODER_ERROR_HEADER;
+
+    data_idx += header_len;
+    packet->payload_offset = data_idx;
+    packet->payload_length = packet->hw_radio_packet.length - CRC_SIZE - data_idx;
+    return FRAME_DECODER_OK;
+}
@@ -0,0 +1,74 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file frame_decoder.h
+ * \addtogroup Frame_decoder
+ * \ingroup D7AP
+ * @{
+ * \brief Reentrant decoder for raw D7A frames, used by host tools to analyse captures.
+ *
+ * The decoder runs the receive path of the stack on a frame as captured over the air: PN9 dewhitening, FEC decoding,
+ * CRC check, parsing of the DLL, D7ANP and D7ATP headers and NLS decryption. Contrary to the stack, all state is kept
+ * in a frame_decoder_t, so threads can decode in parallel using a decoder each.
+ * Frames are not filtered on subnet, address or replay counters. Authentication tags are removed from the payload but
+ * not verified.
+ */
+
+#ifndef OSS_7_FRAME_DECODER_H
+#define OSS_7_FRAME_DECODER_H
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "aes.h"
+#include "fec.h"
+#include "packet.h"
+
+typedef enum {
+    FRAME_DECODER_OK = 0,
+    FRAME_DECODER_ERROR_LENGTH = 1, //!< the frame is shorter than indicated by its length byte, or too short to be valid
+    FRAME_DECODER_ERROR_CRC = 2,
+    FRAME_DECODER_ERROR_HEADER = 3, //!< the DLL, D7ANP or D7ATP header exceeds the frame
+    FRAME_DECODER_ERROR_NLS = 4, //!< the frame is secured but no key is set, or NLS is not enabled in this build
+} frame_decoder_status_t;
+
+typedef struct {
+    fec_decoder_t fec;
+    aes128_key_schedule_t nls_key_schedule;
+    bool has_nls_key;
+    uint8_t buffer[2 * FEC_BUFFER_SIZE]; //!< holds the raw frame, which is up to twice as long as the frame when FEC encoded
+} frame_decoder_t;
+
+/*! \brief Initializes the decoder, nls_key is the 128 bit key used to decrypt secured frames or NULL */
+void frame_decoder_init(frame_decoder_t* decoder, const uint8_t* nls_key);
+
+/*! \brief Decodes a raw frame as received over the air into packet.
+ *
+ * \param coding        The coding of the channel the frame was received on
+ * \param background    True for a background frame (syncword class 0)
+ * \param is_request    Whether the D7ATP header is the one of a request, which contains Tc when an ACK is requested
+ *
+ * The decoded frame is stored in packet->hw_radio_packet and the header fields, payload (or ETA for background frames)
+ * in the other fields of packet. On error the fields decoded so far are kept.
+ */
+frame_decoder_status_t frame_decoder_decode(frame_decoder_t* decoder, const uint8_t* raw, uint16_t raw_length,
+                                            phy_coding_t coding, bool background, bool is_request, packet_t* packet);
+
+#endif //OSS_7_FRAME_DECODER_H
+
+/** @}*/
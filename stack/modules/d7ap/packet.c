@@ -50,28 +50,50 @@ static bool has_hardware_crc = false;
 void packet_init(packet_t* packet)
 {
     memset(packet, 0x00, sizeof(packet_t));
+    packet_reset_payload(packet);
+}
+
+void packet_reset_payload(packet_t* packet)
+{
+    packet->payload_offset = PACKET_TX_HEADER_ROOM;
+    packet->payload_length = 0;
 }
 
 void packet_assemble(packet_t* packet)
 {
+    // a relayed frame is assembled from the received frame, its payload is the D7ATP header and payload as received
+    // (which may be secured) and its headers are encoded in place of the received headers, which have the same length
+    bool relayed = packet->type == RELAYED_FRAME;
+
+    // the payload is moved behind the headers and secured in place, so a packet can only be assembled once
+    assert(relayed || packet->payload_offset == PACKET_TX_HEADER_ROOM);
+    assert(relayed || packet->payload_length <= PACKET_MAX_TX_PAYLOAD_SIZE);
+
     uint8_t* data_ptr = packet->hw_radio_packet.data + 1; // skip length field for now, we fill this later
+    uint8_t* payload = packet_get_payload(packet);
 
-    data_ptr += dll_assemble_packet_header(packet, data_ptr);
+    // the headers are written in the room reserved in front of the payload
+    data_ptr += dll_assemble_packet_header(packet, data_ptr, payload - data_ptr);
 
-    data_ptr += d7anp_assemble_packet_header(packet, data_ptr);
+    data_ptr += d7anp_assemble_packet_header(packet, data_ptr, payload - data_ptr);
 
 #if defined(MODULE_D7AP_NLS_ENABLED)
     uint8_t* nwl_payload = data_ptr;
 #endif
 
-    data_ptr += d7atp_assemble_packet_header(packet, data_ptr);
+    if (!relayed)
+        data_ptr += d7atp_assemble_packet_header(packet, data_ptr, payload - data_ptr);
+
+    // close the gap between the headers and the payload when the headers are smaller than the reserved room
+    if (data_ptr != payload)
+        memmove(data_ptr, payload, packet->payload_length);
 
-    // add payload
-    memcpy(data_ptr, packet->payload, packet->payload_length); data_ptr += packet->payload_length;
+    packet->payload_offset = data_ptr - packet->hw_radio_packet.data;
+    data_ptr += packet->payload_length;
 
 #if defined(MODULE_D7AP_NLS_ENABLED)
     /* Encrypt/authenticate nwl_payload if needed */
-    if (packet->d7anp_ctrl.nls_method)
+    if (packet->d7anp_ctrl.nls_method && !relayed)
         data_ptr += d7anp_secure_payload(packet, nwl_payload, data_ptr - nwl_payload);
 #endif
 
@@ -118,6 +140,12 @@ void packet_disassemble(packet_t* packet)
     else
         data_idx = 0;
 
+    if (packet->hw_radio_packet.length < data_idx + 2)
+    {
+        DPRINT_DLL("Packet too short: len %d", packet->hw_radio_packet.length);
+        goto cleanup;
+    }
+
     if(!dll_disassemble_packet_header(packet, &data_idx))
         goto cleanup;
 
@@ -126,12 +154,22 @@ void packet_disassemble(packet_t* packet)
         if(!d7anp_disassemble_packet_header(packet, &data_idx))
             goto cleanup;
 
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+        if (packet->type == RELAYED_FRAME)
+        {
+            packet->payload_offset = data_idx;
+            packet->payload_length = packet->hw_radio_packet.length - data_idx - 2; // exclude the headers CRC bytes
+            d7anp_relay_packet(packet);
+            return;
+        }
+#endif
+
         if(!d7atp_disassemble_packet_header(packet, &data_idx))
             goto cleanup;
 
-        // extract payload
+        // the payload is left in the radio buffer
+        packet->payload_offset = data_idx;
         packet->payload_length = packet->hw_radio_packet.length - data_idx - 2; // exclude the headers CRC bytes // TODO exclude footers
-        memcpy(packet->payload, packet->hw_radio_packet.data + data_idx, packet->payload_length);
     }
     else
     {
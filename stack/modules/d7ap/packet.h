@@ -41,9 +41,25 @@ typedef enum {
     RESPONSE_TO_UNICAST,
     RESPONSE_TO_BROADCAST,
     BACKGROUND_ADV,
-    REQUEST_IN_DIALOG_EXTENSION
+    REQUEST_IN_DIALOG_EXTENSION,
+    RELAYED_FRAME // received for another destination, the D7ATP header and payload are forwarded as received
 } packet_type;
 
+#ifdef MODULE_D7AP_HOPPING_ENABLED
+// the hopping control and the destination UID
+#define D7ANP_HOPPING_HEADER_MAX_LENGTH (1 + ID_TYPE_UID_ID_LENGTH)
+#else
+#define D7ANP_HOPPING_HEADER_MAX_LENGTH 0
+#endif
+
+/*! The room reserved in front of the payload of a frame to transmit, for the length byte and the largest DLL, D7ANP
+ * and D7ATP headers. This way the payload can be written directly in the radio buffer, before the headers are known. */
+#define PACKET_TX_HEADER_ROOM (1 + 10 + 15 + D7ANP_HOPPING_HEADER_MAX_LENGTH + 9 + D7ATP_ACK_RECORD_MAX_LENGTH)
+
+/*! The largest payload of a frame to transmit, which fits in the radio buffer together with the largest headers and
+ * the CRC. Received frames with smaller headers can have a larger payload. */
+#define PACKET_MAX_TX_PAYLOAD_SIZE (255 - PACKET_TX_HEADER_ROOM - 2)
+
 /*! \brief A D7AP 'packet' used over all layers of the stack. Contains both the raw packet data (as transmitted over the air) as well
  * as metadata parsed or generated while moving through the different layers */
 struct packet
@@ -51,8 +67,10 @@ struct packet
     timer_tick_t request_received_timestamp;
     dll_header_t dll_header;
     d7anp_ctrl_t d7anp_ctrl;
+    d7anp_hop_ctrl_t d7anp_hop_ctrl;
     uint8_t origin_access_class;
     uint8_t origin_access_id[8];
+    uint8_t destination_access_id[8];
     dae_nwl_security_t d7anp_security;
     d7atp_ctrl_t d7atp_ctrl;
     d7ap_addressee_t* d7anp_addressee;
@@ -68,8 +86,7 @@ struct packet
     uint16_t tx_duration;
     // TODO d7atp ack template
     uint8_t payload_length;
-    uint8_t payload[239]; // TODO make max size configurable using cmake
-                            // TODO store payload here or only pointer to file where we need to fetch it? can we assume data will not be changed in between
+    uint8_t payload_offset; // the payload is not copied but stored in hw_radio_packet.data, use packet_get_payload()
     phy_config_t phy_config;
     hw_radio_packet_t hw_radio_packet; // TODO we might not need all metadata included in hw_radio_packet_t. If not copy needed data fields
     uint8_t __data[255];    // reserves space for hw_radio_packet_t.data flexible array member,
@@ -82,6 +99,16 @@ void packet_init(packet_t*);
 void packet_assemble(packet_t*);
 void packet_disassemble(packet_t*);
 
+/*! \brief Discards the payload and reserves the header room in front of it, before writing the payload of a frame to
+ * transmit. Needed when a received packet is reused to transmit the response. */
+void packet_reset_payload(packet_t*);
+
+/*! \brief Returns the payload, which is a view into the radio buffer */
+static inline uint8_t* packet_get_payload(packet_t* packet)
+{
+    return packet->hw_radio_packet.data + packet->payload_offset;
+}
+
 #endif //OSS_7_PACKET_H
 
 /** @}*/
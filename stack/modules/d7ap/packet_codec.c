@@ -0,0 +1,291 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "string.h"
+
+#include "packet_codec.h"
+#include "d7ap.h"
+#include "aes.h"
+#include "MODULE_D7AP_defs.h"
+
+/*
+ * Every header is described as two lists of fields X(type, present, field, length):
+ * - type: BYTE for a single byte, BYTES for a byte array or BE32 for a 32 bit value transmitted big endian
+ * - present: condition which determines if the field is part of the header
+ * - field: the variable the field is encoded from or decoded into
+ * - length: the length of the field over the air
+ * The CONTROL list contains the fixed part of the header which is decoded first. The presence and length of the fields
+ * in the FIELDS list may only depend on the control fields, this way the length of the complete header is known
+ * before the fields are decoded and only needs to be checked against the available size once. The D7ANP header has
+ * an optional hopping control in between, which depends on the control field and determines the destination ID.
+ * Likewise the D7ATP header of a request can end with an ACK record, of which the first byte determines the length.
+ * Fields which are not stored as such in the packet (like the packed DLL control byte) use a local variable.
+ */
+
+#define DLL_HEADER_CONTROL(X)                                                                                          \
+    X(BYTE, true, packet->dll_header.subnet, 1)                                                                        \
+    X(BYTE, true, control, 1)
+
+#define DLL_HEADER_FIELDS(X)                                                                                           \
+    X(BYTES, !background && !ID_TYPE_IS_BROADCAST(packet->dll_header.control_target_id_type), target_address,          \
+        d7ap_addressee_id_length(packet->dll_header.control_target_id_type))
+
+#define D7ANP_HEADER_CONTROL(X)                                                                                        \
+    X(BYTE, true, packet->d7anp_ctrl.raw, 1)
+
+#if defined(MODULE_D7AP_NLS_ENABLED)
+#define D7ANP_HAS_SECURITY_COUNTERS(nls_method)                                                                        \
+    ((nls_method) == AES_CTR || (nls_method) == AES_CCM_32 || (nls_method) == AES_CCM_64 || (nls_method) == AES_CCM_128)
+#else
+#define D7ANP_HAS_SECURITY_COUNTERS(nls_method) false
+#endif
+
+#define D7ANP_HEADER_HOPPING_CONTROL(X)                                                                                \
+    X(BYTE, packet->d7anp_ctrl.hop_enabled, packet->d7anp_hop_ctrl.raw, 1)
+
+#define D7ANP_HEADER_FIELDS(X)                                                                                         \
+    X(BYTE, !packet->d7anp_ctrl.origin_void, packet->origin_access_class, 1)                                           \
+    X(BYTES, !packet->d7anp_ctrl.origin_void, packet->origin_access_id,                                                \
+        d7ap_addressee_id_length(packet->d7anp_ctrl.origin_id_type))                                                   \
+    X(BYTES, packet->d7anp_ctrl.hop_enabled, packet->destination_access_id,                                            \
+        d7ap_addressee_id_length(packet->d7anp_hop_ctrl.destination_id_type))                                          \
+    X(BYTE, D7ANP_HAS_SECURITY_COUNTERS(packet->d7anp_ctrl.nls_method), packet->d7anp_security.key_counter, 1)         \
+    X(BE32, D7ANP_HAS_SECURITY_COUNTERS(packet->d7anp_ctrl.nls_method), packet->d7anp_security.frame_counter, 4)
+
+#define D7ATP_HEADER_CONTROL(X)                                                                                        \
+    X(BYTE, true, packet->d7atp_ctrl.ctrl_raw, 1)                                                                      \
+    X(BYTE, true, packet->d7atp_dialog_id, 1)                                                                          \
+    X(BYTE, true, packet->d7atp_transaction_id, 1)
+
+// TODO ACK bitmap, support for multiple segments to ack not implemented yet
+#define D7ATP_HEADER_FIELDS(X)                                                                                         \
+    X(BYTE, packet->d7atp_ctrl.ctrl_agc, packet->d7atp_target_rx_level_i, 1)                                           \
+    X(BYTE, packet->d7atp_ctrl.ctrl_tl, packet->d7atp_tl, 1)                                                           \
+    X(BYTE, packet->d7atp_ctrl.ctrl_te, packet->d7atp_te, 1)                                                           \
+    X(BYTE, is_request && packet->d7atp_ctrl.ctrl_is_ack_requested, packet->d7atp_tc, 1)                               \
+    X(BYTE, packet->d7atp_ctrl.ctrl_is_ack_requested && packet->d7atp_ctrl.ctrl_ack_not_void,                          \
+        packet->d7atp_ack_template.ack_transaction_id_start, 1)                                                        \
+    X(BYTE, packet->d7atp_ctrl.ctrl_is_ack_requested && packet->d7atp_ctrl.ctrl_ack_not_void,                          \
+        packet->d7atp_ack_template.ack_transaction_id_stop, 1)
+
+#if defined(MODULE_D7AP_ACK_RECORD_ENABLED)
+#define D7ATP_HAS_ACK_RECORD(packet)                                                                                   \
+    (is_request && (packet)->d7atp_ctrl.ctrl_is_ack_requested && (packet)->d7atp_ctrl.ctrl_ack_not_void                \
+        && (packet)->d7atp_ctrl.ctrl_ack_record)
+
+#define D7ATP_HEADER_ACK_RECORD_COUNT(X)                                                                               \
+    X(BYTE, D7ATP_HAS_ACK_RECORD(packet), packet->d7atp_ack_template.ack_record_count, 1)
+
+#define D7ATP_HEADER_ACK_RECORD(X)                                                                                     \
+    X(BYTES, D7ATP_HAS_ACK_RECORD(packet), packet->d7atp_ack_template.ack_record,                                      \
+        packet->d7atp_ack_template.ack_record_count * ID_TYPE_UID_ID_LENGTH)
+#else
+#define D7ATP_HEADER_ACK_RECORD_COUNT(X)
+#define D7ATP_HEADER_ACK_RECORD(X)
+#endif
+
+#define FIELD_LENGTH(type, present, field, length) + ((present) ? (length) : 0)
+#define HEADER_LENGTH(FIELDS) (0 FIELDS(FIELD_LENGTH))
+
+#define ENCODE_FIELD(type, present, field, length)                                                                     \
+    if (present) {                                                                                                     \
+        ENCODE_##type(data, field, length);                                                                            \
+        data += (length);                                                                                              \
+    }
+
+#define DECODE_FIELD(type, present, field, length)                                                                     \
+    if (present) {                                                                                                     \
+        DECODE_##type(data, field, length);                                                                            \
+        data += (length);                                                                                              \
+    }
+
+#define ENCODE_BYTE(data, field, length) (*(data) = (field))
+#define ENCODE_BYTES(data, field, length) memcpy((data), (field), (length))
+#define ENCODE_BE32(data, field, length)                                                                               \
+    do {                                                                                                               \
+        (data)[0] = (uint8_t)((field) >> 24);                                                                          \
+        (data)[1] = (uint8_t)((field) >> 16);                                                                          \
+        (data)[2] = (uint8_t)((field) >> 8);                                                                           \
+        (data)[3] = (uint8_t)(field);                                                                                  \
+    } while (0)
+
+#define DECODE_BYTE(data, field, length) ((field) = *(data))
+#define DECODE_BYTES(data, field, length) memcpy((field), (data), (length))
+#define DECODE_BE32(data, field, length)                                                                               \
+    ((field) = ((uint32_t)(data)[0] << 24) | ((uint32_t)(data)[1] << 16) | ((uint32_t)(data)[2] << 8) | (data)[3])
+
+uint8_t packet_codec_encode_dll_header(packet_t* packet, bool background, uint8_t* data, uint8_t size)
+{
+    uint8_t control = (packet->dll_header.control_target_id_type << 6) | (packet->dll_header.control_eirp_index & 0x3F);
+    const uint8_t* target_address = packet->d7anp_addressee ? packet->d7anp_addressee->id : NULL;
+
+    uint8_t length = HEADER_LENGTH(DLL_HEADER_CONTROL) + HEADER_LENGTH(DLL_HEADER_FIELDS);
+    if (length > size)
+        return 0;
+
+    DLL_HEADER_CONTROL(ENCODE_FIELD)
+    DLL_HEADER_FIELDS(ENCODE_FIELD)
+    return length;
+}
+
+uint8_t packet_codec_decode_dll_header(packet_t* packet, bool background, const uint8_t* data, uint8_t size)
+{
+    uint8_t control;
+    uint8_t* target_address = packet->dll_header.target_address;
+
+    uint8_t length = HEADER_LENGTH(DLL_HEADER_CONTROL);
+    if (length > size)
+        return 0;
+
+    DLL_HEADER_CONTROL(DECODE_FIELD)
+    packet->dll_header.control_target_id_type = control >> 6;
+    packet->dll_header.control_eirp_index = control & 0x3F; // shared with the identifier tag of background frames
+
+    length += HEADER_LENGTH(DLL_HEADER_FIELDS);
+    if (length > size)
+        return 0;
+
+    DLL_HEADER_FIELDS(DECODE_FIELD)
+    return length;
+}
+
+uint8_t packet_codec_encode_d7anp_header(packet_t* packet, uint8_t* data, uint8_t size)
+{
+    uint8_t length = HEADER_LENGTH(D7ANP_HEADER_CONTROL) + HEADER_LENGTH(D7ANP_HEADER_HOPPING_CONTROL)
+        + HEADER_LENGTH(D7ANP_HEADER_FIELDS);
+    if (length > size)
+        return 0;
+
+    D7ANP_HEADER_CONTROL(ENCODE_FIELD)
+    D7ANP_HEADER_HOPPING_CONTROL(ENCODE_FIELD)
+    D7ANP_HEADER_FIELDS(ENCODE_FIELD)
+    return length;
+}
+
+uint8_t packet_codec_decode_d7anp_header(packet_t* packet, const uint8_t* data, uint8_t size)
+{
+    uint8_t length = HEADER_LENGTH(D7ANP_HEADER_CONTROL);
+    if (length > size)
+        return 0;
+
+    D7ANP_HEADER_CONTROL(DECODE_FIELD)
+
+    length += HEADER_LENGTH(D7ANP_HEADER_HOPPING_CONTROL);
+    if (length > size)
+        return 0;
+
+    D7ANP_HEADER_HOPPING_CONTROL(DECODE_FIELD)
+
+    length += HEADER_LENGTH(D7ANP_HEADER_FIELDS);
+    if (length > size)
+        return 0;
+
+    D7ANP_HEADER_FIELDS(DECODE_FIELD)
+    return length;
+}
+
+uint8_t packet_codec_encode_d7atp_header(packet_t* packet, bool is_request, uint8_t* data, uint8_t size)
+{
+    uint8_t length = HEADER_LENGTH(D7ATP_HEADER_CONTROL) + HEADER_LENGTH(D7ATP_HEADER_FIELDS)
+        + HEADER_LENGTH(D7ATP_HEADER_ACK_RECORD_COUNT) + HEADER_LENGTH(D7ATP_HEADER_ACK_RECORD);
+    if (length > size)
+        return 0;
+
+    D7ATP_HEADER_CONTROL(ENCODE_FIELD)
+    D7ATP_HEADER_FIELDS(ENCODE_FIELD)
+    D7ATP_HEADER_ACK_RECORD_COUNT(ENCODE_FIELD)
+    D7ATP_HEADER_ACK_RECORD(ENCODE_FIELD)
+    return length;
+}
+
+uint8_t packet_codec_decode_d7atp_header(packet_t* packet, bool is_request, const uint8_t* data, uint8_t size)
+{
+    uint8_t length = HEADER_LENGTH(D7ATP_HEADER_CONTROL);
+    if (length > size)
+        return 0;
+
+    D7ATP_HEADER_CONTROL(DECODE_FIELD)
+
+    length += HEADER_LENGTH(D7ATP_HEADER_FIELDS);
+    if (length > size)
+        return 0;
+
+    D7ATP_HEADER_FIELDS(DECODE_FIELD)
+
+    length += HEADER_LENGTH(D7ATP_HEADER_ACK_RECORD_COUNT);
+    if (length > size)
+        return 0;
+
+    D7ATP_HEADER_ACK_RECORD_COUNT(DECODE_FIELD)
+#if defined(MODULE_D7AP_ACK_RECORD_ENABLED)
+    if (D7ATP_HAS_ACK_RECORD(packet) && packet->d7atp_ack_template.ack_record_count > D7ATP_ACK_RECORD_SIZE)
+        return 0;
+#endif
+
+    length += HEADER_LENGTH(D7ATP_HEADER_ACK_RECORD);
+    if (length > size)
+        return 0;
+
+    D7ATP_HEADER_ACK_RECORD(DECODE_FIELD)
+    return length;
+}
+
+uint8_t packet_codec_nls_auth_length(uint8_t nls_method)
+{
+    switch (nls_method)
+    {
+    case AES_NONE:
+    case AES_CTR:
+        return 0;
+    case AES_CBC_MAC_128:
+    case AES_CCM_128:
+        return 16;
+    case AES_CBC_MAC_64:
+    case AES_CCM_64:
+        return 8;
+    case AES_CBC_MAC_32:
+    case AES_CCM_32:
+        return 4;
+    default:
+        assert(false);
+    }
+}
+
+void packet_codec_build_nls_iv(packet_t* packet, uint8_t payload_len, uint8_t* iv)
+{
+    /*
+     * According DASH7 specification, the initialization vector is defined  as (LSB first):
+     * IV: Block counter | NLS Method | Key counter | Frame counter | Origin ID | Control extension | Payload length
+     */
+
+    memset(iv, 0, AES_BLOCK_SIZE);
+
+    /* AES-CTR/AES-CCM Initialization Vector (IV)*/
+    iv[0] = SET_NLS_METHOD(packet->d7anp_ctrl.nls_method);
+    iv[1] = packet->d7anp_security.key_counter;
+    ENCODE_BE32(&iv[2], packet->d7anp_security.frame_counter, 4);
+    /* When Origin ID is not provided in the NWL frame, it is provided by upper layer.*/
+    memcpy(iv + 6, packet->origin_access_id, packet->d7anp_ctrl.origin_id_type == ID_TYPE_VID ? 2 : 8);
+    iv[14] = packet->d7anp_ctrl.raw;
+    iv[15] = payload_len;
+}
+
+void packet_codec_set_nls_iv_frame_counter(uint8_t* iv, uint32_t frame_counter)
+{
+    ENCODE_BE32(&iv[2], frame_counter, 4);
+}
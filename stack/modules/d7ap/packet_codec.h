@@ -0,0 +1,62 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*! \file packet_codec.h
+ * \addtogroup Packet_codec
+ * \ingroup D7AP
+ * @{
+ * \brief Encoders and decoders for the DLL, D7ANP and D7ATP frame headers.
+ *
+ * The headers are described once as a list of fields in packet_codec.c, the encoders and decoders are generated from
+ * this description. The codecs only (de)serialize the fields of a [packet](@ref packet_t), filtering and security
+ * processing remain the responsibility of the layers.
+ * All functions return the length of the header, or 0 when the header does not fit in the provided size.
+ */
+
+#ifndef OSS_7_PACKET_CODEC_H
+#define OSS_7_PACKET_CODEC_H
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#include "packet.h"
+
+/*! Encodes the DLL header. A background frame header does not contain the target address. */
+uint8_t packet_codec_encode_dll_header(packet_t* packet, bool background, uint8_t* data, uint8_t size);
+uint8_t packet_codec_decode_dll_header(packet_t* packet, bool background, const uint8_t* data, uint8_t size);
+
+/*! Encodes the D7ANP header, the origin ID is taken from packet->origin_access_id */
+uint8_t packet_codec_encode_d7anp_header(packet_t* packet, uint8_t* data, uint8_t size);
+uint8_t packet_codec_decode_d7anp_header(packet_t* packet, const uint8_t* data, uint8_t size);
+
+/*! Encodes the D7ATP header. The response period Tc is only part of a request, the ACK template is taken from packet->d7atp_ack_template */
+uint8_t packet_codec_encode_d7atp_header(packet_t* packet, bool is_request, uint8_t* data, uint8_t size);
+uint8_t packet_codec_decode_d7atp_header(packet_t* packet, bool is_request, const uint8_t* data, uint8_t size);
+
+/*! Returns the length of the authentication tag appended to the payload by the NLS method */
+uint8_t packet_codec_nls_auth_length(uint8_t nls_method);
+
+/*! Builds the AES-CTR / AES-CCM initialization vector of a secured frame from the decoded D7ANP header fields */
+void packet_codec_build_nls_iv(packet_t* packet, uint8_t payload_len, uint8_t* iv);
+
+/*! Replaces the frame counter in an initialization vector built by packet_codec_build_nls_iv() */
+void packet_codec_set_nls_iv_frame_counter(uint8_t* iv, uint32_t frame_counter);
+
+#endif //OSS_7_PACKET_CODEC_H
+
+/** @}*/
@@ -42,6 +42,8 @@
 #include "packet_queue.h"
 #include "MODULE_D7AP_defs.h"
 #include "d7ap_fs.h"
+#include "trace.h"
+#include "bg_scan_control.h"
 
 #if defined(FRAMEWORK_LOG_ENABLED) && defined(MODULE_D7AP_PHY_LOG_ENABLED)
 #define DPRINT(...) log_print_stack_string(LOG_STACK_PHY, __VA_ARGS__)
@@ -156,6 +158,10 @@ static uint32_t rx_bw_normal_rate;
 static uint32_t rx_bw_hi_rate;
 static bool fact_settings_changed = false;
 
+static rssi_valid_callback_t energy_scan_callback;
+static int16_t energy_scan_rssi;
+static void signal_energy_scan(void *arg);
+
 static uint32_t bitrate_lo_rate;
 static uint32_t fdev_lo_rate;
 static uint32_t bitrate_normal_rate;
@@ -246,6 +252,24 @@ const uint8_t bg_timeout[4] = {
     To_CLASS_HI_RATE
 };
 
+#define BG_SCAN_MAX_LISTEN_TIMEOUT_MARGIN 40
+
+#ifdef MODULE_D7AP_ADAPTIVE_BG_SCAN_ENABLED
+typedef struct
+{
+    channel_id_t channel_id;
+    bg_scan_control_t control;
+} bg_scan_channel_t;
+
+static bg_scan_channel_t bg_scan_channels[PHY_STATUS_MAX_CHANNELS];
+static uint8_t bg_scan_channel_count = 0;
+
+// set while listening for a background frame after the RSSI triggered the scan
+static bg_scan_control_t* triggered_bg_scan_control = NULL;
+static int16_t bg_scan_trigger_rssi;
+static timer_tick_t bg_scan_trigger_time;
+#endif
+
 uint16_t end_time;
 /*!
  * D7A timer used to expire the continuous TX
@@ -267,16 +291,73 @@ static void release_packet(hw_radio_packet_t* hw_radio_packet)
     packet_queue_free_packet(packet_queue_find_packet(hw_radio_packet));
 }
 
+#ifdef MODULE_D7AP_ADAPTIVE_BG_SCAN_ENABLED
+static bg_scan_control_t* get_bg_scan_control(const channel_id_t* channel_id)
+{
+    for (uint8_t i = 0; i < bg_scan_channel_count; i++)
+    {
+        if (phy_radio_channel_ids_equal(&bg_scan_channels[i].channel_id, channel_id))
+            return &bg_scan_channels[i].control;
+    }
+
+    if (bg_scan_channel_count == PHY_STATUS_MAX_CHANNELS)
+        return NULL; // use the fixed threshold and timeout for the remaining channels
+
+    bg_scan_channel_t* bg_scan_channel = &bg_scan_channels[bg_scan_channel_count++];
+    bg_scan_channel->channel_id = *channel_id;
+    uint8_t To = bg_timeout[channel_id->channel_header.ch_class];
+    bg_scan_control_init(&bg_scan_channel->control, To, To + BG_SCAN_MAX_LISTEN_TIMEOUT_MARGIN);
+    return &bg_scan_channel->control;
+}
+
+/*
+ * The detection delay is the time between the trigger and the sync word of the background frame. The frame is
+ * timestamped when it is completely received, so its duration after the sync word is deducted: the listen timeout
+ * only has to cover the detection delay, To leaves the time to receive the rest of the frame.
+ */
+static void report_bg_scan_trigger(bool detected, timer_tick_t frame_received_time)
+{
+    if (triggered_bg_scan_control == NULL)
+        return;
+
+    timer_tick_t delay = 0;
+    if (detected)
+    {
+        uint16_t frame_duration = phy_calculate_tx_duration(current_channel_id.channel_header.ch_class,
+                                                            current_channel_id.channel_header.ch_coding,
+                                                            BACKGROUND_FRAME_LENGTH, true);
+        timer_tick_t sync_detected_time = frame_received_time - frame_duration;
+        if ((int32_t)(sync_detected_time - bg_scan_trigger_time) > 0)
+            delay = sync_detected_time - bg_scan_trigger_time;
+    }
+
+    bg_scan_control_report_trigger(triggered_bg_scan_control, bg_scan_trigger_rssi, detected,
+                                   delay > UINT8_MAX ? UINT8_MAX : delay);
+    triggered_bg_scan_control = NULL;
+}
+#endif
+
+static void switch_state(state_t new_state)
+{
+#ifdef MODULE_D7AP_ADAPTIVE_BG_SCAN_ENABLED
+    // leaving the scan, or starting the next one, without a detected background frame
+    report_bg_scan_trigger(false, 0);
+#endif
+
+    state = new_state;
+    trace_record(TRACE_PHY_STATE, new_state, 0);
+}
+
 void phy_switch_to_standby_mode()
 {
     hw_radio_set_opmode(HW_STATE_STANDBY);
-    state = STATE_IDLE;
+    switch_state(STATE_IDLE);
 }
 
 void phy_switch_to_sleep_mode()
 {
     hw_radio_set_idle();
-    state = STATE_IDLE;
+    switch_state(STATE_IDLE);
 }
 
 static void packet_transmitted(timer_tick_t timestamp)
@@ -285,6 +366,7 @@ static void packet_transmitted(timer_tick_t timestamp)
 
     current_packet->tx_meta.timestamp = timestamp;
     DPRINT("Transmitted packet @ %i with length = %i", current_packet->tx_meta.timestamp, current_packet->length);
+    trace_record(TRACE_PACKET_TX, current_channel_id.center_freq_index, current_packet->length);
 
     phy_switch_to_standby_mode();
 
@@ -325,6 +407,7 @@ static void packet_received(hw_radio_packet_t* hw_radio_packet)
     if(packet->type != BACKGROUND_ADV)
         total_succeeded_fg++;
 
+    trace_record(TRACE_PACKET_RX, current_channel_id.center_freq_index, hw_radio_packet->length);
     DPRINT("RX packet fully decoded <len = %d>", hw_radio_packet->length);
     DPRINT_DATA(hw_radio_packet->data, hw_radio_packet->length);
 
@@ -332,7 +415,12 @@ static void packet_received(hw_radio_packet_t* hw_radio_packet)
     memcpy(&(packet->phy_config.rx.channel_id), &current_channel_id, sizeof(channel_id_t));
 
     if (state == STATE_BG_SCAN)
+    {
+#ifdef MODULE_D7AP_ADAPTIVE_BG_SCAN_ENABLED
+        report_bg_scan_trigger(true, hw_radio_packet->rx_meta.timestamp);
+#endif
         phy_switch_to_standby_mode();
+    }
 
     // in case of FG scan, reception is continuous until upper layer decides to stop it
 
@@ -381,7 +469,7 @@ bool phy_radio_channel_ids_equal(const channel_id_t* a, const channel_id_t* b)
 
 uint16_t phy_calculate_tx_duration(phy_channel_class_t channel_class, phy_coding_t ch_coding, uint16_t packet_length, bool payload_only)
 {
-    double data_rate = 6.0; // Normal rate: 6.9 bytes/tick
+    uint16_t data_rate = 60; // expressed in bytes per 10 ticks to prevent floating point arithmetic
 
     if (ch_coding == PHY_CODING_FEC_PN9)
         packet_length = fec_calculated_decoded_length(packet_length);
@@ -406,25 +494,25 @@ uint16_t phy_calculate_tx_duration(phy_channel_class_t channel_class, phy_coding
         if(!payload_only)
           packet_length += PREAMBLE_LOW_RATE_CLASS;
 
-        data_rate = 1.2; // Lo Rate 9.6 kbps: 1.2 bytes/tick
+        data_rate = 12; // Lo Rate 9.6 kbps: 1.2 bytes/tick
         break;
     case PHY_CLASS_NORMAL_RATE:
         if(!payload_only)
           packet_length += PREAMBLE_NORMAL_RATE_CLASS;
 
-        data_rate = 6.9; // Normal Rate 55.555 kbps: 6.94 bytes/tick
+        data_rate = 69; // Normal Rate 55.555 kbps: 6.94 bytes/tick
         break;
     case PHY_CLASS_HI_RATE:
         if(!payload_only)
           packet_length += PREAMBLE_HI_RATE_CLASS;
 
-        data_rate = 20.8; // High rate 166.667 kbps: 20.83 byte/tick
+        data_rate = 208; // High rate 166.667 kbps: 20.83 byte/tick
         break;
     }
 
     // TODO Add the power ramp-up/ramp-down symbols in the packet length?
 
-    return ceil(packet_length / data_rate) + 1;
+    return ((uint32_t)packet_length * 10 + data_rate - 1) / data_rate + 1; // ceil(packet_length / data_rate) + 1
 }
 
 static void configure_eirp(eirp_t eirp)
@@ -634,6 +722,7 @@ error_t phy_init(void) {
     //while(hw_radio_get_opmode() != OPMODE_STANDBY) {}
 
     timer_init_event(&continuous_tx_expiration_timer, &continuous_tx_expiration);
+    sched_register_task(&signal_energy_scan);
 
     return ret;
 }
@@ -683,12 +772,17 @@ error_t phy_start_rx(channel_id_t* channel, syncword_class_t syncword_class, phy
 
     status_write();
 
-    state = STATE_RX;
+    switch_state(STATE_RX);
     hw_radio_set_opmode(HW_STATE_RX);
 
     return SUCCESS;
 }
 
+static void signal_energy_scan(void *arg)
+{
+    energy_scan_callback(energy_scan_rssi);
+}
+
 error_t phy_start_energy_scan(channel_id_t* channel, rssi_valid_callback_t rssi_cb, int16_t scan_duration)
 {
     // We should not initiate a RSSI measurement before TX is completed
@@ -699,14 +793,22 @@ error_t phy_start_energy_scan(channel_id_t* channel, rssi_valid_callback_t rssi_
     hw_radio_set_payload_length(0x00); // unlimited length mode
 
     // switch to RX since the RSSI measurement is done in RX mode
-    state = STATE_RX;
+    switch_state(STATE_RX);
 
     //FIXME support asynchronous RSSI and scan duration
     //uint8_t rssi_samples = scan_duration
     //hw_radio_set_rssi_smoothing(rssi_samples);
 
-    int16_t rssi = hw_radio_get_rssi();
-    rssi_cb(rssi);
+    if (hw_radio_start_rssi_measurement)
+    {
+        hw_radio_start_rssi_measurement(rssi_cb);
+        return SUCCESS;
+    }
+
+    // the callback is always invoked from a task, also when the scan is started from a precise lane of the timer
+    energy_scan_rssi = hw_radio_get_rssi();
+    energy_scan_callback = rssi_cb;
+    sched_post_task_prio(&signal_energy_scan, MAX_PRIORITY, NULL);
 
     return SUCCESS;
 }
@@ -760,7 +862,7 @@ error_t phy_send_packet(hw_radio_packet_t* packet, phy_tx_config_t* config, phy_
     configure_eirp(config->eirp);
     configure_syncword(config->syncword_class, &config->channel_id);
 
-    state = STATE_TX;
+    switch_state(STATE_TX);
 
     DPRINT("BEFORE ENCODING TX len=%i", packet->length);
     DPRINT_DATA(packet->data, packet->length);
@@ -902,7 +1004,7 @@ error_t phy_send_packet_with_advertising(hw_radio_packet_t* packet, phy_tx_confi
     bg_adv.stop_time = start + eta + bg_adv.tx_duration + FG_SCAN_STARTUP_TIME + 4; // Tadv = Tsched + Ttx + Tfg_startup + Tcalc
     DPRINT("BG Tadv %i (start time @ %i stop time @ %i)", eta + bg_adv.tx_duration, start, bg_adv.stop_time);
 
-    state = STATE_TX;
+    switch_state(STATE_TX);
     DEBUG_RX_END();
     DEBUG_TX_START();
     DEBUG_BG_START();
@@ -997,7 +1099,7 @@ error_t phy_start_background_scan(phy_rx_config_t* config, phy_rx_packet_callbac
     // We should not initiate a background scan before TX is completed
     assert(state != STATE_TX);
 
-    state = STATE_BG_SCAN;
+    switch_state(STATE_BG_SCAN);
 
     configure_syncword(PHY_SYNCWORD_CLASS0, &config->channel_id);
     configure_channel(&config->channel_id);
@@ -1012,12 +1114,23 @@ error_t phy_start_background_scan(phy_rx_config_t* config, phy_rx_packet_callbac
 
     total_bg++;
 
+    int16_t rssi_thr = config->rssi_thr;
+    uint8_t listen_timeout = bg_timeout[current_channel_id.channel_header.ch_class] + BG_SCAN_MAX_LISTEN_TIMEOUT_MARGIN;
+#ifdef MODULE_D7AP_ADAPTIVE_BG_SCAN_ENABLED
+    bg_scan_control_t* control = get_bg_scan_control(&current_channel_id);
+    if (control)
+    {
+        rssi_thr = bg_scan_control_get_rssi_thr(control, rssi_thr);
+        listen_timeout = bg_scan_control_get_listen_timeout(control);
+    }
+#endif
+
     DEBUG_RX_START();
 
     int16_t rssi = hw_radio_get_rssi();
-    if (rssi <= config->rssi_thr)
+    if (rssi <= rssi_thr)
     {
-        DPRINT("FAST RX termination RSSI %i below limit %i\n", rssi, config->rssi_thr);
+        DPRINT("FAST RX termination RSSI %i below limit %i\n", rssi, rssi_thr);
         hw_radio_set_opmode(HW_STATE_SLEEP); //0.136ms + 0.066ms io_deinit = 0.207ms
         // TODO choose standby mode to allow rapid channel cycling
         //phy_switch_to_standby_mode();
@@ -1035,8 +1148,14 @@ error_t phy_start_background_scan(phy_rx_config_t* config, phy_rx_packet_callbac
 
     DPRINT("rssi %i, waiting for BG frame\n", rssi);
 
+#ifdef MODULE_D7AP_ADAPTIVE_BG_SCAN_ENABLED
+    triggered_bg_scan_control = control;
+    bg_scan_trigger_rssi = rssi;
+    bg_scan_trigger_time = timer_get_counter_value();
+#endif
+
     // the device has a period of To to successfully detect the sync word
-    hw_radio_set_rx_timeout(bg_timeout[current_channel_id.channel_header.ch_class] + 40); //TO DO: OPTIMISE THIS TIMEOUT
+    hw_radio_set_rx_timeout(listen_timeout);
     DEBUG_BG_START();
     hw_radio_set_opmode(HW_STATE_RX);
 
@@ -1061,7 +1180,7 @@ void phy_continuous_tx(phy_tx_config_t const* tx_cfg, uint8_t time_period, phy_t
     configure_syncword(tx_cfg->syncword_class, &tx_cfg->channel_id);
     hw_radio_enable_refill(true);
 
-    state = STATE_CONT_TX;
+    switch_state(STATE_CONT_TX);
     if(time_period) {
         continuous_tx_expiration_timer.next_event = time_period * 1024;
         timer_add_event(&continuous_tx_expiration_timer);
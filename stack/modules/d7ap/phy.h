@@ -270,7 +270,8 @@ error_t phy_stop_rx();
 /** \brief Start the energy scan sequence on the radio.
  *
  * \param channel_id   The channel to perform the energy scan on.
- * \param rssi_cb      The rssi_valid_callback_t function to call whenever the energy scan is complete.
+ * \param rssi_cb      The rssi_valid_callback_t function to call whenever the energy scan is complete, it is always
+ *                     invoked from a task.
  * \param cca_duration The duration, in milliseconds, for the channel to be scanned.
  *
  * \return error_t SUCCESS Successfully started scanning the channel.
@@ -68,12 +68,46 @@ static uint8_t file_buffer[FILE_SIZE_MAX]; // statically allocated buffer used d
 static d7ap_fs_modified_file_callback_t file_modified_callbacks[FRAMEWORK_FS_FILE_COUNT] = { NULL }; // TODO limit to lower number so save RAM?
 static d7ap_fs_modifying_file_callback_t file_modifying_callbacks[FRAMEWORK_FS_FILE_COUNT] = { NULL };
 
+#define IS_ACCESS_PROFILE_FILE(file_id) ((file_id) >= D7A_FILE_ACCESS_PROFILE_ID && (file_id) < D7A_FILE_ACCESS_PROFILE_ID + D7A_FILE_ACCESS_PROFILE_COUNT)
+
+// decoded (native endian) copy of the access profile files, so switching access class does not require reading the files
+static dae_access_profile_t access_profile_cache[D7A_FILE_ACCESS_PROFILE_COUNT];
+static int access_profile_cache_status[D7A_FILE_ACCESS_PROFILE_COUNT]; // result of reading the file, the cached profile is only meaningful on SUCCESS
+static uint16_t access_profile_cache_valid = 0; // bitmap of the entries which are up to date
+
 static inline bool is_file_defined(uint8_t file_id)
 {
     fs_file_stat_t *stat = fs_file_stat(file_id);
     return (stat != NULL);
 }
 
+static void update_access_profile_cache(uint8_t access_class_index)
+{
+  uint8_t file_id = D7A_FILE_ACCESS_PROFILE_ID + access_class_index;
+  dae_access_profile_t* access_profile = &access_profile_cache[access_class_index];
+  d7ap_fs_file_header_t header;
+  uint32_t length = D7A_FILE_ACCESS_PROFILE_SIZE;
+
+  access_profile_cache_valid |= (1 << access_class_index);
+
+  int rtc = d7ap_fs_read_file_header(file_id, &header);
+  if(rtc != SUCCESS) {
+    access_profile_cache_status[access_class_index] = rtc;
+    return;
+  }
+
+  // read the body directly instead of using d7ap_fs_read_file(), so caching does not trigger the action protocol
+  if(header.length < length)
+    length = header.length;
+
+  memset(access_profile, 0, sizeof(dae_access_profile_t));
+  access_profile_cache_status[access_class_index] = fs_read_file(file_id, sizeof(d7ap_fs_file_header_t), (uint8_t*)access_profile, length);
+  for(int i=0; i<SUBBANDS_NB; i++) {
+    access_profile->subbands[i].channel_index_start = __builtin_bswap16(access_profile->subbands[i].channel_index_start);
+    access_profile->subbands[i].channel_index_end = __builtin_bswap16(access_profile->subbands[i].channel_index_end);
+  }
+}
+
 #if defined(MODULE_ALP) && defined(MODULE_D7AP)
 static int execute_d7a_action_protocol(uint8_t action_file_id, uint8_t interface_file_id)
 {
@@ -99,11 +133,110 @@ static int execute_d7a_action_protocol(uint8_t action_file_id, uint8_t interface
 }
 #endif // defined(MODULE_ALP) && defined(MODULE_D7AP)
 
+#define CIRCULAR_DATA_OFFSET (sizeof(d7ap_fs_file_header_t))
+#define CIRCULAR_SLOT_OFFSET(slot) (CIRCULAR_DATA_OFFSET + 2 + (slot) * D7AP_FS_CIRCULAR_SLOT_SIZE)
+#define CIRCULAR_RECORDS_OFFSET (CIRCULAR_DATA_OFFSET + D7AP_FS_CIRCULAR_HEADER_SIZE)
+
+typedef struct {
+  uint16_t record_size;
+  uint32_t capacity;
+  uint32_t head;
+  uint32_t tail;
+} circular_state_t;
+
+static uint32_t decode_be32(const uint8_t* data)
+{
+  return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+static void encode_be32(uint8_t* data, uint32_t value)
+{
+  data[0] = value >> 24;
+  data[1] = value >> 16;
+  data[2] = value >> 8;
+  data[3] = value;
+}
+
+static int read_circular_state(uint8_t file_id, const d7ap_fs_file_header_t* header, circular_state_t* state)
+{
+  uint8_t data[D7AP_FS_CIRCULAR_HEADER_SIZE];
+  int rtc = fs_read_file(file_id, CIRCULAR_DATA_OFFSET, data, D7AP_FS_CIRCULAR_HEADER_SIZE);
+  if(rtc != SUCCESS)
+    return rtc;
+
+  state->record_size = (data[0] << 8) | data[1];
+  if(state->record_size == 0 || header->allocated_length < D7AP_FS_CIRCULAR_FILE_SIZE(state->record_size, 1))
+    return -EINVAL;
+
+  state->capacity = (header->allocated_length - D7AP_FS_CIRCULAR_HEADER_SIZE) / state->record_size;
+  state->head = 0;
+  state->tail = 0;
+  for(uint8_t slot = 0; slot < D7AP_FS_CIRCULAR_HEADER_SLOTS; slot++) {
+    uint32_t head = decode_be32(data + 2 + slot * D7AP_FS_CIRCULAR_SLOT_SIZE);
+    uint32_t tail = decode_be32(data + 2 + slot * D7AP_FS_CIRCULAR_SLOT_SIZE + 4);
+    // head n is always written in slot n % D7AP_FS_CIRCULAR_HEADER_SLOTS, a slot which does not match was not
+    // completely programmed (f.e. because of a reset during the append) and is skipped
+    if(head >= D7AP_FS_LAST_RECORDS_FLAG || head % D7AP_FS_CIRCULAR_HEADER_SLOTS != slot || tail > head
+       || head - tail > state->capacity)
+      continue;
+
+    if(head > state->head) {
+      state->head = head;
+      state->tail = tail;
+    }
+  }
+
+  return SUCCESS;
+}
+
+static int read_records(uint8_t file_id, const d7ap_fs_file_header_t* header, uint32_t* offset, uint8_t* buffer, uint32_t* length)
+{
+  circular_state_t state;
+  int rtc = read_circular_state(file_id, header, &state);
+  if(rtc != SUCCESS)
+    return rtc;
+
+  uint32_t first;
+  if(*offset & D7AP_FS_LAST_RECORDS_FLAG) {
+    uint32_t count = *offset & ~D7AP_FS_LAST_RECORDS_FLAG;
+    first = (count < state.head - state.tail) ? state.head - count : state.tail;
+  } else {
+    if(*offset > state.head)
+      return -EINVAL;
+
+    first = (*offset < state.tail) ? state.tail : *offset;
+  }
+
+  uint32_t count = *length / state.record_size;
+  if(count > state.head - first)
+    count = state.head - first;
+
+  *offset = first;
+  *length = count * state.record_size;
+
+  // the records are contiguous, except when they wrap around the end of the file
+  uint32_t position = first % state.capacity;
+  uint32_t count_until_end = state.capacity - position;
+  if(count_until_end > count)
+    count_until_end = count;
+
+  rtc = fs_read_file(file_id, CIRCULAR_RECORDS_OFFSET + position * state.record_size, buffer, count_until_end * state.record_size);
+  if(rtc != SUCCESS || count_until_end == count)
+    return rtc;
+
+  return fs_read_file(file_id, CIRCULAR_RECORDS_OFFSET, buffer + count_until_end * state.record_size,
+                      (count - count_until_end) * state.record_size);
+}
+
 void d7ap_fs_init()
 {
   //init fs with the D7A specific system files
   fs_init();
 
+  access_profile_cache_valid = 0;
+  for(uint8_t i = 0; i < D7A_FILE_ACCESS_PROFILE_COUNT; i++)
+    update_access_profile_cache(i);
+
   // TODO platform specific
   // TODO set FW version
 
@@ -131,17 +264,17 @@ void d7ap_fs_init()
   d7ap_fs_write_file(D7A_FILE_FIRMWARE_VERSION_FILE_ID, 4, firmware_version, D7A_FILE_FIRMWARE_VERSION_APP_NAME_SIZE + D7A_FILE_FIRMWARE_VERSION_GIT_SHA1_SIZE, ROOT_AUTH);
 }
 
-int d7ap_fs_init_file(uint8_t file_id, const d7ap_fs_file_header_t* file_header, const uint8_t* initial_data)
+static fs_blockdevice_types_t default_blockdevice(const d7ap_fs_file_header_t* file_header)
 {
     // init on default permanent or volatile blockdevice based on requested storage class
-    fs_blockdevice_types_t bd_type = (file_header->file_properties.storage_class == FS_STORAGE_VOLATILE)
+    return (file_header->file_properties.storage_class == FS_STORAGE_VOLATILE)
         ? FS_BLOCKDEVICE_TYPE_VOLATILE
         : FS_BLOCKDEVICE_TYPE_PERMANENT;
-    return d7ap_fs_init_file_on_blockdevice(file_id, bd_type, file_header, initial_data);
 }
 
-int d7ap_fs_init_file_on_blockdevice(
-    uint8_t file_id, uint8_t blockdevice_index, const d7ap_fs_file_header_t* file_header, const uint8_t* initial_data)
+// initial_data_length can be smaller than the length in the header, the remaining data is not initialized
+static int init_file(uint8_t file_id, uint8_t blockdevice_index, const d7ap_fs_file_header_t* file_header,
+    const uint8_t* initial_data, uint32_t initial_data_length)
 {
     DPRINT("FS init %i, alloc %i", file_id, file_header->allocated_length);
     
@@ -153,16 +286,140 @@ int d7ap_fs_init_file_on_blockdevice(
     memcpy(file_buffer, (uint8_t *)&file_header_big_endian, sizeof (d7ap_fs_file_header_t));
     uint32_t length = sizeof(d7ap_fs_file_header_t);
     if(initial_data != NULL) {
-        length += file_header->length;
+        length += initial_data_length;
         if(length > FILE_SIZE_MAX)
           return -EFBIG;
-        memcpy(file_buffer + sizeof(d7ap_fs_file_header_t), initial_data, file_header->length);
+        memcpy(file_buffer + sizeof(d7ap_fs_file_header_t), initial_data, initial_data_length);
     }
        
-    return fs_init_file(file_id, blockdevice_index, (const uint8_t *)file_buffer, length, sizeof(d7ap_fs_file_header_t) + file_header->allocated_length);
+    int rc = fs_init_file(file_id, blockdevice_index, (const uint8_t *)file_buffer, length, sizeof(d7ap_fs_file_header_t) + file_header->allocated_length);
+    if(IS_ACCESS_PROFILE_FILE(file_id))
+      update_access_profile_cache(file_id - D7A_FILE_ACCESS_PROFILE_ID);
+
+    return rc;
+}
+
+int d7ap_fs_init_file(uint8_t file_id, const d7ap_fs_file_header_t* file_header, const uint8_t* initial_data)
+{
+    return d7ap_fs_init_file_on_blockdevice(file_id, default_blockdevice(file_header), file_header, initial_data);
+}
+
+int d7ap_fs_init_file_on_blockdevice(
+    uint8_t file_id, uint8_t blockdevice_index, const d7ap_fs_file_header_t* file_header, const uint8_t* initial_data)
+{
+    return init_file(file_id, blockdevice_index, file_header, initial_data, file_header->length);
+}
+
+int d7ap_fs_init_circular_file(uint8_t file_id, const d7ap_fs_file_header_t* file_header, uint16_t record_size)
+{
+    if(record_size == 0 || file_header->allocated_length < D7AP_FS_CIRCULAR_FILE_SIZE(record_size, 1))
+        return -EINVAL;
+
+    d7ap_fs_file_header_t header;
+    memcpy(&header, file_header, sizeof(d7ap_fs_file_header_t));
+    header.file_properties.circular = true;
+    header.length = header.allocated_length;
+
+    // only the circular header is initialized, the records are not valid until they are appended
+    uint8_t circular_header[D7AP_FS_CIRCULAR_HEADER_SIZE] = { 0 };
+    circular_header[0] = record_size >> 8;
+    circular_header[1] = record_size & 0xFF;
+    return init_file(file_id, default_blockdevice(&header), &header, circular_header, D7AP_FS_CIRCULAR_HEADER_SIZE);
+}
+
+int d7ap_fs_append_record(uint8_t file_id, const uint8_t* record, authentication_t auth)
+{
+  int rtc;
+  d7ap_fs_file_header_t header;
+  circular_state_t state;
+
+  DPRINT("FS APPEND %i\n", file_id);
+
+  if(!is_file_defined(file_id)) return -ENOENT;
+
+  rtc = d7ap_fs_read_file_header(file_id, &header);
+  if (rtc != 0)
+    return rtc;
+
+  if(!header.file_properties.circular)
+    return -EINVAL;
+
+#ifndef MODULE_D7AP_FS_DISABLE_PERMISSIONS
+  if(((auth == USER_AUTH) && (!header.file_permissions.user_write)) || ((auth == GUEST_AUTH) && (!header.file_permissions.guest_write)))
+    return -EACCES;
+#endif
+
+  rtc = read_circular_state(file_id, &header, &state);
+  if (rtc != 0)
+    return rtc;
+
+  if(state.head == D7AP_FS_LAST_RECORDS_FLAG - 1)
+    return -ENOSPC; // the next index can no longer be addressed
+
+  // the offset passed to the modifying callback is the index of the record
+  if (file_modifying_callbacks[file_id])
+      if (!file_modifying_callbacks[file_id](file_id, state.head, record, state.record_size))
+          return -EILSEQ;
+
+  // the record is programmed first, so a reset before the counters are updated loses only this record
+  rtc = fs_write_file(file_id, CIRCULAR_RECORDS_OFFSET + (state.head % state.capacity) * state.record_size, record, state.record_size);
+  if (rtc != 0)
+    return rtc;
+
+  state.head++;
+  if(state.head - state.tail > state.capacity)
+    state.tail = state.head - state.capacity;
+
+  uint8_t slot[D7AP_FS_CIRCULAR_SLOT_SIZE];
+  encode_be32(slot, state.head);
+  encode_be32(slot + 4, state.tail);
+  rtc = fs_write_file(file_id, CIRCULAR_SLOT_OFFSET(state.head % D7AP_FS_CIRCULAR_HEADER_SLOTS), slot, D7AP_FS_CIRCULAR_SLOT_SIZE);
+  if (rtc != 0)
+    return rtc;
+
+#if defined(MODULE_ALP) && defined(MODULE_D7AP)
+  if(header.file_properties.action_protocol_enabled == true
+    && header.file_properties.action_condition == D7A_ACT_COND_WRITE)
+  {
+    rtc = execute_d7a_action_protocol(header.action_file_id, header.interface_file_id);
+    if(rtc != SUCCESS)
+      return rtc;
+  }
+#endif // defined(MODULE_ALP) && defined(MODULE_D7AP)
+
+  if (file_modified_callbacks[file_id])
+      file_modified_callbacks[file_id](file_id);
+
+  return 0;
+}
+
+int d7ap_fs_read_record_range(uint8_t file_id, uint32_t* tail, uint32_t* head)
+{
+  d7ap_fs_file_header_t header;
+  circular_state_t state;
+
+  int rtc = d7ap_fs_read_file_header(file_id, &header);
+  if (rtc != 0)
+    return rtc;
+
+  if(!header.file_properties.circular)
+    return -EINVAL;
+
+  rtc = read_circular_state(file_id, &header, &state);
+  if (rtc != 0)
+    return rtc;
+
+  *tail = state.tail;
+  *head = state.head;
+  return 0;
 }
 
 int d7ap_fs_read_file(uint8_t file_id, uint32_t offset, uint8_t* buffer, uint32_t* length, authentication_t auth)
+{
+  return d7ap_fs_read_file_at(file_id, &offset, buffer, length, auth);
+}
+
+int d7ap_fs_read_file_at(uint8_t file_id, uint32_t* offset, uint8_t* buffer, uint32_t* length, authentication_t auth)
 {
   int rtc;
   d7ap_fs_file_header_t header;
@@ -175,12 +432,12 @@ int d7ap_fs_read_file(uint8_t file_id, uint32_t offset, uint8_t* buffer, uint32_
   if (rtc != 0)
     return rtc;
 
-  if(header.length < offset + *length)
+  if(!header.file_properties.circular && header.length < *offset + *length)
   {
-    if(header.length < offset)
+    if(header.length < *offset)
       return -EINVAL;
     else
-      *length = header.length - offset;
+      *length = header.length - *offset;
   }
 
 #ifndef MODULE_D7AP_FS_DISABLE_PERMISSIONS
@@ -188,7 +445,11 @@ int d7ap_fs_read_file(uint8_t file_id, uint32_t offset, uint8_t* buffer, uint32_
     return -EACCES;
 #endif
 
-  rtc = fs_read_file(file_id, sizeof(d7ap_fs_file_header_t) + offset, buffer, *length);
+  if(header.file_properties.circular)
+    rtc = read_records(file_id, &header, offset, buffer, length);
+  else
+    rtc = fs_read_file(file_id, sizeof(d7ap_fs_file_header_t) + *offset, buffer, *length);
+
   if (rtc != 0)
     return rtc;
 
@@ -242,7 +503,11 @@ int d7ap_fs_write_file_header(uint8_t file_id, d7ap_fs_file_header_t* file_heade
   file_header->allocated_length = __builtin_bswap32(file_header->allocated_length);
 #endif
 
-  return (fs_write_file(file_id, 0, (const uint8_t*)file_header, sizeof(d7ap_fs_file_header_t)));
+  int rtc = fs_write_file(file_id, 0, (const uint8_t*)file_header, sizeof(d7ap_fs_file_header_t));
+  if(IS_ACCESS_PROFILE_FILE(file_id))
+    update_access_profile_cache(file_id - D7A_FILE_ACCESS_PROFILE_ID); // length or permissions might have changed
+
+  return rtc;
 }
 
 int d7ap_fs_write_file(uint8_t file_id, uint32_t offset, const uint8_t* buffer, uint32_t length, authentication_t auth)
@@ -263,7 +528,7 @@ int d7ap_fs_write_file_with_callback(uint8_t file_id, uint32_t offset, const uin
   if (rtc != 0)
     return rtc;
 
-  if(header.length < offset + length)
+  if(header.length < offset + length || header.file_properties.circular)
     return -EINVAL;
   
 #ifndef MODULE_D7AP_FS_DISABLE_PERMISSIONS
@@ -279,6 +544,10 @@ int d7ap_fs_write_file_with_callback(uint8_t file_id, uint32_t offset, const uin
   if (rtc != 0)
     return rtc;
 
+  // refresh the cache before any modified callback is called, so these observe the new access profile
+  if(IS_ACCESS_PROFILE_FILE(file_id))
+    update_access_profile_cache(file_id - D7A_FILE_ACCESS_PROFILE_ID);
+
 
 #if defined(MODULE_ALP) && defined(MODULE_D7AP)
   if(header.file_properties.action_protocol_enabled == true
@@ -405,23 +674,20 @@ int d7ap_fs_update_nwl_security_state_register(dae_nwl_trusted_node_t *trusted_n
 
 int d7ap_fs_read_access_class(uint8_t access_class_index, dae_access_profile_t *access_class)
 {
-  uint32_t length = D7A_FILE_ACCESS_PROFILE_SIZE;
-
-  if(access_class_index >= 15)
+  if(access_class_index >= D7A_FILE_ACCESS_PROFILE_COUNT)
     return -EFAULT;
-  if(!is_file_defined(D7A_FILE_ACCESS_PROFILE_ID + access_class_index))
-    return -ENOENT;
-  int result = d7ap_fs_read_file(D7A_FILE_ACCESS_PROFILE_ID + access_class_index, 0, (uint8_t*)access_class, &length, ROOT_AUTH);
-  for(int i=0; i<SUBBANDS_NB; i++) {
-    access_class->subbands[i].channel_index_start = __builtin_bswap16(access_class->subbands[i].channel_index_start);
-    access_class->subbands[i].channel_index_end = __builtin_bswap16(access_class->subbands[i].channel_index_end);
-  }
-  return result;
+
+  // served from the cache, which is kept up to date on every write of the access profile files
+  if(!(access_profile_cache_valid & (1 << access_class_index)))
+    update_access_profile_cache(access_class_index);
+
+  memcpy(access_class, &access_profile_cache[access_class_index], sizeof(dae_access_profile_t));
+  return access_profile_cache_status[access_class_index];
 }
 
 int d7ap_fs_write_access_class(uint8_t access_class_index, dae_access_profile_t* access_class)
 {
-  if(access_class_index >= 15)
+  if(access_class_index >= D7A_FILE_ACCESS_PROFILE_COUNT)
     return -EFAULT;
   if(!is_file_defined(D7A_FILE_ACCESS_PROFILE_ID + access_class_index))
     return -ENOENT;
@@ -0,0 +1,185 @@
+#include "request.h"
+#include "benchmark.h"
+#include "dll.h"
+#include "assert.h"
+#include "stdio.h"
+#include "string.h"
+
+// a gateway queries a group of nodes with a broadcast request in response mode ALL, the responders contend for the
+// channel during the response period using CSMA-CA
+#define QUERY_COUNT 2000
+#define GROUP_REQUEST_RETRY_LIMIT 4
+#define REQUEST_RECEIVED_PERCENT 90
+#define RESPONSE_RECEIVED_PERCENT 90
+#define REQUEST_PAYLOAD_SIZE 8
+#define RESPONSE_PAYLOAD_SIZE 10
+
+// responders which start within the CCA window of each other both find the channel free and collide
+#define CCA_WINDOW_MS 0.5
+
+// length, DLL header with the UID of the requester, D7ANP header with the UID of the responder, D7ATP header, CRC
+#define RESPONSE_LENGTH (1 + 2 + 8 + 2 + 8 + 3 + RESPONSE_PAYLOAD_SIZE + 2)
+
+#define MAX_RESPONDERS 32
+
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+typedef enum {
+    SINGLE_ATTEMPT,
+    RETRIED,
+    RETRIED_WITH_ACK_RECORD,
+    MODE_COUNT
+} query_mode_t;
+
+static const char* mode_names[MODE_COUNT] = { "single attempt", "retried", "retried, ACK record" };
+
+typedef struct {
+    uint32_t attempts;
+    uint32_t heard;
+    uint32_t duplicates;
+    double airtime;
+} result_t;
+
+// the responders which received the request and respond, contend for the channel in the response period
+static uint8_t contend(double tc, double response_airtime, const bool* responding, uint8_t responder_count,
+                       bool* delivered)
+{
+    double start[MAX_RESPONDERS];
+    bool transmitted[MAX_RESPONDERS] = { 0 };
+    uint8_t transmissions = 0;
+    for (uint8_t i = 0; i < responder_count; i++)
+        start[i] = responding[i] ? benchmark_random_time(tc - response_airtime) : -1;
+
+    // handle the responders in the order of their CCA, a responder which finds the channel busy backs off
+    while (true)
+    {
+        int8_t next = -1;
+        for (uint8_t i = 0; i < responder_count; i++)
+            if (start[i] >= 0 && !transmitted[i] && (next < 0 || start[i] < start[next]))
+                next = i;
+
+        if (next < 0)
+            break;
+
+        double busy_until = -1;
+        for (uint8_t i = 0; i < responder_count; i++)
+            if (transmitted[i] && start[i] + CCA_WINDOW_MS <= start[next] && start[next] < start[i] + response_airtime)
+                busy_until = start[i] + response_airtime;
+
+        if (busy_until < 0)
+        {
+            transmitted[next] = true;
+            transmissions++;
+        }
+        else if (busy_until < tc - response_airtime)
+            start[next] = busy_until + benchmark_random_time(tc - response_airtime - busy_until);
+        else
+            start[next] = -1; // the response period is over
+    }
+
+    for (uint8_t i = 0; i < responder_count; i++)
+    {
+        delivered[i] = transmitted[i];
+        for (uint8_t j = 0; j < responder_count; j++)
+            if (i != j && transmitted[j] && start[i] < start[j] + response_airtime && start[j] < start[i] + response_airtime)
+                delivered[i] = false;
+    }
+
+    return transmissions;
+}
+
+static result_t simulate(query_mode_t mode, uint8_t responder_count)
+{
+    result_t result = { 0 };
+    static packet_t request, decoded;
+    uint8_t data[32 + D7ATP_ACK_RECORD_MAX_LENGTH];
+    double response_airtime = benchmark_get_airtime(RESPONSE_LENGTH);
+    double tc = (SFc * responder_count + 1) * response_airtime + t_g;
+    benchmark_seed(BENCHMARK_SEED + responder_count); // the same links for all modes
+
+    for (uint32_t query = 0; query < QUERY_COUNT; query++)
+    {
+        bool heard[MAX_RESPONDERS] = { 0 };
+        uint8_t heard_count = 0;
+        memset(&request, 0, sizeof(packet_t));
+        request.d7atp_transaction_id = query;
+        uint8_t attempt_limit = mode == SINGLE_ATTEMPT ? 1 : GROUP_REQUEST_RETRY_LIMIT;
+        for (uint8_t attempt = 0; attempt < attempt_limit; attempt++)
+        {
+            result.attempts++;
+            uint8_t header_length = encode_request_header(&request, data, sizeof(data));
+            assert(packet_codec_decode_d7atp_header(&decoded, true, data, header_length) == header_length);
+            // length, DLL header without target, D7ANP header with the UID of the requester, D7ATP header, CRC
+            result.airtime += benchmark_get_airtime(1 + 2 + 2 + 8 + header_length + REQUEST_PAYLOAD_SIZE + 2);
+
+            bool responding[MAX_RESPONDERS];
+            for (uint8_t i = 0; i < responder_count; i++)
+                responding[i] = benchmark_received(REQUEST_RECEIVED_PERCENT) && !is_listed_in_ack_record(&decoded, i);
+
+            bool delivered[MAX_RESPONDERS];
+            uint8_t transmissions = contend(tc, response_airtime, responding, responder_count, delivered);
+            result.airtime += transmissions * response_airtime;
+
+            uint8_t new_responders = 0;
+            for (uint8_t i = 0; i < responder_count; i++)
+            {
+                if (!delivered[i] || !benchmark_received(RESPONSE_RECEIVED_PERCENT))
+                    continue;
+
+                if (heard[i])
+                {
+                    result.duplicates++;
+                    continue;
+                }
+
+                heard[i] = true;
+                heard_count++;
+                new_responders++;
+                if (mode == RETRIED_WITH_ACK_RECORD && request.d7atp_ack_template.ack_record_count < D7ATP_ACK_RECORD_SIZE)
+                    get_uid(i, request.d7atp_ack_template.ack_record[request.d7atp_ack_template.ack_record_count++]);
+            }
+
+            // the request is done when an attempt is not answered by any new responder
+            if (heard_count && !new_responders)
+                break;
+        }
+
+        result.heard += heard_count;
+    }
+
+    return result;
+}
+
+static void test_group_query(uint8_t responder_count)
+{
+    printf("%u responders:\n", responder_count);
+    result_t results[MODE_COUNT];
+    for (query_mode_t mode = 0; mode < MODE_COUNT; mode++)
+    {
+        results[mode] = simulate(mode, responder_count);
+        result_t* result = &results[mode];
+        printf("  %-20s %.2f attempts, %5.1f%% of the responders heard, %.2f duplicate responses, %.1f ms airtime per query\n",
+               mode_names[mode], (double)result->attempts / QUERY_COUNT, 100.0 * result->heard / (QUERY_COUNT * responder_count),
+               (double)result->duplicates / QUERY_COUNT, result->airtime / QUERY_COUNT);
+    }
+
+    // the responders which were heard do not respond again, which leaves the channel to the others
+    assert(results[RETRIED_WITH_ACK_RECORD].duplicates * 2 < results[RETRIED].duplicates);
+    assert(results[RETRIED_WITH_ACK_RECORD].heard >= results[RETRIED].heard);
+    assert(results[RETRIED_WITH_ACK_RECORD].heard > results[SINGLE_ATTEMPT].heard);
+    assert(results[RETRIED_WITH_ACK_RECORD].airtime < results[RETRIED].airtime);
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+    printf("Simulating %u broadcast queries in response mode ALL, with an ACK record of %u responders\n", QUERY_COUNT,
+           D7ATP_ACK_RECORD_SIZE);
+    test_group_query(4);
+    test_group_query(8);
+    test_group_query(16);
+#else
+    printf("MODULE_D7AP_ACK_RECORD_ENABLED is not set, skipping\n");
+#endif
+    return 0;
+}
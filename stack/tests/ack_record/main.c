@@ -0,0 +1,100 @@
+#include "request.h"
+#include "assert.h"
+#include "stdio.h"
+#include "string.h"
+
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+static void test_codec()
+{
+    printf("Testing the ACK record of a request ... ");
+    static packet_t request, decoded;
+    uint8_t data[32 + D7ATP_ACK_RECORD_MAX_LENGTH];
+    memset(&request, 0, sizeof(packet_t));
+    request.d7atp_transaction_id = 7;
+    request.d7atp_ack_template.ack_record_count = D7ATP_ACK_RECORD_SIZE;
+    for (uint8_t i = 0; i < D7ATP_ACK_RECORD_SIZE; i++)
+        get_uid(i, request.d7atp_ack_template.ack_record[i]);
+
+    uint8_t length = encode_request_header(&request, data, sizeof(data));
+    assert(length == 3 + 1 + 2 + D7ATP_ACK_RECORD_MAX_LENGTH);
+    assert(packet_codec_decode_d7atp_header(&decoded, true, data, length) == length);
+    assert(packet_codec_decode_d7atp_header(&decoded, true, data, length - 1) == 0);
+    for (uint8_t i = 0; i < D7ATP_ACK_RECORD_SIZE; i++)
+        assert(is_listed_in_ack_record(&decoded, i));
+
+    assert(!is_listed_in_ack_record(&decoded, D7ATP_ACK_RECORD_SIZE));
+
+    // a response does not carry the response period nor a record
+    assert(packet_codec_decode_d7atp_header(&decoded, false, data, length) == length - 1 - D7ATP_ACK_RECORD_MAX_LENGTH);
+
+    // a record which is longer than ours is refused
+    data[length - D7ATP_ACK_RECORD_MAX_LENGTH] = D7ATP_ACK_RECORD_SIZE + 1;
+    assert(packet_codec_decode_d7atp_header(&decoded, true, data, sizeof(data)) == 0);
+    printf("OK\n");
+}
+
+static void test_empty_record()
+{
+    printf("Testing an empty ACK record ... ");
+    static packet_t request, decoded;
+    uint8_t data[32 + D7ATP_ACK_RECORD_MAX_LENGTH];
+    memset(&request, 0, sizeof(packet_t));
+
+    // the first attempt of a request has no record, the ACK template is void
+    uint8_t length = encode_request_header(&request, data, sizeof(data));
+    assert(length == 3 + 1);
+    assert(packet_codec_decode_d7atp_header(&decoded, true, data, length) == length);
+    assert(!decoded.d7atp_ctrl.ctrl_ack_not_void && !decoded.d7atp_ctrl.ctrl_ack_record);
+    assert(!is_listed_in_ack_record(&decoded, 0));
+
+    // a record without responders only takes the count
+    request.d7atp_ctrl.ctrl_ack_not_void = true;
+    request.d7atp_ctrl.ctrl_ack_record = true;
+    length = packet_codec_encode_d7atp_header(&request, true, data, sizeof(data));
+    assert(length == 3 + 1 + 2 + 1);
+    memset(&decoded, 0xFF, sizeof(packet_t));
+    assert(packet_codec_decode_d7atp_header(&decoded, true, data, length) == length);
+    assert(decoded.d7atp_ack_template.ack_record_count == 0);
+    assert(!is_listed_in_ack_record(&decoded, 0));
+    printf("OK\n");
+}
+
+static void test_buffer_size()
+{
+    printf("Testing the buffer size of a full ACK record ... ");
+    static packet_t request, decoded;
+    uint8_t data[32 + D7ATP_ACK_RECORD_MAX_LENGTH];
+    memset(&request, 0, sizeof(packet_t));
+    request.d7atp_ack_template.ack_record_count = D7ATP_ACK_RECORD_SIZE;
+    for (uint8_t i = 0; i < D7ATP_ACK_RECORD_SIZE; i++)
+        get_uid(i, request.d7atp_ack_template.ack_record[i]);
+
+    // the header is encoded completely or not at all
+    uint8_t length = encode_request_header(&request, data, sizeof(data));
+    memset(data, 0xAA, sizeof(data));
+    assert(packet_codec_encode_d7atp_header(&request, true, data, length - 1) == 0);
+    assert(data[0] == 0xAA);
+    assert(packet_codec_encode_d7atp_header(&request, true, data, length) == length);
+
+    // a record which is cut off after any of the responders is refused
+    for (uint8_t i = 0; i < D7ATP_ACK_RECORD_SIZE; i++)
+        assert(packet_codec_decode_d7atp_header(&decoded, true, data, length - (i * ID_TYPE_UID_ID_LENGTH) - 1) == 0);
+
+    // the last responder of a full record is listed
+    assert(packet_codec_decode_d7atp_header(&decoded, true, data, length) == length);
+    assert(is_listed_in_ack_record(&decoded, D7ATP_ACK_RECORD_SIZE - 1));
+    printf("OK\n");
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+    test_codec();
+    test_empty_record();
+    test_buffer_size();
+#else
+    printf("MODULE_D7AP_ACK_RECORD_ENABLED is not set, skipping\n");
+#endif
+    return 0;
+}
@@ -0,0 +1,49 @@
+#ifndef REQUEST_H
+#define REQUEST_H
+
+#include "packet_codec.h"
+#include "assert.h"
+#include "string.h"
+
+// the requests of the ACK record test and benchmark, encoded and checked like the D7ATP does
+
+static void get_uid(uint8_t responder, uint8_t* uid)
+{
+    memset(uid, 0x10, ID_TYPE_UID_ID_LENGTH);
+    uid[ID_TYPE_UID_ID_LENGTH - 1] = responder;
+}
+
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+// encodes the D7ATP header of the request like the requester, the record is only included when the request is retried
+static uint8_t encode_request_header(packet_t* request, uint8_t* data, uint8_t size)
+{
+    request->d7atp_ctrl.ctrl_is_start = true;
+    request->d7atp_ctrl.ctrl_is_ack_requested = true;
+    request->d7atp_ctrl.ctrl_ack_not_void = request->d7atp_ack_template.ack_record_count > 0;
+    request->d7atp_ctrl.ctrl_ack_record = request->d7atp_ack_template.ack_record_count > 0;
+    request->d7atp_ack_template.ack_transaction_id_start = request->d7atp_transaction_id;
+    request->d7atp_ack_template.ack_transaction_id_stop = request->d7atp_transaction_id;
+    uint8_t length = packet_codec_encode_d7atp_header(request, true, data, size);
+    assert(length);
+    return length;
+}
+
+// the check of the responder on the decoded request, see d7atp_process_received_packet()
+static bool is_listed_in_ack_record(packet_t* request, uint8_t responder)
+{
+    if (!request->d7atp_ctrl.ctrl_ack_not_void || !request->d7atp_ctrl.ctrl_ack_record)
+        return false;
+
+    uint8_t uid[ID_TYPE_UID_ID_LENGTH];
+    get_uid(responder, uid);
+    for (uint8_t i = 0; i < request->d7atp_ack_template.ack_record_count; i++)
+    {
+        if (memcmp(request->d7atp_ack_template.ack_record[i], uid, ID_TYPE_UID_ID_LENGTH) == 0)
+            return true;
+    }
+
+    return false;
+}
+#endif
+
+#endif
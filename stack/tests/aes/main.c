@@ -19,7 +19,9 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include "aes.h"
+#include "framework_defs.h"
 
 /*
  * This unit-test application is used to confirm that our implementation has
@@ -207,6 +209,104 @@ static const unsigned char ctr_ct[CTR_TEST_VECTORS_NB][36] =
 
 static const int ctr_len[CTR_TEST_VECTORS_NB] = { 16, 32, 36 };
 
+/*
+ * A secured response with a 40 byte payload, with the IV layout of D7ANP: flags and NLS method (AES-CCM-64), key
+ * counter, frame counter, origin UID, control and payload length
+ */
+#define RESPONSE_LENGTH 40
+#define RESPONSE_AUTH_LEN 8
+#define LATENCY_ITERATIONS 10000
+
+static const uint8_t response_iv[AES_BLOCK_SIZE] = {
+    0x60, 0x00, 0x00, 0x00, 0x01, 0x2A, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x50, RESPONSE_LENGTH
+};
+
+static void secure_response(uint8_t *payload, uint8_t nls_method_ccm)
+{
+    uint8_t ctr[AES_BLOCK_SIZE];
+    memcpy(ctr, response_iv, AES_BLOCK_SIZE);
+    memset(payload, 0x55, RESPONSE_LENGTH + RESPONSE_AUTH_LEN);
+    if (nls_method_ccm)
+        AES128_CCM_encrypt(payload, RESPONSE_LENGTH, response_iv, NULL, 0, ctr, RESPONSE_AUTH_LEN);
+    else
+        AES128_CTR_encrypt(payload, payload, RESPONSE_LENGTH, ctr);
+}
+
+static void precompute_response_keystream(uint8_t nls_method_ccm)
+{
+    uint8_t ctr[AES_BLOCK_SIZE];
+    memcpy(ctr, response_iv, AES_BLOCK_SIZE);
+    if (nls_method_ccm)
+        ctr[0] &= 0xF0; // the authentication tag is encrypted using block counter 0
+
+    AES128_CTR_start_keystream(ctr, (RESPONSE_LENGTH + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE + nls_method_ccm);
+    while (AES128_CTR_precompute_keystream_block());
+}
+
+static int test_keystream_cache(uint8_t nls_method_ccm)
+{
+    const char* name = nls_method_ccm ? "AES-CCM" : "AES-CTR";
+    uint8_t expected[RESPONSE_LENGTH + RESPONSE_AUTH_LEN];
+    uint8_t payload[RESPONSE_LENGTH + RESPONSE_AUTH_LEN];
+    AES128_init(ccm_key);
+
+    clock_t start = clock();
+    for (int i = 0; i < LATENCY_ITERATIONS; i++)
+        secure_response(expected, nls_method_ccm);
+
+    double uncached_us = (clock() - start) * 1000000.0 / CLOCKS_PER_SEC / LATENCY_ITERATIONS;
+
+    // only the encryption itself is timed, the keystream is computed ahead when idle
+    clock_t duration = 0;
+    for (int i = 0; i < LATENCY_ITERATIONS; i++)
+    {
+        precompute_response_keystream(nls_method_ccm);
+        start = clock();
+        secure_response(payload, nls_method_ccm);
+        duration += clock() - start;
+        if (memcmp(payload, expected, sizeof(payload)) != 0)
+        {
+            DPRINT("%s keystream cache output differs\n", name);
+            DPRINT_DATA(payload, sizeof(payload));
+            return -1;
+        }
+    }
+
+    DPRINT("%s secured response assembly: %.2f us, with precomputed keystream %.2f us (cache of %i blocks)\n", name,
+           uncached_us, duration * 1000000.0 / CLOCKS_PER_SEC / LATENCY_ITERATIONS, FRAMEWORK_AES_KEYSTREAM_CACHE_BLOCKS);
+
+    // a key change clears the cache
+    precompute_response_keystream(nls_method_ccm);
+    AES128_init(ctr_key[0]);
+    secure_response(expected, nls_method_ccm);
+    AES128_CTR_clear_keystream();
+    secure_response(payload, nls_method_ccm);
+    if (memcmp(payload, expected, sizeof(payload)) != 0)
+    {
+        DPRINT("%s keystream cache not cleared on key change\n", name);
+        return -1;
+    }
+
+    // as does a frame counter change, which changes the counter block
+    AES128_init(ccm_key);
+    uint8_t ctr[AES_BLOCK_SIZE];
+    memcpy(ctr, response_iv, AES_BLOCK_SIZE);
+    ctr[5]++;
+    AES128_CTR_start_keystream(ctr, 4);
+    while (AES128_CTR_precompute_keystream_block());
+    secure_response(payload, nls_method_ccm);
+    AES128_CTR_clear_keystream();
+    secure_response(expected, nls_method_ccm);
+    if (memcmp(payload, expected, sizeof(payload)) != 0)
+    {
+        DPRINT("%s keystream of another frame counter used\n", name);
+        return -1;
+    }
+
+    DPRINT("%s keystream cache test passed\n", name);
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     int i;
@@ -288,6 +388,9 @@ int main(int argc, char *argv[])
         DPRINT("AES-CCM test vector #%d passed\n", i + 1);
     }
 
+    if (test_keystream_cache(0) != 0 || test_keystream_cache(1) != 0)
+        return -1;
+
     DPRINT("AES all unit tests OK !\n");
     return 0;
 }
@@ -18,6 +18,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "debug.h"
 
@@ -27,6 +28,12 @@
 const char _APP_NAME[] = "alp_test";
 const char _GIT_SHA1[] = "";
 
+// d7ap_fs executes D7AActP on the ALP layer, which is not linked in this test
+void alp_layer_process_d7aactp(alp_interface_config_t* interface_config, uint8_t* alp_command, uint32_t alp_command_length)
+{
+    assert(false);
+}
+
 void test_alp_parse_length_operand()
 {
     fifo_t fifo;
@@ -34,20 +41,21 @@ void test_alp_parse_length_operand()
     fifo_init(&fifo, data, sizeof(data));
 
     fifo_put_byte(&fifo, 0x01);
-    uint32_t length = alp_parse_length_operand(&fifo);
+    uint32_t length = 0;
+    assert(alp_parse_length_operand(&fifo, &length));
     assert(length == 1);
 
     fifo_clear(&fifo);
     fifo_put_byte(&fifo, 0x40);
     fifo_put_byte(&fifo, 0x41);
-    length = alp_parse_length_operand(&fifo);
+    assert(alp_parse_length_operand(&fifo, &length));
     assert(length == 65);
 
     fifo_clear(&fifo);
     fifo_put_byte(&fifo, 0x80);
     fifo_put_byte(&fifo, 0x40);
     fifo_put_byte(&fifo, 0x01);
-    length = alp_parse_length_operand(&fifo);
+    assert(alp_parse_length_operand(&fifo, &length));
     assert(length == 0x4001);
     
     fifo_clear(&fifo);
@@ -55,10 +63,105 @@ void test_alp_parse_length_operand()
     fifo_put_byte(&fifo, 0x41);
     fifo_put_byte(&fifo, 0x10);
     fifo_put_byte(&fifo, 0x00);
-    length = alp_parse_length_operand(&fifo);
+    assert(alp_parse_length_operand(&fifo, &length));
     assert(length == 4263936);
 }
 
+void test_alp_expected_response_length()
+{
+    static alp_command_t command;
+    alp_action_t action;
+    memset(&command, 0, sizeof(alp_command_t));
+    fifo_init(&command.alp_command_fifo, command.alp_command, ALP_PAYLOAD_MAX_SIZE);
+    assert(alp_get_expected_response_length(&command) == 0);
+
+    // opcode, file ID, offset, length and 8 data bytes
+    assert(alp_append_tag_request_action(&command, 1, true));
+    assert(alp_append_read_file_data_action(&command, 0x40, 0, 8, true, false));
+    assert(alp_get_expected_response_length(&command) == 1 + 1 + 1 + 1 + 8);
+
+    // 2 byte offset operand
+    assert(alp_append_read_file_data_action(&command, 0x41, 100, 4, true, false));
+    assert(alp_get_expected_response_length(&command) == 12 + 1 + 1 + 2 + 1 + 4);
+
+    // parsing the actions removes their response
+    assert(alp_parse_action(&command, &action));
+    assert(action.ctrl.operation == ALP_OP_REQUEST_TAG);
+    assert(alp_get_expected_response_length(&command) == 12 + 9);
+    assert(alp_parse_action(&command, &action));
+    assert(action.ctrl.operation == ALP_OP_READ_FILE_DATA);
+    assert(alp_get_expected_response_length(&command) == 9);
+
+    // data put in the fifo directly is accounted for as well
+    uint8_t read_file_properties[] = { ALP_OP_READ_FILE_PROPERTIES, 0x40 };
+    fifo_put(&command.alp_command_fifo, read_file_properties, sizeof(read_file_properties));
+    assert(alp_get_expected_response_length(&command) == 9 + 1 + 1 + sizeof(d7ap_fs_file_header_t));
+    assert(alp_parse_action(&command, &action));
+    assert(alp_get_expected_response_length(&command) == 1 + 1 + sizeof(d7ap_fs_file_header_t));
+    assert(alp_parse_action(&command, &action));
+    assert(action.ctrl.operation == ALP_OP_READ_FILE_PROPERTIES);
+    assert(alp_get_expected_response_length(&command) == 0);
+}
+
+void test_alp_parse_unsupported_operation()
+{
+    static alp_command_t command;
+    alp_action_t action;
+    memset(&command, 0, sizeof(alp_command_t));
+    fifo_init(&command.alp_command_fifo, command.alp_command, ALP_PAYLOAD_MAX_SIZE);
+
+    // operations without a parser in the operation table are refused
+    fifo_put_byte(&command.alp_command_fifo, ALP_OP_EXECUTE_FILE);
+    fifo_put_byte(&command.alp_command_fifo, 0x40);
+    assert(!alp_parse_action(&command, &action));
+
+    fifo_clear(&command.alp_command_fifo);
+    assert(alp_append_tag_request_action(&command, 1, true));
+    assert(alp_parse_action(&command, &action));
+    assert(action.ctrl.operation == ALP_OP_REQUEST_TAG);
+    assert(action.tag_id_operand.tag_id == 1);
+}
+
+void test_alp_break_query()
+{
+    static alp_command_t command;
+    alp_action_t action;
+    memset(&command, 0, sizeof(alp_command_t));
+    fifo_init(&command.alp_command_fifo, command.alp_command, ALP_PAYLOAD_MAX_SIZE);
+
+    uint8_t compare_value[] = { 0x12, 0x34 };
+    assert(alp_append_break_query_action(&command, 0x40, 4, compare_value, sizeof(compare_value), ARITH_COMP_TYPE_INEQUALITY));
+    assert(alp_append_read_file_data_action(&command, 0x40, 0, 8, true, false));
+    // the query itself does not result in a response
+    assert(alp_get_expected_response_length(&command) == 1 + 1 + 1 + 1 + 8);
+
+    assert(alp_parse_action(&command, &action));
+    assert(action.ctrl.operation == ALP_OP_BREAK_QUERY);
+    assert(action.query_operand.code.type == QUERY_CODE_TYPE_ARITHM_COMP_WITH_VALUE_IN_QUERY);
+    assert(action.query_operand.code.param == ARITH_COMP_TYPE_INEQUALITY);
+    assert(!action.query_operand.code.mask);
+    assert(action.query_operand.compare_operand_length == sizeof(compare_value));
+    assert(memcmp(action.query_operand.compare_body, compare_value, sizeof(compare_value)) == 0);
+    // followed by the file offset operand
+    assert(action.query_operand.compare_body[2] == 0x40 && action.query_operand.compare_body[3] == 4);
+
+    assert(alp_parse_action(&command, &action));
+    assert(action.ctrl.operation == ALP_OP_READ_FILE_DATA);
+
+    // the Bloom filter is stored as compare body, the hash count as param
+    uint8_t filter[20] = { 0 };
+    filter[19] = 0x80;
+    assert(alp_append_bloom_filter_query_action(&command, 0x00, 0, filter, sizeof(filter), 7));
+    assert(alp_parse_action(&command, &action));
+    assert(action.ctrl.operation == ALP_OP_BREAK_QUERY);
+    assert(action.query_operand.code.type == QUERY_CODE_TYPE_BLOOM_FILTER);
+    assert(action.query_operand.code.param == 7);
+    assert(action.query_operand.compare_operand_length == sizeof(filter));
+    assert(memcmp(action.query_operand.compare_body, filter, sizeof(filter)) == 0);
+    assert(action.query_operand.compare_body[20] == 0x00 && action.query_operand.compare_body[21] == 0);
+    assert(fifo_get_size(&command.alp_command_fifo) == 0);
+}
+
 void bootstrap()
 {
     printf("Unit-tests for ALP\n");
@@ -66,6 +169,19 @@ void bootstrap()
     printf("Testing alp_parse_length_operand ... ");
     test_alp_parse_length_operand();
     printf("Success!\n");
+
+    printf("Testing alp_get_expected_response_length ... ");
+    test_alp_expected_response_length();
+    printf("Success!\n");
+
+    printf("Testing alp_parse_action with unsupported operations ... ");
+    test_alp_parse_unsupported_operation();
+    printf("Success!\n");
+
+    printf("Testing alp_append_break_query_action ... ");
+    test_alp_break_query();
+    printf("Success!\n");
     
     printf("Unit-tests for ALP completed\n");
+    exit(0); // there is nothing to schedule, do not enter the scheduler loop
 }
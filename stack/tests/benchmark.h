@@ -0,0 +1,44 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "stdbool.h"
+#include "stdint.h"
+
+// shared by the benchmark applications next to the unit tests, which simulate a protocol feature on a lossy channel
+
+// normal rate channel: 55.555 kbps, the preamble and sync word take 6 bytes
+#define BENCHMARK_BYTE_DURATION_MS (8 / 55.555)
+#define BENCHMARK_PREAMBLE_SYNC_SIZE 6
+
+// each run starts from the same seed, so the compared variants see the same channel
+#define BENCHMARK_SEED 0x12345678
+
+static uint32_t benchmark_rnd_state;
+
+static inline void benchmark_seed(uint32_t seed) { benchmark_rnd_state = seed; }
+
+// xorshift32, deterministic on every platform unlike rand()
+static inline uint32_t benchmark_next_rnd()
+{
+    benchmark_rnd_state ^= benchmark_rnd_state << 13;
+    benchmark_rnd_state ^= benchmark_rnd_state >> 17;
+    benchmark_rnd_state ^= benchmark_rnd_state << 5;
+    return benchmark_rnd_state;
+}
+
+static inline bool benchmark_received(uint8_t success_percent) { return benchmark_next_rnd() % 100 < success_percent; }
+
+static inline int16_t benchmark_rnd_range(int16_t min, int16_t max)
+{
+    return min + (int16_t)(benchmark_next_rnd() % (max - min + 1));
+}
+
+static inline double benchmark_random_time(double max) { return max * (benchmark_next_rnd() % 10000) / 10000.0; }
+
+// the airtime of a frame of length bytes, the length byte and the CRC included, in ms
+static inline double benchmark_get_airtime(uint8_t length)
+{
+    return (length + BENCHMARK_PREAMBLE_SYNC_SIZE) * BENCHMARK_BYTE_DURATION_MS;
+}
+
+#endif
@@ -0,0 +1,107 @@
+#include "bg_scan_control.h"
+#include "benchmark.h"
+#include "assert.h"
+#include "stdio.h"
+
+// a background scan on a normal rate channel, durations in ticks
+#define TO 4
+#define MAX_LISTEN_TIMEOUT (TO + 40)
+#define RSSI_MEASUREMENT_DURATION 0.25 // time needed to measure the RSSI, before a fast termination
+
+// the noisy channel: the DLL sets the threshold just above the noise floor, but other systems often transmit on
+// the channel, while a background frame of a D7A node is present in only a few scans
+#define SCAN_COUNT 100000
+#define DLL_RSSI_THR -100
+#define NOISE_FLOOR -104
+#define NOISE_SPREAD 6
+#define INTERFERENCE_PERCENT 30
+#define INTERFERENCE_MIN_RSSI -96
+#define INTERFERENCE_MAX_RSSI -86
+#define BG_FRAME_PERCENT 5
+#define BG_FRAME_MIN_RSSI -90
+#define BG_FRAME_MAX_RSSI -60
+
+typedef struct {
+    double wake_time;
+    uint32_t triggers;
+    uint32_t false_triggers;
+    uint32_t detections;
+    uint32_t bg_frames;
+} result_t;
+
+static result_t simulate(bool adaptive)
+{
+    result_t result = { 0 };
+    bg_scan_control_t control;
+    bg_scan_control_init(&control, TO, MAX_LISTEN_TIMEOUT);
+    benchmark_seed(BENCHMARK_SEED);
+
+    for (uint32_t i = 0; i < SCAN_COUNT; i++)
+    {
+        int16_t rssi = benchmark_rnd_range(NOISE_FLOOR - NOISE_SPREAD / 2, NOISE_FLOOR + NOISE_SPREAD / 2);
+        if (benchmark_received(INTERFERENCE_PERCENT))
+            rssi = benchmark_rnd_range(INTERFERENCE_MIN_RSSI, INTERFERENCE_MAX_RSSI);
+
+        // the sync word of a background frame is detected within To of the trigger
+        bool bg_frame = benchmark_received(BG_FRAME_PERCENT);
+        uint8_t detection_delay = benchmark_next_rnd() % TO;
+        if (bg_frame)
+        {
+            int16_t bg_frame_rssi = benchmark_rnd_range(BG_FRAME_MIN_RSSI, BG_FRAME_MAX_RSSI);
+            if (bg_frame_rssi > rssi)
+                rssi = bg_frame_rssi;
+
+            result.bg_frames++;
+        }
+
+        int16_t rssi_thr = adaptive ? bg_scan_control_get_rssi_thr(&control, DLL_RSSI_THR) : DLL_RSSI_THR;
+        uint8_t listen_timeout = adaptive ? bg_scan_control_get_listen_timeout(&control) : MAX_LISTEN_TIMEOUT;
+        result.wake_time += RSSI_MEASUREMENT_DURATION;
+        if (rssi <= rssi_thr)
+            continue;
+
+        result.triggers++;
+        bool detected = bg_frame && detection_delay < listen_timeout;
+        if (detected)
+        {
+            result.detections++;
+            result.wake_time += detection_delay;
+        }
+        else
+        {
+            result.false_triggers++;
+            result.wake_time += listen_timeout;
+        }
+
+        bg_scan_control_report_trigger(&control, rssi, detected, detection_delay);
+    }
+
+    if (adaptive)
+        printf("adapted RSSI threshold %i dBm, listen timeout %u ticks\n",
+               bg_scan_control_get_rssi_thr(&control, DLL_RSSI_THR), bg_scan_control_get_listen_timeout(&control));
+
+    return result;
+}
+
+static void print_result(const char* name, result_t result)
+{
+    printf("%-10s %u triggers, %u false, %u of %u background frames detected, wake time %.2f ticks per detection\n",
+           name, result.triggers, result.false_triggers, result.detections, result.bg_frames,
+           result.wake_time / result.detections);
+}
+
+int main(int argc, char* argv[])
+{
+    printf("Simulating %u background scans on a noisy channel:\n", SCAN_COUNT);
+    result_t fixed = simulate(false);
+    result_t adaptive = simulate(true);
+    print_result("fixed", fixed);
+    print_result("adaptive", adaptive);
+    printf("Wake time per detection reduced by %.1f%%\n",
+           100.0 * (1.0 - (adaptive.wake_time / adaptive.detections) / (fixed.wake_time / fixed.detections)));
+
+    assert(fixed.detections == fixed.bg_frames);
+    assert(adaptive.detections * 100 >= fixed.detections * 98);
+    assert(adaptive.wake_time / adaptive.detections < fixed.wake_time / fixed.detections / 2);
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "bg_scan_control.h"
+#include "assert.h"
+#include "stdio.h"
+
+// a background scan on a normal rate channel, durations in ticks
+#define TO 4
+#define MAX_LISTEN_TIMEOUT (TO + 40)
+#define DLL_RSSI_THR -100
+
+// more than 3/4 false triggers raises the threshold, less than 1/4 lowers it, see bg_scan_control.c
+#define RAISE_FALSE_TRIGGER_COUNT (BG_SCAN_CONTROL_WINDOW * 3 / 4)
+#define LOWER_FALSE_TRIGGER_COUNT (BG_SCAN_CONTROL_WINDOW / 4)
+
+// reports a complete window, the false triggers first
+static void report_window(bg_scan_control_t* control, uint8_t false_trigger_count, int16_t detection_rssi,
+                          uint8_t detection_delay)
+{
+    for (uint8_t i = 0; i < BG_SCAN_CONTROL_WINDOW; i++)
+        bg_scan_control_report_trigger(control, detection_rssi, i >= false_trigger_count, detection_delay);
+}
+
+static int16_t get_offset(const bg_scan_control_t* control)
+{
+    return bg_scan_control_get_rssi_thr(control, DLL_RSSI_THR) - DLL_RSSI_THR;
+}
+
+static void test_bounds()
+{
+    printf("Testing threshold and timeout bounds ... ");
+    bg_scan_control_t control;
+    bg_scan_control_init(&control, TO, MAX_LISTEN_TIMEOUT);
+    assert(bg_scan_control_get_rssi_thr(&control, DLL_RSSI_THR) == DLL_RSSI_THR);
+    assert(bg_scan_control_get_listen_timeout(&control) == MAX_LISTEN_TIMEOUT);
+
+    // only false triggers: the threshold rises up to the maximum offset, the timeout does not change
+    for (int i = 0; i < BG_SCAN_CONTROL_WINDOW * 20; i++)
+        bg_scan_control_report_trigger(&control, -80, false, 0);
+
+    assert(get_offset(&control) == BG_SCAN_CONTROL_MAX_OFFSET_DB);
+    assert(bg_scan_control_get_listen_timeout(&control) == MAX_LISTEN_TIMEOUT);
+
+    // a weak detection limits the threshold, and sets the timeout
+    for (int i = 0; i < BG_SCAN_CONTROL_WINDOW; i++)
+        bg_scan_control_report_trigger(&control, i == 0 ? -90 : -80, i == 0, 2);
+
+    assert(bg_scan_control_get_rssi_thr(&control, DLL_RSSI_THR) == -90 - BG_SCAN_CONTROL_DETECTION_MARGIN_DB);
+    assert(bg_scan_control_get_listen_timeout(&control) == TO + 2);
+
+    // but the threshold is never below the one set by the DLL
+    assert(bg_scan_control_get_rssi_thr(&control, -94) == -94);
+
+    // only detections: the threshold returns to the one set by the DLL
+    for (int i = 0; i < BG_SCAN_CONTROL_WINDOW * 20; i++)
+        bg_scan_control_report_trigger(&control, -70, true, 1);
+
+    assert(bg_scan_control_get_rssi_thr(&control, DLL_RSSI_THR) == DLL_RSSI_THR);
+    assert(bg_scan_control_get_listen_timeout(&control) == TO + 1);
+
+    // a detection delay longer than the maximum listen timeout
+    report_window(&control, 0, -70, MAX_LISTEN_TIMEOUT);
+    assert(bg_scan_control_get_listen_timeout(&control) == MAX_LISTEN_TIMEOUT);
+    printf("OK\n");
+}
+
+static void test_window_boundaries()
+{
+    printf("Testing the window boundaries ... ");
+    bg_scan_control_t control;
+    bg_scan_control_init(&control, TO, MAX_LISTEN_TIMEOUT);
+
+    // nothing changes before the last trigger of a window
+    for (uint8_t i = 0; i < BG_SCAN_CONTROL_WINDOW - 1; i++)
+        bg_scan_control_report_trigger(&control, -80, false, 0);
+
+    assert(get_offset(&control) == 0);
+    bg_scan_control_report_trigger(&control, -80, false, 0);
+    assert(get_offset(&control) == BG_SCAN_CONTROL_STEP_DB);
+
+    // the threshold is only raised with more than 3/4 false triggers
+    report_window(&control, RAISE_FALSE_TRIGGER_COUNT, -50, 0);
+    assert(get_offset(&control) == BG_SCAN_CONTROL_STEP_DB);
+    report_window(&control, RAISE_FALSE_TRIGGER_COUNT + 1, -50, 0);
+    assert(get_offset(&control) == 2 * BG_SCAN_CONTROL_STEP_DB);
+
+    // and only lowered with less than 1/4 false triggers
+    report_window(&control, LOWER_FALSE_TRIGGER_COUNT, -50, 0);
+    assert(get_offset(&control) == 2 * BG_SCAN_CONTROL_STEP_DB);
+    report_window(&control, LOWER_FALSE_TRIGGER_COUNT - 1, -50, 0);
+    assert(get_offset(&control) == BG_SCAN_CONTROL_STEP_DB);
+
+    // the timeout follows the longest detection delay of the last window, a window without detections keeps it
+    report_window(&control, 0, -50, 7);
+    assert(bg_scan_control_get_listen_timeout(&control) == TO + 7);
+    report_window(&control, BG_SCAN_CONTROL_WINDOW, -50, 0);
+    assert(bg_scan_control_get_listen_timeout(&control) == TO + 7);
+    report_window(&control, 0, -50, 0);
+    assert(bg_scan_control_get_listen_timeout(&control) == TO);
+
+    // the weakest detection is kept across windows, also when later windows only detect stronger frames
+    report_window(&control, BG_SCAN_CONTROL_WINDOW - 1, -95, 0);
+    for (uint8_t i = 0; i < BG_SCAN_CONTROL_MAX_OFFSET_DB / BG_SCAN_CONTROL_STEP_DB; i++)
+        report_window(&control, RAISE_FALSE_TRIGGER_COUNT + 1, -50, 0);
+
+    assert(bg_scan_control_get_rssi_thr(&control, DLL_RSSI_THR) == DLL_RSSI_THR);
+    assert(bg_scan_control_get_rssi_thr(&control, -110) == -95 - BG_SCAN_CONTROL_DETECTION_MARGIN_DB);
+    printf("OK\n");
+}
+
+int main(int argc, char* argv[])
+{
+    test_bounds();
+    test_window_boundaries();
+    return 0;
+}
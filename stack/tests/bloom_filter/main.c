@@ -0,0 +1,125 @@
+#include "bloom_filter.h"
+#include "assert.h"
+#include "stdio.h"
+#include "string.h"
+
+#define UID_SIZE 8
+#define MAX_FILTER_SIZE 95 // fits in the ALP compare body together with the file offset operand
+#define MAX_HASH_COUNT 15
+
+static void get_uid(uint16_t node, uint8_t* uid)
+{
+    // consecutive UIDs, like a batch of devices, only differ in the last bytes
+    memset(uid, 0, UID_SIZE);
+    uid[0] = 0xBE;
+    uid[1] = 0xEF;
+    uid[UID_SIZE - 2] = node >> 8;
+    uid[UID_SIZE - 1] = node & 0xFF;
+}
+
+static uint8_t count_bits(const uint8_t* filter, uint16_t filter_size)
+{
+    uint8_t bit_count = 0;
+    for (uint16_t i = 0; i < filter_size; i++)
+        bit_count += __builtin_popcount(filter[i]);
+
+    return bit_count;
+}
+
+static void test_add()
+{
+    printf("Testing Bloom filter ... ");
+    uint8_t filter[8];
+    uint8_t item[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    memset(filter, 0, sizeof(filter));
+    assert(!bloom_filter_contains(filter, sizeof(filter), 3, item, sizeof(item)));
+    bloom_filter_add(filter, sizeof(filter), 3, item, sizeof(item));
+    assert(bloom_filter_contains(filter, sizeof(filter), 3, item, sizeof(item)));
+
+    // at most hash_count bits are set, adding the item again does not change the filter
+    uint8_t bit_count = count_bits(filter, sizeof(filter));
+    assert(bit_count > 0 && bit_count <= 3);
+    bloom_filter_add(filter, sizeof(filter), 3, item, sizeof(item));
+    assert(count_bits(filter, sizeof(filter)) == bit_count);
+
+    // a filter with all bits set matches every item, also an empty one
+    memset(filter, 0xFF, sizeof(filter));
+    assert(bloom_filter_contains(filter, sizeof(filter), MAX_HASH_COUNT, item, sizeof(item)));
+    assert(bloom_filter_contains(filter, sizeof(filter), MAX_HASH_COUNT, item, 0));
+    printf("OK\n");
+}
+
+static void test_single_byte_filter()
+{
+    printf("Testing a Bloom filter of a single byte ... ");
+    // more hashes than bits: the bit positions wrap around the filter, without getting stuck on a single bit
+    uint8_t uid[UID_SIZE];
+    for (uint16_t node = 0; node < 256; node++)
+    {
+        uint8_t filter = 0;
+        get_uid(node, uid);
+        bloom_filter_add(&filter, 1, MAX_HASH_COUNT, uid, UID_SIZE);
+        assert(count_bits(&filter, 1) > 1);
+        assert(bloom_filter_contains(&filter, 1, MAX_HASH_COUNT, uid, UID_SIZE));
+    }
+
+    printf("OK\n");
+}
+
+static void test_targets()
+{
+    printf("Testing the targets of a query ... ");
+    // 50 out of 500 nodes are targeted, with 8 bits per target
+    uint16_t target_count = 50;
+    uint16_t filter_size = target_count;
+    uint8_t filter[MAX_FILTER_SIZE];
+    uint8_t hash_count = bloom_filter_get_optimal_hash_count(filter_size, target_count, MAX_HASH_COUNT);
+    assert(hash_count == 6);
+
+    uint8_t uid[UID_SIZE];
+    memset(filter, 0, filter_size);
+    for (uint16_t node = 0; node < target_count; node++)
+    {
+        get_uid(node, uid);
+        bloom_filter_add(filter, filter_size, hash_count, uid, UID_SIZE);
+    }
+
+    // no false negatives, and a false positive rate of about 2%
+    uint16_t false_positive_count = 0;
+    for (uint16_t node = 0; node < 500; node++)
+    {
+        get_uid(node, uid);
+        bool match = bloom_filter_contains(filter, filter_size, hash_count, uid, UID_SIZE);
+        if (node < target_count)
+            assert(match);
+        else if (match)
+            false_positive_count++;
+    }
+
+    assert(false_positive_count < 450 / 20);
+    printf("OK\n");
+}
+
+static void test_optimal_hash_count()
+{
+    printf("Testing the optimal hash count ... ");
+    // (m / n) * ln(2), rounded
+    assert(bloom_filter_get_optimal_hash_count(63, 50, MAX_HASH_COUNT) == 7);
+    assert(bloom_filter_get_optimal_hash_count(MAX_FILTER_SIZE, 50, MAX_HASH_COUNT) == 11);
+    // at least one hash, also without items
+    assert(bloom_filter_get_optimal_hash_count(1, 50, MAX_HASH_COUNT) == 1);
+    assert(bloom_filter_get_optimal_hash_count(10, 0, MAX_HASH_COUNT) == 1);
+    // at most the maximum supported by the query
+    assert(bloom_filter_get_optimal_hash_count(MAX_FILTER_SIZE, 5, MAX_HASH_COUNT) == MAX_HASH_COUNT);
+    assert(bloom_filter_get_optimal_hash_count(MAX_FILTER_SIZE, 1, MAX_HASH_COUNT) == MAX_HASH_COUNT);
+    printf("OK\n");
+}
+
+int main(int argc, char* argv[])
+{
+    test_add();
+    test_single_byte_filter();
+    test_targets();
+    test_optimal_hash_count();
+    return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef ACCESS_PROFILE_H
+#define ACCESS_PROFILE_H
+
+#include "channel_queue.h"
+#include "string.h"
+
+// the access profile of the channel queue test and benchmark: 4 normal rate channels
+#define CHANNEL_COUNT 4
+#define CCA_THRESHOLD 80 // -dBm
+#define NOISE_FLOOR -100
+#define BUSY_RSSI -60
+
+static void init_access_profile(dae_access_profile_t* access_profile)
+{
+    memset(access_profile, 0, sizeof(dae_access_profile_t));
+    access_profile->channel_header.ch_class = PHY_CLASS_NORMAL_RATE;
+    access_profile->channel_header.ch_freq_band = PHY_BAND_868;
+    access_profile->subprofiles[0].subband_bitmap = 0x01;
+    access_profile->subbands[0].channel_index_start = 0;
+    access_profile->subbands[0].channel_index_end = 8 * (CHANNEL_COUNT - 1);
+    access_profile->subbands[0].eirp = 10;
+    access_profile->subbands[0].cca = CCA_THRESHOLD;
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include "access_profile.h"
+#include "benchmark.h"
+#include "dll.h"
+#include "random.h"
+#include "assert.h"
+#include "math.h"
+#include "stdio.h"
+
+// a requester on the access profile of the test, the first channel of the subband is occupied most of the time by
+// another system, the other channels only carry some light traffic
+#define REQUEST_COUNT 20000
+#define INTERFERENCE_PERIOD_MS 50.0
+#define INTERFERENCE_DURATION_MS 40.0
+#define BACKGROUND_BUSY_PERCENT 5
+
+// CSMA-CA in AIND mode like the DLL, CCA2 follows CCA1 after 5 ms
+#define REQUEST_LENGTH 32
+#define CCA2_DELAY_MS 5.0
+#define CCA_DURATION_MS 0.3
+
+typedef enum {
+    SINGLE_CHANNEL,
+    CHANNEL_QUEUE_NO_NOISE_FLOOR,
+    CHANNEL_QUEUE,
+    MODE_COUNT
+} queue_mode_t;
+
+static const char* mode_names[MODE_COUNT] = { "single channel", "queue, random order", "queue, noise floor" };
+
+typedef struct {
+    uint32_t succeeded;
+    uint32_t ccas;
+    double access_delay;
+} result_t;
+
+// the RSSI measured by a CCA, the first channel is occupied by the interferer, with a random phase per request
+static int16_t measure_rssi(uint16_t center_freq_index, double time, double interference_phase)
+{
+    if (center_freq_index == 0)
+        return fmod(time + interference_phase, INTERFERENCE_PERIOD_MS) < INTERFERENCE_DURATION_MS ? BUSY_RSSI : NOISE_FLOOR;
+
+    return benchmark_received(BACKGROUND_BUSY_PERCENT) ? BUSY_RSSI : NOISE_FLOOR;
+}
+
+// performs the CCAs of CSMA-CA in AIND mode like the DLL, returns true when the request can be transmitted within Tc
+static bool transmit(queue_mode_t mode, channel_queue_t* queue, const dae_access_profile_t* access_profile,
+                     result_t* result)
+{
+    double tx_duration = benchmark_get_airtime(REQUEST_LENGTH);
+    double tc = (SFc + 1) * tx_duration + t_g;
+    double to = tc - tx_duration - t_g - 1;
+    double interference_phase = benchmark_random_time(INTERFERENCE_PERIOD_MS);
+    double time = 0;
+    double cca_started = 0;
+    uint16_t channel = 0;
+    if (mode != SINGLE_CHANNEL)
+        channel = channel_queue_start(queue, access_profile, 0x01)->channel_id.center_freq_index;
+
+    while (true)
+    {
+        result->ccas++;
+        int16_t rssi = measure_rssi(channel, time, interference_phase);
+        time += CCA_DURATION_MS;
+        if (mode == CHANNEL_QUEUE)
+            channel_queue_report_rssi(queue, rssi);
+
+        if (rssi <= -CCA_THRESHOLD)
+        {
+            time += CCA2_DELAY_MS;
+            result->ccas++;
+            rssi = measure_rssi(channel, time, interference_phase);
+            time += CCA_DURATION_MS;
+            if (mode == CHANNEL_QUEUE)
+                channel_queue_report_rssi(queue, rssi);
+
+            if (rssi <= -CCA_THRESHOLD)
+            {
+                result->access_delay += time;
+                return true;
+            }
+        }
+
+        to -= time - cca_started;
+        if (to <= 0)
+            return false;
+
+        cca_started = time;
+        if (mode != SINGLE_CHANNEL && channel_queue_shift(queue))
+            channel = channel_queue_get_front(queue)->channel_id.center_freq_index;
+
+        uint16_t max_nr_slots = to / tx_duration;
+        if (max_nr_slots)
+            time += (benchmark_next_rnd() % max_nr_slots) * tx_duration;
+    }
+}
+
+static result_t simulate(queue_mode_t mode)
+{
+    result_t result = { 0 };
+    static channel_queue_t queue;
+    dae_access_profile_t access_profile;
+    init_access_profile(&access_profile);
+    channel_queue_init(&queue);
+    benchmark_seed(BENCHMARK_SEED); // the same interference for all modes
+    set_rng_seed(1); // and the same random order of the queue
+
+    for (uint32_t i = 0; i < REQUEST_COUNT; i++)
+    {
+        if (transmit(mode, &queue, &access_profile, &result))
+            result.succeeded++;
+    }
+
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    printf("Simulating %u requests on %u channels, channel 0 is occupied %.0f%% of the time:\n", REQUEST_COUNT,
+           CHANNEL_COUNT, 100 * INTERFERENCE_DURATION_MS / INTERFERENCE_PERIOD_MS);
+    result_t results[MODE_COUNT];
+    for (queue_mode_t mode = 0; mode < MODE_COUNT; mode++)
+    {
+        results[mode] = simulate(mode);
+        result_t* result = &results[mode];
+        printf("  %-20s %5.1f%% transmitted within Tc, %.2f CCAs per request, %.2f ms access delay\n",
+               mode_names[mode], 100.0 * result->succeeded / REQUEST_COUNT, (double)result->ccas / REQUEST_COUNT,
+               result->succeeded ? result->access_delay / result->succeeded : 0);
+    }
+
+    assert(results[CHANNEL_QUEUE_NO_NOISE_FLOOR].succeeded > results[SINGLE_CHANNEL].succeeded);
+    assert(results[CHANNEL_QUEUE].succeeded >= results[CHANNEL_QUEUE_NO_NOISE_FLOOR].succeeded);
+    // the occupied channel is moved to the back of the queue, so it is rarely tried first
+    assert(results[CHANNEL_QUEUE].ccas < results[CHANNEL_QUEUE_NO_NOISE_FLOOR].ccas);
+    assert(results[CHANNEL_QUEUE].access_delay / results[CHANNEL_QUEUE].succeeded
+           < results[CHANNEL_QUEUE_NO_NOISE_FLOOR].access_delay / results[CHANNEL_QUEUE_NO_NOISE_FLOOR].succeeded);
+    return 0;
+}
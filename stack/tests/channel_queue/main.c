@@ -0,0 +1,200 @@
+#include "access_profile.h"
+#include "assert.h"
+#include "stdio.h"
+#include "string.h"
+
+static bool is_in_queue(channel_queue_t* queue, uint16_t center_freq_index)
+{
+    for (uint8_t i = 0; i < queue->length; i++)
+        if (queue->entries[i].channel_id.center_freq_index == center_freq_index)
+            return true;
+
+    return false;
+}
+
+static void test_queue()
+{
+    printf("Testing the channel queue ... ");
+    static channel_queue_t queue;
+    dae_access_profile_t access_profile;
+    init_access_profile(&access_profile);
+    channel_queue_init(&queue);
+    assert(channel_queue_get_front(&queue) == NULL);
+    assert(!channel_queue_shift(&queue));
+
+    // normal rate channels take 8 channel indexes
+    assert(channel_queue_start(&queue, &access_profile, 0x01) != NULL);
+    assert(queue.length == CHANNEL_COUNT);
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+        assert(is_in_queue(&queue, 8 * i));
+
+    // the queue wraps around, all channels are visited once
+    uint16_t visited = 1 << (channel_queue_get_front(&queue)->channel_id.center_freq_index / 8);
+    for (uint8_t i = 1; i < CHANNEL_COUNT; i++)
+    {
+        assert(channel_queue_shift(&queue));
+        visited |= 1 << (channel_queue_get_front(&queue)->channel_id.center_freq_index / 8);
+    }
+
+    assert(visited == (1 << CHANNEL_COUNT) - 1);
+    assert(channel_queue_shift(&queue) && queue.front == 0);
+
+    // a busy channel moves to the back of the queue, while the others keep their estimate
+    uint16_t busy_channel = channel_queue_get_front(&queue)->channel_id.center_freq_index;
+    channel_queue_report_rssi(&queue, BUSY_RSSI);
+    channel_queue_report_rssi(&queue, BUSY_RSSI);
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        channel_queue_start(&queue, &access_profile, 0x01);
+        assert(queue.entries[CHANNEL_COUNT - 1].channel_id.center_freq_index == busy_channel);
+    }
+
+    // a quiet channel moves to the front
+    channel_queue_shift(&queue);
+    uint16_t quiet_channel = channel_queue_get_front(&queue)->channel_id.center_freq_index;
+    channel_queue_report_rssi(&queue, NOISE_FLOOR);
+    assert(channel_queue_start(&queue, &access_profile, 0x01)->channel_id.center_freq_index == quiet_channel);
+
+    // the subbands of the subprofiles which are not in the access mask are not used, and the estimates are lost
+    // when the access profile changes
+    access_profile.subprofiles[1].subband_bitmap = 0x06;
+    access_profile.subbands[1] = (subband_t){ .channel_index_start = 100, .channel_index_end = 90, .eirp = 10 };
+    access_profile.subbands[2] = (subband_t){ .channel_index_start = 200, .channel_index_end = 208, .eirp = 0 };
+    channel_queue_start(&queue, &access_profile, 0x01);
+    assert(queue.length == CHANNEL_COUNT);
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+        assert(queue.entries[i].noise_floor == CCA_THRESHOLD);
+
+    channel_queue_start(&queue, &access_profile, 0x03);
+    assert(queue.length == CHANNEL_COUNT + 3);
+    assert(is_in_queue(&queue, 100) && is_in_queue(&queue, 200) && is_in_queue(&queue, 208));
+
+    // the queue is only shifted to the channels with the same EIRP
+    for (uint8_t i = 0; i < 2 * queue.length; i++)
+    {
+        int8_t eirp = channel_queue_get_front(&queue)->eirp;
+        assert(channel_queue_shift(&queue));
+        assert(channel_queue_get_front(&queue)->eirp == eirp);
+    }
+
+    // a subband with more channels than fit in the queue, each channel can be selected
+    uint16_t selected[4 * CHANNEL_QUEUE_SIZE] = { 0 };
+    access_profile.channel_header.ch_class = PHY_CLASS_LO_RATE;
+    access_profile.subbands[0].channel_index_end = 4 * CHANNEL_QUEUE_SIZE - 1;
+    for (uint16_t i = 0; i < 1000; i++)
+    {
+        access_profile.subbands[0].eirp = i % 2; // forces to take the channels from the access profile again
+        channel_queue_start(&queue, &access_profile, 0x01);
+        assert(queue.length == CHANNEL_QUEUE_SIZE);
+        for (uint8_t j = 0; j < queue.length; j++)
+            selected[queue.entries[j].channel_id.center_freq_index]++;
+    }
+
+    for (uint16_t i = 0; i < 4 * CHANNEL_QUEUE_SIZE; i++)
+        assert(selected[i] > 150 && selected[i] < 350);
+
+    printf("OK\n");
+}
+
+static void test_empty_queue()
+{
+    printf("Testing an access profile without selectable channels ... ");
+    static channel_queue_t queue;
+    dae_access_profile_t access_profile;
+    init_access_profile(&access_profile);
+    channel_queue_init(&queue);
+
+    // no subprofile in the access mask, or only subprofiles with a void subband bitmap
+    assert(channel_queue_start(&queue, &access_profile, 0x00) == NULL);
+    assert(channel_queue_start(&queue, &access_profile, 0x02) == NULL);
+    assert(queue.length == 0);
+    assert(channel_queue_get_front(&queue) == NULL);
+    assert(!channel_queue_shift(&queue));
+    channel_queue_report_rssi(&queue, BUSY_RSSI);
+    assert(queue.length == 0 && queue.front == 0);
+
+    // the queue is filled again when the access mask selects a subprofile
+    assert(channel_queue_start(&queue, &access_profile, 0x01) != NULL);
+    assert(queue.length == CHANNEL_COUNT);
+
+    // a subband which ends before its start only holds the start channel
+    access_profile.subbands[0].channel_index_end = 0;
+    access_profile.subbands[0].channel_index_start = 16;
+    assert(channel_queue_start(&queue, &access_profile, 0x01)->channel_id.center_freq_index == 16);
+    assert(queue.length == 1);
+    assert(!channel_queue_shift(&queue));
+    printf("OK\n");
+}
+
+static void test_different_eirps()
+{
+    printf("Testing a shift without channels of the same EIRP ... ");
+    static channel_queue_t queue;
+    dae_access_profile_t access_profile;
+    init_access_profile(&access_profile);
+    access_profile.subprofiles[0].subband_bitmap = 0x0F;
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+        access_profile.subbands[i] = (subband_t){ .channel_index_start = 8 * i, .channel_index_end = 8 * i,
+                                                  .eirp = i, .cca = CCA_THRESHOLD };
+
+    channel_queue_init(&queue);
+    assert(channel_queue_start(&queue, &access_profile, 0x01) != NULL);
+    assert(queue.length == CHANNEL_COUNT);
+
+    // every channel has its own EIRP, so the front never moves
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        queue.front = i;
+        const channel_queue_entry_t* front = channel_queue_get_front(&queue);
+        assert(!channel_queue_shift(&queue));
+        assert(queue.front == i && channel_queue_get_front(&queue) == front);
+    }
+
+    // a second channel with the same EIRP as the last channel of the queue, the shift wraps around to it
+    int8_t eirp = queue.entries[CHANNEL_COUNT - 1].eirp;
+    queue.entries[0].eirp = eirp;
+    queue.front = CHANNEL_COUNT - 1;
+    assert(channel_queue_shift(&queue) && queue.front == 0);
+    assert(channel_queue_shift(&queue) && queue.front == CHANNEL_COUNT - 1);
+    printf("OK\n");
+}
+
+static void test_report_rssi()
+{
+    printf("Testing the noise floor estimate ... ");
+    static channel_queue_t queue;
+    dae_access_profile_t access_profile;
+    init_access_profile(&access_profile);
+    channel_queue_init(&queue);
+    channel_queue_start(&queue, &access_profile, 0x01);
+
+    // the estimate of the front channel converges to the measured RSSI, up to the rounding of the moving average,
+    // the others keep the CCA threshold
+    for (uint8_t i = 0; i < 20; i++)
+        channel_queue_report_rssi(&queue, NOISE_FLOOR);
+
+    assert(channel_queue_get_front(&queue)->noise_floor >= -NOISE_FLOOR - 1);
+    assert(channel_queue_get_front(&queue)->noise_floor <= -NOISE_FLOOR);
+    for (uint8_t i = 1; i < CHANNEL_COUNT; i++)
+        assert(queue.entries[i].noise_floor == CCA_THRESHOLD);
+
+    // an RSSI outside the range of the estimate is clipped
+    for (uint8_t i = 0; i < 40; i++)
+        channel_queue_report_rssi(&queue, -300);
+
+    assert(channel_queue_get_front(&queue)->noise_floor >= UINT8_MAX - 1);
+    for (uint8_t i = 0; i < 40; i++)
+        channel_queue_report_rssi(&queue, 10);
+
+    assert(channel_queue_get_front(&queue)->noise_floor <= 2);
+    printf("OK\n");
+}
+
+int main(int argc, char* argv[])
+{
+    test_queue();
+    test_empty_queue();
+    test_different_eirps();
+    test_report_rssi();
+    return 0;
+}
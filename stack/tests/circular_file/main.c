@@ -0,0 +1,179 @@
+#include "d7ap_fs.h"
+#include "alp_layer.h"
+#include "fs.h"
+#include "platform.h"
+#include "assert.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+// not using the APP_BUILD() macro for tests
+const char _APP_NAME[] = "circular_file_test";
+const char _GIT_SHA1[] = "";
+
+// the action protocol is not used by this test
+void alp_layer_process_d7aactp(alp_interface_config_t* interface_config, uint8_t* alp_command, uint32_t alp_command_length)
+{
+    assert(false);
+}
+
+#define FILE_ID 0x45
+#define RECORD_SIZE 6
+#define RECORD_COUNT 10
+#define WEAR_APPEND_COUNT 1000
+
+// counts how many times every byte of the permanent block device of the platform is programmed
+#define PROGRAM_COUNT_SIZE 4096
+
+static uint32_t program_count[PROGRAM_COUNT_SIZE];
+static blockdevice_driver_t* platform_driver;
+static blockdevice_driver_t counting_driver;
+
+static error_t counting_program(blockdevice_t* bd, const uint8_t* data, uint32_t addr, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; i++)
+        if (addr + i < PROGRAM_COUNT_SIZE)
+            program_count[addr + i]++;
+
+    return platform_driver->program(bd, data, addr, size);
+}
+
+static void make_record(uint32_t index, uint8_t* record)
+{
+    for (uint8_t i = 0; i < RECORD_SIZE; i++)
+        record[i] = (uint8_t)(index * 7 + i);
+}
+
+static void check_records(const uint8_t* buffer, uint32_t first, uint32_t count)
+{
+    uint8_t record[RECORD_SIZE];
+    for (uint32_t i = 0; i < count; i++) {
+        make_record(first + i, record);
+        assert(memcmp(buffer + i * RECORD_SIZE, record, RECORD_SIZE) == 0);
+    }
+}
+
+static void check_read(uint32_t offset, uint32_t length, uint32_t expected_first, uint32_t expected_count)
+{
+    uint8_t buffer[100];
+    assert(length <= sizeof(buffer));
+    assert(d7ap_fs_read_file_at(FILE_ID, &offset, buffer, &length, GUEST_AUTH) == SUCCESS);
+    assert(offset == expected_first);
+    assert(length == expected_count * RECORD_SIZE);
+    check_records(buffer, expected_first, expected_count);
+}
+
+static void append(uint32_t index)
+{
+    uint8_t record[RECORD_SIZE];
+    make_record(index, record);
+    assert(d7ap_fs_append_record(FILE_ID, record, ROOT_AUTH) == SUCCESS);
+}
+
+static void test_append_and_read()
+{
+    printf("Testing append and read ... ");
+    uint32_t tail, head;
+    assert(d7ap_fs_read_record_range(FILE_ID, &tail, &head) == SUCCESS);
+    assert(tail == 0 && head == 0);
+    check_read(D7AP_FS_LAST_RECORDS(5), 5 * RECORD_SIZE, 0, 0);
+    check_read(0, 5 * RECORD_SIZE, 0, 0);
+
+    for (uint32_t i = 0; i < 4; i++)
+        append(i);
+
+    check_read(0, 100, 0, 4);
+    check_read(D7AP_FS_LAST_RECORDS(2), 100, 2, 2);
+
+    // wrap around, the oldest records are overwritten
+    for (uint32_t i = 4; i < 25; i++)
+        append(i);
+
+    assert(d7ap_fs_read_record_range(FILE_ID, &tail, &head) == SUCCESS);
+    assert(tail == 15 && head == 25);
+    check_read(0, 100, 15, 10);                         // records which were overwritten are skipped
+    check_read(20, 3 * RECORD_SIZE + 2, 20, 3);         // only whole records
+    check_read(D7AP_FS_LAST_RECORDS(4), 100, 21, 4);
+    check_read(D7AP_FS_LAST_RECORDS(100), 100, 15, 10);
+    check_read(25, 100, 25, 0);                         // nothing new yet
+
+    uint32_t offset = 26;
+    uint32_t length = 10;
+    uint8_t buffer[10];
+    assert(d7ap_fs_read_file_at(FILE_ID, &offset, buffer, &length, GUEST_AUTH) == -EINVAL);
+    assert(d7ap_fs_write_file(FILE_ID, 0, buffer, 1, ROOT_AUTH) == -EINVAL);
+    assert(d7ap_fs_append_record(FILE_ID, buffer, GUEST_AUTH) == -EACCES);
+    printf("OK\n");
+}
+
+static void test_interrupted_counter_update()
+{
+    printf("Testing interrupted counter update ... ");
+    uint32_t tail, head;
+    assert(d7ap_fs_read_record_range(FILE_ID, &tail, &head) == SUCCESS);
+
+    // a slot which is only partially programmed is ignored
+    uint8_t garbage[D7AP_FS_CIRCULAR_SLOT_SIZE];
+    memset(garbage, 0xFF, sizeof(garbage));
+    uint32_t slot = (head + 1) % D7AP_FS_CIRCULAR_HEADER_SLOTS;
+    assert(fs_write_file(FILE_ID, sizeof(d7ap_fs_file_header_t) + 2 + slot * D7AP_FS_CIRCULAR_SLOT_SIZE, garbage, 4) == SUCCESS);
+    uint32_t new_tail, new_head;
+    assert(d7ap_fs_read_record_range(FILE_ID, &new_tail, &new_head) == SUCCESS);
+    assert(new_tail == tail && new_head == head);
+
+    append(head);
+    check_read(D7AP_FS_LAST_RECORDS(RECORD_COUNT), 100, head + 1 - RECORD_COUNT, RECORD_COUNT);
+    printf("OK\n");
+}
+
+static void test_wear()
+{
+    uint32_t tail, head;
+    assert(d7ap_fs_read_record_range(FILE_ID, &tail, &head) == SUCCESS);
+    memset(program_count, 0, sizeof(program_count));
+    for (uint32_t i = head; i < head + WEAR_APPEND_COUNT; i++)
+        append(i);
+
+    uint32_t file_address = fs_get_address(FILE_ID) + sizeof(d7ap_fs_file_header_t);
+    uint32_t max_counter_programs = 0;
+    for (uint32_t i = 0; i < D7AP_FS_CIRCULAR_HEADER_SIZE; i++)
+        if (program_count[file_address + i] > max_counter_programs)
+            max_counter_programs = program_count[file_address + i];
+
+    uint32_t max_record_programs = 0;
+    for (uint32_t i = D7AP_FS_CIRCULAR_HEADER_SIZE; i < D7AP_FS_CIRCULAR_FILE_SIZE(RECORD_SIZE, RECORD_COUNT); i++)
+        if (program_count[file_address + i] > max_record_programs)
+            max_record_programs = program_count[file_address + i];
+
+    printf("%u appends: counter bytes programmed at most %u times (%u when updated in place), record bytes %u times\n",
+        WEAR_APPEND_COUNT, max_counter_programs, WEAR_APPEND_COUNT, max_record_programs);
+    assert(max_counter_programs == WEAR_APPEND_COUNT / D7AP_FS_CIRCULAR_HEADER_SLOTS);
+    assert(max_record_programs == WEAR_APPEND_COUNT / RECORD_COUNT);
+}
+
+void bootstrap()
+{
+    printf("Unit-tests for circular files\n");
+    platform_driver = PLATFORM_PERMANENT_BLOCKDEVICE->driver;
+    counting_driver = *platform_driver;
+    counting_driver.program = counting_program;
+    PLATFORM_PERMANENT_BLOCKDEVICE->driver = &counting_driver;
+    fs_init();
+
+    d7ap_fs_file_header_t header = {
+        .file_permissions = (file_permission_t){ .guest_read = true, .user_read = true },
+        .file_properties.storage_class = FS_STORAGE_PERMANENT,
+        .allocated_length = D7AP_FS_CIRCULAR_FILE_SIZE(RECORD_SIZE, RECORD_COUNT),
+    };
+
+    assert(d7ap_fs_init_circular_file(FILE_ID, &header, 0) == -EINVAL);
+    assert(d7ap_fs_init_circular_file(FILE_ID, &header, RECORD_SIZE) == SUCCESS);
+    assert(d7ap_fs_read_file_header(FILE_ID, &header) == SUCCESS);
+    assert(header.file_properties.circular);
+    assert(header.length == D7AP_FS_CIRCULAR_FILE_SIZE(RECORD_SIZE, RECORD_COUNT));
+
+    test_append_and_read();
+    test_interrupted_counter_update();
+    test_wear();
+    exit(0); // there is nothing to schedule, do not enter the scheduler loop
+}
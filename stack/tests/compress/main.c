@@ -0,0 +1,66 @@
+#include "compress.h"
+#include "assert.h"
+#include "math.h"
+#include "stdio.h"
+
+// reference implementation using floating point, as specified T = (4^EXP)·(MANT)
+static uint8_t reference_compress(uint32_t value, bool ceil)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        if (value <= (pow(4, i) * 31))
+        {
+            uint32_t mantissa = value / pow(4, i);
+            uint32_t remainder = value % (uint32_t)(pow(4, i));
+
+            if (ceil && remainder)
+                mantissa++;
+
+            return (uint8_t)(i << 5 | mantissa);
+        }
+    }
+
+    return 0xFF;
+}
+
+void test_decompress()
+{
+    for (uint16_t ct = 0; ct <= 0xFF; ct++)
+        assert(CT_DECOMPRESS(ct) == pow(4, ct >> 5) * (ct & 0x1F));
+
+    assert(CT_DECOMPRESS(0xFF) == 507904);
+}
+
+void test_compress()
+{
+    for (uint32_t value = 0; value <= 507904; value++)
+    {
+        assert(compress_data(value, false) == reference_compress(value, false));
+        assert(compress_data(value, true) == reference_compress(value, true));
+        assert(CT_DECOMPRESS(compress_data(value, true)) >= value);
+        assert(CT_DECOMPRESS(compress_data(value, false)) <= value);
+    }
+}
+
+void test_saturate()
+{
+    assert(compress_data(507905, true) == 0xFF);
+    assert(compress_data(0xFFFFFFFF, false) == 0xFF);
+}
+
+int main()
+{
+    printf("Testing CT_DECOMPRESS ... ");
+    test_decompress();
+    printf("Success!\n");
+
+    printf("Testing compress_data ... ");
+    test_compress();
+    printf("Success!\n");
+
+    printf("Testing compress_data saturation ... ");
+    test_saturate();
+    printf("Success!\n");
+
+    return 0;
+}
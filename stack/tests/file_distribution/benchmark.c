@@ -0,0 +1,173 @@
+#include "file_distribution.h"
+#include "benchmark.h"
+#include "assert.h"
+#include "stdio.h"
+#include "string.h"
+
+// a file distributed to a group of receivers with multicast chunks and repair rounds, compared with sending it to
+// each receiver in turn with unicast requests
+#define RECEIVER_COUNT 100
+#define FILE_ID 0x50
+#define FILE_SIZE 4000
+#define CHUNK_SIZE 100
+#define LOSS_PERCENT 10
+#define UNICAST_MAX_ATTEMPTS 10
+
+// the dialogs at normal rate, durations in ms
+#define D7A_HEADERS 16 // DLL, D7ANP and D7ATP headers
+#define TURNAROUND_MS 5.0 // CCA and RX/TX switching
+#define LISTEN_TIMEOUT_MS 20.0
+#define RESPONSE_GUARD_MS 2.0
+#define UNICAST_REQUEST_OVERHEAD 7 // write file data action with a 3 byte offset and 2 byte length operand
+#define ACK_LENGTH 3
+#define POLL_REQUEST_LENGTH 10 // break query and read file data action
+#define POLL_RESPONSE_LENGTH (4 + FILE_DISTRIBUTION_STATUS_SIZE)
+
+typedef struct {
+    file_distribution_status_t status;
+    uint8_t data[FILE_SIZE];
+    bool asleep;
+} receiver_t;
+
+static receiver_t receivers[RECEIVER_COUNT];
+static uint8_t file[FILE_SIZE];
+
+static bool is_lost() { return !benchmark_received(100 - LOSS_PERCENT); }
+
+// the airtime of a frame with an ALP payload of the given length, the length byte and the CRC included
+static double get_frame_airtime(uint16_t payload_length)
+{
+    return benchmark_get_airtime(1 + D7A_HEADERS + payload_length + 2);
+}
+
+static void fill_file()
+{
+    for (int i = 0; i < FILE_SIZE; i++)
+        file[i] = benchmark_next_rnd();
+}
+
+static void verify_receivers(uint8_t session_id)
+{
+    for (int i = 0; i < RECEIVER_COUNT; i++) {
+        assert(memcmp(receivers[i].data, file, FILE_SIZE) == 0);
+        assert(receivers[i].status.completed_session_id == session_id);
+    }
+}
+
+static void receive_chunk(receiver_t* receiver, file_distribution_status_t* chunk_header, uint32_t offset, uint8_t length)
+{
+    // the ALP command writes the chunk data, followed by the chunk header which triggers the status update
+    memcpy(receiver->data + offset, file + offset, length);
+    memcpy(&receiver->status, chunk_header, FILE_DISTRIBUTION_CHUNK_HEADER_SIZE);
+    assert(file_distribution_receiver_process_status(&receiver->status));
+}
+
+static double distribute_multicast(uint8_t session_id, uint32_t* broadcast_count, uint32_t* poll_count)
+{
+    file_distribution_master_t master;
+    assert(file_distribution_master_init(&master, session_id, FILE_ID, FILE_SIZE, CHUNK_SIZE) == SUCCESS);
+    double time = 0;
+    *broadcast_count = 0;
+    *poll_count = 0;
+
+    // the first receiver misses the complete first round
+    receivers[0].asleep = true;
+    while (true) {
+        uint8_t chunk_index;
+        while (file_distribution_master_next_chunk(&master, &chunk_index)) {
+            uint8_t length = file_distribution_master_get_chunk_length(&master, chunk_index);
+            file_distribution_status_t chunk_header;
+            file_distribution_master_get_chunk_header(&master, chunk_index, &chunk_header);
+            time += get_frame_airtime(length + FILE_DISTRIBUTION_CHUNK_OVERHEAD) + TURNAROUND_MS;
+            (*broadcast_count)++;
+            for (int i = 0; i < RECEIVER_COUNT; i++) {
+                if (!receivers[i].asleep && !is_lost())
+                    receive_chunk(&receivers[i], &chunk_header, (uint32_t)chunk_index * CHUNK_SIZE, length);
+            }
+        }
+
+        receivers[0].asleep = false;
+
+        file_distribution_master_start_poll(&master);
+        time += get_frame_airtime(POLL_REQUEST_LENGTH) + TURNAROUND_MS;
+        (*poll_count)++;
+        double response_period = 0;
+        for (int i = 0; i < RECEIVER_COUNT; i++) {
+            if (is_lost())
+                continue; // poll not received
+
+            if (receivers[i].status.completed_session_id == session_id)
+                continue; // break query failed, no response
+
+            response_period += get_frame_airtime(POLL_RESPONSE_LENGTH) + RESPONSE_GUARD_MS;
+            if (!is_lost())
+                file_distribution_master_process_report(&master, &receivers[i].status);
+        }
+
+        time += response_period > LISTEN_TIMEOUT_MS ? response_period : LISTEN_TIMEOUT_MS;
+
+        file_distribution_poll_result_t result = file_distribution_master_end_poll(&master);
+        assert(result != FILE_DISTRIBUTION_POLL_FAILED);
+        if (result == FILE_DISTRIBUTION_POLL_DONE)
+            return time;
+    }
+}
+
+static double distribute_unicast()
+{
+    double time = 0;
+    uint32_t chunk_count = (FILE_SIZE + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    for (int i = 0; i < RECEIVER_COUNT; i++) {
+        memset(receivers[i].data, 0, FILE_SIZE);
+        for (uint32_t chunk = 0; chunk < chunk_count; chunk++) {
+            uint32_t offset = chunk * CHUNK_SIZE;
+            uint8_t length = FILE_SIZE - offset < CHUNK_SIZE ? FILE_SIZE - offset : CHUNK_SIZE;
+            uint8_t attempt = 0;
+            while (true) {
+                assert(attempt++ < UNICAST_MAX_ATTEMPTS);
+                time += get_frame_airtime(length + UNICAST_REQUEST_OVERHEAD) + TURNAROUND_MS;
+                if (!is_lost()) {
+                    memcpy(receivers[i].data + offset, file + offset, length);
+                    if (!is_lost()) {
+                        time += get_frame_airtime(ACK_LENGTH) + TURNAROUND_MS;
+                        break;
+                    }
+                }
+
+                time += LISTEN_TIMEOUT_MS; // no ACK, retry
+            }
+        }
+
+        assert(memcmp(receivers[i].data, file, FILE_SIZE) == 0);
+    }
+
+    return time;
+}
+
+int main(int argc, char* argv[])
+{
+    printf("Simulating the distribution of %i bytes to %i nodes with %i%% frame loss:\n", FILE_SIZE, RECEIVER_COUNT,
+           LOSS_PERCENT);
+    uint32_t chunk_count = (FILE_SIZE + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    uint32_t broadcast_count, poll_count;
+    memset(receivers, 0, sizeof(receivers));
+    benchmark_seed(BENCHMARK_SEED);
+
+    fill_file();
+    double multicast_time = distribute_multicast(1, &broadcast_count, &poll_count);
+    verify_receivers(1);
+    printf("multicast: %.0f ms, %u chunk broadcasts for %u chunks, %u polls\n", multicast_time, broadcast_count,
+           chunk_count, poll_count);
+
+    // a second session with new content, the receiver which misses the first round still reports the old session
+    fill_file();
+    multicast_time = distribute_multicast(2, &broadcast_count, &poll_count);
+    verify_receivers(2);
+    printf("multicast update: %.0f ms, %u chunk broadcasts for %u chunks, %u polls\n", multicast_time,
+           broadcast_count, chunk_count, poll_count);
+
+    double unicast_time = distribute_unicast();
+    printf("sequential unicast: %.0f ms\n", unicast_time);
+    assert(multicast_time < unicast_time);
+    return 0;
+}
@@ -0,0 +1,246 @@
+#include "file_distribution.h"
+#include "assert.h"
+#include "stdio.h"
+#include "string.h"
+
+#define FILE_ID 0x50
+#define FILE_SIZE 4000
+#define CHUNK_SIZE 100
+
+static void test_receiver()
+{
+    printf("Testing receiver status ... ");
+    file_distribution_status_t status;
+    memset(&status, 0, sizeof(status));
+
+    // nothing received yet
+    assert(!file_distribution_receiver_process_status(&status));
+
+    status.session_id = 1;
+    status.chunk_count = MODULE_ALP_FILE_DISTRIBUTION_MAX_CHUNK_COUNT + 1;
+    assert(!file_distribution_receiver_process_status(&status));
+
+    status.chunk_count = 10;
+    status.chunk_index = 3;
+    assert(file_distribution_receiver_process_status(&status));
+    assert(status.active_session_id == 1);
+    assert(status.completed_session_id == 0);
+    assert(status.missing[0] == 0xF7 && status.missing[1] == 0x03);
+
+    // out of range chunk index does not change the bitmap
+    status.chunk_index = 10;
+    assert(file_distribution_receiver_process_status(&status));
+    assert(status.missing[0] == 0xF7 && status.missing[1] == 0x03);
+
+    for (status.chunk_index = 0; status.chunk_index < 10; status.chunk_index++)
+        assert(file_distribution_receiver_process_status(&status));
+
+    assert(status.completed_session_id == 1);
+
+    // a new session resets the bitmap
+    status.session_id = 2;
+    status.chunk_count = 2;
+    status.chunk_index = 1;
+    assert(file_distribution_receiver_process_status(&status));
+    assert(status.active_session_id == 2);
+    assert(status.completed_session_id == 1);
+    assert(status.missing[0] == 0x01 && status.missing[1] == 0x00);
+    printf("OK\n");
+}
+
+static void test_master()
+{
+    printf("Testing master rounds ... ");
+    file_distribution_master_t master;
+    assert(file_distribution_master_init(&master, 0, FILE_ID, FILE_SIZE, CHUNK_SIZE) == -EINVAL);
+    assert(file_distribution_master_init(&master, 1, FILE_ID, FILE_SIZE, 0) == -EINVAL);
+    assert(file_distribution_master_init(&master, 1, FILE_ID, 0, CHUNK_SIZE) == -EINVAL);
+    assert(file_distribution_master_init(&master, 1, FILE_ID, (MODULE_ALP_FILE_DISTRIBUTION_MAX_CHUNK_COUNT + 1) * 10, 10)
+        == -EINVAL);
+
+    assert(file_distribution_master_init(&master, 1, FILE_ID, 250, 100) == SUCCESS);
+    assert(master.chunk_count == 3);
+    assert(file_distribution_master_get_chunk_length(&master, 0) == 100);
+    assert(file_distribution_master_get_chunk_length(&master, 2) == 50);
+
+    uint8_t chunk_index;
+    for (uint8_t i = 0; i < 3; i++) {
+        assert(file_distribution_master_next_chunk(&master, &chunk_index));
+        assert(chunk_index == i);
+    }
+
+    assert(!file_distribution_master_next_chunk(&master, &chunk_index));
+
+    // a receiver missing chunk 1
+    file_distribution_status_t report;
+    memset(&report, 0, sizeof(report));
+    report.session_id = 1;
+    report.active_session_id = 1;
+    report.missing[0] = 0x02;
+    file_distribution_master_start_poll(&master);
+    file_distribution_master_process_report(&master, &report);
+    assert(file_distribution_master_end_poll(&master) == FILE_DISTRIBUTION_POLL_REPAIR);
+    assert(file_distribution_master_next_chunk(&master, &chunk_index) && chunk_index == 1);
+    assert(!file_distribution_master_next_chunk(&master, &chunk_index));
+
+    // a receiver which missed the complete session still holds the bitmap of an older session, it misses all chunks
+    file_distribution_status_t other_session_report;
+    memset(&other_session_report, 0, sizeof(other_session_report));
+    other_session_report.session_id = 7;
+    other_session_report.active_session_id = 7;
+    other_session_report.missing[0] = 0x04;
+    file_distribution_master_start_poll(&master);
+    file_distribution_master_process_report(&master, &other_session_report);
+    assert(file_distribution_master_end_poll(&master) == FILE_DISTRIBUTION_POLL_REPAIR);
+    for (uint8_t i = 0; i < 3; i++)
+        assert(file_distribution_master_next_chunk(&master, &chunk_index) && chunk_index == i);
+
+    assert(!file_distribution_master_next_chunk(&master, &chunk_index));
+
+    for (uint8_t i = 1; i < MODULE_ALP_FILE_DISTRIBUTION_QUIET_POLL_COUNT; i++) {
+        file_distribution_master_start_poll(&master);
+        assert(file_distribution_master_end_poll(&master) == FILE_DISTRIBUTION_POLL_AGAIN);
+    }
+
+    file_distribution_master_start_poll(&master);
+    assert(file_distribution_master_end_poll(&master) == FILE_DISTRIBUTION_POLL_DONE);
+
+    // give up after the maximum number of repair rounds
+    assert(file_distribution_master_init(&master, 1, FILE_ID, 250, 100) == SUCCESS);
+    for (uint8_t i = 0; i <= MODULE_ALP_FILE_DISTRIBUTION_MAX_REPAIR_ROUNDS; i++) {
+        file_distribution_master_start_poll(&master);
+        file_distribution_master_process_report(&master, &report);
+        file_distribution_poll_result_t result = file_distribution_master_end_poll(&master);
+        if (i < MODULE_ALP_FILE_DISTRIBUTION_MAX_REPAIR_ROUNDS)
+            assert(result == FILE_DISTRIBUTION_POLL_REPAIR);
+        else
+            assert(result == FILE_DISTRIBUTION_POLL_FAILED);
+    }
+
+    printf("OK\n");
+}
+
+static void test_chunk_boundaries()
+{
+    printf("Testing chunk boundaries ... ");
+    file_distribution_master_t master;
+
+    // a file which is a multiple of the chunk size, the last chunk is complete
+    assert(file_distribution_master_init(&master, 1, FILE_ID, 3 * CHUNK_SIZE, CHUNK_SIZE) == SUCCESS);
+    assert(master.chunk_count == 3);
+    assert(file_distribution_master_get_chunk_length(&master, 2) == CHUNK_SIZE);
+
+    // one byte more takes a chunk of a single byte
+    assert(file_distribution_master_init(&master, 1, FILE_ID, 3 * CHUNK_SIZE + 1, CHUNK_SIZE) == SUCCESS);
+    assert(master.chunk_count == 4);
+    assert(file_distribution_master_get_chunk_length(&master, 3) == 1);
+
+    // a file smaller than a chunk
+    assert(file_distribution_master_init(&master, 1, FILE_ID, 1, CHUNK_SIZE) == SUCCESS);
+    assert(master.chunk_count == 1);
+    assert(file_distribution_master_get_chunk_length(&master, 0) == 1);
+
+    // exactly the maximum number of chunks, all are broadcast in the first round
+    uint32_t file_size = MODULE_ALP_FILE_DISTRIBUTION_MAX_CHUNK_COUNT * CHUNK_SIZE;
+    assert(file_distribution_master_init(&master, 1, FILE_ID, file_size, CHUNK_SIZE) == SUCCESS);
+    assert(file_distribution_master_init(&master, 1, FILE_ID, file_size + 1, CHUNK_SIZE) == -EINVAL);
+    assert(file_distribution_master_init(&master, 1, FILE_ID, file_size, CHUNK_SIZE) == SUCCESS);
+    uint8_t chunk_index;
+    uint16_t chunk_count = 0;
+    while (file_distribution_master_next_chunk(&master, &chunk_index))
+        assert(chunk_index == chunk_count++);
+
+    assert(chunk_count == MODULE_ALP_FILE_DISTRIBUTION_MAX_CHUNK_COUNT);
+
+    // a receiver completes the session with the last chunk
+    file_distribution_status_t status;
+    memset(&status, 0, sizeof(status));
+    file_distribution_master_get_chunk_header(&master, 0, &status);
+    for (uint16_t i = 0; i < MODULE_ALP_FILE_DISTRIBUTION_MAX_CHUNK_COUNT; i++) {
+        assert(status.completed_session_id == 0);
+        status.chunk_index = MODULE_ALP_FILE_DISTRIBUTION_MAX_CHUNK_COUNT - 1 - i;
+        assert(file_distribution_receiver_process_status(&status));
+    }
+
+    assert(status.completed_session_id == 1);
+    printf("OK\n");
+}
+
+static void test_repair_rounds()
+{
+    printf("Testing repair rounds ... ");
+    file_distribution_master_t master;
+    assert(file_distribution_master_init(&master, 1, FILE_ID, 8 * CHUNK_SIZE, CHUNK_SIZE) == SUCCESS);
+    uint8_t chunk_index;
+    while (file_distribution_master_next_chunk(&master, &chunk_index))
+        ;
+
+    // the union of the reports is rebroadcast in order, the bits beyond the last chunk are ignored
+    file_distribution_status_t first_report, second_report;
+    memset(&first_report, 0, sizeof(first_report));
+    first_report.active_session_id = 1;
+    second_report = first_report;
+    first_report.missing[0] = 0x20;
+    second_report.missing[0] = 0x21;
+    second_report.missing[1] = 0x01;
+    file_distribution_master_start_poll(&master);
+    file_distribution_master_process_report(&master, &first_report);
+    file_distribution_master_process_report(&master, &second_report);
+    assert(file_distribution_master_end_poll(&master) == FILE_DISTRIBUTION_POLL_REPAIR);
+    assert(file_distribution_master_next_chunk(&master, &chunk_index) && chunk_index == 0);
+    assert(file_distribution_master_next_chunk(&master, &chunk_index) && chunk_index == 5);
+    assert(!file_distribution_master_next_chunk(&master, &chunk_index));
+
+    // a report after a quiet poll starts the count of quiet polls again
+    file_distribution_master_start_poll(&master);
+    assert(file_distribution_master_end_poll(&master) == FILE_DISTRIBUTION_POLL_AGAIN);
+    file_distribution_master_start_poll(&master);
+    file_distribution_master_process_report(&master, &first_report);
+    assert(file_distribution_master_end_poll(&master) == FILE_DISTRIBUTION_POLL_REPAIR);
+    assert(file_distribution_master_next_chunk(&master, &chunk_index) && chunk_index == 5);
+    for (uint8_t i = 1; i < MODULE_ALP_FILE_DISTRIBUTION_QUIET_POLL_COUNT; i++) {
+        file_distribution_master_start_poll(&master);
+        assert(file_distribution_master_end_poll(&master) == FILE_DISTRIBUTION_POLL_AGAIN);
+    }
+
+    file_distribution_master_start_poll(&master);
+    assert(file_distribution_master_end_poll(&master) == FILE_DISTRIBUTION_POLL_DONE);
+    printf("OK\n");
+}
+
+static void test_duplicate_chunk()
+{
+    printf("Testing a chunk received twice ... ");
+    file_distribution_status_t status, copy;
+    memset(&status, 0, sizeof(status));
+    status.session_id = 1;
+    status.chunk_count = 2;
+    status.chunk_index = 0;
+    assert(file_distribution_receiver_process_status(&status));
+
+    // a rebroadcast chunk which was already received does not change the receiver state
+    copy = status;
+    assert(file_distribution_receiver_process_status(&status));
+    assert(memcmp(&status, &copy, sizeof(status)) == 0);
+
+    // nor does it after the session is completed
+    status.chunk_index = 1;
+    assert(file_distribution_receiver_process_status(&status));
+    assert(status.completed_session_id == 1);
+    copy = status;
+    status.chunk_index = 0;
+    assert(file_distribution_receiver_process_status(&status));
+    assert(status.completed_session_id == 1 && status.active_session_id == 1);
+    assert(memcmp(status.missing, copy.missing, sizeof(status.missing)) == 0);
+    printf("OK\n");
+}
+
+int main(int argc, char* argv[])
+{
+    test_receiver();
+    test_master();
+    test_chunk_boundaries();
+    test_repair_rounds();
+    test_duplicate_chunk();
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include "frame_decoder.h"
+#include "packet_codec.h"
+#include "crc.h"
+#include "fec.h"
+#include "pn9.h"
+#include "assert.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#define MAX_RAW_SIZE (2 * FEC_BUFFER_SIZE)
+
+static const uint8_t key[AES_BLOCK_SIZE] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static d7ap_addressee_t addressee;
+
+static void init_packet(packet_t* packet, uint8_t nls_method)
+{
+    memset(packet, 0, sizeof(packet_t));
+    addressee.ctrl.id_type = ID_TYPE_VID;
+    addressee.id[0] = 0x12;
+    addressee.id[1] = 0x34;
+    packet->d7anp_addressee = &addressee;
+    packet->dll_header.subnet = 0x05;
+    packet->dll_header.control_target_id_type = ID_TYPE_VID;
+    packet->dll_header.control_eirp_index = 30;
+    packet->d7anp_ctrl.origin_id_type = ID_TYPE_UID;
+    packet->d7anp_ctrl.nls_method = nls_method;
+    packet->origin_access_class = 0x01;
+    for (int i = 0; i < sizeof(packet->origin_access_id); i++)
+        packet->origin_access_id[i] = 0xA0 + i;
+    packet->d7anp_security.key_counter = 3;
+    packet->d7anp_security.frame_counter = 0x01020304;
+    packet->d7atp_ctrl.ctrl_is_ack_requested = true;
+    packet->d7atp_ctrl.ctrl_tl = true;
+    packet->d7atp_dialog_id = 42;
+    packet->d7atp_transaction_id = 7;
+    packet->d7atp_tl = 0x20;
+    packet->d7atp_tc = 0x10;
+}
+
+// builds a foreground request like the stack transmits it, returns the length of the raw frame
+static uint16_t encode_frame(packet_t* packet, const uint8_t* payload, uint8_t payload_length, phy_coding_t coding,
+                             uint8_t* raw)
+{
+    uint8_t* data = raw + 1;
+    data += packet_codec_encode_dll_header(packet, false, data, 32);
+    data += packet_codec_encode_d7anp_header(packet, data, 32);
+    uint8_t* nls_start = data;
+    data += packet_codec_encode_d7atp_header(packet, true, data, 32);
+    memcpy(data, payload, payload_length);
+    data += payload_length;
+
+    if (packet->d7anp_ctrl.nls_method)
+    {
+        uint8_t nls_length = data - nls_start;
+        uint8_t iv[AES_BLOCK_SIZE];
+        packet_codec_build_nls_iv(packet, nls_length, iv);
+        AES128_init(key);
+        if (packet->d7anp_ctrl.nls_method == AES_CTR)
+            AES128_CTR_encrypt(nls_start, nls_start, nls_length, iv);
+        else
+        {
+            uint8_t ctr_blk[AES_BLOCK_SIZE];
+            memcpy(ctr_blk, iv, AES_BLOCK_SIZE);
+            assert(AES128_CCM_encrypt(nls_start, nls_length, iv, NULL, 0, ctr_blk,
+                                      packet_codec_nls_auth_length(packet->d7anp_ctrl.nls_method)) == SUCCESS);
+        }
+
+        data += packet_codec_nls_auth_length(packet->d7anp_ctrl.nls_method);
+    }
+
+    uint16_t length = data - raw + 2;
+    raw[0] = length - 1;
+    uint16_t crc = __builtin_bswap16(crc_calculate(raw, length - 2));
+    memcpy(data, &crc, 2);
+
+    if (coding == PHY_CODING_FEC_PN9)
+        length = fec_encode(raw, length);
+
+    pn9_encode(raw, length);
+    return length;
+}
+
+static void check_decoded(packet_t* expected, packet_t* decoded, const uint8_t* payload, uint8_t payload_length)
+{
+    assert(decoded->type == INITIAL_REQUEST);
+    assert(decoded->dll_header.subnet == expected->dll_header.subnet);
+    assert(decoded->dll_header.control_eirp_index == expected->dll_header.control_eirp_index);
+    assert(memcmp(decoded->dll_header.target_address, addressee.id, 2) == 0);
+    assert(decoded->d7anp_ctrl.raw == expected->d7anp_ctrl.raw);
+    assert(memcmp(decoded->origin_access_id, expected->origin_access_id, 8) == 0);
+    assert(decoded->d7atp_dialog_id == expected->d7atp_dialog_id);
+    assert(decoded->d7atp_transaction_id == expected->d7atp_transaction_id);
+    assert(decoded->d7atp_tl == expected->d7atp_tl);
+    assert(decoded->d7atp_tc == expected->d7atp_tc);
+    assert(decoded->payload_length == payload_length);
+    assert(memcmp(packet_get_payload(decoded), payload, payload_length) == 0);
+}
+
+static void test_roundtrip(phy_coding_t coding, uint8_t nls_method)
+{
+    static packet_t packet;
+    static packet_t decoded;
+    static frame_decoder_t decoder;
+    uint8_t raw[MAX_RAW_SIZE];
+    uint8_t payload[64];
+
+    for (int i = 0; i < sizeof(payload); i++)
+        payload[i] = rand();
+
+    for (uint8_t payload_length = 0; payload_length <= sizeof(payload); payload_length += 7)
+    {
+        init_packet(&packet, nls_method);
+        uint16_t raw_length = encode_frame(&packet, payload, payload_length, coding, raw);
+
+        frame_decoder_init(&decoder, nls_method ? key : NULL);
+        assert(frame_decoder_decode(&decoder, raw, raw_length, coding, false, true, &decoded) == FRAME_DECODER_OK);
+        check_decoded(&packet, &decoded, payload, payload_length);
+    }
+}
+
+static void test_background()
+{
+    static packet_t decoded;
+    static frame_decoder_t decoder;
+    uint8_t raw[MAX_RAW_SIZE] = { 0x05, 0x42, 0x01, 0x23 };
+
+    uint16_t crc = __builtin_bswap16(crc_calculate(raw, BACKGROUND_FRAME_LENGTH - 2));
+    memcpy(raw + BACKGROUND_FRAME_LENGTH - 2, &crc, 2);
+    uint16_t raw_length = fec_encode(raw, BACKGROUND_FRAME_LENGTH);
+    pn9_encode(raw, raw_length);
+
+    frame_decoder_init(&decoder, NULL);
+    assert(frame_decoder_decode(&decoder, raw, raw_length, PHY_CODING_FEC_PN9, true, false, &decoded) == FRAME_DECODER_OK);
+    assert(decoded.type == BACKGROUND_ADV);
+    assert(decoded.dll_header.subnet == 0x05);
+    assert(decoded.dll_header.control_eirp_index == 0x02);
+    assert(decoded.ETA == 0x0123);
+}
+
+static void test_errors()
+{
+    static packet_t packet;
+    static packet_t decoded;
+    static frame_decoder_t decoder;
+    uint8_t raw[MAX_RAW_SIZE];
+    uint8_t payload[16] = { 0 };
+
+    init_packet(&packet, AES_NONE);
+    uint16_t raw_length = encode_frame(&packet, payload, sizeof(payload), PHY_CODING_PN9, raw);
+    frame_decoder_init(&decoder, NULL);
+
+    raw[raw_length - 1] ^= 0x01;
+    assert(frame_decoder_decode(&decoder, raw, raw_length, PHY_CODING_PN9, false, true, &decoded) == FRAME_DECODER_ERROR_CRC);
+    raw[raw_length - 1] ^= 0x01;
+
+    // a truncated capture
+    assert(frame_decoder_decode(&decoder, raw, raw_length - 1, PHY_CODING_PN9, false, true, &decoded) == FRAME_DECODER_ERROR_LENGTH);
+
+    // a secured frame without key
+    init_packet(&packet, AES_CTR);
+    raw_length = encode_frame(&packet, payload, sizeof(payload), PHY_CODING_PN9, raw);
+    assert(frame_decoder_decode(&decoder, raw, raw_length, PHY_CODING_PN9, false, true, &decoded) == FRAME_DECODER_ERROR_NLS);
+}
+
+int main()
+{
+    srand(0);
+
+    printf("Testing PN9 frames ... ");
+    test_roundtrip(PHY_CODING_PN9, AES_NONE);
+    printf("Success!\n");
+
+    printf("Testing FEC frames ... ");
+    test_roundtrip(PHY_CODING_FEC_PN9, AES_NONE);
+    printf("Success!\n");
+
+    printf("Testing background frames ... ");
+    test_background();
+    printf("Success!\n");
+
+    printf("Testing AES-CTR and AES-CCM frames ... ");
+    test_roundtrip(PHY_CODING_PN9, AES_CTR);
+    test_roundtrip(PHY_CODING_FEC_PN9, AES_CCM_64);
+    printf("Success!\n");
+
+    printf("Testing invalid frames ... ");
+    test_errors();
+    printf("Success!\n");
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "packet.h"
+#include "dll.h"
+#include "benchmark.h"
+#include "assert.h"
+#include "math.h"
+#include "stdio.h"
+
+// a requester flushes a FIFO of several requests in one dialog, the subsequent requests are sent without ad-hoc
+// synchronization and only reach the responders which are still listening. A request which is missed by a responder
+// is retried with ad-hoc synchronization, which takes Tsched of advertising. Durations in ms, the DLL constants and
+// the listen timeout in Ti are taken as ms.
+#define DIALOG_COUNT 5000
+#define REQUESTS_PER_DIALOG 4
+#define SINGLE_REQUEST_RETRY_LIMIT 3
+#define REQUEST_RECEIVED_PERCENT 95
+#define TSCHED_MS 512.0
+#define REQUEST_LENGTH 32
+#define RESPONSE_LENGTH 30
+
+#define MAX_RESPONDERS 8
+
+typedef enum {
+    NO_LISTEN,
+    WORST_CASE,
+    COMPUTED,
+    MODE_COUNT
+} listen_mode_t;
+
+static const char* mode_names[MODE_COUNT] = { "Tl = 0", "worst case Tl", "computed Tl" };
+
+typedef struct {
+    uint32_t retried;
+    double responder_rx;
+    double requester_rx;
+    double duration;
+} result_t;
+
+// the congestion period of the requester, the responders are the only other devices on the channel
+static double get_request_tc() { return (SFc + 1) * benchmark_get_airtime(REQUEST_LENGTH) + t_g; }
+
+static double get_response_tc(uint8_t responder_count)
+{
+    return (SFc * responder_count + 1) * benchmark_get_airtime(RESPONSE_LENGTH) + t_g;
+}
+
+// the listen timeout of a request, counted from its reception, see set_listen_timeout() in d7atp.c
+static double get_listen_timeout(listen_mode_t mode, uint8_t responder_count, uint8_t request)
+{
+    uint8_t remaining_requests = REQUESTS_PER_DIALOG - 1 - request;
+    if (mode == NO_LISTEN || !remaining_requests)
+        return 0;
+
+    // the PHY rounds the transmission duration up to a whole Ti
+    double tl = D7ATP_LISTEN_TIMEOUT(get_response_tc(responder_count), 0, ceil(benchmark_get_airtime(REQUEST_LENGTH)));
+    if (mode == WORST_CASE)
+        tl *= remaining_requests * SINGLE_REQUEST_RETRY_LIMIT; // the time needed to send all remaining requests, retried
+
+    return tl;
+}
+
+// simulates the transaction of one request, the time is counted from the end of the request
+static void transact(uint8_t responder_count, double* listen_started, double* request_sent, result_t* result)
+{
+    double response_airtime = benchmark_get_airtime(RESPONSE_LENGTH);
+    double tc = get_response_tc(responder_count);
+
+    // a unicast responder listens as soon as it responded, the requester sends the next request after the response.
+    // The responders of a broadcast request listen after the response period, which the requester waits for.
+    double next_request_ready = tc + t_t;
+    if (responder_count == 1)
+    {
+        listen_started[0] = benchmark_random_time(tc - response_airtime) + response_airtime;
+        next_request_ready = listen_started[0] + t_t;
+    }
+    else
+    {
+        for (uint8_t i = 0; i < responder_count; i++)
+            listen_started[i] = tc;
+    }
+
+    result->requester_rx += next_request_ready;
+    *request_sent = next_request_ready
+        + benchmark_random_time(get_request_tc() - benchmark_get_airtime(REQUEST_LENGTH) - t_g)
+        + benchmark_get_airtime(REQUEST_LENGTH);
+}
+
+static result_t simulate(listen_mode_t mode, uint8_t responder_count)
+{
+    result_t result = { 0 };
+    double request_airtime = benchmark_get_airtime(REQUEST_LENGTH);
+    benchmark_seed(BENCHMARK_SEED + responder_count); // the same links for all modes
+
+    for (uint32_t dialog = 0; dialog < DIALOG_COUNT; dialog++)
+    {
+        // the initial request is sent with ad-hoc synchronization
+        result.duration += TSCHED_MS + request_airtime;
+        for (uint8_t request = 0; request < REQUESTS_PER_DIALOG; request++)
+        {
+            double listen_started[MAX_RESPONDERS];
+            double request_sent;
+            transact(responder_count, listen_started, &request_sent, &result);
+            if (request == REQUESTS_PER_DIALOG - 1)
+            {
+                result.duration += get_response_tc(responder_count) + t_t;
+                break;
+            }
+
+            double tl = get_listen_timeout(mode, responder_count, request);
+            bool missed = false;
+            for (uint8_t i = 0; i < responder_count; i++)
+            {
+                if (tl <= listen_started[i])
+                {
+                    missed = true;
+                    continue;
+                }
+
+                // a responder stops listening when it receives the next request or when Tl expires
+                bool heard = request_sent <= tl && benchmark_received(REQUEST_RECEIVED_PERCENT);
+                result.responder_rx += ((heard ? request_sent : tl) - listen_started[i]) / responder_count;
+                if (!heard)
+                    missed = true;
+            }
+
+            result.duration += request_sent;
+            if (!missed)
+                continue;
+
+            // the requester does not hear all responders, waits for the end of the response period and retries the
+            // next request with ad-hoc synchronization, which reaches the responders by their background scan
+            result.retried++;
+            double tc = get_response_tc(responder_count) + t_t;
+            result.requester_rx += tc;
+            result.duration += tc + TSCHED_MS + request_airtime;
+        }
+    }
+
+    return result;
+}
+
+static void test_dialogs(uint8_t responder_count)
+{
+    printf("%u responder%s:\n", responder_count, responder_count > 1 ? "s, broadcast" : ", unicast");
+    result_t results[MODE_COUNT];
+    for (listen_mode_t mode = 0; mode < MODE_COUNT; mode++)
+    {
+        results[mode] = simulate(mode, responder_count);
+        result_t* result = &results[mode];
+        printf("  %-14s %5.1f%% of the subsequent requests retried, RX on %5.1f ms (responder) %5.1f ms (requester), %6.1f ms per dialog\n",
+               mode_names[mode], 100.0 * result->retried / (DIALOG_COUNT * (REQUESTS_PER_DIALOG - 1)),
+               result->responder_rx / DIALOG_COUNT,
+               result->requester_rx / DIALOG_COUNT, result->duration / DIALOG_COUNT);
+    }
+
+    // the responders listen long enough to receive the next request, but not longer
+    assert(results[COMPUTED].retried * 2 < results[NO_LISTEN].retried);
+    assert(results[COMPUTED].retried == results[WORST_CASE].retried);
+    assert(results[COMPUTED].responder_rx < results[WORST_CASE].responder_rx);
+    assert(results[COMPUTED].requester_rx < results[NO_LISTEN].requester_rx);
+    assert(results[COMPUTED].duration < results[NO_LISTEN].duration);
+}
+
+int main(int argc, char* argv[])
+{
+    // the next request arrives before Tl expires, even when it waits for the whole congestion period
+    for (uint8_t responder_count = 1; responder_count <= MAX_RESPONDERS; responder_count++)
+    {
+        double latest_request = get_response_tc(responder_count) + t_t + get_request_tc() - t_g;
+        assert(get_listen_timeout(COMPUTED, responder_count, 0) >= latest_request);
+        assert(get_listen_timeout(COMPUTED, responder_count, REQUESTS_PER_DIALOG - 1) == 0);
+    }
+
+    printf("Simulating %u dialogs of %u requests, %u%% of the requests received\n", DIALOG_COUNT, REQUESTS_PER_DIALOG,
+           REQUEST_RECEIVED_PERCENT);
+    test_dialogs(1);
+    test_dialogs(8);
+    return 0;
+}
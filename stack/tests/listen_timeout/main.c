@@ -0,0 +1,65 @@
+#include "packet.h"
+#include "dll.h"
+#include "compress.h"
+#include "assert.h"
+#include "stdio.h"
+
+// the transmission durations of the next request, in Ti, from a short request on a hi rate channel to a long one on a
+// lo rate channel
+static const uint16_t tx_durations[] = { 0, 1, 4, 12, 40, 270 };
+
+// response periods and execution delays, in Ti, as they are decompressed from the request
+static const timer_tick_t periods[] = { 0, 1, 31, 32, 124, 1024, 507904 };
+
+#define COUNT(array) (sizeof(array) / sizeof(array[0]))
+
+static void test_next_request_covered()
+{
+    printf("Testing the listen timeout covers the next request ... ");
+    for (uint8_t i = 0; i < COUNT(tx_durations); i++)
+    {
+        uint16_t tx_duration = tx_durations[i];
+        // without response period the responders still wait for the turnaround of the requester and the next request,
+        // which may start at the end of its congestion period
+        timer_tick_t tl = D7ATP_LISTEN_TIMEOUT(0, 0, tx_duration);
+        assert(tl == t_t + (SFc + 1) * tx_duration + t_g);
+        assert(tl > 0);
+
+        for (uint8_t j = 0; j < COUNT(periods); j++)
+        {
+            // the responders wait for the whole response period and the execution delay before the next request
+            assert(D7ATP_LISTEN_TIMEOUT(periods[j], 0, tx_duration) == tl + periods[j]);
+            assert(D7ATP_LISTEN_TIMEOUT(0, periods[j], tx_duration) == tl + periods[j]);
+            assert(D7ATP_LISTEN_TIMEOUT(periods[j], periods[j], tx_duration) == tl + 2 * periods[j]);
+        }
+    }
+
+    printf("OK\n");
+}
+
+static void test_compressed_listen_timeout()
+{
+    printf("Testing the compressed listen timeout does not expire early ... ");
+    for (uint8_t i = 0; i < COUNT(tx_durations); i++)
+    {
+        for (uint8_t j = 0; j < COUNT(periods); j++)
+        {
+            // Tl is compressed with rounding up, like set_listen_timeout() does
+            timer_tick_t tl = D7ATP_LISTEN_TIMEOUT(periods[j], 0, tx_durations[i]);
+            if (tl > CT_DECOMPRESS(0xFF))
+                continue;
+
+            timer_tick_t decompressed_tl = CT_DECOMPRESS(compress_data(tl, true));
+            assert(decompressed_tl >= tl);
+        }
+    }
+
+    printf("OK\n");
+}
+
+int main(int argc, char* argv[])
+{
+    test_next_request_covered();
+    test_compressed_listen_timeout();
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "scheduler.h"
+#include "timer.h"
+#include "hwsystem.h"
+#include "assert.h"
+#include "stdio.h"
+
+#define MS_TO_TICKS(ms) (((ms) * TIMER_TICKS_PER_SEC + 999) / 1000)
+#define US_TO_TICKS(us) (((us) * TIMER_TICKS_PER_SEC + 999999) / 1000000)
+
+// current of the MCU while running, the radio is not taken into account since it is the same for every policy
+#define ACTIVE_CURRENT_NA 3500000
+#define SENSOR_INTERVAL_TICKS (TIMER_TICKS_PER_SEC * 10)
+
+#define ALL_MODES 0xFF
+
+// one step of the sensor_push cycle: the MCU runs for active_us, and then sleeps for idle_ticks. The MCU is woken up
+// by a timer, or by a radio interrupt while the next timer event is still time_to_next_event away.
+typedef struct {
+    const char* name;
+    uint32_t active_us;
+    uint32_t idle_ticks;
+    bool woken_by_timer;
+    uint32_t time_to_next_event;
+} step_t;
+
+// a measurement reported in a dialog with response mode preferred, at normal rate
+static const step_t sensor_push_cycle[] = {
+    { "measurement, CSMA-CA backoff", 1500, MS_TO_TICKS(3), true, 0 },
+    { "CCA1, guard time", 300, MS_TO_TICKS(5), true, 0 },
+    { "CCA2, transmission", 300, MS_TO_TICKS(4), false, MS_TO_TICKS(40) },
+    { "transmitted, remaining guard time", 300, 1, true, 0 },
+    { "waiting for the response", 200, MS_TO_TICKS(8), false, MS_TO_TICKS(30) },
+    { "response, until the next measurement", 1000, 0, true, 0 }, // idle time is the rest of the interval
+};
+
+#define STEP_COUNT (sizeof(sensor_push_cycle) / sizeof(sensor_push_cycle[0]))
+
+typedef struct {
+    double charge_uc;
+    uint32_t late_wakeup_count;
+    uint32_t ticks_in_mode[SCHED_MAX_LOW_POWER_MODES];
+} result_t;
+
+static double charge_uc(uint32_t current_na, double duration_s) { return current_na * duration_s / 1000.0; }
+
+// fixed_mode_index selects a fixed mode, or -1 to use the automatic selection
+static result_t simulate_cycle(const hw_lowpower_mode_t* modes, uint8_t mode_count, int fixed_mode_index)
+{
+    result_t result = { 0 };
+    uint32_t elapsed_ticks = 0;
+    for (uint8_t i = 0; i < STEP_COUNT; i++) {
+        const step_t* step = &sensor_push_cycle[i];
+        uint32_t idle_ticks = step->idle_ticks;
+        elapsed_ticks += US_TO_TICKS(step->active_us);
+        if (idle_ticks == 0)
+            idle_ticks = SENSOR_INTERVAL_TICKS - elapsed_ticks;
+
+        elapsed_ticks += idle_ticks;
+        uint32_t time_to_next_event = step->woken_by_timer ? idle_ticks : step->time_to_next_event;
+        uint8_t index = fixed_mode_index >= 0
+            ? fixed_mode_index
+            : sched_select_low_power_mode(modes, mode_count, ALL_MODES, time_to_next_event);
+
+        // the counter may increment right after the MCU went to sleep, so in the worst case the timer fires one tick
+        // earlier than the idle time. Mode 0 only halts the core, it is always left in time.
+        double idle_s = (double)idle_ticks / TIMER_TICKS_PER_SEC;
+        double worst_case_idle_s = (double)(idle_ticks - 1) / TIMER_TICKS_PER_SEC;
+        if (step->woken_by_timer && index > 0 && modes[index].wakeup_latency_us / 1000000.0 > worst_case_idle_s)
+            result.late_wakeup_count++;
+
+        result.ticks_in_mode[index] += idle_ticks;
+        double transition_s = modes[index].wakeup_latency_us / 1000000.0;
+        result.charge_uc += charge_uc(ACTIVE_CURRENT_NA, step->active_us / 1000000.0 + transition_s);
+        result.charge_uc += charge_uc(modes[index].current_na, idle_s);
+    }
+
+    return result;
+}
+
+static void print_result(const char* name, result_t result, const hw_lowpower_mode_t* modes, uint8_t mode_count)
+{
+    printf("%-28s %8.2f uC per cycle, average %7.2f uA, %u late wakeups, idle ticks per mode:", name,
+        result.charge_uc, result.charge_uc / (SENSOR_INTERVAL_TICKS / (double)TIMER_TICKS_PER_SEC),
+        result.late_wakeup_count);
+    for (uint8_t i = 0; i < mode_count; i++)
+        printf(" %u: %u", modes[i].mode, result.ticks_in_mode[i]);
+
+    printf("\n");
+}
+
+static void test_select()
+{
+    printf("Testing low power mode selection ... ");
+    static const hw_lowpower_mode_t modes[] = {
+        { .mode = 0, .wakeup_latency_us = 1, .current_na = 1000000 },
+        { .mode = 1, .wakeup_latency_us = 100, .current_na = 1000 },
+        { .mode = 2, .wakeup_latency_us = 10000, .current_na = 500 },
+    };
+
+    assert(sched_select_low_power_mode(modes, 3, ALL_MODES, TIMER_NO_EVENT_PENDING) == 2);
+    assert(sched_select_low_power_mode(modes, 3, 1, TIMER_NO_EVENT_PENDING) == 1);
+    assert(sched_select_low_power_mode(modes, 3, 0, TIMER_NO_EVENT_PENDING) == 0);
+    assert(sched_select_low_power_mode(modes, 3, ALL_MODES, 0) == 0);
+    assert(sched_select_low_power_mode(modes, 3, ALL_MODES, 1) == 0);
+    assert(sched_select_low_power_mode(modes, 3, ALL_MODES, MS_TO_TICKS(5)) == 1);
+    assert(sched_select_low_power_mode(modes, 3, ALL_MODES, MS_TO_TICKS(20)) == 2);
+    assert(sched_select_low_power_mode(modes, 1, ALL_MODES, TIMER_NO_EVENT_PENDING) == 0);
+    printf("OK\n");
+}
+
+static void test_sensor_push()
+{
+    uint8_t mode_count;
+    const hw_lowpower_mode_t* modes = hw_get_lowpower_modes(&mode_count);
+    assert(mode_count >= 1 && mode_count <= SCHED_MAX_LOW_POWER_MODES);
+    assert(modes[0].mode == 0);
+
+    printf("Simulating a sensor_push cycle of %u ms:\n", SENSOR_INTERVAL_TICKS * 1000 / TIMER_TICKS_PER_SEC);
+    result_t fixed_shallow = simulate_cycle(modes, mode_count, 0);
+    print_result("fixed mode 0", fixed_shallow, modes, mode_count);
+    result_t fixed_deep = simulate_cycle(modes, mode_count, mode_count - 1);
+    char name[32];
+    snprintf(name, sizeof(name), "fixed mode %u", modes[mode_count - 1].mode);
+    print_result(name, fixed_deep, modes, mode_count);
+    result_t automatic = simulate_cycle(modes, mode_count, -1);
+    print_result("automatic", automatic, modes, mode_count);
+    // the automatic selection only stays out of the deepest mode when its wakeup latency does not fit, so it costs
+    // more than the deepest fixed mode when that one wakes up late
+    printf("The automatic selection uses %+.1f%% charge compared to fixed mode %u, with %u instead of %u late wakeups\n",
+        100.0 * (automatic.charge_uc - fixed_deep.charge_uc) / fixed_deep.charge_uc, modes[mode_count - 1].mode,
+        automatic.late_wakeup_count, fixed_deep.late_wakeup_count);
+    printf("On a device the automatic selection never goes deeper than FRAMEWORK_SCHEDULER_LP_MODE, which defaults "
+        "to 0\n");
+
+    assert(automatic.late_wakeup_count == 0);
+    assert(automatic.charge_uc <= fixed_shallow.charge_uc);
+    assert(fixed_deep.late_wakeup_count > 0 || automatic.charge_uc <= fixed_deep.charge_uc);
+    if (mode_count > 1)
+        assert(automatic.charge_uc < fixed_shallow.charge_uc / 10);
+}
+
+int main(int argc, char* argv[])
+{
+    test_select();
+    test_sensor_push();
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include "packet_codec.h"
+#include "assert.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "time.h"
+
+#define FUZZ_ITERATIONS 100000
+#define BENCHMARK_ITERATIONS 1000000
+#define MAX_HEADER_SIZE (32 + D7ATP_ACK_RECORD_MAX_LENGTH)
+
+typedef enum {
+    HEADER_DLL,
+    HEADER_DLL_BACKGROUND,
+    HEADER_D7ANP,
+    HEADER_D7ATP_REQUEST,
+    HEADER_D7ATP_RESPONSE,
+    HEADER_COUNT
+} header_t;
+
+static const char* header_names[HEADER_COUNT] = { "DLL", "DLL background", "D7ANP", "D7ATP request", "D7ATP response" };
+
+static d7ap_addressee_t addressee;
+
+static uint8_t encode(header_t header, packet_t* packet, uint8_t* data, uint8_t size)
+{
+    switch (header)
+    {
+        case HEADER_DLL: return packet_codec_encode_dll_header(packet, false, data, size);
+        case HEADER_DLL_BACKGROUND: return packet_codec_encode_dll_header(packet, true, data, size);
+        case HEADER_D7ANP: return packet_codec_encode_d7anp_header(packet, data, size);
+        case HEADER_D7ATP_REQUEST: return packet_codec_encode_d7atp_header(packet, true, data, size);
+        case HEADER_D7ATP_RESPONSE: return packet_codec_encode_d7atp_header(packet, false, data, size);
+        default: assert(false);
+    }
+}
+
+static uint8_t decode(header_t header, packet_t* packet, const uint8_t* data, uint8_t size)
+{
+    switch (header)
+    {
+        case HEADER_DLL: return packet_codec_decode_dll_header(packet, false, data, size);
+        case HEADER_DLL_BACKGROUND: return packet_codec_decode_dll_header(packet, true, data, size);
+        case HEADER_D7ANP: return packet_codec_decode_d7anp_header(packet, data, size);
+        case HEADER_D7ATP_REQUEST: return packet_codec_decode_d7atp_header(packet, true, data, size);
+        case HEADER_D7ATP_RESPONSE: return packet_codec_decode_d7atp_header(packet, false, data, size);
+        default: assert(false);
+    }
+}
+
+static void fill_random(void* buffer, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        ((uint8_t*)buffer)[i] = rand();
+}
+
+static void randomize_packet(packet_t* packet)
+{
+    memset(packet, 0, sizeof(packet_t));
+    fill_random(&packet->dll_header.subnet, 1);
+    packet->dll_header.control_target_id_type = rand() % 4;
+    packet->dll_header.control_eirp_index = rand() % 64;
+    fill_random(addressee.id, sizeof(addressee.id));
+    packet->d7anp_addressee = &addressee;
+    fill_random(&packet->d7anp_ctrl.raw, 1);
+    fill_random(&packet->d7anp_hop_ctrl.raw, 1);
+    fill_random(&packet->origin_access_class, 1);
+    fill_random(packet->origin_access_id, sizeof(packet->origin_access_id));
+    fill_random(packet->destination_access_id, sizeof(packet->destination_access_id));
+    fill_random(&packet->d7anp_security.key_counter, 1);
+    fill_random(&packet->d7anp_security.frame_counter, sizeof(uint32_t));
+    fill_random(&packet->d7atp_ctrl.ctrl_raw, 1);
+    fill_random(&packet->d7atp_dialog_id, 1);
+    fill_random(&packet->d7atp_transaction_id, 1);
+    fill_random(&packet->d7atp_target_rx_level_i, 1);
+    fill_random(&packet->d7atp_tl, 1);
+    fill_random(&packet->d7atp_te, 1);
+    fill_random(&packet->d7atp_tc, 1);
+    fill_random(&packet->d7atp_ack_template, sizeof(d7atp_ack_template_t));
+#ifdef MODULE_D7AP_ACK_RECORD_ENABLED
+    packet->d7atp_ack_template.ack_record_count %= D7ATP_ACK_RECORD_SIZE + 1;
+#endif
+}
+
+// encoding the decoded header has to result in the same bytes
+void test_roundtrip()
+{
+    static packet_t packet;
+    static packet_t decoded_packet;
+    static d7ap_addressee_t decoded_addressee;
+    uint8_t data[MAX_HEADER_SIZE];
+    uint8_t reencoded_data[MAX_HEADER_SIZE];
+
+    for (int i = 0; i < FUZZ_ITERATIONS; i++)
+    {
+        header_t header = rand() % HEADER_COUNT;
+        randomize_packet(&packet);
+        uint8_t length = encode(header, &packet, data, sizeof(data));
+        assert(length > 0);
+
+        // a smaller buffer is refused without writing to it
+        uint8_t size = rand() % (length + 1);
+        memset(reencoded_data, 0xAA, sizeof(reencoded_data));
+        uint8_t truncated_length = encode(header, &packet, reencoded_data, size);
+        assert(truncated_length == (size == length ? length : 0));
+        if (truncated_length == 0)
+            for (int j = 0; j < sizeof(reencoded_data); j++)
+                assert(reencoded_data[j] == 0xAA);
+
+        memset(&decoded_packet, 0, sizeof(packet_t));
+        assert(decode(header, &decoded_packet, data, length) == length);
+        assert(decode(header, &decoded_packet, data, length - 1) == 0);
+
+        memcpy(decoded_addressee.id, decoded_packet.dll_header.target_address, sizeof(decoded_addressee.id));
+        decoded_packet.d7anp_addressee = &decoded_addressee;
+        assert(encode(header, &decoded_packet, reencoded_data, sizeof(reencoded_data)) == length);
+        assert(memcmp(data, reencoded_data, length) == 0);
+    }
+}
+
+// decoding random data may never consume more than the provided size
+void test_random_data()
+{
+    static packet_t packet;
+    uint8_t data[MAX_HEADER_SIZE];
+
+    for (int i = 0; i < FUZZ_ITERATIONS; i++)
+    {
+        header_t header = rand() % HEADER_COUNT;
+        uint8_t size = rand() % (sizeof(data) + 1);
+        fill_random(data, sizeof(data));
+        uint8_t length = decode(header, &packet, data, size);
+        if (length == 0)
+            continue;
+
+        assert(length <= size);
+        assert(decode(header, &packet, data, length) == length);
+        assert(decode(header, &packet, data, length - 1) == 0);
+    }
+}
+
+void benchmark()
+{
+    static packet_t packet;
+    uint8_t data[MAX_HEADER_SIZE];
+    volatile uint32_t total_length = 0;
+
+    // all optional fields present
+    randomize_packet(&packet);
+    packet.dll_header.control_target_id_type = ID_TYPE_UID;
+    packet.d7anp_ctrl.origin_void = false;
+    packet.d7anp_ctrl.origin_id_type = ID_TYPE_UID;
+    packet.d7anp_ctrl.hop_enabled = true;
+    packet.d7anp_hop_ctrl.destination_id_type = ID_TYPE_UID;
+    packet.d7anp_ctrl.nls_method = AES_CCM_32;
+    packet.d7atp_ctrl.ctrl_raw = 0xFF;
+
+    for (header_t header = 0; header < HEADER_COUNT; header++)
+    {
+        clock_t start = clock();
+        for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+            total_length += encode(header, &packet, data, sizeof(data));
+        clock_t encoded = clock();
+        for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+            total_length += decode(header, &packet, data, sizeof(data));
+        clock_t decoded = clock();
+
+        printf("%s: %.1f M encodes/s, %.1f M decodes/s\n", header_names[header],
+            BENCHMARK_ITERATIONS / (1e6 * (encoded - start + 1) / CLOCKS_PER_SEC),
+            BENCHMARK_ITERATIONS / (1e6 * (decoded - encoded + 1) / CLOCKS_PER_SEC));
+    }
+}
+
+int main()
+{
+    srand(0);
+
+    printf("Testing header roundtrip ... ");
+    test_roundtrip();
+    printf("Success!\n");
+
+    printf("Testing decoding random data ... ");
+    test_random_data();
+    printf("Success!\n");
+
+    printf("Benchmarking header codecs\n");
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,286 @@
+#include "timer.h"
+#include "scheduler.h"
+#include "hwtimer.h"
+#include "hwsystem.h"
+#include "errors.h"
+#include "assert.h"
+#include "stdio.h"
+#include "stdlib.h"
+
+// the hardware timer and the CPU time are simulated, time only advances while a task is running (or busy waiting)
+// and while sleeping until the next timer interrupt
+#define US_PER_SEC 1000000
+#define LONG_TASK_US 20000
+#define BACKGROUND_WORK_US 100
+
+// the DLL waits this long between CCA1 and CCA2, and the sx127x driver after the packet sent interrupt
+#define CCA_GAP_US 5000
+#define TX_DONE_WAIT_US 110
+#define TX_AIRTIME_US 4000
+
+// RSSI settling times of the sx127x with the RX bandwidths and RSSI smoothing of the default factory settings
+typedef struct {
+    const char* name;
+    uint32_t rssi_us;
+} channel_class_t;
+
+static const channel_class_t channel_classes[] = {
+    { "lo rate", 831 },
+    { "normal rate", 150 },
+    { "hi rate", 121 },
+};
+
+#define CHANNEL_CLASS_COUNT (sizeof(channel_classes) / sizeof(channel_classes[0]))
+
+static uint64_t now_us;
+static uint64_t busy_wait_us;
+static timer_callback_t compare_callback;
+static timer_callback_t overflow_callback;
+static bool compare_armed;
+static hwtimer_tick_t compare_tick;
+static const hwtimer_info_t timer_info = { .min_delay_ticks = 3 };
+
+static uint32_t ticks_at(uint64_t us) { return us * TIMER_TICKS_PER_SEC / US_PER_SEC; }
+
+static uint64_t first_us_of_tick(uint32_t tick) { return ((uint64_t)tick * US_PER_SEC + TIMER_TICKS_PER_SEC - 1) / TIMER_TICKS_PER_SEC; }
+
+// runs the CPU for duration_us, the timer interrupts are executed as soon as they are due
+static void advance(uint64_t duration_us)
+{
+    uint64_t end = now_us + duration_us;
+    while (first_us_of_tick(ticks_at(now_us) + 1) <= end) {
+        uint32_t tick = ticks_at(now_us) + 1;
+        now_us = first_us_of_tick(tick);
+        if ((hwtimer_tick_t)tick == 0)
+            overflow_callback();
+
+        if (compare_armed && (hwtimer_tick_t)tick == compare_tick) {
+            compare_armed = false;
+            compare_callback();
+        }
+    }
+
+    if (now_us < end)
+        now_us = end;
+}
+
+error_t hw_timer_init(hwtimer_id_t timer_id, uint8_t frequency, timer_callback_t compare_cb, timer_callback_t overflow_cb)
+{
+    compare_callback = compare_cb;
+    overflow_callback = overflow_cb;
+    return SUCCESS;
+}
+
+const hwtimer_info_t* hw_timer_get_info(hwtimer_id_t timer_id) { return &timer_info; }
+
+hwtimer_tick_t hw_timer_getvalue(hwtimer_id_t timer_id) { return (hwtimer_tick_t)ticks_at(now_us); }
+
+error_t hw_timer_schedule(hwtimer_id_t timer_id, hwtimer_tick_t tick)
+{
+    compare_tick = tick;
+    compare_armed = true;
+    return SUCCESS;
+}
+
+error_t hw_timer_cancel(hwtimer_id_t timer_id)
+{
+    compare_armed = false;
+    return SUCCESS;
+}
+
+bool hw_timer_is_overflow_pending(hwtimer_id_t id) { return false; }
+
+void hw_busy_wait(int16_t microseconds)
+{
+    busy_wait_us += microseconds;
+    advance(microseconds);
+}
+
+void __watchdog_init(void) {}
+
+void hw_watchdog_feed(void) {}
+
+uint8_t hw_watchdog_get_timeout(void) { return 0; }
+
+static void start_next_scenario();
+
+void hw_enter_lowpower_mode(uint8_t mode)
+{
+    if (!compare_armed) {
+        start_next_scenario();
+        return;
+    }
+
+    // sleep until the compare interrupt
+    hwtimer_tick_t delay = compare_tick - hw_timer_getvalue(0);
+    uint32_t tick = ticks_at(now_us) + (delay ? delay : 0x10000);
+    advance(first_us_of_tick(tick) - now_us);
+}
+
+// jitter of a timer task and the precise lanes which are due while a long task is running, with another long task
+// pending
+
+static timer_tick_t fire_time;
+static timer_tick_t normal_task_time;
+static timer_tick_t radio_lane_time;
+static timer_tick_t dll_lane_time;
+static bool replaced_lane_called;
+
+static void long_task(void* arg) { advance(LONG_TASK_US); }
+static void pending_task(void* arg) { advance(LONG_TASK_US); }
+static void normal_task(void* arg) { normal_task_time = timer_get_counter_value(); }
+static void radio_lane(void* arg) { radio_lane_time = timer_get_counter_value(); }
+static void dll_lane(void* arg) { dll_lane_time = timer_get_counter_value(); }
+static void replaced_lane(void* arg) { replaced_lane_called = true; }
+
+static void start_jitter_scenario()
+{
+    printf("Testing the jitter while a task of %u us is running ... ", LONG_TASK_US);
+    fire_time = timer_get_counter_value() + 2 * ticks_at(CCA_GAP_US);
+    sched_post_task(&long_task);
+    sched_post_task(&pending_task);
+    assert(timer_post_task_prio(&normal_task, fire_time, DEFAULT_PRIORITY, 0, NULL) == SUCCESS);
+    assert(timer_post_precise_task(TIMER_PRECISE_LANE_RADIO, &radio_lane, fire_time, NULL) == SUCCESS);
+
+    // posting on a lane replaces the pending function of that lane only
+    assert(timer_post_precise_task(TIMER_PRECISE_LANE_DLL, &replaced_lane, fire_time, NULL) == SUCCESS);
+    busy_wait_us = 0;
+    assert(timer_post_precise_task(TIMER_PRECISE_LANE_DLL, &dll_lane, fire_time, NULL) == SUCCESS);
+    assert(busy_wait_us == 0);
+}
+
+static void check_jitter_scenario()
+{
+    printf("timer task %u ticks late, radio lane %u ticks late, DLL lane %u ticks late\n", normal_task_time - fire_time,
+        radio_lane_time - fire_time, dll_lane_time - fire_time);
+    assert(!replaced_lane_called);
+    // the lanes are called from the timer interrupt while the task is running, at most the interrupt latency of the
+    // timer late when they are due at the same tick, whatever the length of the running task
+    assert(radio_lane_time - fire_time <= timer_info.min_delay_ticks + 1);
+    assert(dll_lane_time - fire_time <= timer_info.min_delay_ticks + 1);
+    // the timer task waits for both long tasks
+    assert(normal_task_time - fire_time >= 2 * ticks_at(LONG_TASK_US) - ticks_at(2 * CCA_GAP_US) - 1);
+}
+
+// a CSMA-CA attempt which is structured like the DLL and the sx127x driver, while the application keeps the CPU busy
+
+static const channel_class_t* channel_class;
+static bool csma_busy;
+static uint64_t csma_start_us;
+static uint64_t background_work_us;
+static task_t rssi_valid_task;
+
+static void background_task(void* arg)
+{
+    if (!csma_busy)
+        return;
+
+    advance(BACKGROUND_WORK_US);
+    background_work_us += BACKGROUND_WORK_US;
+    sched_post_task(&background_task);
+}
+
+// the continuations of the radio driver, called from the radio lane
+static void signal_packet_transmitted(void* arg) { csma_busy = false; }
+
+static void packet_transmitted_done(void* arg) { sched_post_task_prio(&signal_packet_transmitted, MAX_PRIORITY, NULL); }
+
+static void packet_sent_isr(void* arg)
+{
+    assert(timer_post_precise_task_delay_us(TIMER_PRECISE_LANE_RADIO, &packet_transmitted_done, TX_DONE_WAIT_US, NULL)
+        == SUCCESS);
+}
+
+// the radio signals the end of the transmission with a GPIO interrupt, simulated with the DLL lane which is free by now
+static void packet_sent_interrupt(void* arg) { sched_post_task_prio(&packet_sent_isr, MAX_PRIORITY, NULL); }
+
+static void rssi_measurement_done(void* arg) { sched_post_task_prio(rssi_valid_task, MAX_PRIORITY, NULL); }
+
+static void start_rssi_measurement(task_t rssi_valid)
+{
+    rssi_valid_task = rssi_valid;
+    assert(timer_post_precise_task_delay_us(TIMER_PRECISE_LANE_RADIO, &rssi_measurement_done, channel_class->rssi_us,
+        NULL) == SUCCESS);
+}
+
+// the DLL
+static void cca2_rssi_valid(void* arg)
+{
+    uint32_t airtime_ticks = ticks_at(TX_AIRTIME_US) + 1;
+    assert(timer_post_precise_task(TIMER_PRECISE_LANE_DLL, &packet_sent_interrupt,
+        timer_get_counter_value() + airtime_ticks, NULL) == SUCCESS);
+}
+
+static void start_cca2(void* arg) { start_rssi_measurement(&cca2_rssi_valid); }
+
+static void cca1_rssi_valid(void* arg)
+{
+    assert(timer_post_precise_task_delay_us(TIMER_PRECISE_LANE_DLL, &start_cca2, CCA_GAP_US, NULL) == SUCCESS);
+}
+
+static void execute_cca1(void* arg) { start_rssi_measurement(&cca1_rssi_valid); }
+
+static void start_csma_scenario(const channel_class_t* class)
+{
+    channel_class = class;
+    csma_busy = true;
+    csma_start_us = now_us;
+    busy_wait_us = 0;
+    background_work_us = 0;
+    sched_post_task(&execute_cca1);
+    sched_post_task(&background_task);
+}
+
+static void check_csma_scenario()
+{
+    uint64_t duration_us = now_us - csma_start_us;
+    uint32_t blocking_wait_us = 2 * channel_class->rssi_us + CCA_GAP_US + TX_DONE_WAIT_US;
+    uint32_t returned_us = blocking_wait_us - busy_wait_us;
+    printf("%-12s attempt of %5llu us: %4llu us busy waiting instead of %4u us, %4u us returned to other tasks\n",
+        channel_class->name, (unsigned long long)duration_us, (unsigned long long)busy_wait_us, blocking_wait_us,
+        returned_us);
+
+    // the CCA gap is always long enough for the precise lane
+    assert(returned_us >= CCA_GAP_US);
+    // everything which was not busy waited was available for the background task, besides the airtime
+    assert(background_work_us + BACKGROUND_WORK_US >= returned_us + TX_AIRTIME_US);
+}
+
+static uint8_t scenario = 0;
+
+static void start_next_scenario()
+{
+    if (scenario == 0)
+        start_jitter_scenario();
+    else if (scenario == 1) {
+        check_jitter_scenario();
+        printf("CPU time per CSMA-CA attempt with a %u ticks per second timer:\n", TIMER_TICKS_PER_SEC);
+    }
+
+    if (scenario >= 2)
+        check_csma_scenario();
+
+    if (scenario >= 1 && scenario - 1 < CHANNEL_CLASS_COUNT)
+        start_csma_scenario(&channel_classes[scenario - 1]);
+    else if (scenario > CHANNEL_CLASS_COUNT)
+        exit(0);
+
+    scenario++;
+}
+
+int main(int argc, char* argv[])
+{
+    scheduler_init();
+    timer_init();
+    sched_register_task(&long_task);
+    sched_register_task(&pending_task);
+    sched_register_task(&normal_task);
+    sched_register_task(&execute_cca1);
+    sched_register_task(&cca1_rssi_valid);
+    sched_register_task(&cca2_rssi_valid);
+    sched_register_task(&packet_sent_isr);
+    sched_register_task(&signal_packet_transmitted);
+    sched_register_task(&background_task);
+    scheduler_run();
+    return 0;
+}
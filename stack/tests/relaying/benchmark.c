@@ -0,0 +1,134 @@
+#include "frame.h"
+#include "benchmark.h"
+#include "duplicate_filter.h"
+#include "assert.h"
+#include "stdio.h"
+
+// a node at the edge of the coverage of the gateway, which can reach an intermediate node much better
+#define REQUEST_COUNT 10000
+#define MAX_ATTEMPTS 8
+#define EDGE_GATEWAY_SUCCESS_PERCENT 35
+#define EDGE_RELAY_SUCCESS_PERCENT 90
+#define RELAY_GATEWAY_SUCCESS_PERCENT 95
+
+#define REQUEST_PAYLOAD_SIZE 16
+#define RESPONSE_PAYLOAD_SIZE 8
+
+#define TICKS_PER_MS 1.024
+#define FRAME_INTERVAL_TICKS 1000
+
+typedef struct {
+    uint32_t attempts;
+    uint32_t failures;
+    uint32_t duplicates;
+    double edge_airtime;
+    double total_airtime;
+} result_t;
+
+static const uint8_t edge_uid[8] = { 0xE0, 1, 2, 3, 4, 5, 6, 7 };
+static const uint8_t gateway_uid[8] = { 0x60, 1, 2, 3, 4, 5, 6, 7 };
+
+// transmits a hopping frame, the sender, the intermediate node and the receiver each filter the copies they receive
+static bool transmit_hopping(frame_t* frame, duplicate_filter_t* receiver_filter, duplicate_filter_t* relay_filter,
+                             uint8_t direct_percent, uint8_t to_relay_percent, uint8_t from_relay_percent,
+                             timer_tick_t now, result_t* result)
+{
+    double airtime = benchmark_get_airtime(frame->length);
+    timer_tick_t lifetime = HOP_LIMIT * 4 * (airtime * TICKS_PER_MS + 1);
+    uint16_t key = get_key(frame);
+    bool delivered = false;
+    result->total_airtime += airtime;
+
+    if (benchmark_received(direct_percent) && !duplicate_filter_check(receiver_filter, key, now, lifetime))
+        delivered = true;
+
+    if (benchmark_received(to_relay_percent) && !duplicate_filter_check(relay_filter, key, now, lifetime))
+    {
+        relay_frame(frame);
+        result->total_airtime += airtime;
+        if (benchmark_received(from_relay_percent))
+        {
+            if (!duplicate_filter_check(receiver_filter, key, now + 1, lifetime))
+                delivered = true;
+            else
+                result->duplicates++;
+        }
+    }
+
+    return delivered;
+}
+
+static result_t simulate(bool hopping)
+{
+    result_t result = { 0 };
+    duplicate_filter_t edge_filter, relay_filter, gateway_filter;
+    duplicate_filter_init(&edge_filter);
+    duplicate_filter_init(&relay_filter);
+    duplicate_filter_init(&gateway_filter);
+    benchmark_seed(BENCHMARK_SEED);
+    timer_tick_t now = 0;
+    uint8_t transaction_id = 0;
+
+    for (uint32_t i = 0; i < REQUEST_COUNT; i++)
+    {
+        bool done = false;
+        for (uint8_t attempt = 0; attempt < MAX_ATTEMPTS && !done; attempt++)
+        {
+            frame_t request, response;
+            transaction_id++;
+            now += FRAME_INTERVAL_TICKS;
+            result.attempts++;
+            build_frame(&request, hopping, edge_uid, gateway_uid, transaction_id, REQUEST_PAYLOAD_SIZE);
+            build_frame(&response, hopping, gateway_uid, edge_uid, transaction_id, RESPONSE_PAYLOAD_SIZE);
+            result.edge_airtime += benchmark_get_airtime(request.length);
+            if (!hopping)
+            {
+                result.total_airtime += benchmark_get_airtime(request.length);
+                if (!benchmark_received(EDGE_GATEWAY_SUCCESS_PERCENT))
+                    continue;
+
+                result.total_airtime += benchmark_get_airtime(response.length);
+                done = benchmark_received(EDGE_GATEWAY_SUCCESS_PERCENT);
+                continue;
+            }
+
+            if (!transmit_hopping(&request, &gateway_filter, &relay_filter, EDGE_GATEWAY_SUCCESS_PERCENT,
+                                  EDGE_RELAY_SUCCESS_PERCENT, RELAY_GATEWAY_SUCCESS_PERCENT, now, &result))
+                continue;
+
+            done = transmit_hopping(&response, &edge_filter, &relay_filter, EDGE_GATEWAY_SUCCESS_PERCENT,
+                                    RELAY_GATEWAY_SUCCESS_PERCENT, EDGE_RELAY_SUCCESS_PERCENT, now + 10, &result);
+        }
+
+        if (!done)
+            result.failures++;
+    }
+
+    return result;
+}
+
+static void print_result(const char* name, result_t result)
+{
+    uint32_t delivered = REQUEST_COUNT - result.failures;
+    printf("%-8s %.2f attempts per request, %u failed, edge node airtime %.2f ms and total airtime %.2f ms per "
+           "delivered request, %u duplicates dropped\n",
+           name, (double)result.attempts / REQUEST_COUNT, result.failures, result.edge_airtime / delivered,
+           result.total_airtime / delivered, result.duplicates);
+}
+
+int main(int argc, char* argv[])
+{
+    printf("Simulating %u requests of a node at the edge of the coverage of the gateway:\n", REQUEST_COUNT);
+    result_t direct = simulate(false);
+    result_t relayed = simulate(true);
+    print_result("direct", direct);
+    print_result("relayed", relayed);
+
+    assert(relayed.attempts * 2 < direct.attempts);
+    assert(relayed.failures < direct.failures);
+    assert(relayed.edge_airtime * 2 < direct.edge_airtime);
+    assert(relayed.total_airtime < direct.total_airtime);
+    // the gateway and the edge node also receive some frames directly, those copies are dropped
+    assert(relayed.duplicates > 0);
+    return 0;
+}
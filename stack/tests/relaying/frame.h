@@ -0,0 +1,70 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "packet_codec.h"
+#include "crc.h"
+#include "assert.h"
+#include "string.h"
+
+// the frames of the relaying test and benchmark, encoded with the packet codec of the stack
+
+#define HOP_LIMIT 1
+
+typedef struct {
+    uint8_t data[255];
+    uint8_t length;
+    uint8_t d7anp_header_idx;
+} frame_t;
+
+// builds the frame like packet_assemble(), which is not linked in this test
+static void build_frame(frame_t* frame, bool hopping, const uint8_t* origin, const uint8_t* destination,
+                        uint8_t transaction_id, uint8_t payload_size)
+{
+    static packet_t packet;
+    static d7ap_addressee_t addressee;
+    memset(&packet, 0, sizeof(packet_t));
+    memcpy(addressee.id, destination, 8);
+    packet.d7anp_addressee = &addressee;
+    packet.dll_header.control_target_id_type = hopping ? ID_TYPE_NOID : ID_TYPE_UID;
+    packet.d7anp_ctrl.origin_id_type = ID_TYPE_UID;
+    memcpy(packet.origin_access_id, origin, 8);
+    packet.d7anp_ctrl.hop_enabled = hopping;
+    packet.d7anp_hop_ctrl.hop_limit = HOP_LIMIT;
+    packet.d7anp_hop_ctrl.destination_id_type = ID_TYPE_UID;
+    memcpy(packet.destination_access_id, destination, 8);
+    packet.d7atp_ctrl.ctrl_is_start = true;
+    packet.d7atp_ctrl.ctrl_is_ack_requested = true;
+    packet.d7atp_transaction_id = transaction_id;
+
+    uint8_t* data = frame->data + 1;
+    data += packet_codec_encode_dll_header(&packet, false, data, frame->data + sizeof(frame->data) - data);
+    frame->d7anp_header_idx = data - frame->data;
+    data += packet_codec_encode_d7anp_header(&packet, data, frame->data + sizeof(frame->data) - data);
+    data += packet_codec_encode_d7atp_header(&packet, true, data, frame->data + sizeof(frame->data) - data);
+    memset(data, transaction_id, payload_size);
+    data += payload_size;
+
+    frame->length = data - frame->data + 2;
+    frame->data[0] = frame->length - 1;
+}
+
+// the key of the duplicate filter, like the D7ANP derives it from a received hopping frame
+static uint16_t get_key(frame_t* frame)
+{
+    uint8_t hop_invariant_idx = frame->d7anp_header_idx + 2;
+    return crc_calculate(frame->data + hop_invariant_idx, frame->length - 2 - hop_invariant_idx);
+}
+
+// the intermediate node only encodes the D7ANP header again, with the next hop count
+static void relay_frame(frame_t* frame)
+{
+    static packet_t packet;
+    uint8_t* d7anp_header = frame->data + frame->d7anp_header_idx;
+    uint8_t header_len = packet_codec_decode_d7anp_header(&packet, d7anp_header, frame->length - 2 - frame->d7anp_header_idx);
+    assert(header_len && packet.d7anp_ctrl.hop_enabled);
+    assert(packet.d7anp_hop_ctrl.hop_count < packet.d7anp_hop_ctrl.hop_limit);
+    packet.d7anp_hop_ctrl.hop_count++;
+    assert(packet_codec_encode_d7anp_header(&packet, d7anp_header, header_len) == header_len);
+}
+
+#endif
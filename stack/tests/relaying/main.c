@@ -0,0 +1,155 @@
+#include "frame.h"
+#include "duplicate_filter.h"
+#include "assert.h"
+#include "stdio.h"
+#include "string.h"
+
+#define PAYLOAD_SIZE 16
+#define LIFETIME 100 // ticks
+
+typedef enum {
+    DROPPED,
+    DELIVERED,
+    RELAYED
+} process_result_t;
+
+static const uint8_t edge_uid[8] = { 0xE0, 1, 2, 3, 4, 5, 6, 7 };
+static const uint8_t gateway_uid[8] = { 0x60, 1, 2, 3, 4, 5, 6, 7 };
+static const uint8_t relay_uid[8] = { 0x40, 1, 2, 3, 4, 5, 6, 7 };
+static const uint8_t second_relay_uid[8] = { 0x41, 1, 2, 3, 4, 5, 6, 7 };
+
+static void decode_d7anp_header(frame_t* frame, packet_t* packet)
+{
+    uint8_t* d7anp_header = frame->data + frame->d7anp_header_idx;
+    assert(packet_codec_decode_d7anp_header(packet, d7anp_header, frame->length - 2 - frame->d7anp_header_idx));
+}
+
+// the checks of a node which receives a hopping frame, see process_hopping_frame() of the D7ANP
+static process_result_t process_frame(frame_t* frame, const uint8_t* own_uid, duplicate_filter_t* filter,
+                                      timer_tick_t now)
+{
+    static packet_t packet;
+    decode_d7anp_header(frame, &packet);
+    assert(packet.d7anp_ctrl.hop_enabled);
+    if (memcmp(packet.origin_access_id, own_uid, 8) == 0 || duplicate_filter_check(filter, get_key(frame), now, LIFETIME))
+        return DROPPED;
+
+    if (memcmp(packet.destination_access_id, own_uid, 8) == 0)
+        return DELIVERED;
+
+    if (packet.d7anp_hop_ctrl.hop_count >= packet.d7anp_hop_ctrl.hop_limit)
+        return DROPPED;
+
+    return RELAYED;
+}
+
+static void test_duplicate_filter()
+{
+    printf("Testing the duplicate filter ... ");
+    duplicate_filter_t filter;
+    duplicate_filter_init(&filter);
+    assert(!duplicate_filter_check(&filter, 0x1234, 100, 10));
+    assert(duplicate_filter_check(&filter, 0x1234, 109, 10));
+    assert(!duplicate_filter_check(&filter, 0x1234, 110, 10)); // expired, added again
+    assert(!duplicate_filter_check(&filter, 0x5678, 110, 10));
+
+    // the expiration time wraps around like the timer
+    assert(!duplicate_filter_check(&filter, 0x9ABC, UINT32_MAX - 5, 10));
+    assert(duplicate_filter_check(&filter, 0x9ABC, 3, 10));
+    assert(!duplicate_filter_check(&filter, 0x9ABC, 4, 10));
+
+    // the oldest key is replaced when the filter is full
+    duplicate_filter_init(&filter);
+    for (uint16_t key = 0; key <= DUPLICATE_FILTER_SIZE; key++)
+        assert(!duplicate_filter_check(&filter, key, 0, 100));
+
+    assert(!duplicate_filter_check(&filter, 0, 0, 100));
+    assert(duplicate_filter_check(&filter, DUPLICATE_FILTER_SIZE, 0, 100));
+    printf("OK\n");
+}
+
+static void test_hopping_header()
+{
+    printf("Testing the hopping header ... ");
+    static packet_t packet;
+    frame_t direct, hopping;
+    build_frame(&direct, false, edge_uid, gateway_uid, 1, PAYLOAD_SIZE);
+    build_frame(&hopping, true, edge_uid, gateway_uid, 1, PAYLOAD_SIZE);
+
+    // the hopping control and the destination, the DLL header has no target
+    assert(hopping.length == direct.length - 8 + 1 + 8);
+    decode_d7anp_header(&hopping, &packet);
+    assert(packet.d7anp_hop_ctrl.hop_count == 0 && packet.d7anp_hop_ctrl.hop_limit == HOP_LIMIT);
+    assert(packet.d7anp_hop_ctrl.destination_id_type == ID_TYPE_UID);
+    assert(memcmp(packet.destination_access_id, gateway_uid, 8) == 0);
+    decode_d7anp_header(&direct, &packet);
+    assert(!packet.d7anp_ctrl.hop_enabled);
+
+    // relaying only changes the hop count, not the length nor the key
+    uint8_t length = hopping.length;
+    uint16_t key = get_key(&hopping);
+    relay_frame(&hopping);
+    assert(hopping.length == length && get_key(&hopping) == key);
+    decode_d7anp_header(&hopping, &packet);
+    assert(packet.d7anp_hop_ctrl.hop_count == 1 && packet.d7anp_hop_ctrl.hop_limit == HOP_LIMIT);
+    assert(memcmp(packet.origin_access_id, edge_uid, 8) == 0);
+    printf("OK\n");
+}
+
+static void test_duplicate_relayed_frame()
+{
+    printf("Testing a duplicate relayed frame ... ");
+    duplicate_filter_t relay_filter, gateway_filter, edge_filter;
+    duplicate_filter_init(&relay_filter);
+    duplicate_filter_init(&gateway_filter);
+    duplicate_filter_init(&edge_filter);
+    frame_t frame, retry;
+    build_frame(&frame, true, edge_uid, gateway_uid, 1, PAYLOAD_SIZE);
+
+    // the gateway receives the frame directly, the copy relayed by the intermediate node is dropped
+    assert(process_frame(&frame, gateway_uid, &gateway_filter, 0) == DELIVERED);
+    assert(process_frame(&frame, relay_uid, &relay_filter, 0) == RELAYED);
+    relay_frame(&frame);
+    assert(process_frame(&frame, gateway_uid, &gateway_filter, 10) == DROPPED);
+
+    // the intermediate node does not relay the frame again, the origin drops its own frame
+    assert(process_frame(&frame, relay_uid, &relay_filter, 10) == DROPPED);
+    assert(process_frame(&frame, edge_uid, &edge_filter, 10) == DROPPED);
+
+    // a retry of the request is another frame
+    build_frame(&retry, true, edge_uid, gateway_uid, 2, PAYLOAD_SIZE);
+    assert(process_frame(&retry, gateway_uid, &gateway_filter, 20) == DELIVERED);
+
+    // a late copy, after the frame could still be relayed, is handled as a new frame
+    assert(process_frame(&frame, gateway_uid, &gateway_filter, LIFETIME) == DELIVERED);
+    printf("OK\n");
+}
+
+static void test_hop_limit()
+{
+    printf("Testing the hop limit ... ");
+    duplicate_filter_t first_relay_filter, second_relay_filter, gateway_filter;
+    duplicate_filter_init(&first_relay_filter);
+    duplicate_filter_init(&second_relay_filter);
+    duplicate_filter_init(&gateway_filter);
+    frame_t frame;
+    build_frame(&frame, true, edge_uid, gateway_uid, 1, PAYLOAD_SIZE);
+
+    // a second intermediate node out of reach of the edge node does not relay the relayed frame further
+    assert(process_frame(&frame, relay_uid, &first_relay_filter, 0) == RELAYED);
+    relay_frame(&frame);
+    assert(process_frame(&frame, second_relay_uid, &second_relay_filter, 10) == DROPPED);
+
+    // but the destination still accepts it
+    assert(process_frame(&frame, gateway_uid, &gateway_filter, 10) == DELIVERED);
+    printf("OK\n");
+}
+
+int main(int argc, char* argv[])
+{
+    test_duplicate_filter();
+    test_hopping_header();
+    test_duplicate_relayed_frame();
+    test_hop_limit();
+    return 0;
+}
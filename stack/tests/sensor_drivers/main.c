@@ -0,0 +1,367 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "assert.h"
+#include "stdio.h"
+#include "string.h"
+
+#include "hwi2c.h"
+#include "i2c_mock.h"
+#include "LSM303AGR_ACC_driver.h"
+#include "HTS221_Driver.h"
+
+#define SAMPLE_COUNT 25
+
+// model of the LSM303AGR accelerometer FIFO, only stream mode is emulated
+static i2c_mock_device_t lsm303agr;
+static int16_t fifo[LSM303AGR_ACC_FIFO_SIZE][3];
+static uint8_t fifo_head;
+static uint8_t fifo_count;
+static bool fifo_overrun;
+
+static i2c_mock_device_t hts221;
+
+static bool lsm303agr_fifo_enabled()
+{
+    return (lsm303agr.registers[LSM303AGR_ACC_CTRL_REG5] & LSM303AGR_ACC_FIFO_EN_MASK)
+        && (lsm303agr.registers[LSM303AGR_ACC_FIFO_CTRL_REG] & LSM303AGR_ACC_FM_MASK) != LSM303AGR_ACC_FM_BYPASS;
+}
+
+static void lsm303agr_push_sample(int16_t x, int16_t y, int16_t z)
+{
+    assert(lsm303agr_fifo_enabled());
+    if(fifo_count == LSM303AGR_ACC_FIFO_SIZE)
+    {
+        // stream mode discards the oldest sample
+        fifo_head = (fifo_head + 1) % LSM303AGR_ACC_FIFO_SIZE;
+        fifo_count--;
+        fifo_overrun = true;
+    }
+
+    int16_t* sample = fifo[(fifo_head + fifo_count) % LSM303AGR_ACC_FIFO_SIZE];
+    sample[0] = x;
+    sample[1] = y;
+    sample[2] = z;
+    fifo_count++;
+}
+
+static uint8_t lsm303agr_read(i2c_mock_device_t* device, uint8_t register_address)
+{
+    if(register_address == LSM303AGR_ACC_FIFO_SRC_REG)
+    {
+        uint8_t threshold = device->registers[LSM303AGR_ACC_FIFO_CTRL_REG] & LSM303AGR_ACC_FTH_MASK;
+        return (fifo_count > threshold ? LSM303AGR_ACC_WTM_OVERFLOW : 0)
+            | (fifo_overrun ? LSM303AGR_ACC_OVRN_FIFO_OVERRUN : 0)
+            | (fifo_count == 0 ? LSM303AGR_ACC_EMPTY_EMPTY : 0)
+            | (fifo_count & LSM303AGR_ACC_FSS_MASK);
+    }
+
+    if(register_address >= LSM303AGR_ACC_OUT_X_L && register_address <= LSM303AGR_ACC_OUT_Z_H && lsm303agr_fifo_enabled())
+    {
+        assert(fifo_count > 0);
+        uint8_t index = register_address - LSM303AGR_ACC_OUT_X_L;
+        uint16_t value = fifo[fifo_head][index / 2];
+        uint8_t data = (index % 2) ? (value >> 8) : (value & 0xFF);
+        if(register_address == LSM303AGR_ACC_OUT_Z_H)
+        {
+            // reading the last byte of a sample pops it from the FIFO
+            fifo_head = (fifo_head + 1) % LSM303AGR_ACC_FIFO_SIZE;
+            fifo_count--;
+            fifo_overrun = false;
+        }
+
+        return data;
+    }
+
+    return device->registers[register_address];
+}
+
+static void lsm303agr_write(i2c_mock_device_t* device, uint8_t register_address, uint8_t value)
+{
+    device->registers[register_address] = value;
+    if(register_address == LSM303AGR_ACC_FIFO_CTRL_REG && (value & LSM303AGR_ACC_FM_MASK) == LSM303AGR_ACC_FM_BYPASS)
+    {
+        fifo_head = 0;
+        fifo_count = 0;
+        fifo_overrun = false;
+    }
+}
+
+static uint8_t lsm303agr_next_register(i2c_mock_device_t* device, uint8_t register_address)
+{
+    if(register_address == LSM303AGR_ACC_OUT_Z_H && lsm303agr_fifo_enabled())
+        return LSM303AGR_ACC_OUT_X_L;
+
+    return register_address + 1;
+}
+
+static void init_devices()
+{
+    i2c_mock_detach_all_devices();
+
+    memset(&lsm303agr, 0, sizeof(lsm303agr));
+    lsm303agr.address = LSM303AGR_ACC_I2C_ADDRESS;
+    lsm303agr.auto_increment_mask = 0x80;
+    lsm303agr.read_callback = &lsm303agr_read;
+    lsm303agr.write_callback = &lsm303agr_write;
+    lsm303agr.next_register_callback = &lsm303agr_next_register;
+    fifo_head = 0;
+    fifo_count = 0;
+    fifo_overrun = false;
+    i2c_mock_attach_device(&lsm303agr);
+
+    memset(&hts221, 0, sizeof(hts221));
+    hts221.address = HTS221_I2C_ADDRESS;
+    hts221.auto_increment_mask = 0x80;
+    i2c_mock_attach_device(&hts221);
+}
+
+static int16_t sample_value(int sample, int axis)
+{
+    return (int16_t)((sample * 3 + axis) * 16 * (axis == 1 ? -1 : 1));
+}
+
+void test_lsm303agr_fifo_configuration(i2c_handle_t* handle)
+{
+    init_devices();
+    assert(LSM303AGR_ACC_Enable_FIFO(handle, 20) == MEMS_SUCCESS);
+    assert(lsm303agr.registers[LSM303AGR_ACC_CTRL_REG5] & LSM303AGR_ACC_FIFO_EN_ENABLED);
+    assert(lsm303agr.registers[LSM303AGR_ACC_CTRL_REG3] & LSM303AGR_ACC_I1_WTM_ENABLED);
+    assert(lsm303agr.registers[LSM303AGR_ACC_FIFO_CTRL_REG] == (LSM303AGR_ACC_FM_STREAM | 20));
+    assert(LSM303AGR_ACC_Enable_FIFO(handle, LSM303AGR_ACC_FIFO_SIZE) == MEMS_ERROR);
+
+    assert(LSM303AGR_ACC_Disable_FIFO(handle) == MEMS_SUCCESS);
+    assert(!(lsm303agr.registers[LSM303AGR_ACC_CTRL_REG5] & LSM303AGR_ACC_FIFO_EN_ENABLED));
+    assert(!(lsm303agr.registers[LSM303AGR_ACC_CTRL_REG3] & LSM303AGR_ACC_I1_WTM_ENABLED));
+    assert((lsm303agr.registers[LSM303AGR_ACC_FIFO_CTRL_REG] & LSM303AGR_ACC_FM_MASK) == LSM303AGR_ACC_FM_BYPASS);
+}
+
+void test_lsm303agr_fifo_burst_read(i2c_handle_t* handle)
+{
+    Type3Axis16bit_U samples[LSM303AGR_ACC_FIFO_SIZE];
+    u8_t count;
+
+    init_devices();
+    assert(LSM303AGR_ACC_Enable_FIFO(handle, SAMPLE_COUNT - 1) == MEMS_SUCCESS);
+    for(int i = 0; i < SAMPLE_COUNT; i++)
+        lsm303agr_push_sample(sample_value(i, 0), sample_value(i, 1), sample_value(i, 2));
+
+    LSM303AGR_ACC_WTM_t watermark;
+    assert(LSM303AGR_ACC_R_WatermarkLevel(handle, &watermark) == MEMS_SUCCESS);
+    assert(watermark == LSM303AGR_ACC_WTM_OVERFLOW);
+
+    // reading the FIFO status and all samples takes two transactions
+    i2c_mock_reset_stats();
+    assert(LSM303AGR_ACC_Get_Raw_Acceleration_FIFO(handle, samples[0].u8bit, LSM303AGR_ACC_FIFO_SIZE, &count) == MEMS_SUCCESS);
+    assert(count == SAMPLE_COUNT);
+    assert(i2c_mock_get_stats()->transactions == 2);
+    assert(i2c_mock_get_stats()->bytes_read == 1 + (SAMPLE_COUNT * 6));
+    for(int i = 0; i < SAMPLE_COUNT; i++)
+        for(int axis = 0; axis < 3; axis++)
+            assert(samples[i].i16bit[axis] == sample_value(i, axis));
+
+    // an empty FIFO only needs the status
+    i2c_mock_reset_stats();
+    assert(LSM303AGR_ACC_Get_Raw_Acceleration_FIFO(handle, samples[0].u8bit, LSM303AGR_ACC_FIFO_SIZE, &count) == MEMS_SUCCESS);
+    assert(count == 0);
+    assert(i2c_mock_get_stats()->transactions == 1);
+}
+
+void test_lsm303agr_fifo_partial_read(i2c_handle_t* handle)
+{
+    Type3Axis16bit_U samples[LSM303AGR_ACC_FIFO_SIZE];
+    u8_t count;
+
+    init_devices();
+    assert(LSM303AGR_ACC_Enable_FIFO(handle, 0) == MEMS_SUCCESS);
+    for(int i = 0; i < 10; i++)
+        lsm303agr_push_sample(sample_value(i, 0), sample_value(i, 1), sample_value(i, 2));
+
+    assert(LSM303AGR_ACC_Get_Raw_Acceleration_FIFO(handle, samples[0].u8bit, 4, &count) == MEMS_SUCCESS);
+    assert(count == 4);
+    assert(fifo_count == 6);
+    assert(LSM303AGR_ACC_Get_Raw_Acceleration_FIFO(handle, samples[4].u8bit, LSM303AGR_ACC_FIFO_SIZE, &count) == MEMS_SUCCESS);
+    assert(count == 6);
+    for(int i = 0; i < 10; i++)
+        for(int axis = 0; axis < 3; axis++)
+            assert(samples[i].i16bit[axis] == sample_value(i, axis));
+}
+
+void test_lsm303agr_fifo_overrun(i2c_handle_t* handle)
+{
+    Type3Axis16bit_U samples[LSM303AGR_ACC_FIFO_SIZE];
+    u8_t count;
+
+    init_devices();
+    assert(LSM303AGR_ACC_Enable_FIFO(handle, 16) == MEMS_SUCCESS);
+    for(int i = 0; i < LSM303AGR_ACC_FIFO_SIZE + 8; i++)
+        lsm303agr_push_sample(sample_value(i, 0), sample_value(i, 1), sample_value(i, 2));
+
+    // a full FIFO contains the newest samples
+    assert(LSM303AGR_ACC_Get_Raw_Acceleration_FIFO(handle, samples[0].u8bit, LSM303AGR_ACC_FIFO_SIZE, &count) == MEMS_SUCCESS);
+    assert(count == LSM303AGR_ACC_FIFO_SIZE);
+    for(int i = 0; i < LSM303AGR_ACC_FIFO_SIZE; i++)
+        for(int axis = 0; axis < 3; axis++)
+            assert(samples[i].i16bit[axis] == sample_value(i + 8, axis));
+}
+
+void test_lsm303agr_fifo_acceleration(i2c_handle_t* handle)
+{
+    int acceleration[LSM303AGR_ACC_FIFO_SIZE * 3];
+    u8_t count;
+
+    init_devices();
+    assert(LSM303AGR_ACC_W_HiRes(handle, LSM303AGR_ACC_HR_ENABLED) == MEMS_SUCCESS);
+    assert(LSM303AGR_ACC_W_FullScale(handle, LSM303AGR_ACC_FS_4G) == MEMS_SUCCESS);
+    assert(LSM303AGR_ACC_Enable_FIFO(handle, 0) == MEMS_SUCCESS);
+    for(int i = 0; i < SAMPLE_COUNT; i++)
+        lsm303agr_push_sample(sample_value(i, 0), sample_value(i, 1), sample_value(i, 2));
+
+    // the conversion in place from the raw samples should not overwrite samples which are not converted yet
+    assert(LSM303AGR_ACC_Get_Acceleration_FIFO(handle, acceleration, LSM303AGR_ACC_FIFO_SIZE, &count) == MEMS_SUCCESS);
+    assert(count == SAMPLE_COUNT);
+    for(int i = 0; i < SAMPLE_COUNT; i++)
+        for(int axis = 0; axis < 3; axis++)
+            assert(acceleration[(i * 3) + axis] == ((sample_value(i, axis) >> 4) * 1950 + 500) / 1000);
+}
+
+void test_lsm303agr_transactions_per_sample(i2c_handle_t* handle)
+{
+    int acceleration[LSM303AGR_ACC_FIFO_SIZE * 3];
+    u8_t count;
+
+    // single sample acquisition, the output registers contain the last sample
+    init_devices();
+    assert(LSM303AGR_ACC_W_HiRes(handle, LSM303AGR_ACC_HR_ENABLED) == MEMS_SUCCESS);
+    i2c_release(handle);
+    i2c_mock_reset_stats();
+    for(int i = 0; i < SAMPLE_COUNT; i++)
+    {
+        i2c_acquire(handle);
+        assert(LSM303AGR_ACC_Get_Acceleration(handle, acceleration) == MEMS_SUCCESS);
+        i2c_release(handle);
+    }
+
+    i2c_mock_stats_t single = *i2c_mock_get_stats();
+
+    // batch acquisition after the watermark interrupt
+    i2c_acquire(handle);
+    assert(LSM303AGR_ACC_Enable_FIFO(handle, SAMPLE_COUNT - 1) == MEMS_SUCCESS);
+    i2c_release(handle);
+    for(int i = 0; i < SAMPLE_COUNT; i++)
+        lsm303agr_push_sample(sample_value(i, 0), sample_value(i, 1), sample_value(i, 2));
+
+    i2c_mock_reset_stats();
+    i2c_acquire(handle);
+    assert(LSM303AGR_ACC_Get_Acceleration_FIFO(handle, acceleration, LSM303AGR_ACC_FIFO_SIZE, &count) == MEMS_SUCCESS);
+    i2c_release(handle);
+    assert(count == SAMPLE_COUNT);
+
+    i2c_mock_stats_t batch = *i2c_mock_get_stats();
+    assert(batch.transactions < single.transactions);
+    assert(batch.acquires == 1);
+    i2c_acquire(handle);
+
+    printf("%d samples: single %.2f transactions/sample (%lu acquires), batch %.2f transactions/sample (%lu acquires) ... ",
+        SAMPLE_COUNT, (float)single.transactions / SAMPLE_COUNT, (unsigned long)single.acquires,
+        (float)batch.transactions / SAMPLE_COUNT, (unsigned long)batch.acquires);
+}
+
+void test_hts221_calibrated_measurement(i2c_handle_t* handle)
+{
+    HTS221_Calibration_st calibration;
+    uint16_t humidity, calibrated_humidity;
+    int16_t temperature, calibrated_temperature;
+
+    init_devices();
+    hts221.registers[HTS221_H0_RH_X2] = 40; // 20 %
+    hts221.registers[HTS221_H1_RH_X2] = 140; // 70 %
+    hts221.registers[HTS221_T0_DEGC_X8] = 80; // 10 'C
+    hts221.registers[HTS221_T1_DEGC_X8] = 0x40; // 40 'C, MSB in T0_T1_DEGC_H2
+    hts221.registers[HTS221_T0_T1_DEGC_H2] = 0x04;
+    hts221.registers[HTS221_H0_T0_OUT_L] = (uint8_t)-500;
+    hts221.registers[HTS221_H0_T0_OUT_H] = (uint8_t)(-500 >> 8);
+    hts221.registers[HTS221_H1_T0_OUT_L] = 8000 & 0xFF;
+    hts221.registers[HTS221_H1_T0_OUT_H] = 8000 >> 8;
+    hts221.registers[HTS221_T0_OUT_L] = 300 & 0xFF;
+    hts221.registers[HTS221_T0_OUT_H] = 300 >> 8;
+    hts221.registers[HTS221_T1_OUT_L] = 3000 & 0xFF;
+    hts221.registers[HTS221_T1_OUT_H] = 3000 >> 8;
+    hts221.registers[HTS221_HR_OUT_L_REG] = 3750 & 0xFF;
+    hts221.registers[HTS221_HR_OUT_H_REG] = 3750 >> 8;
+    hts221.registers[HTS221_TEMP_OUT_L_REG] = 1650 & 0xFF;
+    hts221.registers[HTS221_TEMP_OUT_H_REG] = 1650 >> 8;
+
+    i2c_mock_reset_stats();
+    assert(HTS221_Get_Calibration(handle, &calibration) == HTS221_OK);
+    assert(i2c_mock_get_stats()->transactions == 1);
+    assert(calibration.H0_rh == 20 && calibration.H1_rh == 70);
+    assert(calibration.T0_degC == 10 && calibration.T1_degC == 40);
+    assert(calibration.H0_T0_out == -500 && calibration.H1_T0_out == 8000);
+    assert(calibration.T0_out == 300 && calibration.T1_out == 3000);
+
+    i2c_mock_reset_stats();
+    assert(HTS221_Get_CalibratedMeasurement(handle, &calibration, &calibrated_humidity, &calibrated_temperature) == HTS221_OK);
+    assert(i2c_mock_get_stats()->transactions == 1);
+    assert(calibrated_humidity == 450);
+    assert(calibrated_temperature == 250);
+
+    i2c_mock_reset_stats();
+    assert(HTS221_Get_CalibratedTemperature(handle, &calibration, &calibrated_temperature) == HTS221_OK);
+    assert(i2c_mock_get_stats()->transactions == 1);
+    assert(calibrated_temperature == 250);
+
+    assert(HTS221_Get_Measurement(handle, &humidity, &temperature) == HTS221_OK);
+    assert(humidity == calibrated_humidity);
+    assert(temperature == calibrated_temperature);
+    assert(HTS221_Get_Temperature(handle, &temperature) == HTS221_OK);
+    assert(temperature == calibrated_temperature);
+    assert(HTS221_Get_Humidity(handle, &humidity) == HTS221_OK);
+    assert(humidity == calibrated_humidity);
+}
+
+int main()
+{
+    i2c_handle_t* handle = i2c_init(0, 0, 100000, true);
+    i2c_acquire(handle);
+
+    printf("Testing LSM303AGR FIFO configuration ... ");
+    test_lsm303agr_fifo_configuration(handle);
+    printf("Success!\n");
+
+    printf("Testing LSM303AGR FIFO burst read ... ");
+    test_lsm303agr_fifo_burst_read(handle);
+    test_lsm303agr_fifo_partial_read(handle);
+    test_lsm303agr_fifo_overrun(handle);
+    printf("Success!\n");
+
+    printf("Testing LSM303AGR FIFO acceleration ... ");
+    test_lsm303agr_fifo_acceleration(handle);
+    printf("Success!\n");
+
+    printf("Testing LSM303AGR I2C transactions ... ");
+    test_lsm303agr_transactions_per_sample(handle);
+    printf("Success!\n");
+
+    printf("Testing HTS221 calibrated measurement ... ");
+    test_hts221_calibrated_measurement(handle);
+    printf("Success!\n");
+
+    i2c_release(handle);
+    return 0;
+}
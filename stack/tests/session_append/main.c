@@ -0,0 +1,377 @@
+#include "d7ap.h"
+#include "d7ap_fs.h"
+#include "alp_layer.h"
+#include "frame_decoder.h"
+#include "packet_codec.h"
+#include "phy.h"
+#include "MODULE_D7AP_defs.h"
+#include "crc.h"
+#include "pn9.h"
+#include "fec.h"
+#include "timer.h"
+#include "scheduler.h"
+#include "hwradio.h"
+#include "hwtimer.h"
+#include "hwsystem.h"
+#include "hwuart.h"
+#include "hwgpio.h"
+#include "blockdevice_ram.h"
+#include "framework_defs.h"
+#include "errors.h"
+#include "assert.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+// not using the APP_BUILD() macro for tests
+const char _APP_NAME[] = "session_append_test";
+const char _GIT_SHA1[] = "";
+
+// the action protocol is not used by this test
+void alp_layer_process_d7aactp(alp_interface_config_t* interface_config, uint8_t* alp_command, uint32_t alp_command_length)
+{
+    assert(false);
+}
+
+void alp_layer_free_commands() {}
+
+void hw_reset() { assert(false); }
+
+// the default system files of the d7ap_fs module are used, the native platform itself starts with an empty file system
+#define METADATA_SIZE (4 + 4 + (256 * 9))
+
+extern uint8_t d7ap_fs_metadata[METADATA_SIZE];
+extern uint8_t d7ap_files_data[FRAMEWORK_FS_PERMANENT_STORAGE_SIZE];
+extern uint8_t d7ap_volatile_files_data[FRAMEWORK_FS_VOLATILE_STORAGE_SIZE];
+
+static blockdevice_ram_t metadata_bd = (blockdevice_ram_t){
+    .base.driver = &blockdevice_driver_ram,
+    .base.size = METADATA_SIZE,
+    .buffer = d7ap_fs_metadata
+};
+
+static blockdevice_ram_t permanent_bd = (blockdevice_ram_t){
+    .base.driver = &blockdevice_driver_ram,
+    .base.size = FRAMEWORK_FS_PERMANENT_STORAGE_SIZE,
+    .buffer = d7ap_files_data
+};
+
+static blockdevice_ram_t volatile_bd = (blockdevice_ram_t){
+    .base.driver = &blockdevice_driver_ram,
+    .base.size = FRAMEWORK_FS_VOLATILE_STORAGE_SIZE,
+    .buffer = d7ap_volatile_files_data
+};
+
+blockdevice_t * const metadata_blockdevice = (blockdevice_t* const) &metadata_bd;
+blockdevice_t * const persistent_files_blockdevice = (blockdevice_t* const) &permanent_bd;
+blockdevice_t * const volatile_blockdevice = (blockdevice_t* const) &volatile_bd;
+
+uart_handle_t* uart_init(uint8_t port_idx, uint32_t baudrate, uint8_t pins) { return NULL; }
+bool uart_enable(uart_handle_t* uart) { return true; }
+bool uart_disable(uart_handle_t* uart) { return true; }
+void uart_send_bytes(uart_handle_t* uart, void const *data, size_t length) {}
+error_t uart_rx_interrupt_enable(uart_handle_t* uart) { return SUCCESS; }
+void uart_set_rx_interrupt_callback(uart_handle_t* uart, uart_rx_inthandler_t rx_handler) {}
+void uart_set_error_callback(uart_handle_t* uart, uart_error_handler_t error_handler) {}
+error_t hw_gpio_set(pin_id_t pin_id) { return SUCCESS; }
+system_reboot_reason_t hw_system_reboot_reason(void) { return REBOOT_REASON_POR; }
+uint64_t hw_get_unique_id(void) { return 0x0102030405060708; }
+void __watchdog_init(void) {}
+void hw_watchdog_feed(void) {}
+uint8_t hw_watchdog_get_timeout(void) { return 0; }
+
+// the hardware timer is simulated, time only advances while busy waiting and while sleeping until the next timer
+// interrupt, so the tasks of the stack take no time
+#define US_PER_SEC 1000000
+
+static uint64_t now_us;
+static timer_callback_t compare_callback;
+static timer_callback_t overflow_callback;
+static bool compare_armed;
+static hwtimer_tick_t compare_tick;
+static const hwtimer_info_t timer_info = { .min_delay_ticks = 3 };
+
+static uint32_t ticks_at(uint64_t us) { return us * TIMER_TICKS_PER_SEC / US_PER_SEC; }
+
+static uint64_t first_us_of_tick(uint32_t tick) { return ((uint64_t)tick * US_PER_SEC + TIMER_TICKS_PER_SEC - 1) / TIMER_TICKS_PER_SEC; }
+
+static void advance(uint64_t duration_us)
+{
+    uint64_t end = now_us + duration_us;
+    while (first_us_of_tick(ticks_at(now_us) + 1) <= end) {
+        uint32_t tick = ticks_at(now_us) + 1;
+        now_us = first_us_of_tick(tick);
+        if ((hwtimer_tick_t)tick == 0)
+            overflow_callback();
+
+        if (compare_armed && (hwtimer_tick_t)tick == compare_tick) {
+            compare_armed = false;
+            compare_callback();
+        }
+    }
+
+    if (now_us < end)
+        now_us = end;
+}
+
+error_t hw_timer_init(hwtimer_id_t timer_id, uint8_t frequency, timer_callback_t compare_cb, timer_callback_t overflow_cb)
+{
+    compare_callback = compare_cb;
+    overflow_callback = overflow_cb;
+    return SUCCESS;
+}
+
+const hwtimer_info_t* hw_timer_get_info(hwtimer_id_t timer_id) { return &timer_info; }
+
+hwtimer_tick_t hw_timer_getvalue(hwtimer_id_t timer_id) { return (hwtimer_tick_t)ticks_at(now_us); }
+
+error_t hw_timer_schedule(hwtimer_id_t timer_id, hwtimer_tick_t tick)
+{
+    compare_tick = tick;
+    compare_armed = true;
+    return SUCCESS;
+}
+
+error_t hw_timer_cancel(hwtimer_id_t timer_id)
+{
+    compare_armed = false;
+    return SUCCESS;
+}
+
+bool hw_timer_is_overflow_pending(hwtimer_id_t id) { return false; }
+
+void hw_busy_wait(int16_t microseconds) { advance(microseconds); }
+
+void hw_enter_lowpower_mode(uint8_t mode)
+{
+    // the test ends when the second request is answered, the stack never waits without a timer event before that
+    assert(compare_armed);
+
+    hwtimer_tick_t delay = compare_tick - hw_timer_getvalue(0);
+    uint32_t tick = ticks_at(now_us) + (delay ? delay : 0x10000);
+    advance(first_us_of_tick(tick) - now_us);
+}
+
+// the radio is simulated as well: every RSSI measurement reports a free channel, a transmitted frame is decoded and
+// answered by a responder, and each frame records the CCA measurements done since the previous one
+
+#define MAX_FRAME_COUNT 4
+#define FREE_CHANNEL_RSSI -140
+#define RESPONSE_DELAY_US 2000
+#define CHANNEL_CODING PHY_CODING_FEC_PN9 // the channel of the default access profile
+#define MAX_RAW_SIZE (2 * FEC_BUFFER_SIZE)
+
+typedef struct {
+    packet_t packet;
+    uint16_t cca_count;
+} frame_t;
+
+static const uint8_t responder_uid[8] = { 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7 };
+
+static hwradio_init_args_t radio_callbacks;
+static hw_radio_state_t radio_opmode = HW_STATE_OFF;
+static uint16_t cca_count;
+static frame_t frames[MAX_FRAME_COUNT];
+static uint8_t frame_count;
+
+static void radio_tx_done(void* arg) { radio_callbacks.tx_packet_cb(timer_get_counter_value()); }
+
+static void radio_respond(void* arg)
+{
+    packet_t* request = &frames[frame_count - 1].packet;
+    static packet_t response;
+    memset(&response, 0, sizeof(packet_t));
+    // the response is sent to the access class of the requester, from the access class which was addressed
+    response.dll_header.subnet = request->origin_access_class;
+    response.dll_header.control_target_id_type = ID_TYPE_NOID;
+    response.dll_header.control_eirp_index = 32 + 14;
+    response.d7anp_ctrl.origin_id_type = ID_TYPE_UID;
+    response.origin_access_class = request->dll_header.subnet;
+    memcpy(response.origin_access_id, responder_uid, 8);
+    response.d7atp_dialog_id = request->d7atp_dialog_id;
+    response.d7atp_transaction_id = request->d7atp_transaction_id;
+
+    uint8_t raw[MAX_RAW_SIZE];
+    uint8_t* data = raw + 1;
+    data += packet_codec_encode_dll_header(&response, false, data, 32);
+    data += packet_codec_encode_d7anp_header(&response, data, 32);
+    data += packet_codec_encode_d7atp_header(&response, false, data, 32);
+    uint16_t length = data - raw + 2;
+    raw[0] = length - 1;
+    uint16_t crc = __builtin_bswap16(crc_calculate(raw, length - 2));
+    memcpy(data, &crc, 2);
+    length = fec_encode(raw, length);
+    pn9_encode(raw, length);
+
+    // the requester listens for the response
+    assert(radio_opmode == HW_STATE_RX);
+    hw_radio_packet_t* hw_radio_packet = radio_callbacks.alloc_packet_cb(length);
+    assert(hw_radio_packet != NULL);
+    memcpy(hw_radio_packet->data, raw, length);
+    hw_radio_packet->length = length;
+    hw_radio_packet->rx_meta.timestamp = timer_get_counter_value();
+    hw_radio_packet->rx_meta.rssi = -60;
+    hw_radio_packet->rx_meta.lqi = 0;
+    hw_radio_packet->rx_meta.crc_status = HW_CRC_UNAVAILABLE;
+    radio_callbacks.rx_packet_cb(hw_radio_packet);
+}
+
+static void test_frame_sent();
+
+error_t hw_radio_init(hwradio_init_args_t* init_args)
+{
+    radio_callbacks = *init_args;
+    radio_opmode = HW_STATE_IDLE;
+    return SUCCESS;
+}
+
+void hw_radio_stop(void) { radio_opmode = HW_STATE_OFF; }
+
+error_t hw_radio_set_idle(void)
+{
+    radio_opmode = HW_STATE_SLEEP;
+    return SUCCESS;
+}
+
+void hw_radio_set_opmode(hw_radio_state_t opmode) { radio_opmode = opmode; }
+
+int16_t hw_radio_get_rssi(void)
+{
+    cca_count++;
+    return FREE_CHANNEL_RSSI;
+}
+
+error_t hw_radio_send_payload(uint8_t* data, uint16_t len)
+{
+    assert(frame_count < MAX_FRAME_COUNT);
+    frame_t* frame = &frames[frame_count++];
+    frame->cca_count = cca_count;
+    cca_count = 0;
+
+    uint8_t raw[MAX_RAW_SIZE];
+    memcpy(raw, data, len);
+    frame_decoder_t decoder;
+    frame_decoder_init(&decoder, NULL);
+    assert(frame_decoder_decode(&decoder, raw, len, CHANNEL_CODING, false, true, &frame->packet) == FRAME_DECODER_OK);
+
+    radio_opmode = HW_STATE_TX;
+    uint16_t airtime = phy_calculate_tx_duration(PHY_CLASS_NORMAL_RATE, CHANNEL_CODING, frame->packet.hw_radio_packet.length, false);
+    assert(timer_post_task_delay(&radio_tx_done, airtime) == SUCCESS);
+    assert(timer_post_task_delay(&radio_respond, airtime + ticks_at(RESPONSE_DELAY_US)) == SUCCESS);
+    test_frame_sent();
+    return SUCCESS;
+}
+
+void hw_radio_set_payload_length(uint16_t length) {}
+void hw_radio_enable_refill(bool enable) {}
+void hw_radio_enable_preloading(bool enable) {}
+void hw_radio_set_center_freq(uint32_t center_freq) {}
+void hw_radio_set_rx_bw_hz(uint32_t bw_hz) {}
+void hw_radio_set_bitrate(uint32_t bps) {}
+void hw_radio_set_tx_fdev(uint32_t fdev) {}
+void hw_radio_set_preamble_size(uint16_t size) {}
+void hw_radio_set_preamble_detector(uint8_t preamble_detector_size, uint8_t preamble_tol) {}
+void hw_radio_set_rssi_config(uint8_t rssi_smoothing, uint8_t rssi_offset) {}
+void hw_radio_set_dc_free(uint8_t scheme) {}
+void hw_radio_set_sync_word(uint8_t* sync_word, uint8_t sync_size) {}
+void hw_radio_set_crc_on(uint8_t enable) {}
+void hw_radio_set_tx_power(int8_t eirp) {}
+void hw_radio_set_rx_timeout(uint32_t timeout) {}
+
+// a request is appended to the dialog while the first request of the session is being transmitted
+
+static uint8_t client_id;
+static uint16_t trans_ids[2];
+static error_t transmitted_errors[2];
+static uint8_t transmitted_count;
+static uint8_t payloads[2][4] = { { 0x01, 0x02, 0x03, 0x04 }, { 0x05, 0x06, 0x07, 0x08 } };
+
+static d7ap_session_config_t session_config = {
+    .qos.qos_resp_mode = SESSION_RESP_MODE_ANY,
+    .dormant_timeout = 0,
+    .addressee = {
+        .ctrl.id_type = ID_TYPE_UID,
+        .access_class = 0x01,
+        .id = { 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7 },
+    },
+};
+
+static void test_frame_sent()
+{
+    if (frame_count != 1)
+        return;
+
+    assert(d7ap_send(client_id, &session_config, payloads[1], sizeof(payloads[1]), 0, &trans_ids[1]) == SUCCESS);
+
+#if MODULE_D7AP_FIFO_MAX_REQUESTS_COUNT == 2
+    // request IDs are not reused within a session, so the FIFO is full now
+    uint16_t trans_id;
+    assert(d7ap_send(client_id, &session_config, payloads[1], sizeof(payloads[1]), 0, &trans_id) == -ESIZE);
+#endif
+}
+
+static void check_session()
+{
+    printf("Testing a request appended to an active session ... ");
+    assert(frame_count == 2);
+    packet_t* initial = &frames[0].packet;
+    packet_t* appended = &frames[1].packet;
+    assert(initial->d7atp_dialog_id == appended->d7atp_dialog_id);
+    assert(initial->d7atp_transaction_id != appended->d7atp_transaction_id);
+    assert(memcmp(packet_get_payload(appended), payloads[1], sizeof(payloads[1])) == 0);
+
+    // CCA1 and CCA2 before the initial request, the appended request follows the unicast response on the guarded
+    // channel
+    assert(frames[0].cca_count == 2);
+    assert(frames[1].cca_count == 0);
+
+    assert(transmitted_errors[0] == SUCCESS && transmitted_errors[1] == SUCCESS);
+    printf("OK\n");
+    exit(0);
+}
+
+static void transmitted_cb(uint16_t trans_id, error_t error)
+{
+    assert(transmitted_count < 2);
+    assert(trans_id == trans_ids[transmitted_count]);
+    transmitted_errors[transmitted_count++] = error;
+    if (transmitted_count == 2)
+        check_session();
+}
+
+static void receive_cb(uint16_t trans_id, uint8_t* payload, uint8_t len, d7ap_session_result_t result) {}
+
+static bool unsolicited_cb(uint8_t* payload, uint8_t len, d7ap_session_result_t result)
+{
+    assert(false);
+    return false;
+}
+
+static void start_session(void* arg)
+{
+    assert(d7ap_send(client_id, &session_config, payloads[0], sizeof(payloads[0]), 0, &trans_ids[0]) == SUCCESS);
+}
+
+int main(int argc, char* argv[])
+{
+    blockdevice_init(metadata_blockdevice);
+    blockdevice_init(persistent_files_blockdevice);
+    blockdevice_init(volatile_blockdevice);
+    scheduler_init();
+    timer_init();
+    sched_register_task(&radio_tx_done);
+    sched_register_task(&radio_respond);
+    sched_register_task(&start_session);
+
+    d7ap_fs_init();
+    d7ap_init();
+    d7ap_resource_desc_t client = {
+        .receive_cb = receive_cb,
+        .transmitted_cb = transmitted_cb,
+        .unsolicited_cb = unsolicited_cb,
+    };
+    client_id = d7ap_register(&client);
+    sched_post_task(&start_session);
+    scheduler_run();
+    return 0;
+}
@@ -0,0 +1,498 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Decodes a capture file of raw D7A frames using all cores, and stores the result in columnar form: one file per
+ * field in the output directory, containing the value of that field for every frame, in native byte order.
+ * The payloads are concatenated in payload.bin, payload_offset.bin and payload_length.bin index into it.
+ *
+ * A capture file is a sequence of records, all fields big endian:
+ *   timestamp (4 bytes) | rssi (2 bytes, signed) | flags (1 byte) | length (2 bytes) | raw frame (length bytes)
+ * The raw frame is the frame as received over the air, before PN9 dewhitening and FEC decoding. The flags are:
+ *   bit 0: the frame was received on a FEC coded channel
+ *   bit 1: background frame
+ *   bit 2: response, the D7ATP header of responses differs from the one of requests
+ *
+ * Usage:
+ *   capture_decoder [-t threads] [-k key] <capture> <output dir>
+ *   capture_decoder --benchmark [-t threads] [-k key] <capture>
+ *   capture_decoder --generate <frame count> <capture>
+ */
+
+#include "frame_decoder.h"
+#include "packet_codec.h"
+#include "crc.h"
+#include "pn9.h"
+
+#include "assert.h"
+#include "errno.h"
+#include "pthread.h"
+#include "stddef.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "sys/stat.h"
+#include "time.h"
+#include "unistd.h"
+
+#define RECORD_HEADER_SIZE 9
+#define RECORD_FLAG_FEC (1 << 0)
+#define RECORD_FLAG_BACKGROUND (1 << 1)
+#define RECORD_FLAG_RESPONSE (1 << 2)
+
+#define MAX_PAYLOAD_SIZE sizeof(((packet_t*)0)->__data)
+
+// the columns of the output, X(type, name, value) where value is evaluated for every decoded frame
+#define COLUMNS(X)                                                                                                     \
+    X(uint32_t, timestamp, record->timestamp)                                                                          \
+    X(int16_t, rssi, record->rssi)                                                                                     \
+    X(uint8_t, status, status)                                                                                         \
+    X(uint8_t, subnet, packet->dll_header.subnet)                                                                      \
+    X(uint8_t, target_id_type, packet->dll_header.control_target_id_type)                                              \
+    X(uint8_t, eirp_index, packet->dll_header.control_eirp_index)                                                      \
+    X(uint8_t, nwl_control, packet->d7anp_ctrl.raw)                                                                    \
+    X(uint8_t, origin_access_class, packet->origin_access_class)                                                       \
+    X(uint64_t, origin_access_id, origin_access_id)                                                                    \
+    X(uint32_t, frame_counter, packet->d7anp_security.frame_counter)                                                   \
+    X(uint8_t, tp_control, packet->d7atp_ctrl.ctrl_raw)                                                                \
+    X(uint8_t, dialog_id, packet->d7atp_dialog_id)                                                                     \
+    X(uint8_t, transaction_id, packet->d7atp_transaction_id)                                                           \
+    X(uint16_t, eta, packet->ETA)                                                                                      \
+    X(uint8_t, payload_length, packet->payload_length)
+
+typedef struct {
+    uint32_t timestamp;
+    int16_t rssi;
+    uint8_t flags;
+    uint16_t length;
+    const uint8_t* raw;
+} record_t;
+
+typedef struct {
+#define COLUMN_FIELD(type, name, value) type* name;
+    COLUMNS(COLUMN_FIELD)
+    uint8_t* payload; // MAX_PAYLOAD_SIZE bytes reserved per frame, compacted when written
+} columns_t;
+
+typedef struct {
+    pthread_t thread;
+    const record_t* records;
+    size_t first;
+    size_t count;
+    const uint8_t* key;
+    columns_t* columns;
+} worker_t;
+
+static uint16_t read_be16(const uint8_t* data)
+{
+    return (data[0] << 8) | data[1];
+}
+
+static uint32_t read_be32(const uint8_t* data)
+{
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+static uint8_t* read_file(const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = malloc(*size ? *size : 1);
+    if (data && fread(data, 1, *size, file) != *size)
+    {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+    return data;
+}
+
+// the records have a variable length, so the capture is indexed first to be able to split it over the threads
+static record_t* index_capture(const uint8_t* data, size_t size, size_t* count)
+{
+    size_t capacity = 1024;
+    record_t* records = malloc(capacity * sizeof(record_t));
+    size_t offset = 0;
+    *count = 0;
+    while (records && offset + RECORD_HEADER_SIZE <= size)
+    {
+        record_t record = {
+            .timestamp = read_be32(data + offset),
+            .rssi = (int16_t)read_be16(data + offset + 4),
+            .flags = data[offset + 6],
+            .length = read_be16(data + offset + 7),
+            .raw = data + offset + RECORD_HEADER_SIZE,
+        };
+
+        offset += RECORD_HEADER_SIZE + record.length;
+        if (offset > size)
+        {
+            fprintf(stderr, "truncated record at the end of the capture, ignored\n");
+            break;
+        }
+
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            records = realloc(records, capacity * sizeof(record_t));
+            if (!records)
+                break;
+        }
+
+        records[(*count)++] = record;
+    }
+
+    return records;
+}
+
+static bool alloc_columns(columns_t* columns, size_t count)
+{
+    memset(columns, 0, sizeof(columns_t));
+#define COLUMN_ALLOC(type, name, value) columns->name = malloc((count ? count : 1) * sizeof(type));
+    COLUMNS(COLUMN_ALLOC)
+    columns->payload = malloc((count ? count : 1) * MAX_PAYLOAD_SIZE);
+
+#define COLUMN_CHECK(type, name, value) || !columns->name
+    return !(!columns->payload COLUMNS(COLUMN_CHECK));
+}
+
+static void free_columns(columns_t* columns)
+{
+#define COLUMN_FREE(type, name, value) free(columns->name);
+    COLUMNS(COLUMN_FREE)
+    free(columns->payload);
+}
+
+static void* decode_records(void* arg)
+{
+    worker_t* worker = arg;
+    frame_decoder_t* decoder = malloc(sizeof(frame_decoder_t));
+    packet_t* packet = malloc(sizeof(packet_t));
+    assert(decoder && packet);
+
+    frame_decoder_init(decoder, worker->key);
+    for (size_t i = worker->first; i < worker->first + worker->count; i++)
+    {
+        const record_t* record = &worker->records[i];
+        memset(packet, 0, offsetof(packet_t, phy_config));
+
+        uint8_t status = frame_decoder_decode(decoder, record->raw, record->length,
+                                              (record->flags & RECORD_FLAG_FEC) ? PHY_CODING_FEC_PN9 : PHY_CODING_PN9,
+                                              record->flags & RECORD_FLAG_BACKGROUND,
+                                              !(record->flags & RECORD_FLAG_RESPONSE), packet);
+        if (status != FRAME_DECODER_OK)
+            packet->payload_length = 0;
+
+        uint64_t origin_access_id = 0;
+        for (int j = 0; j < sizeof(packet->origin_access_id); j++)
+            origin_access_id = (origin_access_id << 8) | packet->origin_access_id[j];
+
+#define COLUMN_STORE(type, name, value) worker->columns->name[i] = (value);
+        COLUMNS(COLUMN_STORE)
+        memcpy(worker->columns->payload + i * MAX_PAYLOAD_SIZE, packet_get_payload(packet), packet->payload_length);
+    }
+
+    free(packet);
+    free(decoder);
+    return NULL;
+}
+
+static bool decode_capture(const record_t* records, size_t count, int thread_count, const uint8_t* key,
+                           columns_t* columns)
+{
+    worker_t workers[thread_count];
+    size_t first = 0;
+    for (int i = 0; i < thread_count; i++)
+    {
+        workers[i].records = records;
+        workers[i].first = first;
+        workers[i].count = count / thread_count + (i < count % thread_count);
+        workers[i].key = key;
+        workers[i].columns = columns;
+        first += workers[i].count;
+        if (pthread_create(&workers[i].thread, NULL, decode_records, &workers[i]) != 0)
+        {
+            fprintf(stderr, "could not create thread: %s\n", strerror(errno));
+            for (int j = 0; j < i; j++)
+                pthread_join(workers[j].thread, NULL);
+
+            return false;
+        }
+    }
+
+    for (int i = 0; i < thread_count; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    return true;
+}
+
+static bool write_column(const char* dir, const char* name, const void* data, size_t size)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s.bin", dir, name);
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "could not open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    bool success = fwrite(data, 1, size, file) == size;
+    fclose(file);
+    return success;
+}
+
+static bool write_columns(const char* dir, const columns_t* columns, size_t count)
+{
+    mkdir(dir, 0777);
+#define COLUMN_WRITE(type, name, value)                                                                                \
+    if (!write_column(dir, #name, columns->name, count * sizeof(type)))                                               \
+        return false;
+    COLUMNS(COLUMN_WRITE)
+
+    uint32_t* offsets = malloc((count ? count : 1) * sizeof(uint32_t));
+    uint8_t* payload = malloc((count ? count : 1) * MAX_PAYLOAD_SIZE);
+    uint32_t payload_size = 0;
+    bool success = offsets && payload;
+    for (size_t i = 0; success && i < count; i++)
+    {
+        offsets[i] = payload_size;
+        memcpy(payload + payload_size, columns->payload + i * MAX_PAYLOAD_SIZE, columns->payload_length[i]);
+        payload_size += columns->payload_length[i];
+    }
+
+    success = success && write_column(dir, "payload_offset", offsets, count * sizeof(uint32_t))
+        && write_column(dir, "payload", payload, payload_size);
+    free(offsets);
+    free(payload);
+    return success;
+}
+
+static double get_time()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void benchmark(const record_t* records, size_t count, const uint8_t* key, int max_thread_count)
+{
+    columns_t columns;
+    if (!alloc_columns(&columns, count))
+    {
+        fprintf(stderr, "out of memory\n");
+        return;
+    }
+
+    double single_thread_rate = 0;
+    for (int thread_count = 1; thread_count <= max_thread_count; thread_count *= 2)
+    {
+        // finish with the maximum when it is not a power of 2
+        if (thread_count * 2 > max_thread_count)
+            thread_count = max_thread_count;
+
+        double start = get_time();
+        if (!decode_capture(records, count, thread_count, key, &columns))
+            break;
+
+        double rate = count / (get_time() - start);
+        if (thread_count == 1)
+            single_thread_rate = rate;
+
+        printf("%2d threads: %10.0f frames/s (x%.2f)\n", thread_count, rate, rate / single_thread_rate);
+    }
+
+    free_columns(&columns);
+}
+
+// writes a capture of random foreground requests and responses, a third of them FEC encoded
+static bool generate_capture(const char* path, size_t count)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    static packet_t packet;
+    static d7ap_addressee_t addressee = { .ctrl.id_type = ID_TYPE_UID };
+    uint8_t frame[255];
+    uint8_t raw[RECORD_HEADER_SIZE + 2 * FEC_BUFFER_SIZE];
+    srand(0);
+    for (size_t i = 0; i < count; i++)
+    {
+        bool is_request = rand() % 2;
+        bool fec = rand() % 3 == 0;
+        memset(&packet, 0, sizeof(packet_t));
+        packet.d7anp_addressee = &addressee;
+        packet.dll_header.subnet = 0x05;
+        packet.dll_header.control_target_id_type = ID_TYPE_UID;
+        packet.d7anp_ctrl.origin_id_type = ID_TYPE_UID;
+        for (int j = 0; j < sizeof(packet.origin_access_id); j++)
+            packet.origin_access_id[j] = addressee.id[j] = rand();
+
+        packet.d7atp_ctrl.ctrl_is_ack_requested = is_request;
+        packet.d7atp_dialog_id = rand();
+        packet.d7atp_transaction_id = rand();
+
+        uint8_t* data = frame + 1;
+        data += packet_codec_encode_dll_header(&packet, false, data, 32);
+        data += packet_codec_encode_d7anp_header(&packet, data, 32);
+        data += packet_codec_encode_d7atp_header(&packet, is_request, data, 32);
+        uint8_t payload_length = 8 + rand() % 64;
+        for (int j = 0; j < payload_length; j++)
+            *data++ = rand();
+
+        uint16_t length = data - frame + 2;
+        frame[0] = length - 1;
+        uint16_t crc = __builtin_bswap16(crc_calculate(frame, length - 2));
+        memcpy(data, &crc, 2);
+
+        uint8_t* encoded = raw + RECORD_HEADER_SIZE;
+        memcpy(encoded, frame, length);
+        if (fec)
+            length = fec_encode(encoded, length);
+
+        pn9_encode(encoded, length);
+
+        uint32_t timestamp = i * 100;
+        int16_t rssi = -40 - rand() % 60;
+        raw[0] = timestamp >> 24;
+        raw[1] = timestamp >> 16;
+        raw[2] = timestamp >> 8;
+        raw[3] = timestamp;
+        raw[4] = (uint16_t)rssi >> 8;
+        raw[5] = rssi;
+        raw[6] = (fec ? RECORD_FLAG_FEC : 0) | (is_request ? 0 : RECORD_FLAG_RESPONSE);
+        raw[7] = length >> 8;
+        raw[8] = length;
+        if (fwrite(raw, 1, RECORD_HEADER_SIZE + length, file) != RECORD_HEADER_SIZE + length)
+        {
+            fclose(file);
+            return false;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+static bool parse_key(const char* hex, uint8_t* key)
+{
+    if (strlen(hex) != 2 * AES_BLOCK_SIZE)
+        return false;
+
+    for (int i = 0; i < AES_BLOCK_SIZE; i++)
+    {
+        unsigned int byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1)
+            return false;
+
+        key[i] = byte;
+    }
+
+    return true;
+}
+
+static int usage(const char* name)
+{
+    fprintf(stderr, "usage: %s [-t threads] [-k key] <capture> <output dir>\n"
+                    "       %s --benchmark [-t threads] [-k key] <capture>\n"
+                    "       %s --generate <frame count> <capture>\n"
+                    "the key is the 128 bit NLS key in hexadecimal\n", name, name, name);
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    int thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    uint8_t key_buffer[AES_BLOCK_SIZE];
+    const uint8_t* key = NULL;
+    bool run_benchmark = false;
+    const char* args[2];
+    int arg_count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--generate") == 0 && i + 2 < argc)
+            return generate_capture(argv[i + 2], strtoul(argv[i + 1], NULL, 0)) ? 0 : 1;
+        else if (strcmp(argv[i], "--benchmark") == 0)
+            run_benchmark = true;
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            thread_count = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+        {
+            if (!parse_key(argv[++i], key_buffer))
+                return usage(argv[0]);
+
+            key = key_buffer;
+        }
+        else if (arg_count < 2)
+            args[arg_count++] = argv[i];
+        else
+            return usage(argv[0]);
+    }
+
+    if (thread_count < 1 || arg_count != (run_benchmark ? 1 : 2))
+        return usage(argv[0]);
+
+    size_t size;
+    uint8_t* capture = read_file(args[0], &size);
+    if (!capture)
+    {
+        fprintf(stderr, "could not read %s\n", args[0]);
+        return 1;
+    }
+
+    size_t count;
+    record_t* records = index_capture(capture, size, &count);
+    if (!records)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    int result = 0;
+    if (run_benchmark)
+        benchmark(records, count, key, thread_count);
+    else
+    {
+        columns_t columns;
+        if (!alloc_columns(&columns, count) || !decode_capture(records, count, thread_count, key, &columns)
+            || !write_columns(args[1], &columns, count))
+            result = 1;
+        else
+        {
+            size_t decoded = 0;
+            for (size_t i = 0; i < count; i++)
+                decoded += columns.status[i] == FRAME_DECODER_OK;
+
+            printf("%zu frames, %zu decoded successfully\n", count, decoded);
+        }
+
+        free_columns(&columns);
+    }
+
+    free(records);
+    free(capture);
+    return result;
+}
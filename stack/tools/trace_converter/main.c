@@ -0,0 +1,239 @@
+/* * OSS-7 - An opensource implementation of the DASH7 Alliance Protocol for ultra
+ * lowpower wireless sensor communication
+ *
+ * Copyright 2015 University of Antwerp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Converts a trace recorded using FRAMEWORK_TRACE_ENABLED (see trace.h) to the Chrome trace event JSON format, which
+ * can be opened in chrome://tracing or https://ui.perfetto.dev
+ * The input is either the file written on the NATIVE platform, or a memory dump of the trace_buffer ring buffer.
+ *
+ * Every source of events is shown as a separate thread:
+ *   scheduler: a slice per task, named after the task address (resolve it using the map file or addr2line)
+ *   timer: an instant event per timer which fired, at the moment its task was posted
+ *   phy: a slice per phy state
+ *   radio: an instant event per transmitted or received packet
+ *   alp: an async slice per ALP command, from the moment it is processed until it is freed
+ *
+ * Usage:
+ *   trace_converter <trace> [<output json>]
+ */
+
+#include "trace.h"
+
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+enum {
+    THREAD_SCHEDULER = 1,
+    THREAD_TIMER,
+    THREAD_PHY,
+    THREAD_RADIO,
+    THREAD_ALP,
+};
+
+// in the order of state_t in phy.c
+static const char* phy_state_names[] = { "idle", "tx", "rx", "bg scan", "cont tx", "cont rx" };
+
+typedef struct {
+    FILE* out;
+    bool first_event;
+    uint64_t ticks_per_sec;
+    uint64_t timestamp_offset; // added to the 32 bit timestamps, to unwrap them
+    uint32_t previous_timestamp;
+    bool timestamp_seen;
+    uint64_t start_timestamp;
+    int phy_state; // -1 as long as no state change was seen
+    bool alp_command_active[256];
+    uint8_t alp_command_tag_id[256];
+} converter_t;
+
+static void print_event_prefix(converter_t* converter, const char* name, const char* phase, int thread,
+    double timestamp_us)
+{
+    fprintf(converter->out, "%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"pid\":1,\"tid\":%i,\"ts\":%.3f",
+        converter->first_event ? "" : ",", name, phase, thread, timestamp_us);
+    converter->first_event = false;
+}
+
+static void print_thread_name(converter_t* converter, int thread, const char* name)
+{
+    print_event_prefix(converter, "thread_name", "M", thread, 0);
+    fprintf(converter->out, ",\"args\":{\"name\":\"%s\"}}", name);
+}
+
+static double get_timestamp_us(converter_t* converter, uint32_t timestamp)
+{
+    if (converter->timestamp_seen && timestamp < converter->previous_timestamp)
+        converter->timestamp_offset += 1ULL << 32;
+
+    uint64_t unwrapped = converter->timestamp_offset + timestamp;
+    if (!converter->timestamp_seen)
+        converter->start_timestamp = unwrapped;
+
+    converter->timestamp_seen = true;
+    converter->previous_timestamp = timestamp;
+    return (double)(unwrapped - converter->start_timestamp) * 1000000.0 / converter->ticks_per_sec;
+}
+
+static void convert_event(converter_t* converter, const trace_event_t* event)
+{
+    char name[32];
+    double ts = get_timestamp_us(converter, event->timestamp);
+    switch (event->type) {
+    case TRACE_TASK_START:
+    case TRACE_TASK_STOP:
+        snprintf(name, sizeof(name), "task 0x%08x", event->value);
+        print_event_prefix(converter, name, event->type == TRACE_TASK_START ? "B" : "E", THREAD_SCHEDULER, ts);
+        fprintf(converter->out, ",\"args\":{\"priority\":%u}}", event->id);
+        break;
+    case TRACE_TIMER_FIRED:
+        snprintf(name, sizeof(name), "timer 0x%08x", event->value);
+        print_event_prefix(converter, name, "i", THREAD_TIMER, ts);
+        fprintf(converter->out, ",\"s\":\"t\",\"args\":{\"priority\":%u}}", event->id);
+        break;
+    case TRACE_PHY_STATE:
+        if (converter->phy_state >= 0) {
+            print_event_prefix(converter, phy_state_names[converter->phy_state], "E", THREAD_PHY, ts);
+            fprintf(converter->out, "}");
+        }
+
+        if (event->id >= sizeof(phy_state_names) / sizeof(phy_state_names[0])) {
+            fprintf(stderr, "Skipping unknown phy state %u\n", event->id);
+            converter->phy_state = -1;
+            break;
+        }
+
+        converter->phy_state = event->id;
+        print_event_prefix(converter, phy_state_names[event->id], "B", THREAD_PHY, ts);
+        fprintf(converter->out, "}");
+        break;
+    case TRACE_PACKET_RX:
+    case TRACE_PACKET_TX:
+        print_event_prefix(converter, event->type == TRACE_PACKET_RX ? "rx" : "tx", "i", THREAD_RADIO, ts);
+        fprintf(converter->out, ",\"s\":\"t\",\"args\":{\"channel\":%u,\"length\":%u}}", event->id, event->value);
+        break;
+    case TRACE_ALP_COMMAND_BEGIN:
+    case TRACE_ALP_COMMAND_END:
+        // commands which are freed without being processed do not have a begin event
+        if (converter->alp_command_active[event->id]) {
+            snprintf(name, sizeof(name), "command tag %u", converter->alp_command_tag_id[event->id]);
+            print_event_prefix(converter, name, "e", THREAD_ALP, ts);
+            fprintf(converter->out, ",\"cat\":\"alp\",\"id\":%u}", event->id);
+            converter->alp_command_active[event->id] = false;
+        }
+
+        if (event->type == TRACE_ALP_COMMAND_BEGIN) {
+            snprintf(name, sizeof(name), "command tag %u", event->value & 0xFF);
+            print_event_prefix(converter, name, "b", THREAD_ALP, ts);
+            fprintf(converter->out, ",\"cat\":\"alp\",\"id\":%u}", event->id);
+            converter->alp_command_active[event->id] = true;
+            converter->alp_command_tag_id[event->id] = event->value;
+        }
+
+        break;
+    default:
+        fprintf(stderr, "Skipping unknown event type %u\n", event->type);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <trace> [<output json>]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    trace_header_t header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || header.magic != TRACE_MAGIC) {
+        fprintf(stderr, "%s is not a trace\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (header.version != TRACE_VERSION || header.event_size != sizeof(trace_event_t) || header.ticks_per_sec == 0) {
+        fprintf(stderr, "Unsupported trace version %u\n", header.version);
+        return EXIT_FAILURE;
+    }
+
+    // a ring buffer dump is read completely, once it wrapped the oldest event is at write_count % capacity
+    uint32_t event_count = 0;
+    uint32_t first_index = 0;
+    trace_event_t* events = NULL;
+    if (header.capacity > 0) {
+        events = malloc(header.capacity * sizeof(trace_event_t));
+        if (fread(events, sizeof(trace_event_t), header.capacity, in) != header.capacity) {
+            fprintf(stderr, "Truncated ring buffer dump\n");
+            return EXIT_FAILURE;
+        }
+
+        event_count = header.write_count < header.capacity ? header.write_count : header.capacity;
+        if (header.write_count > header.capacity)
+            first_index = header.write_count % header.capacity;
+    }
+
+    converter_t converter = {
+        .out = stdout,
+        .first_event = true,
+        .ticks_per_sec = header.ticks_per_sec,
+        .phy_state = -1,
+    };
+
+    if (argc == 3) {
+        converter.out = fopen(argv[2], "w");
+        if (converter.out == NULL) {
+            perror(argv[2]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fprintf(converter.out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    print_thread_name(&converter, THREAD_SCHEDULER, "scheduler");
+    print_thread_name(&converter, THREAD_TIMER, "timer");
+    print_thread_name(&converter, THREAD_PHY, "phy");
+    print_thread_name(&converter, THREAD_RADIO, "radio");
+    print_thread_name(&converter, THREAD_ALP, "alp");
+
+    uint32_t converted_count = 0;
+    if (events != NULL) {
+        for (uint32_t i = 0; i < event_count; i++)
+            convert_event(&converter, &events[(first_index + i) % header.capacity]);
+
+        converted_count = event_count;
+        free(events);
+    } else {
+        trace_event_t event;
+        while (fread(&event, sizeof(event), 1, in) == 1) {
+            convert_event(&converter, &event);
+            converted_count++;
+        }
+    }
+
+    fprintf(converter.out, "\n]}\n");
+    fclose(in);
+    if (converter.out != stdout)
+        fclose(converter.out);
+
+    fprintf(stderr, "Converted %u events\n", converted_count);
+    return EXIT_SUCCESS;
+}